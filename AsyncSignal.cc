@@ -0,0 +1,366 @@
+#include <longbeach/signals/AsyncSignal.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/core/LuaCodeGen.h>
+#include <longbeach/core/LuabindScripting.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
+#include <longbeach/signals/SignalBuilder.h>
+
+namespace longbeach {
+namespace signals {
+
+/************************************************************************************************/
+// AsyncSignalExecutor
+/************************************************************************************************/
+
+AsyncSignalExecutor::AsyncSignalExecutor(uint32_t spinsBeforeSleep, uint32_t idleSleepUs)
+    : m_spinsBeforeSleep(spinsBeforeSleep)
+    , m_idleSleepUs(idleSleepUs)
+    , m_removals(0)
+    , m_pBusy(NULL)
+    , m_bStop(false)
+    , m_numEvaluated(0)
+{
+    m_thread = boost::thread(boost::bind(&AsyncSignalExecutor::run, this));
+}
+
+AsyncSignalExecutor::~AsyncSignalExecutor()
+{
+    m_bStop.store(true, std::memory_order_relaxed);
+    m_thread.join();
+}
+
+const AsyncSignalExecutorPtr &AsyncSignalExecutor::getDefault()
+{
+    static const AsyncSignalExecutorPtr s_spDefault(new AsyncSignalExecutor());
+    return s_spDefault;
+}
+
+size_t AsyncSignalExecutor::getNumSignals() const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_signals.size();
+}
+
+void AsyncSignalExecutor::add(AsyncSignal *sig)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_signals.push_back(sig);
+}
+
+void AsyncSignalExecutor::remove(AsyncSignal *sig)
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_signals.erase(std::remove(m_signals.begin(), m_signals.end(), sig), m_signals.end());
+        m_removals.fetch_add(1, std::memory_order_seq_cst);
+    }
+    // the helper either sees the removal before it starts on sig, or has published that it is
+    // busy with it before we look (both sides are seq_cst), so this wait is enough
+    while(m_pBusy.load(std::memory_order_seq_cst) == sig)
+        boost::this_thread::yield();
+}
+
+void AsyncSignalExecutor::run()
+{
+    std::vector<AsyncSignal*> sweep;
+    uint32_t numIdle = 0;
+    while(!m_bStop.load(std::memory_order_relaxed))
+    {
+        uint64_t numEvaluated = 0;
+        uint64_t removals;
+        {
+            boost::mutex::scoped_lock lock(m_mutex);
+            sweep.assign(m_signals.begin(), m_signals.end());
+            removals = m_removals.load(std::memory_order_relaxed);
+        }
+        for(size_t i = 0; i < sweep.size(); ++i)
+        {
+            m_pBusy.store(sweep[i], std::memory_order_seq_cst);
+            if(m_removals.load(std::memory_order_seq_cst) != removals)
+            {
+                // sweep[i] may be gone; start again from the current list
+                m_pBusy.store(NULL, std::memory_order_release);
+                break;
+            }
+            numEvaluated += sweep[i]->evaluatePending();
+            m_pBusy.store(NULL, std::memory_order_release);
+        }
+        if(numEvaluated)
+        {
+            m_numEvaluated.fetch_add(numEvaluated, std::memory_order_relaxed);
+            numIdle = 0;
+        }
+        else if(numIdle < m_spinsBeforeSleep)
+        {
+            ++numIdle;
+            boost::this_thread::yield();
+        }
+        else
+            boost::this_thread::sleep_for(boost::chrono::microseconds(m_idleSleepUs));
+    }
+}
+
+/************************************************************************************************/
+// AsyncSignal
+/************************************************************************************************/
+
+AsyncSignal::AsyncSignal(ClockMonitor *cm,
+        ISignalPtr subSignal,
+        AsyncSignalExecutorPtr executor,
+        const ptime_duration_t &pollInterval,
+        const ptime_duration_t &pollOffset,
+        uint32_t priority)
+    : PeriodicWakeup(cm, pollInterval, pollOffset, priority, false)
+    , m_subSignal(subSignal)
+    , m_pSubNode(dynamic_cast<EvalEngineNode*>(subSignal.get()))
+    , m_pEvaluable(dynamic_cast<const IAsyncEvaluable*>(subSignal.get()))
+    , m_spExecutor(executor)
+    , m_stateSize(subSignal->getStateSize())
+    , m_isOK(false)
+    , m_state(m_stateSize, 0.0)
+    , m_discardThroughSeq(0)
+    , m_spInputs(new LatestValueMailbox<PostedInput>())
+    , m_spResults(new LatestValueMailbox<Result>())
+{
+    if(!m_spExecutor)
+        LONGBEACH_THROW_ERROR_SS("AsyncSignal " << subSignal->getDesc() << ": Bad AsyncSignalExecutor");
+    if(!m_pEvaluable)
+        LONGBEACH_THROW_ERROR_SS("AsyncSignal " << subSignal->getDesc() << ": signal cannot be evaluated asynchronously");
+    if(!m_pSubNode)
+        LONGBEACH_THROW_ERROR_SS("AsyncSignal " << subSignal->getDesc() << ": signal cannot be observed");
+
+    if(pollInterval.ticks() != 0)
+        startPeriodicWakeup();
+    m_pSubNode->addNotificationObserver(this);
+    addEvalUpstream(subSignal.get());
+    m_spExecutor->add(this);
+}
+
+AsyncSignal::~AsyncSignal()
+{
+    m_pSubNode->removeNotificationObserver(this);
+    m_spExecutor->remove(this);
+}
+
+void AsyncSignal::onSignalNotified(const ISignal *sig, const timeval_t &tv)
+{
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("AsyncSignal", "onSignalNotified", CYCLES_INPUT);
+    collect();
+
+    PostedInput &posted = m_spInputs->writeSlot();
+    posted.input.tv = tv;
+    if(!m_pEvaluable->captureAsyncInput(posted.input))
+    {
+        // whatever the helper is working on was captured while the signal was still OK
+        m_discardThroughSeq = m_stats.numPosted;
+        if(m_isOK)
+        {
+            m_isOK = false;
+            m_state.assign(m_stateSize, 0.0);
+            m_lastChangeTime = tv;
+            notify(tv);
+        }
+        return;
+    }
+    posted.seq = ++m_stats.numPosted;
+    posted.postNs = SignalLatencyProfiler::now();
+    if(m_spInputs->publish())
+        ++m_stats.numOverwritten;
+}
+
+void AsyncSignal::onPeriodicWakeup(const timeval_t &ctv, const timeval_t &swtv)
+{
+    LONGBEACH_TIME_SIGNAL_HANDLER("AsyncSignal", "onPeriodicWakeup");
+    collect();
+}
+
+void AsyncSignal::collect()
+{
+    if(!m_spResults->take())
+        return;
+    const Result &r = m_spResults->readSlot();
+    if(r.seq <= m_discardThroughSeq)
+    {
+        ++m_stats.numDiscarded;
+        return;
+    }
+    ++m_stats.numCollected;
+    m_stats.lastInputsBehind = m_stats.numPosted - r.seq;
+    m_stats.maxInputsBehind = std::max(m_stats.maxInputsBehind, m_stats.lastInputsBehind);
+    m_postToCollectNs.record(SignalLatencyProfiler::now() - r.postNs);
+
+    if(r.isOK == m_isOK && r.state == m_state)
+        return;
+    m_isOK = r.isOK;
+    m_state = r.state;
+    m_lastChangeTime = r.tv;
+    notify(r.tv);
+}
+
+void AsyncSignal::notify(const timeval_t &tv)
+{
+    if(!deferNotification(tv))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
+}
+
+bool AsyncSignal::evaluatePending()
+{
+    if(!m_spInputs->take())
+        return false;
+    const PostedInput &posted = m_spInputs->readSlot();
+    Result &r = m_spResults->writeSlot();
+    r.seq = posted.seq;
+    r.postNs = posted.postNs;
+    r.tv = posted.input.tv;
+    r.state.assign(m_stateSize, 0.0);
+    r.isOK = m_pEvaluable->evalAsync(posted.input, r.state);
+    m_spResults->publish();
+    return true;
+}
+
+void AsyncSignal::printStats(std::ostream &o) const
+{
+    o << getDesc() << ": posted " << m_stats.numPosted
+      << ", overwritten " << m_stats.numOverwritten
+      << ", collected " << m_stats.numCollected
+      << ", discarded " << m_stats.numDiscarded
+      << ", inputs behind " << m_stats.lastInputsBehind << " (max " << m_stats.maxInputsBehind << ")" << std::endl;
+    m_postToCollectNs.print(o, getDesc() + " post to collect ns");
+}
+
+/************************************************************************************************/
+// AsyncSignalSpec
+/************************************************************************************************/
+
+AsyncSignalSpec::AsyncSignalSpec(const AsyncSignalSpec &e)
+    : m_subSignal(ISignalSpec::clone(e.m_subSignal))
+    , m_pollInterval(e.m_pollInterval)
+    , m_pollOffset(e.m_pollOffset)
+    , m_pollPriority(e.m_pollPriority)
+{
+}
+
+ISignalPtr AsyncSignalSpec::build(SignalBuilder *builder) const
+{
+    LONGBEACH_PROFILE_BUILD_SCOPE("AsyncSignalSpec", "build", getDescription());
+    ISignalPtr subSignal = builder->buildSignal(m_subSignal);
+
+    LONGBEACH_PROFILE_BUILD_SCOPE("AsyncSignal", "construct", getDescription());
+    return makeSignalObject<AsyncSignal>(
+            builder->getClockMonitor().get(),
+            subSignal,
+            AsyncSignalExecutor::getDefault(),
+            m_pollInterval,
+            m_pollOffset,
+            m_pollPriority);
+}
+
+void AsyncSignalSpec::checkValid() const
+{
+    LONGBEACH_PROFILE_BUILD_SCOPE("AsyncSignalSpec", "checkValid", getDescription());
+    ISignalSpec::checkValid();
+    if(!m_subSignal)
+        LONGBEACH_THROW_ERROR_SS("AsyncSignalSpec: subSignal is null");
+    m_subSignal->checkValid();
+    if(m_pollInterval.is_negative())
+        LONGBEACH_THROW_ERROR_SS("AsyncSignal " << m_subSignal->getDescription() << ": poll interval is negative");
+    cacheHash();
+}
+
+AsyncSignalSpec *AsyncSignalSpec::clone() const
+{
+    return new AsyncSignalSpec(*this);
+}
+
+void AsyncSignalSpec::hashCombine(size_t &result) const
+{
+    boost::hash_combine(result, specHash());
+}
+
+void AsyncSignalSpec::hashMembers(size_t &seed) const
+{
+    boost::hash_combine(seed, *m_subSignal);
+    boost::hash_combine(seed, m_pollInterval);
+    boost::hash_combine(seed, m_pollOffset);
+    boost::hash_combine(seed, m_pollPriority);
+}
+
+bool AsyncSignalSpec::compare(const ISignalSpec *other) const
+{
+    if(fastReject(other)) return false;
+    const AsyncSignalSpec *b = dynamic_cast<const AsyncSignalSpec*>(other);
+    if(!b) return false;
+    if(*this->m_subSignal != *b->m_subSignal) return false;
+    if(this->m_pollInterval != b->m_pollInterval) return false;
+    if(this->m_pollOffset != b->m_pollOffset) return false;
+    if(this->m_pollPriority != b->m_pollPriority) return false;
+    return true;
+}
+
+void AsyncSignalSpec::print(std::ostream &o, const LuaPrintSettings &ps) const
+{
+    const LuaPrintSettings onei = ps.next(); // indentation one past current
+
+    o << "(function () -- AsyncSignalSpec" << std::endl
+      << onei.indent() << "local as = AsyncSignalSpec()" << std::endl
+      << onei.indent() << "as.subSignal = " << luaMode(*m_subSignal, onei) << std::endl
+      << onei.indent() << "as.pollInterval = " << luaMode(m_pollInterval, onei) << std::endl
+      << onei.indent() << "as.pollOffset = " << luaMode(m_pollOffset, onei) << std::endl
+      << onei.indent() << "as.pollPriority = " << luaMode(m_pollPriority, onei) << std::endl
+      << onei.indent() << "return as" << std::endl
+      << onei.indent() << "end)()";
+}
+
+void AsyncSignalSpec::getDataRequirements(IDataRequirements *rqs) const
+{
+    LONGBEACH_PROFILE_BUILD_SCOPE("AsyncSignalSpec", "getDataRequirements", getDescription());
+    m_subSignal->getDataRequirements(rqs);
+}
+
+void AsyncSignalSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSpec(m_subSignal);
+    ar.write(m_pollInterval);
+    ar.write(m_pollOffset);
+    ar.write(m_pollPriority);
+}
+
+void AsyncSignalSpec::readBinary(SpecInArchive &ar)
+{
+    m_subSignal = ar.readSpec();
+    ar.read(m_pollInterval);
+    ar.read(m_pollOffset);
+    ar.read(m_pollPriority);
+}
+
+bool AsyncSignalSpec::registerScripting(lua_State &state)
+{
+    // each Spec class must be added to registerScripting in Signals_Scripting.cc
+    luabind::module( &state )
+    [
+        luabind::class_<AsyncSignalSpec, ISignalSpec, ISignalSpecPtr>("AsyncSignalSpec")
+            .def( luabind::constructor<>() )
+            .property("subSignal",
+                      &AsyncSignalSpec::__get_signal_spec,
+                      &AsyncSignalSpec::__set_signal_spec)
+            .def_readwrite("pollInterval", &AsyncSignalSpec::m_pollInterval)
+            .def_readwrite("pollOffset",   &AsyncSignalSpec::m_pollOffset)
+            .def_readwrite("pollPriority", &AsyncSignalSpec::m_pollPriority)
+    ];
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,255 @@
+#ifndef LONGBEACH_SIGNALS_ASYNCSIGNAL_H
+#define LONGBEACH_SIGNALS_ASYNCSIGNAL_H
+
+#include <atomic>
+#include <iosfwd>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/core/ptime.h>
+
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/ShardQueue.h>
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/clientcore/PeriodicWakeup.h>
+
+namespace longbeach {
+namespace signals {
+
+class AsyncSignal;
+
+/// What a signal hands to its helper thread: everything its state is computed from, flattened.
+struct AsyncSignalInput
+{
+    timeval_t tv;                   // of the notification it was captured at
+    std::vector<double> values;     // layout is up to the signal
+};
+
+/// Implemented by signals whose state can be computed away from the event thread, from a
+/// snapshot of their inputs (see AsyncSignal).
+class IAsyncEvaluable
+{
+public:
+    virtual ~IAsyncEvaluable() {}
+
+    /// Event thread, on each notification.  Copies the inputs into in.values, reusing its
+    /// buffer; must be much cheaper than the computation itself.  Returns false if the signal
+    /// is not OK, in which case nothing is evaluated.
+    virtual bool captureAsyncInput(AsyncSignalInput &in) const = 0;
+
+    /// Helper thread.  Computes the state from in alone into state, which is already sized to
+    /// getStateSize(), and returns isOK.  Runs concurrently with the event thread, so it may
+    /// read nothing of the signal but what is fixed at construction.
+    virtual bool evalAsync(const AsyncSignalInput &in, std::vector<double> &state) const = 0;
+};
+
+/// One helper thread evaluating the pending inputs of any number of AsyncSignals.
+///
+/// The thread sweeps its signals, evaluating each one that has a new input, and spins while
+/// there is work; after spinsBeforeSleep empty sweeps it sleeps idleSleepUs between sweeps.
+/// It copies the list under its lock and evaluates outside it, so the lock is only held
+/// briefly by signals being added or removed and by the start of a sweep, never by the event
+/// thread posting inputs or collecting results.
+class AsyncSignalExecutor : private boost::noncopyable
+{
+public:
+    explicit AsyncSignalExecutor(uint32_t spinsBeforeSleep = 1000, uint32_t idleSleepUs = 50);
+    ~AsyncSignalExecutor();
+
+    /// The executor AsyncSignalSpec builds with, started on first use.
+    static const boost::shared_ptr<AsyncSignalExecutor> &getDefault();
+
+    size_t getNumSignals() const;
+
+    /// Evaluations done so far, by all signals.
+    uint64_t getNumEvaluated() const { return m_numEvaluated.load(std::memory_order_relaxed); }
+
+private:
+    friend class AsyncSignal;
+
+    /// Removing waits only while the helper thread is evaluating that very signal, after which
+    /// it no longer touches it.
+    void add(AsyncSignal *sig);
+    void remove(AsyncSignal *sig);
+
+    void run();
+
+    uint32_t m_spinsBeforeSleep;
+    uint32_t m_idleSleepUs;
+    mutable boost::mutex m_mutex;
+    std::vector<AsyncSignal*> m_signals;
+    std::atomic<uint64_t> m_removals;   // bumped by every remove(); a sweep stops when it moves
+    std::atomic<AsyncSignal*> m_pBusy;  // the signal the helper is evaluating, if any
+    std::atomic<bool> m_bStop;
+    std::atomic<uint64_t> m_numEvaluated;
+    boost::thread m_thread;
+};
+LONGBEACH_DECLARE_SHARED_PTR(AsyncSignalExecutor);
+
+/// Counters of an AsyncSignal, all kept on the event thread.
+struct AsyncSignalStats
+{
+    AsyncSignalStats() : numPosted(0), numOverwritten(0), numCollected(0), numDiscarded(0)
+        , lastInputsBehind(0), maxInputsBehind(0) {}
+
+    uint64_t numPosted;         // inputs handed to the helper
+    uint64_t numOverwritten;    // inputs replaced by a newer one before the helper took them
+    uint64_t numCollected;      // results taken into the state
+    uint64_t numDiscarded;      // results dropped because the signal went not OK after their input
+    uint64_t lastInputsBehind;  // inputs posted after the one the current state comes from
+    uint64_t maxInputsBehind;
+};
+
+/// Evaluates an expensive signal on a helper thread, keeping only the latest value.
+///
+/// On each notification of the wrapped signal, the event thread captures its inputs
+/// (IAsyncEvaluable::captureAsyncInput) into a LatestValueMailbox, replacing any input the
+/// helper has not started on, and the helper posts the state it computes into a second
+/// mailbox.  Results are taken on the event thread at the wrapped signal's next notification,
+/// or at the next poll if a poll interval is set, and the wrapper notifies if the state
+/// changed.  The event thread never waits: in exchange the state lags the inputs by one
+/// evaluation at least, which getStats and getPostToCollectNs measure.
+///
+/// Only for signals whose listeners want the freshest value and can skip intermediate ones;
+/// the wrapped signal should have no other listeners, or its state is computed on the event
+/// thread as well.
+class AsyncSignal
+    : public SignalImpl
+    , public EvalEngineNode
+    , public PeriodicWakeup
+    , private IEvalNotificationObserver
+{
+public:
+    /// A zero pollInterval collects results only when the wrapped signal notifies.
+    AsyncSignal(ClockMonitor *cm, ISignalPtr subSignal, AsyncSignalExecutorPtr executor,
+            const ptime_duration_t &pollInterval, const ptime_duration_t &pollOffset, uint32_t priority);
+    virtual ~AsyncSignal();
+
+    virtual const instrument_t& getInstrument() const
+        { return m_subSignal->getInstrument(); }
+    virtual const std::string& getDesc() const
+        { return m_subSignal->getDesc(); }
+
+    virtual size_t getStateSize() const
+        { return m_subSignal->getStateSize(); }
+    virtual const std::vector<std::string>& getStateNames() const
+        { return m_subSignal->getStateNames(); }
+
+    /// Not OK as soon as the wrapped signal is not, even before the helper has caught up.
+    virtual bool isOK() const
+        { return m_isOK && m_subSignal->isOK(); }
+    virtual const std::vector<double>& getSignalState() const
+        { return m_state; }
+
+    /// tv of the notification whose inputs the current state was computed from.
+    virtual longbeach::timeval_t getLastChangeTv() const { return m_lastChangeTime; }
+
+    const AsyncSignalStats &getStats() const { return m_stats; }
+
+    /// Nanoseconds from posting an input to taking its result, per result taken.
+    const LatencyHistogram &getPostToCollectNs() const { return m_postToCollectNs; }
+
+    void printStats(std::ostream &o) const;
+
+protected:
+    void onPeriodicWakeup(const timeval_t &ctv, const timeval_t &swtv);
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
+
+private:
+    friend class AsyncSignalExecutor;
+
+    struct PostedInput
+    {
+        uint64_t seq;
+        uint64_t postNs;
+        AsyncSignalInput input;
+    };
+
+    struct Result
+    {
+        uint64_t seq;
+        uint64_t postNs;
+        timeval_t tv;
+        bool isOK;
+        std::vector<double> state;
+    };
+
+    virtual void onSignalNotified(const ISignal *sig, const timeval_t &tv);
+
+    /// Event thread: takes the latest result, if any, and notifies if the state changed.
+    void collect();
+    void notify(const timeval_t &tv);
+
+    /// Helper thread: evaluates the latest input, if any.  Returns whether there was one.
+    bool evaluatePending();
+
+    ISignalPtr m_subSignal;
+    EvalEngineNode *m_pSubNode;
+    const IAsyncEvaluable *m_pEvaluable;
+    AsyncSignalExecutorPtr m_spExecutor;
+    size_t m_stateSize;
+
+    bool m_isOK;
+    std::vector<double> m_state;
+    longbeach::timeval_t m_lastChangeTime;
+    uint64_t m_discardThroughSeq;   // results of inputs up to this one are stale
+
+    boost::scoped_ptr<LatestValueMailbox<PostedInput> > m_spInputs;    // event thread -> helper
+    boost::scoped_ptr<LatestValueMailbox<Result> > m_spResults;        // helper -> event thread
+
+    AsyncSignalStats m_stats;
+    LatencyHistogram m_postToCollectNs;
+};
+LONGBEACH_DECLARE_SHARED_PTR(AsyncSignal);
+
+/// AsyncSignalSpec
+class AsyncSignalSpec
+    : public ISignalSpec
+    , public SpecHashCache<AsyncSignalSpec>
+    , public IBinarySpec
+{
+public:
+    LONGBEACH_DECLARE_SCRIPTING();
+
+    AsyncSignalSpec() : m_pollPriority(0) {}
+    AsyncSignalSpec(const AsyncSignalSpec &e);
+
+    virtual ISignalPtr build(SignalBuilder *builder) const;
+    virtual void checkValid() const;
+    virtual void hashCombine(size_t &result) const;
+    virtual bool compare(const ISignalSpec *other) const;
+    virtual void print(std::ostream &o, const LuaPrintSettings &ps) const;
+    virtual void getDataRequirements(IDataRequirements *rqs) const;
+    virtual AsyncSignalSpec *clone() const;
+
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "AsyncSignalSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
+    virtual instrument_t getInstrument() const { return m_subSignal->getInstrument(); }
+    virtual std::string getDescription() const { return m_subSignal->getDescription(); }
+
+    ISignalSpecCPtr __get_signal_spec() const { return m_subSignal; }
+    void            __set_signal_spec(ISignalSpecPtr p) { m_subSignal = p; }
+
+    ISignalSpecCPtr m_subSignal;
+    ptime_duration_t m_pollInterval, m_pollOffset;
+    uint32_t m_pollPriority;
+};
+LONGBEACH_DECLARE_SHARED_PTR(AsyncSignalSpec);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_ASYNCSIGNAL_H
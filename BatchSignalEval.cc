@@ -0,0 +1,490 @@
+#include <longbeach/signals/BatchSignalEval.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <math.h>
+
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SigMACD.h>
+
+namespace longbeach {
+namespace signals {
+
+void ColumnarBookHistory::resize(size_t rows, size_t levels)
+{
+    numRows = rows;
+    numLevels = levels;
+    times.resize(rows);
+    midPx.resize(rows);
+    bookOK.resize(rows, 1);
+    bidPxs.resize(rows * levels);
+    bidSzs.resize(rows * levels);
+    askPxs.resize(rows * levels);
+    askSzs.resize(rows * levels);
+}
+
+void ColumnarPriceSeries::resize(size_t rows)
+{
+    numRows = rows;
+    times.resize(rows);
+    px.resize(rows);
+    pxOK.resize(rows, 1);
+}
+
+void BatchSignalOutput::init(const std::vector<std::string> &stateNames, size_t rows)
+{
+    names = stateNames;
+    numRows = rows;
+    values.assign(names.size() * rows, 0.0);
+    ok.assign(rows, 0);
+}
+
+namespace {
+
+std::vector<size_t> blockStarts(size_t numRows)
+{
+    std::vector<size_t> starts;
+    for(size_t r = 0; r < numRows; r += BatchSignalEval::BlockRows)
+        starts.push_back(r);
+    return starts;
+}
+
+std::vector<size_t> dayStarts(const ColumnarBookHistory &book)
+{
+    if(book.dayStarts.empty())
+        return std::vector<size_t>(1, 0);
+    return book.dayStarts;
+}
+
+void checkBook(const char *who, const ColumnarBookHistory &book, size_t numLevels)
+{
+    if(book.numLevels < numLevels)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::" << who << ": history has " << book.numLevels
+            << " levels, signal needs " << numLevels);
+    if(book.times.size() != book.numRows || book.midPx.size() != book.numRows || book.bookOK.size() != book.numRows
+        || book.bidPxs.size() != book.numRows * book.numLevels || book.bidSzs.size() != book.numRows * book.numLevels
+        || book.askPxs.size() != book.numRows * book.numLevels || book.askSzs.size() != book.numRows * book.numLevels)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::" << who << ": book columns do not match " << book.numRows << " rows");
+}
+
+void checkSeries(const char *who, const ColumnarPriceSeries &series, size_t numRows)
+{
+    if(series.numRows != numRows || series.times.size() != numRows || series.px.size() != numRows
+        || series.pxOK.size() != numRows)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::" << who << ": price columns do not match " << numRows << " rows");
+}
+
+struct ChunkJob
+{
+    const std::vector<size_t> *starts;
+    size_t numRows;
+    const BatchSignalEval::chunk_fn_t *fn;
+    std::atomic<size_t> next;
+    std::vector<std::string> errors;    // one slot per chunk, empty if it succeeded
+
+    void run()
+    {
+        for(size_t c = next.fetch_add(1); c < starts->size(); c = next.fetch_add(1))
+        {
+            const size_t end = (c + 1 < starts->size()) ? (*starts)[c + 1] : numRows;
+            try
+            {
+                (*fn)((*starts)[c], end);
+            }
+            catch(const std::exception &e)
+            {
+                errors[c] = e.what();
+                if(errors[c].empty())
+                    errors[c] = "chunk failed";
+            }
+            catch(...)
+            {
+                errors[c] = "unknown exception";
+            }
+        }
+    }
+};
+
+/************************************************************************************************/
+// SigBook
+/************************************************************************************************/
+
+void sigBookChunk(const SigBookSpec *spec, const ColumnarBookHistory *book, const ColumnarPriceSeries *ref,
+    BatchSignalOutput *out, size_t begin, size_t end)
+{
+    BatchSignalEval::SigBookBuffers buf;
+    BatchSignalEval::sigBookRows(spec->m_numLevels, spec->m_numSBvars, spec->m_returnMode, *book, *ref,
+        begin, end, buf, *out);
+}
+
+/************************************************************************************************/
+// SigBookSizeBias
+/************************************************************************************************/
+
+void sizeBiasDay(const SigBookSizeBiasSpec *spec, const ColumnarBookHistory *book,
+    BatchSignalOutput *out, size_t begin, size_t end)
+{
+    const size_t n = end - begin;
+    const size_t L = spec->m_numLevels;
+    const size_t numLags = spec->m_intervals.size();
+
+    std::vector<double> imb(L * n);
+    for(size_t l = 0; l < L; ++l)
+    {
+        const double *bs = book->bidSz(l) + begin, *as = book->askSz(l) + begin;
+        double *d = &imb[l * n];
+        for(size_t r = 0; r < n; ++r)
+            d[r] = SigBookSizeBias::levelImbalance(bs[r], as[r], spec->m_power, spec->m_sizeUnit);
+    }
+
+    // the snapshot is a recurrence over the day; each day starts from the ATOPEN reset
+    Snapshot<std::vector<double> > snapshot( (std::vector<double>()) );
+    snapshot.setSize(numLags);
+    for(size_t i = 0; i < numLags; ++i)
+        snapshot.setInterval(i, spec->m_intervals[i]);
+
+    const bool bLevels = !book->bidLevelChanged.empty() && !book->askLevelChanged.empty();
+    timeval_t lastCheck;
+    std::vector<double> bookimbVec(L);
+    for(size_t r = 0; r < n; ++r)
+    {
+        const size_t row = begin + r;
+        const int32_t bidChg = bLevels ? book->bidLevelChanged[row] : 0;
+        const int32_t askChg = bLevels ? book->askLevelChanged[row] : 0;
+        if( !(book->times[row] == lastCheck ||
+              ( (bidChg != -1 && uint32_t(bidChg) > L) && (askChg != -1 && uint32_t(askChg) > L) )) )
+        {
+            lastCheck = book->times[row];
+            for(size_t l = 0; l < L; ++l)
+                bookimbVec[l] = imb[l * n + r];
+            snapshot.onBeat(bookimbVec);
+        }
+
+        out->ok[row] = book->bookOK[row];
+        if(!out->ok[row])
+            continue;
+        size_t idx = 0;
+        for(size_t lag = 0; lag < numLags; ++lag)
+        {
+            const std::vector<double> &v = snapshot.getValAt(lag);
+            for(size_t l = 0; l < L; ++l, ++idx)
+                out->values[idx * out->numRows + row] = (v.size() == L) ? v[l] : 0.0;
+        }
+    }
+}
+
+/************************************************************************************************/
+// SigBookBiasL2
+/************************************************************************************************/
+
+// Adds one level of one side to its sums.  With a finite cutoff, a row stops at its first
+// priced level past it, as the walk in evalSideWeightedPriceSize does.
+void biasL2Level(const double *px, const double *sz, const double *mid, size_t n, double lambda,
+    double cutoff, char *stopped, double *pxsz, double *total)
+{
+    if(!stopped)
+    {
+        for(size_t r = 0; r < n; ++r)
+        {
+            const double w = SigBookBiasL2::levelWeight(px[r], sz[r], mid[r], lambda);
+            total[r] += w;
+            pxsz[r] += px[r] * w;
+        }
+        return;
+    }
+    for(size_t r = 0; r < n; ++r)
+    {
+        stopped[r] |= px[r] > 0 && fabs(px[r] - mid[r]) > cutoff * mid[r];
+        if(stopped[r] || !sz)
+            continue;
+        const double w = SigBookBiasL2::levelWeight(px[r], sz[r], mid[r], lambda);
+        total[r] += w;
+        pxsz[r] += px[r] * w;
+    }
+}
+
+void biasL2Chunk(const SigBookBiasL2Spec *spec, const ColumnarBookHistory *book,
+    BatchSignalOutput *out, size_t begin, size_t end)
+{
+    const size_t n = end - begin;
+    const double *mid = &book->midPx[begin];
+    std::vector<double> bpxsz(n, 0.0), bsz(n, 0.0), apxsz(n, 0.0), asz(n, 0.0);
+
+    const double cutoff = SigBookBiasL2::depthCutoff(spec->m_maxRelDistance, spec->m_minLevelWeight, spec->m_lambda);
+    const size_t numLevels = spec->m_maxLevels ? std::min<size_t>(book->numLevels, spec->m_maxLevels) : book->numLevels;
+    std::vector<char> bidStopped, askStopped;
+    if(cutoff < std::numeric_limits<double>::infinity())
+    {
+        // the top level is not weighted, but the walk stops there if it is past the cutoff
+        bidStopped.assign(n, 0);
+        askStopped.assign(n, 0);
+        biasL2Level(book->bidPx(0) + begin, NULL, mid, n, spec->m_lambda, cutoff, &bidStopped[0], NULL, NULL);
+        biasL2Level(book->askPx(0) + begin, NULL, mid, n, spec->m_lambda, cutoff, &askStopped[0], NULL, NULL);
+    }
+    char *bidStop = bidStopped.empty() ? NULL : &bidStopped[0];
+    char *askStop = askStopped.empty() ? NULL : &askStopped[0];
+
+    // the top level is excluded, as in evalSideWeightedPriceSize
+    for(size_t l = 1; l < numLevels; ++l)
+    {
+        biasL2Level(book->bidPx(l) + begin, book->bidSz(l) + begin, mid, n, spec->m_lambda, cutoff,
+            bidStop, &bpxsz[0], &bsz[0]);
+        biasL2Level(book->askPx(l) + begin, book->askSz(l) + begin, mid, n, spec->m_lambda, cutoff,
+            askStop, &apxsz[0], &asz[0]);
+    }
+
+    double *s = out->column(0) + begin;
+    for(size_t r = 0; r < n; ++r)
+        s[r] = SigBookBiasL2::biasFromSides(bpxsz[r], bsz[r], apxsz[r], asz[r], mid[r]);
+    std::copy(book->bookOK.begin() + begin, book->bookOK.begin() + end, out->ok.begin() + begin);
+}
+
+} // anonymous namespace
+
+BatchSignalEval::BatchSignalEval(size_t numThreads)
+    : m_numThreads(numThreads)
+{
+}
+
+void BatchSignalEval::forEachChunk(const std::vector<size_t> &starts, size_t numRows, const chunk_fn_t &fn) const
+{
+    ChunkJob job;
+    job.starts = &starts;
+    job.numRows = numRows;
+    job.fn = &fn;
+    job.next.store(0);
+    job.errors.resize(starts.size());
+
+    const size_t numWorkers = std::min(m_numThreads, starts.size());
+    if(numWorkers <= 1)
+    {
+        job.run();
+    }
+    else
+    {
+        boost::thread_group workers;
+        for(size_t w = 0; w < numWorkers; ++w)
+            workers.create_thread(boost::bind(&ChunkJob::run, &job));
+        workers.join_all();
+    }
+
+    for(size_t c = 0; c < job.errors.size(); ++c)
+        if(!job.errors[c].empty())
+            LONGBEACH_THROW_ERROR_SS("BatchSignalEval: rows from " << starts[c] << ": " << job.errors[c]);
+}
+
+void BatchSignalEval::sigBookRows(size_t numLevels, size_t numVars, ReturnMode returnMode,
+    const ColumnarBookHistory &book, const ColumnarPriceSeries &ref, size_t begin, size_t end,
+    SigBookBuffers &buf, BatchSignalOutput &out)
+{
+    const size_t n = end - begin;
+    const size_t L = numLevels;
+
+    // one row of updateVars per element, a level at a time; vars is level-major like the book
+    buf.bavg.resize(n);
+    buf.bttl.resize(n);
+    buf.aavg.resize(n);
+    buf.attl.resize(n);
+    buf.refpx.resize(n);
+    buf.vars.assign(numVars * n, 0.0);
+    buf.ok.resize(n);
+    double *bavg = &buf.bavg[0], *bttl = &buf.bttl[0], *aavg = &buf.aavg[0], *attl = &buf.attl[0];
+    double *refpx = &buf.refpx[0];
+    std::vector<double> &vars = buf.vars;
+    uint8_t *ok = &buf.ok[0];
+
+    const double *bpx = book.bidPx(0) + begin, *bsz = book.bidSz(0) + begin;
+    const double *apx = book.askPx(0) + begin, *asz = book.askSz(0) + begin;
+    const double *rpx = &ref.px[begin];
+    const uint8_t *rok = &ref.pxOK[begin];
+    for(size_t r = 0; r < n; ++r)
+    {
+        bavg[r] = bpx[r];
+        bttl[r] = bsz[r];
+        aavg[r] = apx[r];
+        attl[r] = asz[r];
+        // something wrong with refpp, use midpoint between bid and ask of this book instead
+        refpx[r] = rok[r] ? rpx[r] : (aavg[r] + bavg[r]) * 0.5;
+        ok[r] = rok[r] && book.bookOK[begin + r];
+    }
+    double *v0 = &vars[0];
+    for(size_t r = 0; r < n; ++r)
+        v0[r] = SigBook::bidVar0(bavg[r], refpx[r]);
+
+    for(size_t l = 0; l < L; ++l)
+    {
+        const double *bs = book.bidSz(l) + begin, *as = book.askSz(l) + begin;
+        for(size_t r = 0; r < n; ++r)
+            ok[r] &= (bs[r] > 0) & (as[r] > 0);     // not enough levels in the book
+    }
+
+    for(size_t i = 1; i < L; ++i)
+    {
+        const double *px = book.bidPx(i) + begin, *sz = book.bidSz(i) + begin;
+        const double *prev = &vars[(i - 1) * n];
+        double *v = &vars[i * n];
+        for(size_t r = 0; r < n; ++r)
+        {
+            SigBook::accumulateLevel(bavg[r], bttl[r], px[r], sz[r]);
+            v[r] = SigBook::bidVar(bavg[r], prev[r]);
+        }
+
+        px = book.askPx(i) + begin;
+        sz = book.askSz(i) + begin;
+        const size_t askindex = i + L - 1;
+        double *va = &vars[askindex * n];
+        if(i == 1)
+        {
+            for(size_t r = 0; r < n; ++r)
+            {
+                SigBook::accumulateLevel(aavg[r], attl[r], px[r], sz[r]);
+                va[r] = SigBook::askVar1(aavg[r], refpx[r]);
+            }
+        }
+        else
+        {
+            const double *preva = &vars[(askindex - 1) * n];
+            for(size_t r = 0; r < n; ++r)
+            {
+                SigBook::accumulateLevel(aavg[r], attl[r], px[r], sz[r]);
+                va[r] = SigBook::askVar(aavg[r], preva[r]);
+            }
+        }
+    }
+
+    // recomputeState: states are relative to the refpp itself, and 0 whenever the signal is not ok
+    for(size_t k = 0; k < numVars; ++k)
+    {
+        const double *v = &vars[k * n];
+        double *s = out.column(k) + begin;
+        for(size_t r = 0; r < n; ++r)
+            s[r] = (ok[r] && rpx[r]) ? SigBook::varToState(returnMode, v[r], rpx[r]) : 0.0;
+    }
+    std::copy(ok, ok + n, out.ok.begin() + begin);
+}
+
+BatchSignalOutput BatchSignalEval::evalSigBook(const SigBookSpec &spec, const ColumnarBookHistory &book,
+    const ColumnarPriceSeries &ref) const
+{
+    const size_t L = spec.m_numLevels;
+    if(L == 0 || spec.m_numSBvars < 2 * L - 1)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::evalSigBook: " << spec.getDescription() << ": num_sbvars "
+            << spec.m_numSBvars << " too small for " << L << " levels");
+    if(spec.m_tickSize > 0)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::evalSigBook: " << spec.getDescription() << ": tick mode is not supported");
+    checkBook("evalSigBook", book, L);
+    checkSeries("evalSigBook", ref, book.numRows);
+
+    std::vector<std::string> names;
+    for(size_t i = 0; i < L; ++i)
+        names.push_back(boost::str(boost::format("bid%1%") % i));
+    for(size_t i = 1; i < spec.m_numSBvars - (L - 1); ++i)
+        names.push_back(boost::str(boost::format("ask%1%") % i));
+
+    BatchSignalOutput out;
+    out.init(names, book.numRows);
+    forEachChunk(blockStarts(book.numRows), book.numRows,
+        boost::bind(&sigBookChunk, &spec, &book, &ref, &out, _1, _2));
+    return out;
+}
+
+BatchSignalOutput BatchSignalEval::evalSizeBias(const SigBookSizeBiasSpec &spec, const ColumnarBookHistory &book) const
+{
+    checkBook("evalSizeBias", book, spec.m_numLevels);
+
+    std::vector<std::string> names;
+    for(size_t lag = 0; lag < spec.m_intervals.size(); ++lag)
+        for(size_t lvl = 0; lvl < spec.m_numLevels; ++lvl)
+            names.push_back(boost::str(boost::format("lag%1%lvl%2%") % spec.m_intervals[lag] % lvl));
+
+    BatchSignalOutput out;
+    out.init(names, book.numRows);
+    forEachChunk(dayStarts(book), book.numRows,
+        boost::bind(&sizeBiasDay, &spec, &book, &out, _1, _2));
+    return out;
+}
+
+BatchSignalOutput BatchSignalEval::evalBiasL2(const SigBookBiasL2Spec &spec, const ColumnarBookHistory &book) const
+{
+    if(spec.m_tickSize > 0)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::evalBiasL2: " << spec.getDescription() << ": tick mode is not supported");
+    if(spec.m_volFilterWindow > 0)
+        LONGBEACH_THROW_ERROR_SS("BatchSignalEval::evalBiasL2: " << spec.getDescription() << ": vol_filter_window is not supported");
+    checkBook("evalBiasL2", book, 1);
+
+    BatchSignalOutput out;
+    out.init(std::vector<std::string>(1, "bias0"), book.numRows);
+    forEachChunk(blockStarts(book.numRows), book.numRows,
+        boost::bind(&biasL2Chunk, &spec, &book, &out, _1, _2));
+    return out;
+}
+
+BatchSignalOutput BatchSignalEval::evalMACD(const SigMACDSpec &spec, const ColumnarPriceSeries &series) const
+{
+    checkSeries("evalMACD", series, series.numRows);
+
+    std::vector<std::string> names;
+    names.push_back("macd");
+    names.push_back("dea");
+    names.push_back("diff");
+    BatchSignalOutput out;
+    out.init(names, series.numRows);
+
+    technicals::macd_t macd( spec.short_window, spec.long_window, spec.mid_window );
+    bool bOK = false;
+    double *osc = out.column(0), *dea = out.column(1), *diff = out.column(2);
+    for(size_t r = 0; r < series.numRows; ++r)
+    {
+        if(series.pxOK[r])
+        {
+            macd.update( series.px[r] );
+            bOK = true;
+        }
+        out.ok[r] = bOK;
+        if(bOK && macd.get_dea())
+        {
+            osc[r] = macd.get_osc().get();
+            dea[r] = macd.get_dea().get();
+            diff[r] = macd.get_diff().get();
+        }
+    }
+    return out;
+}
+
+BatchSignalOutput BatchSignalEval::evalKalman(const SigKalmanFilterSpec &spec, const ColumnarPriceSeries &series) const
+{
+    checkSeries("evalKalman", series, series.numRows);
+
+    std::vector<std::string> names;
+    names.push_back("px_est");
+    names.push_back("v_est");
+    names.push_back("sig_est");
+    names.push_back("px_pred");
+    names.push_back("v_pred");
+    names.push_back("sig_pred");
+    BatchSignalOutput out;
+    out.init(names, series.numRows);
+
+    KalmanPxFilter filter( spec );
+    double state[KalmanPxFilter::NumStates] = { 0 };
+    for(size_t r = 0; r < series.numRows; ++r)
+    {
+        filter.update( series.times[r], series.px[r], state );
+        out.ok[r] = series.pxOK[r];
+        for(size_t k = 0; k < KalmanPxFilter::NumStates; ++k)
+            out.values[k * series.numRows + r] = state[k];
+    }
+    return out;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,139 @@
+#ifndef LONGBEACH_SIGNALS_BATCHSIGNALEVAL_H
+#define LONGBEACH_SIGNALS_BATCHSIGNALEVAL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+class SigBookSpec;
+class SigBookSizeBiasSpec;
+class SigBookBiasL2Spec;
+class SigMACDSpec;
+class SigKalmanFilterSpec;
+
+/// Book history in columns, one row per book change.
+///
+/// The price and size matrices are level-major: level l of every row is contiguous, at
+/// [l * numRows, (l+1) * numRows), so the batch kernels walk one level across many rows with
+/// unit stride.  Levels the book did not have are 0 price and 0 size.
+struct ColumnarBookHistory
+{
+    ColumnarBookHistory() : numRows(0), numLevels(0) {}
+
+    void resize(size_t rows, size_t levels);
+
+    const double *bidPx(size_t lvl) const { return &bidPxs[lvl * numRows]; }
+    const double *bidSz(size_t lvl) const { return &bidSzs[lvl * numRows]; }
+    const double *askPx(size_t lvl) const { return &askPxs[lvl * numRows]; }
+    const double *askSz(size_t lvl) const { return &askSzs[lvl * numRows]; }
+
+    size_t numRows;
+    size_t numLevels;
+    std::vector<timeval_t> times;       // IBook::getLastChangeTime of each row
+    std::vector<double> midPx;          // IBook::getMidPrice of each row
+    std::vector<uint8_t> bookOK;        // IBook::isOK of each row
+    std::vector<double> bidPxs, bidSzs, askPxs, askSzs;
+
+    /// Deepest level changed on each side (-1 for none), as passed to onBookChanged.  May be
+    /// left empty, in which case every row counts as a change within any depth.
+    std::vector<int32_t> bidLevelChanged, askLevelChanged;
+
+    /// First row of each trading day, ascending and starting at 0; empty means one day.
+    std::vector<size_t> dayStarts;
+};
+
+/// A price provider's history: one row per price change.
+struct ColumnarPriceSeries
+{
+    ColumnarPriceSeries() : numRows(0) {}
+
+    void resize(size_t rows);
+
+    size_t numRows;
+    std::vector<timeval_t> times;       // IPriceProvider::getLastChangeTime
+    std::vector<double> px;             // IPriceProvider::getRefPrice
+    std::vector<uint8_t> pxOK;          // IPriceProvider::isPriceOK
+};
+
+/// Signal states over a history, one row per input row.
+struct BatchSignalOutput
+{
+    BatchSignalOutput() : numRows(0) {}
+
+    void init(const std::vector<std::string> &stateNames, size_t rows);
+
+    const double *column(size_t state) const { return &values[state * numRows]; }
+    double *column(size_t state) { return &values[state * numRows]; }
+
+    std::vector<std::string> names;
+    size_t numRows;
+    std::vector<double> values;         // state-major, names.size() x numRows
+    std::vector<uint8_t> ok;            // the signal's isOK after each row
+};
+
+/// Offline evaluation of signals over whole columnar histories, for research and for
+/// regenerating features, producing the same states the live signals would have had after
+/// each input row.
+///
+/// Each signal's arithmetic is shared with its online implementation (the static kernels on
+/// SigBook, SigBookBiasL2, SigBookSizeBias and KalmanPxFilter), so the two paths agree to the
+/// bit as long as they are compiled with the same floating point flags.  Signals without
+/// state across rows (SigBook, SigBookBiasL2) are computed a level at a time over blocks of
+/// rows, which the compiler can vectorize; SigBookSizeBias resets at each open, so its days
+/// are independent.  Those chunks are spread over numThreads threads.  SigMACD and
+/// SigKalmanFilter are recurrences over the whole series and run on the calling thread.
+class BatchSignalEval
+{
+public:
+    /// Rows per chunk for signals without state across rows.
+    static const size_t BlockRows = 4096;
+
+    /// numThreads 0 evaluates everything on the calling thread.
+    explicit BatchSignalEval(size_t numThreads = 0);
+
+    /// ref must have a row for every book row: the reference price as of that book change.
+    BatchSignalOutput evalSigBook(const SigBookSpec &spec, const ColumnarBookHistory &book,
+        const ColumnarPriceSeries &ref) const;
+    BatchSignalOutput evalSizeBias(const SigBookSizeBiasSpec &spec, const ColumnarBookHistory &book) const;
+    BatchSignalOutput evalBiasL2(const SigBookBiasL2Spec &spec, const ColumnarBookHistory &book) const;
+    BatchSignalOutput evalMACD(const SigMACDSpec &spec, const ColumnarPriceSeries &series) const;
+    BatchSignalOutput evalKalman(const SigKalmanFilterSpec &spec, const ColumnarPriceSeries &series) const;
+
+    /// Scratch of sigBookRows.  Callers that run it repeatedly keep one so it stops allocating.
+    struct SigBookBuffers
+    {
+        std::vector<double> bavg, bttl, aavg, attl, refpx;
+        std::vector<double> vars;       // after the call: updateVars' vars, level-major, numVars x rows
+        std::vector<uint8_t> ok;        // after the call: isOK of each row
+    };
+
+    /// The SigBook kernel behind evalSigBook: rows [begin, end) of book and ref into the same
+    /// rows of out, a level at a time across rows.  Rows need not be one book's history;
+    /// SigBookBatchEngine passes one row per instrument.
+    static void sigBookRows(size_t numLevels, size_t numVars, ReturnMode returnMode,
+        const ColumnarBookHistory &book, const ColumnarPriceSeries &ref, size_t begin, size_t end,
+        SigBookBuffers &buf, BatchSignalOutput &out);
+
+    /// Called with [begin, end) row ranges.
+    typedef boost::function<void (size_t begin, size_t end)> chunk_fn_t;
+
+    /// Runs fn over the chunks [starts[i], starts[i+1]) (the last one ending at numRows),
+    /// spread over the threads.  Rethrows the first failure after all chunks are done.
+    void forEachChunk(const std::vector<size_t> &starts, size_t numRows, const chunk_fn_t &fn) const;
+
+private:
+    size_t m_numThreads;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_BATCHSIGNALEVAL_H
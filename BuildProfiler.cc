@@ -0,0 +1,216 @@
+#include <longbeach/signals/BuildProfiler.h>
+
+#include <time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <vector>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+#ifdef LONGBEACH_SIGNALS_PROFILE_ALLOCS
+thread_local uint64_t t_allocs = 0;
+thread_local uint64_t t_allocBytes = 0;
+#endif
+
+uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t allocCount()
+{
+#ifdef LONGBEACH_SIGNALS_PROFILE_ALLOCS
+    return t_allocs;
+#else
+    return 0;
+#endif
+}
+
+uint64_t allocBytes()
+{
+#ifdef LONGBEACH_SIGNALS_PROFILE_ALLOCS
+    return t_allocBytes;
+#else
+    return 0;
+#endif
+}
+
+struct Frame
+{
+    std::string classKey;    // "SpecClass::phase"
+    std::string instanceKey; // "SpecClass::phase desc"
+    std::string stackKey;    // folded stack down to and including this frame
+    uint64_t startNs;
+    uint64_t childNs;
+    uint64_t startAllocs;
+    uint64_t startAllocBytes;
+};
+
+// each thread building signals keeps its own stack of open scopes
+thread_local std::vector<Frame> t_frames;
+
+typedef std::pair<std::string, BuildProfiler::Stats> entry_t;
+
+bool bySelfTime(const entry_t &a, const entry_t &b)
+{
+    return a.second.selfNs > b.second.selfNs;
+}
+
+void printTable(std::ostream &o, const char *title, const std::map<std::string, BuildProfiler::Stats> &stats, size_t topN)
+{
+    std::vector<entry_t> entries(stats.begin(), stats.end());
+    std::sort(entries.begin(), entries.end(), &bySelfTime);
+    if(entries.size() > topN)
+        entries.resize(topN);
+
+    o << title << '\n'
+      << std::setw(10) << "self_ms" << std::setw(10) << "incl_ms" << std::setw(9) << "calls"
+      << std::setw(10) << "allocs" << std::setw(12) << "alloc_kb" << "  name" << '\n';
+    for(std::vector<entry_t>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    {
+        const BuildProfiler::Stats &s = it->second;
+        o << std::fixed << std::setprecision(3)
+          << std::setw(10) << s.selfNs / 1e6
+          << std::setw(10) << s.inclusiveNs / 1e6
+          << std::setw(9) << s.calls
+          << std::setw(10) << s.allocs
+          << std::setw(12) << s.allocBytes / 1024.0
+          << "  " << it->first << '\n';
+    }
+}
+
+void accumulate(BuildProfiler::Stats &s, uint64_t inclNs, uint64_t selfNs, uint64_t allocs, uint64_t bytes)
+{
+    ++s.calls;
+    s.inclusiveNs += inclNs;
+    s.selfNs += selfNs;
+    s.allocs += allocs;
+    s.allocBytes += bytes;
+}
+
+} // anonymous namespace
+
+std::atomic<bool> BuildProfiler::s_bEnabled(false);
+
+BuildProfiler &BuildProfiler::instance()
+{
+    static BuildProfiler profiler;
+    return profiler;
+}
+
+void BuildProfiler::reset()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_byClass.clear();
+    m_byInstance.clear();
+    m_foldedNs.clear();
+}
+
+uint64_t BuildProfiler::threadAllocCount()
+{
+    return allocCount();
+}
+
+uint64_t BuildProfiler::threadAllocBytes()
+{
+    return allocBytes();
+}
+
+bool BuildProfiler::countsAllocs()
+{
+#ifdef LONGBEACH_SIGNALS_PROFILE_ALLOCS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BuildProfiler::enter(const char *specClass, const char *phase, const std::string &desc)
+{
+    Frame f;
+    f.classKey = std::string(specClass) + "::" + phase;
+    f.instanceKey = f.classKey + ' ' + desc;
+    f.stackKey = t_frames.empty() ? f.classKey : t_frames.back().stackKey + ';' + f.classKey;
+    f.childNs = 0;
+    f.startAllocs = allocCount();
+    f.startAllocBytes = allocBytes();
+    t_frames.push_back(f);
+    // start the clock last so the bookkeeping above is not charged to the scope
+    t_frames.back().startNs = nowNs();
+}
+
+void BuildProfiler::leave()
+{
+    const uint64_t endNs = nowNs();
+    if(t_frames.empty())
+        return; // enabled while a scope was open
+
+    Frame &f = t_frames.back();
+    const uint64_t inclNs = endNs - f.startNs;
+    const uint64_t selfNs = inclNs > f.childNs ? inclNs - f.childNs : 0;
+    const uint64_t allocs = allocCount() - f.startAllocs;
+    const uint64_t bytes = allocBytes() - f.startAllocBytes;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        accumulate(m_byClass[f.classKey], inclNs, selfNs, allocs, bytes);
+        accumulate(m_byInstance[f.instanceKey], inclNs, selfNs, allocs, bytes);
+        m_foldedNs[f.stackKey] += selfNs;
+    }
+    t_frames.pop_back();
+    if(!t_frames.empty())
+        t_frames.back().childNs += inclNs;
+}
+
+void BuildProfiler::printReport(std::ostream &o, size_t topN) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    printTable(o, "== signal build profile by spec class ==", m_byClass, topN);
+    o << '\n';
+    printTable(o, "== signal build profile by spec instance ==", m_byInstance, topN);
+}
+
+void BuildProfiler::printFoldedStacks(std::ostream &o) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for(std::map<std::string, uint64_t>::const_iterator it = m_foldedNs.begin(); it != m_foldedNs.end(); ++it)
+        o << it->first << ' ' << it->second / 1000 << '\n';
+}
+
+} // namespace signals
+} // namespace longbeach
+
+#ifdef LONGBEACH_SIGNALS_PROFILE_ALLOCS
+// Counting replacements of the global allocation functions.  Only compiled in on request since
+// they affect the whole process.
+void *operator new(std::size_t n)
+{
+    ++longbeach::signals::t_allocs;
+    longbeach::signals::t_allocBytes += n;
+    if(void *p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t n)
+{
+    return ::operator new(n);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+#endif // LONGBEACH_SIGNALS_PROFILE_ALLOCS
@@ -0,0 +1,107 @@
+#ifndef LONGBEACH_SIGNALS_BUILDPROFILER_H
+#define LONGBEACH_SIGNALS_BUILDPROFILER_H
+
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace longbeach {
+namespace signals {
+
+/// Opt-in profiler for signal graph construction.
+///
+/// Spec checkValid/getDataRequirements/build, the nested book/price provider/tick provider
+/// builds and the signal constructors are wrapped in LONGBEACH_PROFILE_BUILD_SCOPE.  While the
+/// profiler is enabled each scope records wall time (inclusive and self) and, when the library
+/// is compiled with LONGBEACH_SIGNALS_PROFILE_ALLOCS, the number and bytes of heap allocations
+/// made inside it.  When disabled a scope costs one branch, and its description argument is
+/// not evaluated.
+class BuildProfiler : private boost::noncopyable
+{
+public:
+    struct Stats
+    {
+        Stats() : calls(0), inclusiveNs(0), selfNs(0), allocs(0), allocBytes(0) {}
+        uint64_t calls;
+        uint64_t inclusiveNs;
+        uint64_t selfNs;
+        uint64_t allocs;
+        uint64_t allocBytes;
+    };
+
+    static BuildProfiler &instance();
+
+    static bool isEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled) { s_bEnabled.store(enabled, std::memory_order_relaxed); }
+    void reset();
+
+    /// Writes the topN entries by self time, per "SpecClass::phase" and per spec instance.
+    void printReport(std::ostream &o, size_t topN = 50) const;
+
+    /// Writes "frame;frame;frame self_us" lines, the input format of flamegraph.pl.
+    void printFoldedStacks(std::ostream &o) const;
+
+    void enter(const char *specClass, const char *phase, const std::string &desc);
+    void leave();
+
+    /// Heap allocations (count and bytes) made so far by the calling thread.  Always 0 unless
+    /// compiled with LONGBEACH_SIGNALS_PROFILE_ALLOCS.
+    static uint64_t threadAllocCount();
+    static uint64_t threadAllocBytes();
+    static bool countsAllocs();
+
+private:
+    BuildProfiler() {}
+
+    typedef std::map<std::string, Stats> stats_map_t;
+
+    // read by every scope, on whichever thread builds (see ParallelSignalBuild)
+    static std::atomic<bool> s_bEnabled;
+
+    mutable boost::mutex m_mutex;
+    stats_map_t m_byClass;
+    stats_map_t m_byInstance;
+    std::map<std::string, uint64_t> m_foldedNs;
+};
+
+/// RAII helper behind LONGBEACH_PROFILE_BUILD_SCOPE.  The macro calls enter() only while the
+/// profiler is enabled, so the description (often a getDescription() copy) is built only then.
+class BuildProfileScope : private boost::noncopyable
+{
+public:
+    BuildProfileScope(const char *specClass, const char *phase)
+        : m_specClass(specClass), m_phase(phase), m_bActive(false) {}
+    ~BuildProfileScope()
+    {
+        if(m_bActive)
+            BuildProfiler::instance().leave();
+    }
+
+    void enter(const std::string &desc)
+    {
+        m_bActive = true;
+        BuildProfiler::instance().enter(m_specClass, m_phase, desc);
+    }
+
+private:
+    const char *const m_specClass;
+    const char *const m_phase;
+    bool m_bActive;
+};
+
+#define LONGBEACH_PROFILE_BUILD_CAT2(a, b) a##b
+#define LONGBEACH_PROFILE_BUILD_CAT(a, b) LONGBEACH_PROFILE_BUILD_CAT2(a, b)
+#define LONGBEACH_PROFILE_BUILD_SCOPE_NAMED(name, specClass, phase, desc) \
+    ::longbeach::signals::BuildProfileScope name(specClass, phase); \
+    if(::longbeach::signals::BuildProfiler::isEnabled()) name.enter(desc)
+#define LONGBEACH_PROFILE_BUILD_SCOPE(specClass, phase, desc) \
+    LONGBEACH_PROFILE_BUILD_SCOPE_NAMED(LONGBEACH_PROFILE_BUILD_CAT(_lb_buildProfileScope, __LINE__), specClass, phase, desc)
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_BUILDPROFILER_H
@@ -0,0 +1,240 @@
+#include <longbeach/signals/LatencyHistogram.h>
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <ostream>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+/************************************************************************************************/
+// LatencyHistogram
+/************************************************************************************************/
+
+LatencyHistogram::LatencyHistogram(unsigned subBucketBits)
+    : m_subBucketBits(subBucketBits)
+    , m_subBucketCount(uint64_t(1) << subBucketBits)
+    , m_count(0)
+    , m_sum(0)
+    , m_min(std::numeric_limits<uint64_t>::max())
+    , m_max(0)
+{
+    if(subBucketBits < 1 || subBucketBits > 16)
+        LONGBEACH_THROW_ERROR_SS("LatencyHistogram: subBucketBits must be in [1, 16], got " << subBucketBits);
+    // exact buckets, then half a sub-bucket range for every power of two above them
+    m_counts.resize(m_subBucketCount + (64 - subBucketBits) * (m_subBucketCount / 2), 0);
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) const
+{
+    if(value < m_subBucketCount)
+        return value;
+    const unsigned msb = 63 - __builtin_clzll(value);
+    const unsigned shift = msb - m_subBucketBits + 1;
+    const uint64_t half = m_subBucketCount / 2;
+    return m_subBucketCount + (shift - 1) * half + ((value >> shift) - half);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t idx) const
+{
+    if(idx < m_subBucketCount)
+        return idx;
+    const uint64_t half = m_subBucketCount / 2;
+    const uint64_t k = idx - m_subBucketCount;
+    const unsigned shift = k / half + 1;
+    const uint64_t top = k % half + half;
+    // wraps to 2^64 - 1 for the very last bucket, which is the right answer
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    if(other.m_subBucketBits != m_subBucketBits)
+        LONGBEACH_THROW_ERROR_SS("LatencyHistogram: cannot merge histograms of different precision");
+    for(size_t i = 0; i < m_counts.size(); ++i)
+        m_counts[i] += other.m_counts[i];
+    m_count += other.m_count;
+    m_sum += other.m_sum;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = std::numeric_limits<uint64_t>::max();
+    m_max = 0;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double p) const
+{
+    if(m_count == 0)
+        return 0;
+    uint64_t target = uint64_t(std::ceil(std::max(0.0, std::min(p, 100.0)) / 100.0 * m_count));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for(size_t i = 0; i < m_counts.size(); ++i)
+    {
+        seen += m_counts[i];
+        if(seen >= target)
+            return std::min(bucketUpperBound(i), m_max);
+    }
+    return m_max;
+}
+
+void LatencyHistogram::print(std::ostream &o, const std::string &label) const
+{
+    o << std::left << std::setw(48) << label << std::right
+      << " n=" << std::setw(10) << m_count
+      << " mean=" << std::setw(9) << uint64_t(getMean())
+      << " p50=" << std::setw(9) << valueAtPercentile(50)
+      << " p90=" << std::setw(9) << valueAtPercentile(90)
+      << " p99=" << std::setw(9) << valueAtPercentile(99)
+      << " p99.9=" << std::setw(9) << valueAtPercentile(99.9)
+      << " p99.99=" << std::setw(9) << valueAtPercentile(99.99)
+      << " max=" << std::setw(9) << m_max
+      << std::endl;
+}
+
+/************************************************************************************************/
+// SignalLatencyProfiler
+/************************************************************************************************/
+
+std::atomic<unsigned> SignalLatencyProfiler::s_numEnabled(0);
+std::atomic<bool> SignalLatencyProfiler::s_bManuallyEnabled(false);
+
+/// Histograms recorded by one thread, one per site, created by that thread on the site's first
+/// record and published to reports through the atomic pointer.
+struct SignalLatencyProfiler::ThreadData
+{
+    ThreadData()
+    {
+        for(size_t i = 0; i < MaxSites; ++i)
+            histograms[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    std::atomic<LatencyHistogram*> histograms[MaxSites];
+};
+
+namespace {
+thread_local SignalLatencyProfiler::ThreadData *t_pThreadData = NULL;
+}
+
+SignalLatencyProfiler &SignalLatencyProfiler::instance()
+{
+    static SignalLatencyProfiler s_instance;
+    return s_instance;
+}
+
+void SignalLatencyProfiler::setEnabled(bool enabled)
+{
+    if(s_bManuallyEnabled.exchange(enabled) != enabled)
+    {
+        if(enabled)
+            s_numEnabled.fetch_add(1, std::memory_order_relaxed);
+        else
+            s_numEnabled.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t SignalLatencyProfiler::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+SignalLatencyProfiler::ThreadData &SignalLatencyProfiler::threadData()
+{
+    if(!t_pThreadData)
+    {
+        t_pThreadData = new ThreadData;
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_threads.push_back(t_pThreadData);
+    }
+    return *t_pThreadData;
+}
+
+size_t SignalLatencyProfiler::registerSite(const char *signalClass, const char *handler)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for(size_t i = 0; i < m_sites.size(); ++i)
+        if(std::strcmp(m_sites[i].first, signalClass) == 0 && std::strcmp(m_sites[i].second, handler) == 0)
+            return i;
+    if(m_sites.size() == MaxSites)
+        LONGBEACH_THROW_ERROR_SS("SignalLatencyProfiler: more than " << MaxSites << " timed handlers");
+    m_sites.push_back(std::make_pair(signalClass, handler));
+    return m_sites.size() - 1;
+}
+
+void SignalLatencyProfiler::record(size_t site, uint64_t ns)
+{
+    std::atomic<LatencyHistogram*> &slot = threadData().histograms[site];
+    LatencyHistogram *h = slot.load(std::memory_order_relaxed);
+    if(!h)
+    {
+        h = new LatencyHistogram;
+        slot.store(h, std::memory_order_release);
+    }
+    h->record(ns);
+}
+
+void SignalLatencyProfiler::reset()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for(size_t i = 0; i < m_threads.size(); ++i)
+        for(size_t site = 0; site < m_sites.size(); ++site)
+            if(LatencyHistogram *h = m_threads[i]->histograms[site].load(std::memory_order_acquire))
+                h->reset();
+}
+
+std::vector<SignalLatencyProfiler::Entry> SignalLatencyProfiler::getReport() const
+{
+    std::map<std::pair<std::string, std::string>, LatencyHistogram> merged;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        for(size_t i = 0; i < m_threads.size(); ++i)
+        {
+            for(size_t site = 0; site < m_sites.size(); ++site)
+            {
+                const LatencyHistogram *h = m_threads[i]->histograms[site].load(std::memory_order_acquire);
+                if(h && h->getCount())
+                    merged[std::make_pair(std::string(m_sites[site].first), std::string(m_sites[site].second))].merge(*h);
+            }
+        }
+    }
+
+    std::vector<Entry> report;
+    for(std::map<std::pair<std::string, std::string>, LatencyHistogram>::const_iterator it = merged.begin();
+        it != merged.end(); ++it)
+    {
+        Entry e;
+        e.signalClass = it->first.first;
+        e.handler = it->first.second;
+        e.histogram = it->second;
+        report.push_back(e);
+    }
+    return report;
+}
+
+void SignalLatencyProfiler::printReport(std::ostream &o) const
+{
+    std::vector<Entry> report = getReport();
+    o << "signal handler latency (ns)" << std::endl;
+    for(size_t i = 0; i < report.size(); ++i)
+        report[i].histogram.print(o, report[i].signalClass + "::" + report[i].handler);
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,202 @@
+#ifndef LONGBEACH_SIGNALS_LATENCYHISTOGRAM_H
+#define LONGBEACH_SIGNALS_LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace longbeach {
+namespace signals {
+
+/// HDR-style histogram of non-negative integer values (typically nanoseconds).
+///
+/// Values below 2^subBucketBits are counted exactly; above that each power of two is split into
+/// 2^(subBucketBits-1) equal sub-buckets, so every recorded value is known to within a relative
+/// error of 2^-(subBucketBits-1) across the whole 64-bit range, in a fixed amount of memory.
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(unsigned subBucketBits = 8);
+
+    void record(uint64_t value)
+    {
+        ++m_counts[bucketOf(value)];
+        ++m_count;
+        m_sum += value;
+        if(value < m_min)
+            m_min = value;
+        if(value > m_max)
+            m_max = value;
+    }
+
+    /// Adds other's counts to this one.  Both must have the same subBucketBits.
+    void merge(const LatencyHistogram &other);
+    void reset();
+
+    uint64_t getCount() const { return m_count; }
+    uint64_t getMin() const { return m_count ? m_min : 0; }
+    uint64_t getMax() const { return m_max; }
+    double getMean() const { return m_count ? double(m_sum) / m_count : 0.0; }
+
+    /// Upper bound of the bucket holding the value at percentile p (0-100).
+    uint64_t valueAtPercentile(double p) const;
+
+    /// One line: count, mean, p50, p90, p99, p99.9, p99.99, max.
+    void print(std::ostream &o, const std::string &label) const;
+
+private:
+    size_t bucketOf(uint64_t value) const;
+    uint64_t bucketUpperBound(size_t idx) const;
+
+    unsigned m_subBucketBits;
+    uint64_t m_subBucketCount;      // 2^subBucketBits
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count;
+    uint64_t m_sum;
+    uint64_t m_min;
+    uint64_t m_max;
+};
+
+/// Opt-in latency profiler for signal event handlers (onBookChanged, onTickReceived, onMsg,
+/// recomputeState, ...), keyed by signal class and handler.
+///
+/// Every timed handler is a site, numbered once on first use.  Each thread records into its
+/// own histogram per site, found by index with no lock or lookup; getReport() merges them.
+/// When disabled a timed handler costs one branch.
+class SignalLatencyProfiler : private boost::noncopyable
+{
+public:
+    struct Entry
+    {
+        std::string signalClass;
+        std::string handler;
+        LatencyHistogram histogram;
+    };
+
+    /// Most distinct sites a process can time.
+    static const size_t MaxSites = 256;
+
+    static SignalLatencyProfiler &instance();
+
+    static bool isEnabled() { return s_numEnabled.load(std::memory_order_relaxed) != 0; }
+
+    /// Switches profiling on or off for the whole process.  Independent of, and combined with,
+    /// any SignalLatencyProfiling scopes alive on other threads.
+    static void setEnabled(bool enabled);
+
+    /// Clears the histograms of every thread.  Only call while no handler is running.
+    void reset();
+
+    /// Merged histograms of all threads, sorted by signal class then handler.  Reads the other
+    /// threads' histograms without stopping them, so only call it while no timed handler is
+    /// running (e.g. between replays or warmups) if the counts must be exact.
+    std::vector<Entry> getReport() const;
+    void printReport(std::ostream &o) const;
+
+    /// Index of the site timing handler of signalClass, for record(); the same pair always
+    /// gets the same index.  Both must be string literals (or otherwise outlive the profiler).
+    size_t registerSite(const char *signalClass, const char *handler);
+
+    void record(size_t site, uint64_t ns);
+
+    /// Monotonic clock, in nanoseconds.
+    static uint64_t now();
+
+    struct ThreadData;
+
+private:
+    friend class SignalLatencyProfiling;
+
+    SignalLatencyProfiler() {}
+
+    ThreadData &threadData();
+
+    /// Manual switch plus live SignalLatencyProfiling scopes; profiling is on while non-zero.
+    static std::atomic<unsigned> s_numEnabled;
+    static std::atomic<bool> s_bManuallyEnabled;
+
+    mutable boost::mutex m_mutex;
+    std::vector<std::pair<const char*, const char*> > m_sites;  // [site]
+    std::vector<ThreadData*> m_threads;     // never freed, so reports survive thread exit
+};
+
+/// Turns signal handler profiling on for its lifetime, if asked to, and back off when it ends
+/// (including by an exception) unless something else still has it on.  Scopes on different
+/// threads, e.g. one per shard, nest freely.
+class SignalLatencyProfiling : private boost::noncopyable
+{
+public:
+    explicit SignalLatencyProfiling(bool enable = true)
+        : m_bEnabled(enable)
+    {
+        if(m_bEnabled)
+            SignalLatencyProfiler::s_numEnabled.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~SignalLatencyProfiling()
+    {
+        if(m_bEnabled)
+            SignalLatencyProfiler::s_numEnabled.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    const bool m_bEnabled;
+};
+
+/// RAII helper behind LONGBEACH_TIME_SIGNAL_HANDLER.  The site index lives in a constant-
+/// initialized static of the timed function and is looked up on the first enabled call, so a
+/// disabled handler pays for isEnabled() and nothing else.
+class SignalLatencyScope : private boost::noncopyable
+{
+public:
+    static const size_t NoSite = size_t(-1);
+
+    SignalLatencyScope(std::atomic<size_t> &site, const char *signalClass, const char *handler)
+        : m_site(site)
+        , m_signalClass(signalClass)
+        , m_handler(handler)
+        , m_start(SignalLatencyProfiler::isEnabled() ? SignalLatencyProfiler::now() : 0)
+    {
+    }
+    ~SignalLatencyScope()
+    {
+        if(m_start)
+            record(m_site, m_signalClass, m_handler, m_start);
+    }
+
+    /// Records the time since start against the site, numbering it first if need be.
+    static void record(std::atomic<size_t> &site, const char *signalClass, const char *handler, uint64_t start)
+    {
+        const uint64_t ns = SignalLatencyProfiler::now() - start;
+        SignalLatencyProfiler &profiler = SignalLatencyProfiler::instance();
+        size_t idx = site.load(std::memory_order_relaxed);
+        if(idx == NoSite)
+        {
+            idx = profiler.registerSite(signalClass, handler);
+            site.store(idx, std::memory_order_relaxed);
+        }
+        profiler.record(idx, ns);
+    }
+
+private:
+    std::atomic<size_t> &m_site;
+    const char *m_signalClass;
+    const char *m_handler;
+    const uint64_t m_start;
+};
+
+#define LONGBEACH_TIME_SIGNAL_HANDLER_CAT2(a, b) a##b
+#define LONGBEACH_TIME_SIGNAL_HANDLER_CAT(a, b) LONGBEACH_TIME_SIGNAL_HANDLER_CAT2(a, b)
+#define LONGBEACH_TIME_SIGNAL_HANDLER(signalClass, handler) \
+    static std::atomic<size_t> LONGBEACH_TIME_SIGNAL_HANDLER_CAT(_lb_latencySite, __LINE__)( \
+        ::longbeach::signals::SignalLatencyScope::NoSite); \
+    ::longbeach::signals::SignalLatencyScope LONGBEACH_TIME_SIGNAL_HANDLER_CAT(_lb_latencyScope, __LINE__)( \
+        LONGBEACH_TIME_SIGNAL_HANDLER_CAT(_lb_latencySite, __LINE__), signalClass, handler)
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_LATENCYHISTOGRAM_H
@@ -0,0 +1,184 @@
+#include <longbeach/signals/MarketDataReplay.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+const char ReplayMagic[8] = { 'L', 'B', 'R', 'E', 'P', 'L', 'A', 'Y' };
+const uint32_t ReplayVersion = 1;
+const size_t FileHeaderSize = sizeof(ReplayMagic) + sizeof(uint32_t);
+
+const char *recordTypeName(size_t type)
+{
+    switch(type)
+    {
+    case REPLAY_CRYPTO_ORDER_DEPTH: return "CryptoOrderDepthMsg";
+    case REPLAY_WIND_STOCK_MD:      return "WindStockMarketDataMsg";
+    case REPLAY_MH_MD:              return "MhMdMsg";
+    case REPLAY_GD_ETF_QD:          return "GdEtfQdMsg";
+    case REPLAY_TRADE_TICK:         return "TradeTick";
+    case REPLAY_CANDLE:             return "Candle";
+    default:                        return "unknown";
+    }
+}
+
+} // anonymous namespace
+
+/************************************************************************************************/
+// ReplayWriter
+/************************************************************************************************/
+
+ReplayWriter::ReplayWriter(const std::string &path)
+    : m_file(fopen(path.c_str(), "wb"))
+    , m_path(path)
+{
+    if(!m_file)
+        LONGBEACH_THROW_ERROR_SS("ReplayWriter: cannot open " << path << ": " << strerror(errno));
+    fwrite(ReplayMagic, sizeof(ReplayMagic), 1, m_file);
+    fwrite(&ReplayVersion, sizeof(ReplayVersion), 1, m_file);
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    if(m_file)
+        fclose(m_file);
+}
+
+void ReplayWriter::append(ReplayRecordType type, int64_t timeUs, const void *payload, uint32_t length)
+{
+    if(!m_file)
+        LONGBEACH_THROW_ERROR_SS("ReplayWriter: " << m_path << " is closed");
+    ReplayRecordHeader h;
+    h.type = type;
+    h.length = length;
+    h.timeUs = timeUs;
+    if(fwrite(&h, sizeof(h), 1, m_file) != 1 || (length && fwrite(payload, length, 1, m_file) != 1))
+        LONGBEACH_THROW_ERROR_SS("ReplayWriter: write to " << m_path << " failed: " << strerror(errno));
+}
+
+void ReplayWriter::close()
+{
+    if(m_file && fclose(m_file) != 0)
+    {
+        m_file = NULL;
+        LONGBEACH_THROW_ERROR_SS("ReplayWriter: close of " << m_path << " failed: " << strerror(errno));
+    }
+    m_file = NULL;
+}
+
+/************************************************************************************************/
+// MarketDataReplay
+/************************************************************************************************/
+
+MarketDataReplay::MarketDataReplay(const std::string &path)
+    : m_path(path)
+    , m_data(NULL)
+    , m_size(0)
+    , m_handlers(REPLAY_NUM_RECORD_TYPES)
+    , m_startUs(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: cannot open " << path << ": " << strerror(errno));
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: cannot stat " << path << ": " << strerror(errno));
+    }
+    m_size = st.st_size;
+    if(m_size < FileHeaderSize)
+    {
+        close(fd);
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: " << path << " is not a replay file");
+    }
+
+    void *p = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(p == MAP_FAILED)
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: cannot map " << path << ": " << strerror(errno));
+    m_data = static_cast<const char*>(p);
+    madvise(p, m_size, MADV_SEQUENTIAL);
+
+    uint32_t version;
+    std::memcpy(&version, m_data + sizeof(ReplayMagic), sizeof(version));
+    if(std::memcmp(m_data, ReplayMagic, sizeof(ReplayMagic)) != 0 || version != ReplayVersion)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: " << path << " is not a version " << ReplayVersion << " replay file");
+    }
+}
+
+MarketDataReplay::~MarketDataReplay()
+{
+    if(m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+void MarketDataReplay::setHandler(ReplayRecordType type, const handler_t &handler)
+{
+    if(type <= 0 || type >= REPLAY_NUM_RECORD_TYPES)
+        LONGBEACH_THROW_ERROR_SS("MarketDataReplay: bad record type " << int(type));
+    m_handlers[type] = handler;
+}
+
+MarketDataReplay::Stats MarketDataReplay::run(uint64_t maxRecords, bool profileSignalHandlers)
+{
+    Stats stats;
+    stats.dispatchNs.resize(REPLAY_NUM_RECORD_TYPES);
+
+    const SignalLatencyProfiling profiling(profileSignalHandlers);
+
+    const uint64_t start = SignalLatencyProfiler::now();
+    size_t pos = FileHeaderSize;
+    while(pos + sizeof(ReplayRecordHeader) <= m_size && (maxRecords == 0 || stats.records < maxRecords))
+    {
+        ReplayRecordHeader h;
+        std::memcpy(&h, m_data + pos, sizeof(h));
+        pos += sizeof(h);
+        if(pos + h.length > m_size)
+            LONGBEACH_THROW_ERROR_SS("MarketDataReplay: " << m_path << " is truncated at offset " << pos);
+
+        if(h.type > 0 && h.type < REPLAY_NUM_RECORD_TYPES && m_handlers[h.type] && h.timeUs >= m_startUs)
+        {
+            ReplayRecord r = { ReplayRecordType(h.type), h.timeUs, m_data + pos, h.length };
+            const uint64_t t0 = SignalLatencyProfiler::now();
+            m_handlers[h.type](r);
+            stats.dispatchNs[h.type].record(SignalLatencyProfiler::now() - t0);
+            ++stats.records;
+        }
+        else
+        {
+            ++stats.skipped;
+        }
+        stats.bytes += sizeof(h) + h.length;
+        pos += h.length;
+    }
+    stats.wallNs = SignalLatencyProfiler::now() - start;
+    return stats;
+}
+
+void MarketDataReplay::Stats::print(std::ostream &o) const
+{
+    o << "replayed " << records << " records (" << bytes << " bytes, " << skipped << " skipped) in "
+      << wallNs / 1e6 << " ms: " << uint64_t(recordsPerSecond()) << " records/s" << std::endl;
+    o << "dispatch latency (ns)" << std::endl;
+    for(size_t t = 1; t < dispatchNs.size(); ++t)
+        if(dispatchNs[t].getCount())
+            dispatchNs[t].print(o, recordTypeName(t));
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,114 @@
+#ifndef LONGBEACH_SIGNALS_MARKETDATAREPLAY_H
+#define LONGBEACH_SIGNALS_MARKETDATAREPLAY_H
+
+#include <cstdio>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/signals/LatencyHistogram.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Kinds of record in a replay file.  The payload of each is whatever the recording side wrote;
+/// the handlers registered with MarketDataReplay decode it.
+enum ReplayRecordType
+{
+    REPLAY_CRYPTO_ORDER_DEPTH   = 1,    // CryptoOrderDepthMsg
+    REPLAY_WIND_STOCK_MD        = 2,    // WindStockMarketDataMsg
+    REPLAY_MH_MD                = 3,    // MhMdMsg
+    REPLAY_GD_ETF_QD            = 4,    // GdEtfQdMsg
+    REPLAY_TRADE_TICK           = 5,
+    REPLAY_CANDLE               = 6,
+    REPLAY_NUM_RECORD_TYPES
+};
+
+/// Fixed header in front of every record.
+struct ReplayRecordHeader
+{
+    uint32_t type;
+    uint32_t length;        // payload bytes following the header
+    int64_t  timeUs;        // exchange or capture time of the record, microseconds since epoch
+};
+
+/// One record as handed to a handler.  payload points into the mapped file.
+struct ReplayRecord
+{
+    ReplayRecordType type;
+    int64_t timeUs;
+    const char *payload;
+    uint32_t length;
+};
+
+/// Appends records to a replay file.
+class ReplayWriter : private boost::noncopyable
+{
+public:
+    explicit ReplayWriter(const std::string &path);
+    ~ReplayWriter();
+
+    void append(ReplayRecordType type, int64_t timeUs, const void *payload, uint32_t length);
+    void close();
+
+private:
+    FILE *m_file;
+    std::string m_path;
+};
+
+/// Feeds a recorded message stream, memory-mapped, through caller-supplied handlers as fast as
+/// they will take it, and measures it.
+///
+/// Each handler typically decodes the payload into the matching Msg and dispatches it through
+/// the EventDistributor the signal graph was built on, so a dispatch covers everything the
+/// graph does for that message.  Records are delivered strictly in file order, so two runs over
+/// the same file with the same graph do the same work.  Per-handler timings inside the signals
+/// come from SignalLatencyProfiler, which run() enables for its duration if asked to.  run()
+/// adds to whatever the profiler already holds, so that replays on several threads (e.g. the
+/// shards of a SignalWarmup) can share it: reset it beforehand for a report of one replay.
+class MarketDataReplay : private boost::noncopyable
+{
+public:
+    typedef boost::function<void (const ReplayRecord &)> handler_t;
+
+    struct Stats
+    {
+        Stats() : records(0), bytes(0), skipped(0), wallNs(0) {}
+
+        uint64_t records;
+        uint64_t bytes;
+        uint64_t skipped;                       // records of a type with no handler, or before the start time
+        uint64_t wallNs;
+        std::vector<LatencyHistogram> dispatchNs; // per ReplayRecordType
+
+        double recordsPerSecond() const { return wallNs ? records * 1e9 / wallNs : 0.0; }
+        void print(std::ostream &o) const;
+    };
+
+    explicit MarketDataReplay(const std::string &path);
+    ~MarketDataReplay();
+
+    void setHandler(ReplayRecordType type, const handler_t &handler);
+
+    /// Records stamped before fromUs are skipped without being dispatched, e.g. to replay only
+    /// the last hour of a day's file when warming signals up (see SignalWarmup).
+    void setStartTime(int64_t fromUs) { m_startUs = fromUs; }
+
+    /// Replays the file from the start; maxRecords == 0 means all of it.
+    Stats run(uint64_t maxRecords = 0, bool profileSignalHandlers = true);
+
+private:
+    std::string m_path;
+    const char *m_data;
+    size_t m_size;
+    std::vector<handler_t> m_handlers;
+    int64_t m_startUs;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_MARKETDATAREPLAY_H
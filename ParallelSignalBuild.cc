@@ -0,0 +1,249 @@
+#include <longbeach/signals/ParallelSignalBuild.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/optional.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/clientcore/ClientContext.h>
+#include <longbeach/signals/ShardedSignalEngine.h>
+#include <longbeach/signals/SignalBuilder.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+/// Specs sharing an instrument, with their positions in the caller's list.
+struct Component
+{
+    std::vector<size_t> specIdx;
+};
+
+/// One deque of component indices per worker.  A worker pops from the front of its own deque
+/// and, once it is empty, steals from the back of the others.
+class WorkStealingQueues
+{
+public:
+    explicit WorkStealingQueues(size_t numWorkers)
+        : m_queues(numWorkers)
+    {
+        for(size_t i = 0; i < numWorkers; ++i)
+            m_mutexes.push_back(new boost::mutex);
+    }
+
+    void push(size_t worker, size_t item)
+    {
+        m_queues[worker].push_back(item);
+    }
+
+    boost::optional<size_t> pop(size_t worker)
+    {
+        {
+            boost::mutex::scoped_lock lock(m_mutexes[worker]);
+            if(!m_queues[worker].empty())
+            {
+                size_t item = m_queues[worker].front();
+                m_queues[worker].pop_front();
+                return item;
+            }
+        }
+        for(size_t k = 1; k < m_queues.size(); ++k)
+        {
+            size_t victim = (worker + k) % m_queues.size();
+            boost::mutex::scoped_lock lock(m_mutexes[victim]);
+            if(!m_queues[victim].empty())
+            {
+                size_t item = m_queues[victim].back();
+                m_queues[victim].pop_back();
+                return item;
+            }
+        }
+        return boost::none;
+    }
+
+private:
+    std::vector<std::deque<size_t> > m_queues;
+    boost::ptr_vector<boost::mutex> m_mutexes;
+};
+
+struct ValidationJob
+{
+    const std::vector<ISignalSpecCPtr> *specs;
+    const std::vector<Component> *components;
+    WorkStealingQueues *queues;
+    std::vector<std::string> *errors; // one slot per spec, empty if valid
+
+    void run(size_t worker)
+    {
+        while(boost::optional<size_t> c = queues->pop(worker))
+        {
+            const std::vector<size_t> &idx = (*components)[*c].specIdx;
+            for(std::vector<size_t>::const_iterator it = idx.begin(); it != idx.end(); ++it)
+            {
+                try
+                {
+                    (*specs)[*it]->checkValid();
+                }
+                catch(const std::exception &e)
+                {
+                    (*errors)[*it] = e.what();
+                    if((*errors)[*it].empty())
+                        (*errors)[*it] = "invalid spec";
+                }
+                catch(...)
+                {
+                    // nothing may escape a worker thread
+                    (*errors)[*it] = "invalid spec: unknown exception";
+                }
+            }
+        }
+    }
+};
+
+} // anonymous namespace
+
+ParallelSignalBuild::ParallelSignalBuild(size_t numThreads)
+    : m_numThreads(numThreads)
+    , m_numComponents(0)
+{
+}
+
+void ParallelSignalBuild::validate(const std::vector<ISignalSpecCPtr> &specs)
+{
+    // partition by instrument, in order of first appearance so runs are reproducible.
+    // the same spec object listed twice is validated once, since checkValid caches into it.
+    std::vector<Component> components;
+    std::map<instrument_t, size_t> componentOf;
+    std::set<const ISignalSpec*> seen;
+    for(size_t i = 0; i < specs.size(); ++i)
+    {
+        if(!specs[i])
+            LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: spec " << i << " is null");
+        if(!seen.insert(specs[i].get()).second)
+            continue;
+        std::pair<std::map<instrument_t, size_t>::iterator, bool> ins =
+            componentOf.insert(std::make_pair(specs[i]->getInstrument(), components.size()));
+        if(ins.second)
+            components.push_back(Component());
+        components[ins.first->second].specIdx.push_back(i);
+    }
+    m_numComponents = components.size();
+
+    const size_t numWorkers = std::max<size_t>(1, std::min(m_numThreads, components.size()));
+    WorkStealingQueues queues(numWorkers);
+    for(size_t c = 0; c < components.size(); ++c)
+        queues.push(c % numWorkers, c);
+
+    std::vector<std::string> errors(specs.size());
+    ValidationJob job = { &specs, &components, &queues, &errors };
+    if(m_numThreads == 0)
+    {
+        job.run(0);
+    }
+    else
+    {
+        boost::thread_group workers;
+        for(size_t w = 0; w < numWorkers; ++w)
+            workers.create_thread(boost::bind(&ValidationJob::run, &job, w));
+        workers.join_all();
+    }
+
+    for(size_t i = 0; i < errors.size(); ++i)
+        if(!errors[i].empty())
+            LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: " << specs[i]->getDescription() << ": " << errors[i]);
+}
+
+std::vector<ISignalPtr> ParallelSignalBuild::build(SignalBuilder *builder, const std::vector<ISignalSpecCPtr> &specs)
+{
+    validate(specs);
+
+    // construction and listener wiring stay on this thread, in input order
+    std::vector<ISignalPtr> signals;
+    signals.reserve(specs.size());
+    for(std::vector<ISignalSpecCPtr>::const_iterator it = specs.begin(); it != specs.end(); ++it)
+        signals.push_back(builder->buildSignal(*it));
+    return signals;
+}
+
+std::vector<ISignalPtr> ParallelSignalBuild::build(const builder_factory_t &builderFactory,
+    const std::vector<ISignalSpecCPtr> &specs)
+{
+    if(!builderFactory)
+        LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: no builder factory given");
+    validate(specs);
+
+    const size_t numWorkers = std::max<size_t>(1, m_numThreads);
+    m_workerOf = ShardedSignalEngine::assignShards(specs, numWorkers);
+    m_builders.assign(numWorkers, boost::shared_ptr<SignalBuilder>());
+
+    // signal constructors subscribe to their builder's EventDistributor and schedule wakeups on
+    // its ClockMonitor; neither is thread-safe, so no two workers may share a client context
+    std::map<const ClientContext*, size_t> workerOfContext;
+    for(size_t w = 0; w < numWorkers; ++w)
+    {
+        m_builders[w] = builderFactory(w);
+        if(!m_builders[w])
+            LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: builder factory returned NULL for worker " << w);
+        std::pair<std::map<const ClientContext*, size_t>::iterator, bool> ins =
+            workerOfContext.insert(std::make_pair(m_builders[w]->getClientContext().get(), w));
+        if(!ins.second)
+            LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: workers " << ins.first->second << " and " << w
+                << " were given builders on the same ClientContext");
+    }
+
+    std::vector<ISignalPtr> signals(specs.size());
+    std::vector<std::string> errors(specs.size());
+    if(m_numThreads == 0)
+    {
+        buildWorker(0, &specs, &signals, &errors);
+    }
+    else
+    {
+        boost::thread_group workers;
+        for(size_t w = 0; w < numWorkers; ++w)
+            workers.create_thread(boost::bind(&ParallelSignalBuild::buildWorker, this, w,
+                &specs, &signals, &errors));
+        workers.join_all();
+    }
+
+    for(size_t i = 0; i < errors.size(); ++i)
+        if(!errors[i].empty())
+            LONGBEACH_THROW_ERROR_SS("ParallelSignalBuild: worker " << m_workerOf[i] << ": "
+                << specs[i]->getDescription() << ": " << errors[i]);
+    return signals;
+}
+
+void ParallelSignalBuild::buildWorker(size_t worker, const std::vector<ISignalSpecCPtr> *specs,
+    std::vector<ISignalPtr> *signals, std::vector<std::string> *errors)
+{
+    for(size_t i = 0; i < specs->size(); ++i)
+    {
+        if(m_workerOf[i] != worker)
+            continue;
+        try
+        {
+            (*signals)[i] = m_builders[worker]->buildSignal((*specs)[i]);
+        }
+        catch(const std::exception &e)
+        {
+            (*errors)[i] = e.what();
+            if((*errors)[i].empty())
+                (*errors)[i] = "build failed";
+        }
+        catch(...)
+        {
+            (*errors)[i] = "build failed: unknown exception";
+        }
+    }
+}
+
+} // namespace signals
+} // namespace longbeach
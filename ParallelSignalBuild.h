@@ -0,0 +1,78 @@
+#ifndef LONGBEACH_SIGNALS_PARALLELSIGNALBUILD_H
+#define LONGBEACH_SIGNALS_PARALLELSIGNALBUILD_H
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalSpec.h>
+
+namespace longbeach {
+namespace signals {
+
+class SignalBuilder;
+
+/// Builds a universe of signal specs with the instrument-independent work spread over threads.
+///
+/// The specs are partitioned into components by instrument.  Each component is validated on a
+/// small work-stealing pool; checkValid also memoizes every spec's hash (see SpecHashCache),
+/// which dominates interning at startup.
+///
+/// SignalBuilder and the books, price providers and event subscriptions it hands out are not
+/// thread-safe, so construction runs in parallel only across builders: given a builder factory,
+/// each worker builds, in input order, the specs assigned to it on a builder of its own, with
+/// specs reading the same instruments on the same worker (as ShardedSignalEngine assigns them
+/// to shards).  Signal constructors subscribe to their builder's EventDistributor and schedule
+/// wakeups on its ClockMonitor, so the builders must not share a ClientContext; each context
+/// then sees the subscriptions of one worker, made in input order.  The assignment depends only
+/// on the spec list, so each builder ends up with the graph a serial loop of its buildSignal()
+/// over its specs produces.  Given a single builder, construction stays on the calling thread,
+/// in input order.
+class ParallelSignalBuild : private boost::noncopyable
+{
+public:
+    /// Creates the builder of a worker, on a ClientContext no other worker's builder uses.
+    /// Called on the calling thread, in worker order, before any worker starts.
+    typedef boost::function<boost::shared_ptr<SignalBuilder> (size_t worker)> builder_factory_t;
+
+    /// numThreads == 0 validates and builds on the calling thread.
+    explicit ParallelSignalBuild(size_t numThreads);
+
+    /// Validates all specs, then builds them in order.  If any spec is invalid, the error of the
+    /// first invalid spec (in input order) is rethrown and nothing is built.
+    std::vector<ISignalPtr> build(SignalBuilder *builder, const std::vector<ISignalSpecCPtr> &specs);
+
+    /// Validates all specs, then builds them on max(1, numThreads) workers, each with the
+    /// builder builderFactory gives it.  The result is in input order.  Errors are reported as
+    /// above; if a build fails, the error of the first failed spec is rethrown once all workers
+    /// are done.  Throws before building anything if two builders share a ClientContext.
+    std::vector<ISignalPtr> build(const builder_factory_t &builderFactory, const std::vector<ISignalSpecCPtr> &specs);
+
+    /// Only the parallel validation step of build().
+    void validate(const std::vector<ISignalSpecCPtr> &specs);
+
+    /// Number of components found by the last call, for diagnostics.
+    size_t getNumComponents() const { return m_numComponents; }
+
+    /// Worker a spec passed to the last factory build() was built by, and that worker's builder.
+    size_t getWorkerOf(size_t specIdx) const { return m_workerOf[specIdx]; }
+    const boost::shared_ptr<SignalBuilder> &getBuilder(size_t worker) const { return m_builders[worker]; }
+    size_t getNumWorkers() const { return m_builders.size(); }
+
+private:
+    void buildWorker(size_t worker, const std::vector<ISignalSpecCPtr> *specs,
+        std::vector<ISignalPtr> *signals, std::vector<std::string> *errors);
+
+    size_t m_numThreads;
+    size_t m_numComponents;
+    std::vector<size_t> m_workerOf;
+    std::vector<boost::shared_ptr<SignalBuilder> > m_builders;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_PARALLELSIGNALBUILD_H
@@ -0,0 +1,75 @@
+#include <longbeach/signals/RecomputeMemo.h>
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <typeinfo>
+
+#include <boost/core/demangle.hpp>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+std::string typeName(const ISignal &signal)
+{
+    std::string name = boost::core::demangle(typeid(signal).name());
+    std::string::size_type colons = name.rfind("::");
+    return colons == std::string::npos ? name : name.substr(colons + 2);
+}
+
+struct MemoTotals
+{
+    MemoTotals() : numSignals(0), numHits(0), numMisses(0) {}
+
+    void add(const RecomputeMemo &memo)
+    {
+        ++numSignals;
+        numHits += memo.getNumHits();
+        numMisses += memo.getNumMisses();
+    }
+
+    size_t numSignals;
+    uint64_t numHits;
+    uint64_t numMisses;
+};
+
+void printTotals(std::ostream &o, const std::string &name, const MemoTotals &t)
+{
+    const uint64_t n = t.numHits + t.numMisses;
+    o << std::setw(32) << std::left << name << std::right
+      << std::setw(8) << t.numSignals << std::setw(14) << t.numHits << std::setw(14) << t.numMisses
+      << std::setw(10) << std::fixed << std::setprecision(1) << (n ? 100.0 * t.numHits / n : 0.0) << '%'
+      << std::endl;
+}
+
+} // anonymous namespace
+
+void printRecomputeMemoStats(std::ostream &o, const std::vector<ISignalPtr> &signals)
+{
+    std::map<std::string, MemoTotals> byType;
+    MemoTotals total;
+    for(size_t i = 0; i < signals.size(); ++i)
+    {
+        const IRecomputeMemoized *p = dynamic_cast<const IRecomputeMemoized*>(signals[i].get());
+        if(!p)
+            continue;
+        byType[typeName(*signals[i])].add(p->getRecomputeMemo());
+        total.add(p->getRecomputeMemo());
+    }
+
+    const std::ios::fmtflags flags = o.flags();
+    const std::streamsize precision = o.precision();
+    o << std::setw(32) << std::left << "type" << std::right << std::setw(8) << "signals"
+      << std::setw(14) << "hits" << std::setw(14) << "misses" << std::setw(11) << "hit rate" << std::endl;
+    for(std::map<std::string, MemoTotals>::const_iterator it = byType.begin(); it != byType.end(); ++it)
+        printTotals(o, it->first, it->second);
+    printTotals(o, "total", total);
+    o.flags(flags);
+    o.precision(precision);
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,121 @@
+#ifndef LONGBEACH_SIGNALS_RECOMPUTEMEMO_H
+#define LONGBEACH_SIGNALS_RECOMPUTEMEMO_H
+
+#include <stdint.h>
+#include <iosfwd>
+#include <vector>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/core/ptime.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+/// The versions of a signal's inputs when its state was last recomputed, so that a
+/// recomputeState whose inputs have not advanced since can return the state it already has.
+///
+/// A version is anything that changes whenever its input does: a count of the notifications
+/// the signal took from it, a last change time, an OK flag.  recomputeState builds a Key from
+/// its inputs first thing and returns if check() says it matches; otherwise it recomputes and
+/// then commit()s the key, so a recompute that throws part way is not remembered as done.
+/// Whatever sets the state other than recomputeState (a reset, a batch result, a checkpoint)
+/// must invalidate().
+class RecomputeMemo
+{
+public:
+    static const size_t MaxVersions = 4;
+    static const size_t MaxTimes = 2;
+
+    class Key
+    {
+    public:
+        Key() : m_versions(), m_times(), m_numVersions(0), m_numTimes(0) {}
+
+        Key &add(uint64_t version)
+        {
+            LONGBEACH_ASSERT(m_numVersions < MaxVersions);
+            m_versions[m_numVersions++] = version;
+            return *this;
+        }
+        Key &add(const timeval_t &tv)
+        {
+            LONGBEACH_ASSERT(m_numTimes < MaxTimes);
+            m_times[m_numTimes++] = tv;
+            return *this;
+        }
+
+        bool operator==(const Key &k) const
+        {
+            if(m_numVersions != k.m_numVersions || m_numTimes != k.m_numTimes)
+                return false;
+            for(size_t i = 0; i < m_numVersions; ++i)
+                if(m_versions[i] != k.m_versions[i])
+                    return false;
+            for(size_t i = 0; i < m_numTimes; ++i)
+                if(!(m_times[i] == k.m_times[i]))
+                    return false;
+            return true;
+        }
+
+    private:
+        uint64_t m_versions[MaxVersions];
+        timeval_t m_times[MaxTimes];
+        uint32_t m_numVersions, m_numTimes;
+    };
+
+    RecomputeMemo() : m_bValid(false), m_numHits(0), m_numMisses(0) {}
+
+    /// True, counting a hit, if key is the one of the last committed recompute; otherwise
+    /// counts a miss.
+    bool check(const Key &key)
+    {
+        if(m_bValid && key == m_key)
+        {
+            ++m_numHits;
+            return true;
+        }
+        ++m_numMisses;
+        return false;
+    }
+
+    /// Records key as that of the recompute just completed.
+    void commit(const Key &key)
+    {
+        m_key = key;
+        m_bValid = true;
+    }
+
+    /// The next check misses, whatever its key.
+    void invalidate() { m_bValid = false; }
+
+    uint64_t getNumHits() const { return m_numHits; }
+    uint64_t getNumMisses() const { return m_numMisses; }
+    /// Fraction of the recomputes skipped; 0 before any.
+    double getHitRate() const
+        { return m_numHits + m_numMisses ? double(m_numHits) / double(m_numHits + m_numMisses) : 0.0; }
+
+private:
+    Key m_key;
+    bool m_bValid;
+    uint64_t m_numHits;
+    uint64_t m_numMisses;
+};
+
+/// Implemented by signals that memoize recomputeState, so their hit rates can be reported.
+class IRecomputeMemoized
+{
+public:
+    virtual ~IRecomputeMemoized() {}
+
+    virtual const RecomputeMemo &getRecomputeMemo() const = 0;
+};
+
+/// Hits, misses and hit rate of the memoized ones among signals, by signal type then in total.
+/// Must run on the thread that drives them.
+void printRecomputeMemoStats(std::ostream &o, const std::vector<ISignalPtr> &signals);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_RECOMPUTEMEMO_H
@@ -2,6 +2,10 @@
 
 #include <longbeach/core/LuaCodeGen.h>
 #include <longbeach/core/LuabindScripting.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
 
 namespace longbeach {
@@ -18,10 +22,12 @@ SampleAndHoldSignal::SampleAndHoldSignal(ClockMonitor *cm,
 {
     startPeriodicWakeup();
     m_lastState.resize(subSignal->getStateSize(), 0.0);
+    addEvalUpstream(subSignal.get());
 }
 
 void SampleAndHoldSignal::onPeriodicWakeup(const timeval_t &ctv, const timeval_t &swtv)
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SampleAndHoldSignal", "onPeriodicWakeup", CYCLES_INPUT);
     bool isOK = m_subSignal->isOK();
 
     if(isOK)
@@ -33,7 +39,11 @@ void SampleAndHoldSignal::onPeriodicWakeup(const timeval_t &ctv, const timeval_t
             m_lastState = newState;
             m_lastChangeTime = m_subSignal->getLastChangeTv();
             m_lastWakeupSwtv = swtv;
-            notifySignalListeners();
+            if(!deferNotification())
+            {
+                LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                notifySignalListeners();
+            }
         }
     }
     else
@@ -44,7 +54,11 @@ void SampleAndHoldSignal::onPeriodicWakeup(const timeval_t &ctv, const timeval_t
             m_lastState.resize(m_subSignal->getStateSize(), 0.0);
             m_lastChangeTime = m_subSignal->getLastChangeTv();
             m_lastWakeupSwtv = swtv;
-            notifySignalListeners();
+            if(!deferNotification())
+            {
+                LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                notifySignalListeners();
+            }
         }
     }
 }
@@ -63,21 +77,26 @@ SampleAndHoldSignalSpec::SampleAndHoldSignalSpec(const SampleAndHoldSignalSpec &
 
 ISignalPtr SampleAndHoldSignalSpec::build(SignalBuilder *builder) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SampleAndHoldSignalSpec", "build", getDescription());
     ISignalPtr subSignal = builder->buildSignal(m_subSignal);
-    return ISignalPtr(new SampleAndHoldSignal(
+
+    LONGBEACH_PROFILE_BUILD_SCOPE("SampleAndHoldSignal", "construct", getDescription());
+    return makeSignalObject<SampleAndHoldSignal>(
             builder->getClockMonitor().get(),
             subSignal,
             m_wakeupInterval,
             m_wakeupOffset,
-            m_wakeupPriority));
+            m_wakeupPriority);
 }
 
 void SampleAndHoldSignalSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SampleAndHoldSignalSpec", "checkValid", getDescription());
     ISignalSpec::checkValid();
     m_subSignal->checkValid();
     if(m_wakeupInterval.ticks() == 0)
         LONGBEACH_THROW_ERROR_SS("SampleAndHoldSignal " << m_subSignal->getDescription() << ": wakeup interval is 0");
+    cacheHash();
 }
 
 SampleAndHoldSignalSpec *SampleAndHoldSignalSpec::clone() const
@@ -87,14 +106,20 @@ SampleAndHoldSignalSpec *SampleAndHoldSignalSpec::clone() const
 
 void SampleAndHoldSignalSpec::hashCombine(size_t &result) const
 {
-    boost::hash_combine(result, *m_subSignal);
-    boost::hash_combine(result, m_wakeupInterval);
-    boost::hash_combine(result, m_wakeupOffset);
-    boost::hash_combine(result, m_wakeupPriority);
+    boost::hash_combine(result, specHash());
+}
+
+void SampleAndHoldSignalSpec::hashMembers(size_t &seed) const
+{
+    boost::hash_combine(seed, *m_subSignal);
+    boost::hash_combine(seed, m_wakeupInterval);
+    boost::hash_combine(seed, m_wakeupOffset);
+    boost::hash_combine(seed, m_wakeupPriority);
 }
 
 bool SampleAndHoldSignalSpec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     const SampleAndHoldSignalSpec *b = dynamic_cast<const SampleAndHoldSignalSpec*>(other);
     if(!b) return false;
     if(*this->m_subSignal != *b->m_subSignal) return false;
@@ -120,9 +145,26 @@ void SampleAndHoldSignalSpec::print(std::ostream &o, const LuaPrintSettings &ps)
 
 void SampleAndHoldSignalSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SampleAndHoldSignalSpec", "getDataRequirements", getDescription());
     m_subSignal->getDataRequirements(rqs);
 }
 
+void SampleAndHoldSignalSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSpec(m_subSignal);
+    ar.write(m_wakeupInterval);
+    ar.write(m_wakeupOffset);
+    ar.write(m_wakeupPriority);
+}
+
+void SampleAndHoldSignalSpec::readBinary(SpecInArchive &ar)
+{
+    m_subSignal = ar.readSpec();
+    ar.read(m_wakeupInterval);
+    ar.read(m_wakeupOffset);
+    ar.read(m_wakeupPriority);
+}
+
 bool SampleAndHoldSignalSpec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -6,6 +6,9 @@
 
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
 #include <longbeach/clientcore/PeriodicWakeup.h>
 
 namespace longbeach {
@@ -14,6 +17,7 @@ namespace signals {
 /// Samples a given signal at fixed intervals.
 class SampleAndHoldSignal
     : public SignalImpl
+    , public EvalEngineNode
     , public PeriodicWakeup
 {
 public:
@@ -41,6 +45,7 @@ public:
 
 protected:
     void onPeriodicWakeup(const timeval_t &ctv, const timeval_t &swtv);
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
 
     ISignalPtr m_subSignal;
     bool m_lastIsOK;
@@ -50,7 +55,10 @@ protected:
 LONGBEACH_DECLARE_SHARED_PTR(SampleAndHoldSignal);
 
 /// SampleAndHoldSignalSpec
-class SampleAndHoldSignalSpec : public ISignalSpec
+class SampleAndHoldSignalSpec
+    : public ISignalSpec
+    , public SpecHashCache<SampleAndHoldSignalSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -66,6 +74,13 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SampleAndHoldSignalSpec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SampleAndHoldSignalSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     virtual instrument_t getInstrument() const { return m_subSignal->getInstrument(); }
     virtual std::string getDescription() const { return m_subSignal->getDescription(); }
 
@@ -0,0 +1,177 @@
+#ifndef LONGBEACH_SIGNALS_SHARDQUEUE_H
+#define LONGBEACH_SIGNALS_SHARDQUEUE_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Size assumed for a cache line when padding per-thread state.
+#define LONGBEACH_CACHE_LINE_SIZE 64
+
+/// Base for objects that are allocated on the heap and written by one thread while
+/// neighbouring objects are written by another.  operator new hands out cache-line-aligned
+/// storage, which plain new does not guarantee for over-aligned types before C++17.
+struct CacheAligned
+{
+    static void *operator new(size_t sz)
+    {
+        void *p = NULL;
+        if(posix_memalign(&p, LONGBEACH_CACHE_LINE_SIZE, sz) != 0)
+            throw std::bad_alloc();
+        return p;
+    }
+    static void operator delete(void *p) { free(p); }
+};
+
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+///
+/// The head (written by the consumer) and tail (written by the producer) sit on their own cache
+/// lines, and each side keeps a private copy of the other's index so it only touches the shared
+/// line when it appears to be full or empty.
+template<typename T>
+class SpscQueue
+    : public CacheAligned
+    , private boost::noncopyable
+{
+public:
+    /// capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity)
+        : m_mask(roundUp(capacity) - 1)
+        , m_slots(m_mask + 1)
+        , m_head(0)
+        , m_cachedTail(0)
+        , m_tail(0)
+        , m_cachedHead(0)
+    {
+    }
+
+    /// Producer side.  Returns false if the queue is full.
+    bool push(const T &v)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if(tail - m_cachedHead > m_mask)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if(tail - m_cachedHead > m_mask)
+                return false;
+        }
+        m_slots[tail & m_mask] = v;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side.  Returns false if the queue is empty.
+    bool pop(T &v)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if(head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if(head == m_cachedTail)
+                return false;
+        }
+        v = m_slots[head & m_mask];
+        m_slots[head & m_mask] = T(); // release whatever the slot holds now, not on the next lap
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    static size_t roundUp(size_t n)
+    {
+        if(n == 0)
+            LONGBEACH_THROW_ERROR_SS("SpscQueue: capacity must be positive");
+        size_t p = 1;
+        while(p < n)
+            p <<= 1;
+        return p;
+    }
+
+    const size_t m_mask;
+    std::vector<T> m_slots;
+
+    // consumer-owned line
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+    size_t m_cachedTail;
+
+    // producer-owned line
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+    size_t m_cachedHead;
+};
+
+/// Single-slot lock-free mailbox for one producer thread and one consumer thread, where the
+/// consumer only wants the latest value.
+///
+/// A triple buffer: the producer fills its private slot and swaps it with the shared middle
+/// one; the consumer swaps its private slot with the middle one when that holds something new.
+/// Neither side ever waits for the other, and a value the consumer has not taken yet is simply
+/// replaced.  Slots are reused, so a T that owns buffers (vectors sized on first use) stops
+/// allocating after the first few exchanges.
+template<typename T>
+class LatestValueMailbox
+    : public CacheAligned
+    , private boost::noncopyable
+{
+public:
+    LatestValueMailbox()
+        : m_middle(1)
+        , m_write(0)
+        , m_read(2)
+    {
+    }
+
+    /// Producer side: the slot to fill before publish.
+    T &writeSlot() { return m_slots[m_write].value; }
+
+    /// Producer side.  Makes the write slot the latest value; returns true if that replaced
+    /// one the consumer never took.
+    bool publish()
+    {
+        const unsigned prev = m_middle.exchange(m_write | FreshBit, std::memory_order_acq_rel);
+        m_write = prev & IndexMask;
+        return (prev & FreshBit) != 0;
+    }
+
+    /// Consumer side.  Moves the latest value to the read slot; returns false, leaving the read
+    /// slot as it was, if nothing was published since the last take.
+    bool take()
+    {
+        if(!(m_middle.load(std::memory_order_relaxed) & FreshBit))
+            return false;
+        const unsigned prev = m_middle.exchange(m_read, std::memory_order_acq_rel);
+        m_read = prev & IndexMask;
+        return true;
+    }
+
+    /// Consumer side: the value of the last successful take.
+    const T &readSlot() const { return m_slots[m_read].value; }
+
+private:
+    static const unsigned IndexMask = 3;
+    static const unsigned FreshBit = 4;
+
+    struct alignas(LONGBEACH_CACHE_LINE_SIZE) Slot
+    {
+        T value;
+    };
+
+    Slot m_slots[3];
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<unsigned> m_middle;  // index, plus FreshBit
+    alignas(LONGBEACH_CACHE_LINE_SIZE) unsigned m_write;                // producer-owned
+    alignas(LONGBEACH_CACHE_LINE_SIZE) unsigned m_read;                 // consumer-owned
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SHARDQUEUE_H
@@ -0,0 +1,445 @@
+#include <longbeach/signals/ShardedSignalEngine.h>
+
+#include <map>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/ParallelSignalBuild.h>
+#include <longbeach/signals/SampleAndHoldSignal.h>
+#include <longbeach/signals/SignalBuilder.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+// the shard the calling thread runs, if it is one of an engine's workers
+thread_local const ShardedSignalEngine *t_pEngine = NULL;
+thread_local size_t t_shard = 0;
+
+struct CurrentShardScope
+{
+    CurrentShardScope(const ShardedSignalEngine *engine, size_t shard)
+    {
+        t_pEngine = engine;
+        t_shard = shard;
+    }
+    ~CurrentShardScope() { t_pEngine = NULL; }
+};
+
+/// Union-find over instruments, so that instruments read by one spec end up in one group.
+class InstrumentGroups
+{
+public:
+    size_t add(const instrument_t &instr)
+    {
+        std::pair<std::map<instrument_t, size_t>::iterator, bool> ins =
+            m_index.insert(std::make_pair(instr, m_parent.size()));
+        if(ins.second)
+            m_parent.push_back(m_parent.size());
+        return ins.first->second;
+    }
+
+    size_t find(size_t i)
+    {
+        while(m_parent[i] != i)
+            i = m_parent[i] = m_parent[m_parent[i]];
+        return i;
+    }
+
+    // the root is always the earlier instrument, which keeps group order = first appearance
+    void join(size_t a, size_t b)
+    {
+        a = find(a);
+        b = find(b);
+        if(a < b)
+            m_parent[b] = a;
+        else if(b < a)
+            m_parent[a] = b;
+    }
+
+private:
+    std::map<instrument_t, size_t> m_index;
+    std::vector<size_t> m_parent;
+};
+
+/// Joins into group every instrument spec reads: its own, its reference price's, and those of
+/// the spec a wrapper is built on.
+void joinInputs(InstrumentGroups &groups, size_t group, const ISignalSpec *spec)
+{
+    groups.join(group, groups.add(spec->getInstrument()));
+    if(const SignalSpec *ss = dynamic_cast<const SignalSpec*>(spec))
+    {
+        // the reference price of a spec may be another instrument (SigDiff's b leg, a
+        // SigKalmanFilter priced off a different book); keep it with the spec
+        if(ss->m_refPxP)
+            groups.join(group, groups.add(ss->m_refPxP->getInstrument()));
+    }
+    else if(const SampleAndHoldSignalSpec *sh = dynamic_cast<const SampleAndHoldSignalSpec*>(spec))
+    {
+        if(sh->m_subSignal)
+            joinInputs(groups, group, sh->m_subSignal.get());
+    }
+    else if(const AsyncSignalSpec *as = dynamic_cast<const AsyncSignalSpec*>(spec))
+    {
+        if(as->m_subSignal)
+            joinInputs(groups, group, as->m_subSignal.get());
+    }
+}
+
+struct PriceRelay
+{
+    ShardedSignalEngine *engine;
+    size_t fromShard, toShard;
+    boost::function<void (double, bool)> onChange;
+
+    void operator()(const IPriceProvider &pp) const
+    {
+        engine->post(fromShard, toShard, boost::bind(onChange, pp.getRefPrice(), pp.isPriceOK()));
+    }
+};
+
+/// The receiving end of relayPrice: holds the last price relayed, and is only ever changed,
+/// and so only notifies its listeners, on the receiving shard's thread.
+class RelayedPriceProvider : public PriceProviderImpl
+{
+public:
+    explicit RelayedPriceProvider(const IPriceProvider &source)
+        : m_instr(source.getInstrument())
+        , m_px(source.getRefPrice())
+        , m_bOK(source.isPriceOK())
+        , m_lastChangeTv(source.getLastChangeTime())
+    {
+    }
+
+    virtual double getRefPrice(bool *pSuccess = NULL) const
+    {
+        if(pSuccess)
+            *pSuccess = m_bOK;
+        return m_px;
+    }
+    virtual bool isPriceOK() const { return m_bOK; }
+    virtual const instrument_t &getInstrument() const { return m_instr; }
+    virtual timeval_t getLastChangeTime() const { return m_lastChangeTv; }
+
+    void update(double px, bool ok, const timeval_t &tv)
+    {
+        m_px = px;
+        m_bOK = ok;
+        m_lastChangeTv = tv;
+        notifyPriceListeners();
+    }
+
+private:
+    instrument_t m_instr;
+    double m_px;
+    bool m_bOK;
+    timeval_t m_lastChangeTv;
+};
+LONGBEACH_DECLARE_SHARED_PTR(RelayedPriceProvider);
+
+struct PriceProviderRelay
+{
+    ShardedSignalEngine *engine;
+    size_t fromShard, toShard;
+    RelayedPriceProviderPtr target;
+
+    void operator()(const IPriceProvider &pp) const
+    {
+        engine->post(fromShard, toShard, boost::bind(&RelayedPriceProvider::update, target,
+            pp.getRefPrice(), pp.isPriceOK(), pp.getLastChangeTime()));
+    }
+};
+
+} // anonymous namespace
+
+ShardedSignalEngine::ShardedSignalEngine(size_t numShards, const builder_factory_t &builderFactory, size_t queueCapacity)
+    : m_builderFactory(builderFactory)
+    , m_bUseArenas(false)
+    , m_bStop(false)
+    , m_numDone(0)
+    , m_numInFlight(0)
+{
+    if(numShards == 0)
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: need at least one shard");
+    if(!m_builderFactory)
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: no builder factory given");
+
+    for(size_t i = 0; i < numShards; ++i)
+    {
+        m_shards.push_back(new Shard);
+        m_shards.back().backlog.resize(numShards);
+    }
+    for(size_t i = 0; i < numShards * numShards; ++i)
+        m_channels.push_back(new SpscQueue<work_t>(queueCapacity));
+}
+
+ShardedSignalEngine::~ShardedSignalEngine()
+{
+}
+
+std::vector<size_t> ShardedSignalEngine::assignShards(const std::vector<ISignalSpecCPtr> &specs, size_t numShards)
+{
+    if(numShards == 0)
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: need at least one shard");
+
+    InstrumentGroups groups;
+    std::vector<size_t> instrOf(specs.size());
+    for(size_t i = 0; i < specs.size(); ++i)
+    {
+        if(!specs[i])
+            LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: spec " << i << " is null");
+        instrOf[i] = groups.add(specs[i]->getInstrument());
+        joinInputs(groups, instrOf[i], specs[i].get());
+    }
+
+    // weigh each group by its number of specs, then place groups in order of first appearance
+    std::map<size_t, size_t> weight;
+    std::vector<size_t> order;
+    for(size_t i = 0; i < specs.size(); ++i)
+    {
+        size_t g = groups.find(instrOf[i]);
+        if(weight[g]++ == 0)
+            order.push_back(g);
+    }
+
+    std::map<size_t, size_t> shardOfGroup;
+    std::vector<size_t> load(numShards, 0);
+    for(std::vector<size_t>::const_iterator it = order.begin(); it != order.end(); ++it)
+    {
+        size_t best = 0;
+        for(size_t s = 1; s < numShards; ++s)
+            if(load[s] < load[best])
+                best = s;
+        shardOfGroup[*it] = best;
+        load[best] += weight[*it];
+    }
+
+    std::vector<size_t> shardOf(specs.size());
+    for(size_t i = 0; i < specs.size(); ++i)
+        shardOf[i] = shardOfGroup[groups.find(instrOf[i])];
+    return shardOf;
+}
+
+std::vector<ISignalPtr> ShardedSignalEngine::build(const std::vector<ISignalSpecCPtr> &specs)
+{
+    m_shardOf = assignShards(specs, m_shards.size());
+    ParallelSignalBuild(m_shards.size()).validate(specs);
+
+    // each shard creates its builder and signals on its own thread, so that what it allocates
+    // is local to the core that will run it
+    std::vector<ISignalPtr> signals(specs.size());
+    std::vector<std::string> errors(specs.size());
+    boost::thread_group workers;
+    for(size_t s = 0; s < m_shards.size(); ++s)
+        workers.create_thread(boost::bind(&ShardedSignalEngine::buildShard, this, s, &specs, &signals, &errors));
+    workers.join_all();
+
+    for(size_t i = 0; i < errors.size(); ++i)
+        if(!errors[i].empty())
+            LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: shard " << m_shardOf[i] << ": "
+                << specs[i]->getDescription() << ": " << errors[i]);
+    return signals;
+}
+
+void ShardedSignalEngine::buildShard(size_t shard, const std::vector<ISignalSpecCPtr> *specs,
+    std::vector<ISignalPtr> *signals, std::vector<std::string> *errors)
+{
+    CurrentShardScope scope(this, shard);
+    Shard &s = m_shards[shard];
+    if(m_bUseArenas && !s.arena)
+        s.arena = boost::make_shared<SignalArena>(m_arenaOptions);
+    SignalArenaScope arenaScope(s.arena);
+    try
+    {
+        if(!s.builder)
+            s.builder = m_builderFactory(shard);
+        if(!s.builder)
+            LONGBEACH_THROW_ERROR_SS("builder factory returned NULL");
+    }
+    catch(const std::exception &e)
+    {
+        for(size_t i = 0; i < specs->size(); ++i)
+            if(m_shardOf[i] == shard)
+                (*errors)[i] = e.what();
+        return;
+    }
+    catch(...)
+    {
+        // nothing may escape a shard's thread
+        for(size_t i = 0; i < specs->size(); ++i)
+            if(m_shardOf[i] == shard)
+                (*errors)[i] = "build failed: builder factory threw an unknown exception";
+        return;
+    }
+
+    for(size_t i = 0; i < specs->size(); ++i)
+    {
+        if(m_shardOf[i] != shard)
+            continue;
+        try
+        {
+            (*signals)[i] = s.builder->buildSignal((*specs)[i]);
+        }
+        catch(const std::exception &e)
+        {
+            (*errors)[i] = e.what();
+            if((*errors)[i].empty())
+                (*errors)[i] = "build failed";
+        }
+        catch(...)
+        {
+            (*errors)[i] = "build failed: unknown exception";
+        }
+    }
+}
+
+void ShardedSignalEngine::useArenas(const SignalArena::Options &options)
+{
+    m_bUseArenas = true;
+    m_arenaOptions = options;
+}
+
+const boost::shared_ptr<SignalBuilder> &ShardedSignalEngine::getBuilder(size_t shard) const
+{
+    if(shard >= m_shards.size())
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: no shard " << shard);
+    return m_shards[shard].builder;
+}
+
+void ShardedSignalEngine::run(const event_loop_step_t &step)
+{
+    m_bStop.store(false, std::memory_order_relaxed);
+    m_numDone.store(0, std::memory_order_relaxed);
+    // work left over from a stopped run is still queued and counted, and runs first
+    for(size_t s = 0; s < m_shards.size(); ++s)
+        m_shards[s].bDone = false;
+
+    boost::thread_group workers;
+    for(size_t s = 0; s < m_shards.size(); ++s)
+        workers.create_thread(boost::bind(&ShardedSignalEngine::runShard, this, s, &step));
+    workers.join_all();
+}
+
+void ShardedSignalEngine::runShard(size_t shard, const event_loop_step_t *step)
+{
+    CurrentShardScope scope(this, shard);
+    Shard &s = m_shards[shard];
+    while(!m_bStop.load(std::memory_order_acquire))
+    {
+        const size_t numRun = drainInbound(shard);
+        const bool bFlushed = flushBacklog(shard);
+        if(!s.bDone && bFlushed)
+        {
+            ++s.numSteps;
+            if(!(*step)(shard))
+            {
+                s.bDone = true;
+                m_numDone.fetch_add(1, std::memory_order_acq_rel);
+            }
+        }
+        else if(s.bDone && m_numDone.load(std::memory_order_acquire) == m_shards.size()
+            && m_numInFlight.load(std::memory_order_acquire) == 0)
+        {
+            // no feed is left, and no work is queued or running that could post more
+            break;
+        }
+        else if(numRun == 0)
+        {
+            boost::this_thread::yield();
+        }
+    }
+}
+
+size_t ShardedSignalEngine::drainInbound(size_t shard)
+{
+    size_t n = 0;
+    work_t fn;
+    for(size_t from = 0; from < m_shards.size(); ++from)
+    {
+        SpscQueue<work_t> &q = channel(from, shard);
+        while(q.pop(fn))
+        {
+            fn();
+            ++n;
+            // only once it has run, so that whatever it posted is counted first
+            m_numInFlight.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+    m_shards[shard].numReceived += n;
+    return n;
+}
+
+bool ShardedSignalEngine::flushBacklog(size_t shard)
+{
+    bool bEmpty = true;
+    std::vector<std::deque<work_t> > &backlog = m_shards[shard].backlog;
+    for(size_t to = 0; to < backlog.size(); ++to)
+    {
+        std::deque<work_t> &pending = backlog[to];
+        SpscQueue<work_t> &q = channel(shard, to);
+        while(!pending.empty() && q.push(pending.front()))
+            pending.pop_front();
+        bEmpty = bEmpty && pending.empty();
+    }
+    return bEmpty;
+}
+
+void ShardedSignalEngine::post(size_t fromShard, size_t toShard, const work_t &fn)
+{
+    if(fromShard >= m_shards.size() || toShard >= m_shards.size())
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: bad shard in post " << fromShard << " -> " << toShard);
+
+    ++m_shards[fromShard].numPosted;
+
+    // a full queue parks the work rather than waiting here: two shards posting to each other
+    // must not block, and running inbound work from inside a handler would reenter it.  for
+    // the same reason work a shard posts to itself is queued too, on its own channel.
+    // the backlog keeps the order, since nothing bypasses it while it is not empty
+    m_numInFlight.fetch_add(1, std::memory_order_acq_rel);
+    std::deque<work_t> &pending = m_shards[fromShard].backlog[toShard];
+    if(!pending.empty() || !channel(fromShard, toShard).push(fn))
+        pending.push_back(fn);
+}
+
+void ShardedSignalEngine::relayPrice(size_t fromShard, const IPriceProviderPtr &pxp,
+    size_t toShard, const boost::function<void (double, bool)> &onChange)
+{
+    if(!pxp)
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: relayPrice was passed a NULL price provider");
+
+    PriceRelay relay = { this, fromShard, toShard, onChange };
+    Shard &s = m_shards[fromShard];
+    Subscription sub;
+    pxp->addPriceListener(sub, relay);
+    s.relayed.push_back(pxp);
+    s.relaySubs.push_back(sub);
+}
+
+IPriceProviderPtr ShardedSignalEngine::relayPrice(size_t fromShard, const IPriceProviderPtr &pxp, size_t toShard)
+{
+    if(!pxp)
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: relayPrice was passed a NULL price provider");
+    if(fromShard >= m_shards.size() || toShard >= m_shards.size())
+        LONGBEACH_THROW_ERROR_SS("ShardedSignalEngine: bad shard in relayPrice " << fromShard << " -> " << toShard);
+
+    RelayedPriceProviderPtr target(new RelayedPriceProvider(*pxp));
+    PriceProviderRelay relay = { this, fromShard, toShard, target };
+    Shard &s = m_shards[fromShard];
+    Subscription sub;
+    pxp->addPriceListener(sub, relay);
+    s.relayed.push_back(pxp);
+    s.relaySubs.push_back(sub);
+    return target;
+}
+
+size_t ShardedSignalEngine::getCurrentShard() const
+{
+    return t_pEngine == this ? t_shard : m_shards.size();
+}
+
+} // namespace signals
+} // namespace longbeach
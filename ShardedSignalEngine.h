@@ -0,0 +1,154 @@
+#ifndef LONGBEACH_SIGNALS_SHARDEDSIGNALENGINE_H
+#define LONGBEACH_SIGNALS_SHARDEDSIGNALENGINE_H
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/clientcore/PriceProvider.h>
+#include <longbeach/signals/ShardQueue.h>
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalSpec.h>
+
+namespace longbeach {
+namespace signals {
+
+class SignalBuilder;
+
+/// Runs a universe of signals as N independent shards, one thread and one event loop each.
+///
+/// Instruments are partitioned across shards together with everything built for them: each
+/// shard has its own SignalBuilder (and so its own ClientContext, EventDistributor, books and
+/// tick providers), supplied by the caller, and builds and runs its signals on its own thread.
+/// Instruments that a spec reads together (e.g. the two legs of a SigDiff, or a
+/// SigKalmanFilter's input and reference price, including through a SampleAndHoldSignalSpec or
+/// AsyncSignalSpec wrapper) are kept on the same shard, so the usual universe has no
+/// cross-shard edges.  Inputs that must cross shards anyway go through post() or relayPrice(),
+/// which use one SpscQueue per ordered pair of shards.
+///
+/// The assignment depends only on the order and contents of the spec list, and each shard
+/// handles its own feed in order, so a signal with no cross-shard inputs sees the same
+/// sequence of inputs as it would in a single-threaded run.  Work crossing shards arrives in
+/// the order it was posted by each shard, but at a point in the receiving shard's own feed that
+/// depends on thread timing: signals reading relayed inputs are not reproducible run to run.
+class ShardedSignalEngine : private boost::noncopyable
+{
+public:
+    /// Creates the builder for a shard.  Called on that shard's thread.
+    typedef boost::function<boost::shared_ptr<SignalBuilder> (size_t shard)> builder_factory_t;
+
+    /// Runs one turn of a shard's event loop (e.g. dispatches the next batch of its feed).
+    /// Returns false once the shard has nothing more to do.
+    typedef boost::function<bool (size_t shard)> event_loop_step_t;
+
+    typedef boost::function<void ()> work_t;
+
+    ShardedSignalEngine(size_t numShards, const builder_factory_t &builderFactory, size_t queueCapacity = 4096);
+    ~ShardedSignalEngine();
+
+    size_t getNumShards() const { return m_shards.size(); }
+
+    /// Computes the shard of every spec.  Specs reading the same instruments are grouped, and
+    /// groups (in order of first appearance) go to the least loaded shard, lowest index on ties.
+    static std::vector<size_t> assignShards(const std::vector<ISignalSpecCPtr> &specs, size_t numShards);
+
+    /// Validates and builds every spec on its shard's thread.  The result is in input order.
+    std::vector<ISignalPtr> build(const std::vector<ISignalSpecCPtr> &specs);
+
+    /// Shard a spec passed to the last build() was assigned to.
+    size_t getShardOf(size_t specIdx) const { return m_shardOf[specIdx]; }
+
+    /// Builder of a shard, for wiring inputs after build().
+    const boost::shared_ptr<SignalBuilder> &getBuilder(size_t shard) const;
+
+    /// Gives each shard a SignalArena, current while the shard builds, so that its signals
+    /// and their fixed buffers are laid out together, in spec order, in memory first touched
+    /// by the shard's own thread.  Call before the first build().
+    void useArenas(const SignalArena::Options &options = SignalArena::Options());
+
+    /// Arena of a shard, NULL unless useArenas() was called.
+    const SignalArenaPtr &getArena(size_t shard) const { return m_shards[shard].arena; }
+
+    /// Runs every shard's event loop on its own thread until all steps return false and all
+    /// the posted work has run, or until stop() is called.  Between steps a
+    /// shard runs the work posted to it; a shard whose feed is done keeps doing so
+    /// until every shard is done.
+    void run(const event_loop_step_t &step);
+
+    /// Asks run() to return after the current step of every shard.
+    void stop() { m_bStop.store(true, std::memory_order_release); }
+
+    /// Queues work from fromShard (which must be the calling thread's shard) to run on
+    /// toShard's thread.  Never blocks or runs other work, fn included, even when toShard is
+    /// fromShard: fn runs once the current step or work item has returned.  If the queue is
+    /// full the work waits in fromShard's backlog, and fromShard takes no further step until
+    /// its backlog has gone through, which bounds how far a producer can run ahead of its
+    /// consumer.
+    void post(size_t fromShard, size_t toShard, const work_t &fn);
+
+    /// Forwards every change of pxp, which lives on fromShard, to onChange on toShard's thread,
+    /// as (refPrice, isPriceOK).  Must be called on fromShard's thread or before run().
+    void relayPrice(size_t fromShard, const IPriceProviderPtr &pxp,
+        size_t toShard, const boost::function<void (double, bool)> &onChange);
+
+    /// A price provider living on toShard that follows pxp, which lives on fromShard, so that
+    /// signals on toShard (SigDiff, SigKalmanFilter, ...) can be built on it.  Its listeners are
+    /// called on toShard's thread.  Must be called on fromShard's thread or before run().
+    IPriceProviderPtr relayPrice(size_t fromShard, const IPriceProviderPtr &pxp, size_t toShard);
+
+    /// The shard whose thread is calling, or getNumShards() on any other thread.
+    size_t getCurrentShard() const;
+
+    /// Per-shard counters, for diagnostics.
+    uint64_t getNumSteps(size_t shard) const { return m_shards[shard].numSteps; }
+    uint64_t getNumPosted(size_t shard) const { return m_shards[shard].numPosted; }
+    uint64_t getNumReceived(size_t shard) const { return m_shards[shard].numReceived; }
+
+private:
+    /// Everything a shard's thread writes while running sits in its own cache-aligned block.
+    struct alignas(LONGBEACH_CACHE_LINE_SIZE) Shard
+        : public CacheAligned
+    {
+        Shard() : numSteps(0), numPosted(0), numReceived(0), bDone(false) {}
+
+        boost::shared_ptr<SignalBuilder> builder;
+        SignalArenaPtr arena;
+        std::vector<IPriceProviderPtr> relayed;
+        std::vector<Subscription> relaySubs;
+        std::vector<std::deque<work_t> > backlog;   // [toShard], posts that found the queue full
+        uint64_t numSteps;
+        uint64_t numPosted;
+        uint64_t numReceived;
+        bool bDone;
+    };
+
+    void buildShard(size_t shard, const std::vector<ISignalSpecCPtr> *specs,
+        std::vector<ISignalPtr> *signals, std::vector<std::string> *errors);
+    void runShard(size_t shard, const event_loop_step_t *step);
+    size_t drainInbound(size_t shard);
+    /// Moves what it can of the shard's backlog into the queues.  Returns true if it is empty.
+    bool flushBacklog(size_t shard);
+
+    SpscQueue<work_t> &channel(size_t from, size_t to) { return m_channels[from * m_shards.size() + to]; }
+
+    builder_factory_t m_builderFactory;
+    boost::ptr_vector<Shard> m_shards;
+    boost::ptr_vector<SpscQueue<work_t> > m_channels; // [from * numShards + to]
+    std::vector<size_t> m_shardOf;
+    bool m_bUseArenas;
+    SignalArena::Options m_arenaOptions;
+    std::atomic<bool> m_bStop;
+    std::atomic<size_t> m_numDone;
+    std::atomic<uint64_t> m_numInFlight;    // posted and not yet run
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SHARDEDSIGNALENGINE_H
@@ -1,5 +1,6 @@
 #include <longbeach/signals/SigBook.h>
 
+#include <algorithm>
 #include <iostream>
 #include <boost/format.hpp>
 #include <boost/bind.hpp>
@@ -7,24 +8,48 @@
 #include <longbeach/core/LuaCodeGen.h>
 #include <longbeach/core/LuabindScripting.h>
 #include <longbeach/clientcore/BookLevel.h>
+#include <longbeach/signals/BatchSignalEval.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalCycleCounters.h>
+#include <longbeach/signals/SignalLog.h>
 #include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SigBookBatchEngine.h>
 
 namespace longbeach {
 namespace signals {
 
 using std::cout;
 
+namespace {
+SignalLogSite s_logSourcesNotOK("SigBook::updateVars sources not ok, vars set to 0", "", 10);
+SignalLogSite s_logNotEnoughLevels("SigBook::updateVars not enough levels, vars set to 0", "levels", 10);
+SignalLogSite s_logNoSize("SigBook::updateVars level has no size in units, vars set to 0", "level,size_unit", 10);
+SignalLogSite s_logOverflow("SigBook::updateVars tick sums overflow, vars set to 0", "level,tick_size,size_unit", 10);
+SignalLogSite s_logClampBid("SigBook::updateVars diff too large, normalizing bid", "level,from,to", 100);
+SignalLogSite s_logClampAsk("SigBook::updateVars diff too large, normalizing ask", "level,from,to", 100);
+}
+
 SigBook::SigBook(const instrument_t& instr, const std::string &desc, ClockMonitorPtr clockm,
-                 IPriceProviderPtr spRefpp, IBookPtr spBook, size_t num_levels, size_t num_sbvars, int vbose, ReturnMode returnMode)
+                 IPriceProviderPtr spRefpp, IBookPtr spBook, size_t num_levels, size_t num_sbvars, int vbose, ReturnMode returnMode,
+                 double tickSize, double sizeUnit)
     : SignalSmonImpl( instr, desc, clockm, vbose )
     , m_spRefpp( spRefpp )
     , m_spBook( spBook )
     , m_vars(num_sbvars, 0.0)
+    , m_levelScratch(6 * num_levels, 0.0)
     , m_varsOK(false)
     , m_varsDirty(false)
     , m_numLevels(num_levels)
     , m_numSBvars(num_sbvars)
     , m_returnMode(returnMode)
+    , m_tickSize(tickSize)
+    , m_sizeUnit(sizeUnit)
+    , m_pBatchEngine(NULL)
+    , m_batchGroup(0)
+    , m_bBatchDirty(false)
+    , m_bBatchState(false)
+    , m_numInputs(0)
 {
     if (m_spBook->addBookListener(this) == false)
         LONGBEACH_THROW_ERROR_SS("SigBook: Book::addListener returned false");
@@ -45,9 +70,79 @@ SigBook::SigBook(const instrument_t& instr, const std::string &desc, ClockMonito
 
 SigBook::~SigBook()
 {
+    if(m_pBatchEngine)
+        m_pBatchEngine->detach(this, m_batchGroup);
     m_spBook->removeBookListener(this);
 }
 
+void SigBook::attachBatchEngine(SigBookBatchEngine *engine)
+{
+    if(engine && m_tickSize > 0)
+        LONGBEACH_THROW_ERROR_SS("SigBook " << m_desc << ": tick mode cannot run in a SigBookBatchEngine");
+    if(m_pBatchEngine)
+        m_pBatchEngine->detach(this, m_batchGroup);
+    m_pBatchEngine = NULL;
+    m_bBatchState = false;
+    if(engine)
+        m_batchGroup = engine->attach(m_numLevels, m_numSBvars, m_returnMode);
+    m_pBatchEngine = engine;
+    if(!m_bBatchDirty)
+        return;
+    if(m_pBatchEngine)
+        m_pBatchEngine->markDirty(this, m_batchGroup);
+    else
+    {
+        // the book change the old engine was holding back; the state recomputes on read
+        m_bBatchDirty = false;
+        if(!deferNotification())
+        {
+            LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+            notifySignalListeners();
+        }
+    }
+}
+
+SigBook::CumulativeStatus SigBook::cumulativePrices(const double *px, const double *sz, size_t numLevels,
+    double tickSize, double sizeUnit, double *avgpx, size_t &failedLevel)
+{
+    if (tickSize > 0) {
+        // tick mode: exact sums over levels, one conversion per cumulative price
+        int64_t pxsz = 0, ttlsz = 0;
+        for (size_t i=0; i < numLevels; i++) {
+            failedLevel = i;
+            int64_t t, l;
+            if (!ticks::toUnitsChecked(px[i], tickSize, t) || !ticks::toUnitsChecked(sz[i], sizeUnit, l)
+                || !accumulateLevelTicks(pxsz, ttlsz, t, l))
+                return CUMULATIVE_OVERFLOW;
+            if (ttlsz <= 0)
+                return CUMULATIVE_NO_SIZE;
+            avgpx[i] = ticks::vwap(pxsz, ttlsz, tickSize);
+        }
+        return CUMULATIVE_OK;
+    }
+
+    double ttlsz = sz[0];
+    avgpx[0] = px[0];
+    for (size_t i=1; i < numLevels; i++) {
+        avgpx[i] = avgpx[i-1];
+        accumulateLevel(avgpx[i], ttlsz, px[i], sz[i]);
+    }
+    return CUMULATIVE_OK;
+}
+
+void SigBook::varsFromPrices(const double *bavgpx, const double *aavgpx, size_t numLevels,
+    double refpx, double *vars)
+{
+    vars[0] = bidVar0(bavgpx[0], refpx);
+    const int offset = numLevels - 1;
+    for (size_t i=1; i < numLevels; i++) {
+        vars[i] = bidVar(bavgpx[i], vars[i-1]);
+        // ask is more complicated because it didn't have a first value
+        int askindex = i + offset;
+        vars[askindex] = (i == 1) ? askVar1(aavgpx[i], refpx) : askVar(aavgpx[i], vars[askindex-1]);
+    }
+}
+
 void SigBook::resetVars() const
 {
     LONGBEACH_ASSERT(m_vars.size() == m_numSBvars);
@@ -58,8 +153,20 @@ void SigBook::resetVars() const
 
 void SigBook::reset()
 {
+    m_bBatchState = false;
+    m_memo.invalidate();
     resetVars();
     SignalSmonImpl::reset();
+    // a reset (including one from onBookFlushed) notifies no one, but readers must see it
+    refreshPublishedState();
+}
+
+void SigBook::onSMonStatusChange( source_t src, smon_status_t status, smon_status_t old_status,
+                                  const std::string& msg, const timeval_t& ctv, const timeval_t& swtv )
+{
+    SignalSmonImpl::onSMonStatusChange( src, status, old_status, msg, ctv, swtv );
+    // m_bSourcesOK changed under the signal, outside of any notification
+    refreshPublishedState();
 }
 
 void SigBook::updateVars() const
@@ -68,7 +175,7 @@ void SigBook::updateVars() const
 
     if ( !m_bSourcesOK ) {
         if (m_vboseLvl >= 2) {
-            cout << m_desc << "::updateVars: source(s) are not ok, setting vars to 0.0" << std::endl;
+            SignalLog::instance().log(s_logSourcesNotOK, m_spBook->getLastChangeTime(), m_desc);
         }
         return;
     }
@@ -78,27 +185,35 @@ void SigBook::updateVars() const
     bool ares = getNBookLevels( *m_spBook, ASK, m_numLevels, abls);
     if (m_spBook->isOK() == false || bres == false || ares == false) {
         if (m_vboseLvl) {
-            cout << m_desc << ": Not enough levels:" << m_numLevels << " in book to calculate"
-                 << " signals. Setting vars to 0.0" << std::endl;
+            SignalLog::instance().log(s_logNotEnoughLevels, m_spBook->getLastChangeTime(), m_desc, m_numLevels);
         }
         return;
     }
 
-    std::vector<double> bavgpx;
-    std::vector<double> bttlsz;
-    std::vector<double> aavgpx;
-    std::vector<double> attlsz;
-
-    bavgpx.resize(m_numLevels, 0.0);
-    bttlsz.resize(m_numLevels, 0.0);
-    aavgpx.resize(m_numLevels, 0.0);
-    attlsz.resize(m_numLevels, 0.0);
-
-    // initialize the avgpxs and ttlszs
-    bavgpx[0] = bbls[0]->getPrice();
-    bttlsz[0] = bbls[0]->getSize();
-    aavgpx[0] = abls[0]->getPrice();
-    attlsz[0] = abls[0]->getSize();
+    // prices and sizes of each side, then their cumulative prices, in one buffer kept across calls
+    double *bpx = &m_levelScratch[0], *bsz = bpx + m_numLevels, *apx = bsz + m_numLevels;
+    double *asz = apx + m_numLevels, *bavgpx = asz + m_numLevels, *aavgpx = bavgpx + m_numLevels;
+    for (size_t i=0; i < m_numLevels; i++) {
+        bpx[i] = bbls[i]->getPrice();
+        bsz[i] = bbls[i]->getSize();
+        apx[i] = abls[i]->getPrice();
+        asz[i] = abls[i]->getSize();
+    }
+    size_t bfailed = 0, afailed = 0;
+    const CumulativeStatus bstatus = cumulativePrices(bpx, bsz, m_numLevels, m_tickSize, m_sizeUnit, bavgpx, bfailed);
+    const CumulativeStatus astatus = cumulativePrices(apx, asz, m_numLevels, m_tickSize, m_sizeUnit, aavgpx, afailed);
+    if (bstatus != CUMULATIVE_OK || astatus != CUMULATIVE_OK) {
+        // tick mode only: the signal goes not ok rather than use wrapped sums
+        if (m_vboseLvl) {
+            const size_t level = std::min(bstatus != CUMULATIVE_OK ? bfailed : m_numLevels,
+                                          astatus != CUMULATIVE_OK ? afailed : m_numLevels);
+            if (bstatus == CUMULATIVE_OVERFLOW || astatus == CUMULATIVE_OVERFLOW)
+                SignalLog::instance().log(s_logOverflow, m_spBook->getLastChangeTime(), m_desc, level, m_tickSize, m_sizeUnit);
+            else
+                SignalLog::instance().log(s_logNoSize, m_spBook->getLastChangeTime(), m_desc, level, m_sizeUnit);
+        }
+        return;
+    }
 
     // get the refpp to use in case we need to normalize
     bool refppok;
@@ -109,51 +224,15 @@ void SigBook::updateVars() const
     }
 
     // for best mkt, only use bid side as a var, so we don't run into singularity problems
-    // with RefPx
-    m_vars[0] = bavgpx[0];
-    if (m_vars[0] < refpx * MaxDiffRefMidpx) {
-        m_vars[0] = refpx * MaxDiffRefMidpx;
-        if (m_vboseLvl) {
-            cout << m_desc << ": diff too large: normalizing bid[0] from "
-                 << bavgpx[0] << " to " << m_vars[0] << std::endl;
-        }
-    }
-    int offset = m_numLevels - 1;
-    for (size_t i=1; i < m_numLevels; i++) {
-        bavgpx[i] = (bavgpx[i-1] * bttlsz[i-1] + bbls[i]->getPrice() * bbls[i]->getSize()) / (bttlsz[i-1] + bbls[i]->getSize());
-        bttlsz[i] = bttlsz[i-1] + bbls[i]->getSize();
-        aavgpx[i] = (aavgpx[i-1] * attlsz[i-1] + abls[i]->getPrice() * abls[i]->getSize()) / (attlsz[i-1] + abls[i]->getSize());
-        attlsz[i] = attlsz[i-1] + abls[i]->getSize();
-        // stick em in for both bid and ask sides, but normalize em slightly if the values are too extreme
-        m_vars[i] = bavgpx[i];
-        if (m_vars[i] < m_vars[i-1] * MaxDownChg) {
-            m_vars[i] = m_vars[i-1] * MaxDownChg;
-            if (m_vboseLvl) {
-                cout << m_desc << ": diff too large: normalizing bid[" << i << "] from "
-                     << bavgpx[i] << " to " << m_vars[i] << std::endl;
-            }
-        }
-        // ask is more complicated because it didn't have a first value
-        int askindex = i + offset;
-        m_vars[askindex] = aavgpx[i];
-        if (i == 1) {
-            // since there is no ask 0 var, use refpx with an extra amount to sub for first value
-            if (m_vars[askindex] > refpx * (0.001 + MaxUpChg) * MaxUpChg) {
-                m_vars[askindex] = refpx * (0.001 + MaxUpChg) * MaxUpChg;
-                if (m_vboseLvl) {
-                    cout << m_desc << ": diff too large: normalizing ask[" << i << "] from "
-                         << aavgpx[i] << " to " << m_vars[askindex] << std::endl;
-                }
-            }
-        }
-        else {
-            if (m_vars[askindex] > m_vars[askindex-1] * MaxUpChg) {
-                m_vars[askindex] = m_vars[askindex-1] * MaxUpChg;
-                if (m_vboseLvl) {
-                    cout << m_desc << ": diff too large: normalizing ask[" << i << "] from "
-                         << aavgpx[i] << " to " << m_vars[askindex] << std::endl;
-                }
-            }
+    // with RefPx; the others are normalized slightly if the values are too extreme
+    varsFromPrices(bavgpx, aavgpx, m_numLevels, refpx, &m_vars[0]);
+    if (m_vboseLvl) {
+        const int offset = m_numLevels - 1;
+        for (size_t i=0; i < m_numLevels; i++) {
+            if (m_vars[i] != bavgpx[i])
+                SignalLog::instance().log(s_logClampBid, m_spBook->getLastChangeTime(), m_desc, i, bavgpx[i], m_vars[i]);
+            if (i > 0 && m_vars[i + offset] != aavgpx[i])
+                SignalLog::instance().log(s_logClampAsk, m_spBook->getLastChangeTime(), m_desc, i, aavgpx[i], m_vars[i + offset]);
         }
     }
 
@@ -168,14 +247,33 @@ void SigBook::updateVars() const
 
 void SigBook::onPriceChanged( const IPriceProvider& pp )
 {
-    notifySignalListeners();
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBook", "onPriceChanged", CYCLES_INPUT);
+    ++m_numInputs;
+    m_bBatchState = false;
+    if(!deferNotification())
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
 }
 
 void SigBook::onBookChanged( const IBook* pBook, const Msg* pMsg,
                              int32_t bidLevelChanged, int32_t askLevelChanged )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBook", "onBookChanged", CYCLES_INPUT);
+    ++m_numInputs;
     m_varsDirty = true;
-    notifySignalListeners();
+    m_bBatchState = false;
+    if(m_pBatchEngine)
+    {
+        markBatchDirty();
+        return;
+    }
+    if(!deferNotification())
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
 }
 
 void SigBook::onBookFlushed( const IBook* pBook, const Msg* pMsg )
@@ -185,6 +283,15 @@ void SigBook::onBookFlushed( const IBook* pBook, const Msg* pMsg )
 
 void SigBook::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBook", "recomputeState", CYCLES_RECOMPUTE);
+    if (m_bBatchState && m_bSourcesOK)
+        return;     // set by applyBatchResult, nothing changed since
+    m_bBatchState = false;
+    RecomputeMemo::Key key;
+    key.add(m_numInputs).add(m_spRefpp->getLastChangeTime()).add(uint64_t(m_bSourcesOK))
+        .add(uint64_t(m_spRefpp->isPriceOK()));
+    if (m_memo.check(key))
+        return;     // inputs unchanged since the last recompute
     if (m_varsDirty)
     {
         m_varsDirty = false;
@@ -206,16 +313,73 @@ void SigBook::recomputeState() const
     for(size_t i=0; i < m_numSBvars; i++)
     {
         if (refpx)
-            switch(m_returnMode)
-            {
-            case DIFF: m_state[i] = (m_vars[i] - refpx); break;
-            case ARITH: m_state[i] = (m_vars[i] - refpx) / refpx * 10000; break;
-            case LOG: m_state[i] = log( m_vars[i] / refpx ) * 10000; break;
-            default: LONGBEACH_THROW_ERROR_SS("SigBook: invalid return mode"); break;
-            }
+            m_state[i] = varToState(m_returnMode, m_vars[i], refpx);
         else
             m_state[i] = 0.0;
     }
+    m_memo.commit(key);
+}
+
+void SigBook::gatherBatchInput(size_t lane, ColumnarBookHistory &book, ColumnarPriceSeries &ref,
+    std::vector<BookLevelCPtr> &bbls, std::vector<BookLevelCPtr> &abls)
+{
+    // the engine takes the book as it is now; later changes need another flush
+    m_bBatchDirty = false;
+
+    bbls.clear();
+    abls.clear();
+    bool bres = getNBookLevels( *m_spBook, BID, m_numLevels, bbls );
+    bool ares = getNBookLevels( *m_spBook, ASK, m_numLevels, abls );
+    const bool ok = m_bSourcesOK && m_spBook->isOK() && bres && ares;
+    const size_t n = book.numRows;
+    for(size_t l = 0; l < m_numLevels; ++l)
+    {
+        book.bidPxs[l * n + lane] = ok ? bbls[l]->getPrice() : 0.0;
+        book.bidSzs[l * n + lane] = ok ? bbls[l]->getSize() : 0.0;
+        book.askPxs[l * n + lane] = ok ? abls[l]->getPrice() : 0.0;
+        book.askSzs[l * n + lane] = ok ? abls[l]->getSize() : 0.0;
+    }
+    book.bookOK[lane] = ok;
+
+    bool refppok;
+    double refpx = m_spRefpp->getRefPrice( &refppok );
+    ref.px[lane] = refppok ? refpx : 0.0;
+    ref.pxOK[lane] = refppok;
+}
+
+void SigBook::applyBatchResult(bool ok, const double *vars, const double *states, size_t stride)
+{
+    if(m_bBatchDirty)
+        return;     // the book changed again while notifying; the next flush has it
+
+    if(ok)
+    {
+        for(size_t i = 0; i < m_numSBvars; ++i)
+            m_vars[i] = vars[i * stride];
+        m_varsOK = true;
+        m_varsDirty = false;
+    }
+    else
+        resetVars();
+    m_isOK = ok;
+    for(size_t i = 0; i < m_numSBvars; ++i)
+        m_state[i] = states[i * stride];
+    m_bBatchState = true;
+    m_memo.invalidate();
+
+    if(!deferNotification())
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
+}
+
+void SigBook::markBatchDirty()
+{
+    if(m_bBatchDirty)
+        return;
+    m_bBatchDirty = true;
+    m_pBatchEngine->markDirty(this, m_batchGroup);
 }
 
 /************************************************************************************************/
@@ -226,6 +390,8 @@ SigBookSpec::SigBookSpec()
     : m_numLevels(4)
     , m_numSBvars(7)
     , m_returnMode(DIFF)
+    , m_tickSize(0.0)
+    , m_sizeUnit(1.0)
 {
 }
 
@@ -236,15 +402,27 @@ SigBookSpec::SigBookSpec(const SigBookSpec &e)
     , m_numLevels(e.m_numLevels)
     , m_numSBvars(e.m_numSBvars)
     , m_returnMode(e.m_returnMode)
+    , m_tickSize(e.m_tickSize)
+    , m_sizeUnit(e.m_sizeUnit)
 {
 }
 
 ISignalPtr SigBookSpec::build(SignalBuilder *builder) const
 {
-    IPriceProviderPtr priceProv = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
-    IBookPtr book = builder->getBookBuilder()->buildBook(m_book);
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSpec", "build", m_description);
+    IPriceProviderPtr priceProv;
+    IBookPtr book;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildPxProvider", m_description);
+        priceProv = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
+    }
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildBook", m_description);
+        book = builder->getBookBuilder()->buildBook(m_book);
+    }
 
-    std::auto_ptr<SigBook> sb(new SigBook(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBook", "construct", m_description);
+    SigBookPtr sb = makeSignalObject<SigBook>(
             m_book->getInstrument(),
             m_description,
             builder->getClockMonitor(),
@@ -253,28 +431,40 @@ ISignalPtr SigBookSpec::build(SignalBuilder *builder) const
             m_numLevels,
             m_numSBvars,
             builder->getVerboseLevel(),
-            m_returnMode));
+            m_returnMode,
+            m_tickSize,
+            m_sizeUnit);
     sb->registerWithSourceMonitors(builder->getClientContext(), m_sources);
-    return ISignalPtr(sb);
+    return sb;
 }
 
 void SigBookSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSpec", "checkValid", m_description);
     SignalSpec::checkValid();
     if(!m_book)
         LONGBEACH_THROW_ERROR_SS("SigBookSpec " << m_description << ": book is null");
     m_book->checkValid();
     util::checkSourcesValid(m_sources);
+    ticks::checkSpec("SigBookSpec", m_description, m_tickSize, m_sizeUnit);
+    cacheHash();
 }
 
 void SigBookSpec::hashCombine(size_t &result) const
 {
-    SignalSpec::hashCombine(result);
-    boost::hash_combine(result, *m_book);
-    boost::hash_combine(result, m_sources);
-    boost::hash_combine(result, m_numLevels);
-    boost::hash_combine(result, m_numSBvars);
-    boost::hash_combine(result, m_returnMode);
+    boost::hash_combine(result, specHash());
+}
+
+void SigBookSpec::hashMembers(size_t &seed) const
+{
+    SignalSpec::hashCombine(seed);
+    boost::hash_combine(seed, *m_book);
+    boost::hash_combine(seed, m_sources);
+    boost::hash_combine(seed, m_numLevels);
+    boost::hash_combine(seed, m_numSBvars);
+    boost::hash_combine(seed, m_returnMode);
+    boost::hash_combine(seed, m_tickSize);
+    boost::hash_combine(seed, m_sizeUnit);
 }
 
 SigBookSpec *SigBookSpec::clone() const
@@ -284,6 +474,7 @@ SigBookSpec *SigBookSpec::clone() const
 
 bool SigBookSpec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     if(!SignalSpec::compare(other)) return false;
 
     const SigBookSpec *b = dynamic_cast<const SigBookSpec*>(other);
@@ -294,6 +485,8 @@ bool SigBookSpec::compare(const ISignalSpec *other) const
     if(this->m_numLevels != b->m_numLevels) return false;
     if(this->m_numSBvars != b->m_numSBvars) return false;
     if(this->m_returnMode != b->m_returnMode) return false;
+    if(this->m_tickSize != b->m_tickSize) return false;
+    if(this->m_sizeUnit != b->m_sizeUnit) return false;
     return true;
 }
 
@@ -312,16 +505,46 @@ void SigBookSpec::print(std::ostream &o, const LuaPrintSettings &ps) const
       << onei.indent() << "sb.num_levels = " << luaMode(m_numLevels, onei) << '\n'
       << onei.indent() << "sb.num_sbvars = " << luaMode(m_numSBvars, onei) << '\n'
       << onei.indent() << "sb.return_mode = " << luaMode(m_returnMode, onei) << '\n'
+      << onei.indent() << "sb.tick_size = " << luaMode(m_tickSize, onei) << '\n'
+      << onei.indent() << "sb.size_unit = " << luaMode(m_sizeUnit, onei) << '\n'
       << onei.indent() << "return sb" "\n"
       << onei.indent() << "end)()";
 }
 
 void SigBookSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     m_book->getDataRequirements(rqs);
 }
 
+void SigBookSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(m_book);
+    ar.writeExternal(m_sources);
+    ar.write(uint64_t(m_numLevels));
+    ar.write(uint64_t(m_numSBvars));
+    ar.write(m_returnMode);
+    ar.write(m_tickSize);
+    ar.write(m_sizeUnit);
+}
+
+void SigBookSpec::readBinary(SpecInArchive &ar)
+{
+    uint64_t numLevels, numSBvars;
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(m_book);
+    ar.readExternal(m_sources);
+    ar.read(numLevels);
+    ar.read(numSBvars);
+    ar.read(m_returnMode);
+    ar.read(m_tickSize);
+    ar.read(m_sizeUnit);
+    m_numLevels = numLevels;
+    m_numSBvars = numSBvars;
+}
+
 bool SigBookSpec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -334,6 +557,8 @@ bool SigBookSpec::registerScripting(lua_State &state)
             .def_readwrite("num_levels", &SigBookSpec::m_numLevels)
             .def_readwrite("num_sbvars", &SigBookSpec::m_numSBvars)
             .def_readwrite("return_mode", &SigBookSpec::m_returnMode)
+            .def_readwrite("tick_size", &SigBookSpec::m_tickSize)
+            .def_readwrite("size_unit", &SigBookSpec::m_sizeUnit)
             ];
     return true;
 }
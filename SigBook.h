@@ -2,19 +2,38 @@
 #define LONGBEACH_SIGNALS_SIGBOOK_H
 
 
+#include <math.h>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/clientcore/BookLevel.h>
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/RecomputeMemo.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalMemory.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/TickArithmetic.h>
 
 namespace longbeach {
 namespace signals {
 
+class SigBookBatchEngine;
+struct ColumnarBookHistory;
+struct ColumnarPriceSeries;
+
 class SigBook
     : public SignalSmonImpl
+    , public EvalEngineNode
+    , public IMemoryAccountable
+    , public IRecomputeMemoized
     , protected IBookListener
 {
 public:
     SigBook(const instrument_t& instr, const std::string &desc, ClockMonitorPtr clockm,
-            IPriceProviderPtr spRefpp, IBookPtr spBook, size_t num_levels, size_t num_sbvars, int vbose, ReturnMode returnMode);
+            IPriceProviderPtr spRefpp, IBookPtr spBook, size_t num_levels, size_t num_sbvars, int vbose, ReturnMode returnMode,
+            double tickSize = 0.0, double sizeUnit = 1.0);
     virtual ~SigBook();
 
 //    static const size_t NumLevels = 4;
@@ -22,10 +41,73 @@ public:
 
     virtual void reset();
 
+    /// Hands this signal's book changes to engine, which computes the vars of all its dirty
+    /// SigBooks together at the end of the event and notifies for each then.  NULL goes back
+    /// to notifying on each change and computing on read, and notifies at once of a change the
+    /// old engine was still holding back.
+    void attachBatchEngine(SigBookBatchEngine *engine);
+    SigBookBatchEngine *getBatchEngine() const { return m_pBatchEngine; }
+
+    // IMemoryAccountable interface
+    virtual size_t getHeapFootprint() const { return footprint::of(m_vars) + footprint::of(m_levelScratch); }
+
+    /// Keyed on the book and refpp changes taken, the refpp's last change time and OK, and
+    /// whether the sources are OK.
+    virtual const RecomputeMemo &getRecomputeMemo() const { return m_memo; }
+
+    /// Per-level arithmetic of updateVars and recomputeState.  Public so that the batch path
+    /// (BatchSignalEval) runs the very same expressions and reproduces the online numbers.
+    static void accumulateLevel(double &avgpx, double &ttlsz, double px, double sz)
+    {
+        avgpx = (avgpx * ttlsz + px * sz) / (ttlsz + sz);
+        ttlsz = ttlsz + sz;
+    }
+    /// Tick mode counterpart of accumulateLevel: exact sums, turned into a price by ticks::vwap.
+    /// False, leaving the sums meaningless, if they would overflow.
+    static bool accumulateLevelTicks(int64_t &pxsz, int64_t &ttlsz, int64_t px, int64_t sz)
+    {
+        return ticks::mulAdd(pxsz, px, sz) && !__builtin_add_overflow(ttlsz, sz, &ttlsz);
+    }
+
+    enum CumulativeStatus { CUMULATIVE_OK, CUMULATIVE_NO_SIZE, CUMULATIVE_OVERFLOW };
+
+    /// avgpx[i] is the size-weighted price of levels 0 to i of one side, from the level prices
+    /// and sizes px and sz, level 0 first.  In tick mode (tickSize > 0) the sums are exact, and
+    /// fail at the level where they have no size in units or would overflow, given back in
+    /// failedLevel.  Shared with the tests that check the two modes against each other.
+    static CumulativeStatus cumulativePrices(const double *px, const double *sz, size_t numLevels,
+        double tickSize, double sizeUnit, double *avgpx, size_t &failedLevel);
+
+    /// The clamped vars of updateVars from each side's cumulative prices and the reference
+    /// price: the best bid, then bid levels 1 to numLevels-1, then ask levels 1 to numLevels-1.
+    static void varsFromPrices(const double *bavgpx, const double *aavgpx, size_t numLevels,
+        double refpx, double *vars);
+    static double bidVar0(double bidpx, double refpx)
+    {   const double lo = refpx * MaxDiffRefMidpx; return bidpx < lo ? lo : bidpx; }
+    static double bidVar(double avgpx, double prevVar)
+    {   const double lo = prevVar * MaxDownChg; return avgpx < lo ? lo : avgpx; }
+    // since there is no ask 0 var, ask 1 is capped off refpx with an extra amount
+    static double askVar1(double avgpx, double refpx)
+    {   const double hi = refpx * (0.001 + MaxUpChg) * MaxUpChg; return avgpx > hi ? hi : avgpx; }
+    static double askVar(double avgpx, double prevVar)
+    {   const double hi = prevVar * MaxUpChg; return avgpx > hi ? hi : avgpx; }
+    static double varToState(ReturnMode mode, double var, double refpx)
+    {
+        switch(mode)
+        {
+        case DIFF: return var - refpx;
+        case ARITH: return (var - refpx) / refpx * 10000;
+        case LOG: return log( var / refpx ) * 10000;
+        default: LONGBEACH_THROW_ERROR_SS("SigBook: invalid return mode");
+        }
+        return 0.0;
+    }
+
 protected:
     void resetVars() const;
     void updateVars() const;
     virtual void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
 
     // IPriceProvider Listener
     void onPriceChanged( const IPriceProvider& pp );
@@ -38,11 +120,29 @@ protected:
     /// Invoked when the subscribed Book is flushed.
     virtual void onBookFlushed( const IBook* pBook, const Msg* pMsg );
 
+    // ISourceMonitorListener interface, through SignalSmonImpl
+    virtual void onSMonStatusChange( source_t src, smon_status_t status, smon_status_t old_status,
+                                     const std::string& msg, const timeval_t& ctv, const timeval_t& swtv );
+
+private:
+    friend class SigBookBatchEngine;
+
+    /// Fills row lane of the engine's columns from the book and the refpp; a book updateVars
+    /// would reject gets zero sizes.
+    void gatherBatchInput(size_t lane, ColumnarBookHistory &book, ColumnarPriceSeries &ref,
+        std::vector<BookLevelCPtr> &bbls, std::vector<BookLevelCPtr> &abls);
+    /// Takes the engine's result, var and state i at vars[i * stride] and states[i * stride],
+    /// and notifies.
+    void applyBatchResult(bool ok, const double *vars, const double *states, size_t stride);
+    /// Queues this for the engine's next flush, unless it already is.
+    void markBatchDirty();
+
 protected:
     IPriceProviderPtr m_spRefpp;
     Subscription m_spRefppSub;
     IBookPtr m_spBook;
-    mutable std::vector<double> m_vars;
+    mutable arena_vector<double>::type m_vars;
+    mutable arena_vector<double>::type m_levelScratch;     // updateVars' level prices and sizes
     mutable bool m_varsOK, m_varsDirty;
 //#ifdef UBUNTU
 //    static const double MaxDownChg = 0.9975;
@@ -56,12 +156,25 @@ protected:
     size_t m_numLevels;
     size_t m_numSBvars;
     ReturnMode m_returnMode;
+    double m_tickSize;      // 0 unless in tick mode
+    double m_sizeUnit;
+
+    SigBookBatchEngine *m_pBatchEngine;
+    size_t m_batchGroup;
+    bool m_bBatchDirty;             // waiting for the engine's next flush
+    mutable bool m_bBatchState;     // the state is the engine's result and still current
+
+    uint64_t m_numInputs;           // book and refpp notifications taken, for m_memo
+    mutable RecomputeMemo m_memo;
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigBook);
 
 
 /// SignalSpec for SigBook
-class SigBookSpec : public SignalSpec
+class SigBookSpec
+    : public SignalSpec
+    , public SpecHashCache<SigBookSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -78,6 +191,13 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SigBookSpec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigBookSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IBookSpecPtr m_book;
     sources_t m_sources;
 
@@ -85,6 +205,9 @@ public:
     size_t m_numSBvars;
     ReturnMode m_returnMode;
 
+    /// A positive tick size switches to integer ticks and lots of size_unit (see TickArithmetic.h).
+    double m_tickSize;
+    double m_sizeUnit;
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigBookSpec);
 
@@ -0,0 +1,133 @@
+#include <longbeach/signals/SigBookBatchEngine.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/SigBook.h>
+
+namespace longbeach {
+namespace signals {
+
+SigBookBatchEngine::SigBookBatchEngine(EventDistributorPtr spED, Priority flushPriority)
+    : m_spED(spED)
+    , m_flushPriority(flushPriority)
+    , m_bFlushScheduled(false)
+    , m_numFlushes(0)
+    , m_numEvaluated(0)
+{
+    if(!m_spED)
+        LONGBEACH_THROW_ERROR_SS("SigBookBatchEngine: was passed a NULL EventDistributor");
+}
+
+size_t SigBookBatchEngine::attach(size_t numLevels, size_t numVars, ReturnMode returnMode)
+{
+    if(numLevels == 0 || numVars < 2 * numLevels - 1)
+        LONGBEACH_THROW_ERROR_SS("SigBookBatchEngine: num_sbvars " << numVars << " too small for "
+            << numLevels << " levels");
+    for(size_t i = 0; i < m_groups.size(); ++i)
+        if(m_groups[i].numLevels == numLevels && m_groups[i].numVars == numVars && m_groups[i].returnMode == returnMode)
+            return i;
+    m_groups.push_back(Group());
+    Group &g = m_groups.back();
+    g.numLevels = numLevels;
+    g.numVars = numVars;
+    g.returnMode = returnMode;
+    return m_groups.size() - 1;
+}
+
+void SigBookBatchEngine::detach(SigBook *sb, size_t group)
+{
+    Group &g = m_groups[group];
+    g.dirty.erase(std::remove(g.dirty.begin(), g.dirty.end(), sb), g.dirty.end());
+    std::replace(g.lanes.begin(), g.lanes.end(), sb, static_cast<SigBook*>(NULL));
+}
+
+void SigBookBatchEngine::markDirty(SigBook *sb, size_t group)
+{
+    m_groups[group].dirty.push_back(sb);
+    scheduleFlush();
+}
+
+void SigBookBatchEngine::scheduleFlush()
+{
+    if(!m_bFlushScheduled)
+        m_bFlushScheduled = m_spED->addWork(boost::bind(&SigBookBatchEngine::flush, this), m_flushPriority);
+}
+
+void SigBookBatchEngine::flush()
+{
+    m_bFlushScheduled = false;
+    ++m_numFlushes;
+    for(size_t i = 0; i < m_groups.size(); ++i)
+        if(!m_groups[i].dirty.empty())
+        {
+            try
+            {
+                evalGroup(m_groups[i]);
+            }
+            catch(...)
+            {
+                // the groups not reached yet keep their dirty signals for the next flush
+                for(size_t j = i; j < m_groups.size(); ++j)
+                    if(!m_groups[j].dirty.empty())
+                        scheduleFlush();
+                throw;
+            }
+        }
+}
+
+void SigBookBatchEngine::evalGroup(Group &g)
+{
+    // books marked while notifying go into the next flush
+    g.lanes.swap(g.dirty);
+    g.dirty.clear();
+
+    const size_t n = g.lanes.size();
+    g.book.resize(n, g.numLevels);
+    g.ref.resize(n);
+    g.out.numRows = n;
+    g.out.values.resize(g.numVars * n);
+    g.out.ok.resize(n);
+
+    size_t gathered = 0;    // lanes after it still have their dirty mark
+    size_t next = 0;        // lanes before it have taken their result
+    try
+    {
+        for(; gathered < n; ++gathered)
+            g.lanes[gathered]->gatherBatchInput(gathered, g.book, g.ref, m_bidLevels, m_askLevels);
+        BatchSignalEval::sigBookRows(g.numLevels, g.numVars, g.returnMode, g.book, g.ref, 0, n, g.buf, g.out);
+        m_numEvaluated += n;
+
+        while(next < n)
+        {
+            const size_t r = next++;
+            if(g.lanes[r])     // NULL if detached by a listener of an earlier one
+                g.lanes[r]->applyBatchResult(g.out.ok[r] != 0, &g.buf.vars[r], &g.out.values[r], n);
+        }
+    }
+    catch(...)
+    {
+        // a listener (or a book) threw: the lanes it cut off go back for the next flush rather
+        // than being left with neither a result nor the dirty mark
+        for(size_t r = next; r < n; ++r)
+        {
+            if(!g.lanes[r])
+                continue;
+            if(r > gathered)
+            {
+                g.dirty.push_back(g.lanes[r]);
+                scheduleFlush();
+            }
+            else
+                g.lanes[r]->markBatchDirty();
+        }
+        g.lanes.clear();
+        throw;
+    }
+    g.lanes.clear();
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,91 @@
+#ifndef LONGBEACH_SIGNALS_SIGBOOKBATCHENGINE_H
+#define LONGBEACH_SIGNALS_SIGBOOKBATCHENGINE_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/clientcore/BookLevel.h>
+#include <longbeach/clientcore/EventDist.h>
+#include <longbeach/signals/BatchSignalEval.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+class SigBook;
+
+/// Computes the vars and states of many SigBooks at once, across instruments.
+///
+/// A SigBook attached with SigBook::attachBatchEngine no longer notifies on each book change;
+/// it marks itself dirty here instead.  At the end of the event the engine gathers the top
+/// levels of every dirty book into level-major columns, one row per instrument, runs the
+/// BatchSignalEval SigBook kernel over them (cumulative VWAP, the MaxDownChg / MaxUpChg /
+/// MaxDiffRefMidpx clamps and the return transform a level at a time across instruments, so
+/// each vector instruction covers 4 or 8 of them), scatters the results back into each
+/// signal, and notifies each one once.  The arithmetic is the online one, so states are the
+/// same to the bit as without the engine.
+///
+/// SigBooks are grouped by (num_levels, num_sbvars, return_mode); each group is one kernel
+/// run.  Refpp changes still notify immediately and recompute on read, as before.
+///
+/// The engine must outlive the signals attached to it, or they must be detached first.
+class SigBookBatchEngine : private boost::noncopyable
+{
+public:
+    /// The flush runs as EventDistributor work at flushPriority, which must be lower than the
+    /// priority of the book handlers, and higher than that of any SignalEvalEngine the
+    /// SigBooks are also attached to.
+    SigBookBatchEngine(EventDistributorPtr spED, Priority flushPriority);
+
+    /// Evaluates every dirty SigBook and notifies for each.  Normally called from the scheduled
+    /// EventDistributor work; may be called directly at the end of an event.  If a listener
+    /// throws, the exception propagates and the SigBooks not yet notified stay dirty, with
+    /// another flush scheduled.
+    void flush();
+
+    size_t getNumGroups() const { return m_groups.size(); }
+    uint64_t getNumFlushes() const { return m_numFlushes; }
+
+    /// Signal evaluations done in batches, over all flushes.
+    uint64_t getNumEvaluated() const { return m_numEvaluated; }
+
+private:
+    friend class SigBook;
+
+    size_t attach(size_t numLevels, size_t numVars, ReturnMode returnMode);
+    void detach(SigBook *sb, size_t group);
+    void markDirty(SigBook *sb, size_t group);
+    void scheduleFlush();
+
+    struct Group
+    {
+        size_t numLevels;
+        size_t numVars;
+        ReturnMode returnMode;
+        std::vector<SigBook*> dirty;
+        std::vector<SigBook*> lanes;    // the dirty signals being evaluated, one per row
+
+        // reused from flush to flush, so a flush allocates nothing once they have grown
+        ColumnarBookHistory book;
+        ColumnarPriceSeries ref;
+        BatchSignalEval::SigBookBuffers buf;
+        BatchSignalOutput out;
+    };
+
+    void evalGroup(Group &g);
+
+    EventDistributorPtr m_spED;
+    Priority m_flushPriority;
+    bool m_bFlushScheduled;
+    std::vector<Group> m_groups;
+    std::vector<BookLevelCPtr> m_bidLevels, m_askLevels;
+    uint64_t m_numFlushes;
+    uint64_t m_numEvaluated;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SigBookBatchEngine);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGBOOKBATCHENGINE_H
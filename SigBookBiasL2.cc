@@ -8,6 +8,10 @@
 #include <longbeach/core/CommoditiesSpecifications.h>
 #include <longbeach/clientcore/BookLevel.h>
 #include <longbeach/clientcore/clientcoreutils.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
 
 #include <longbeach/clientcore/Message_macros.h>
@@ -15,6 +19,8 @@
 
 #include <cppformat/format.h>
 
+#include <limits>
+
 namespace longbeach {
 namespace signals {
 
@@ -24,9 +30,9 @@ SigBookBiasL2::SigBookBiasL2( const instrument_t& instr, const std::string &desc
     : SignalStateImpl(instr, desc)
     , m_spCM( spCC->getClockMonitor() )
     , m_spBook( spBook )
-//    , m_volFilter( seconds(spec.m_volFilterWindow) )
     , m_updatePeriod( seconds(10) )
-    , m_lambda( spec.m_lambda )
+    , m_params( spec )
+    , m_numInputs( 0 )
 {
     if ( !m_spCM )
         LONGBEACH_THROW_ERROR_SS( "SigBookBiasL2: Bad ClockMonitor" );
@@ -71,12 +77,10 @@ SigBookBiasL2::SigBookBiasL2( const instrument_t& instr, const std::string &desc
             , m_spBook->getSource(), GdEtfQdMsg::kMType, m_spBook->getInstrument(), PRIORITY_SIGNALS_Signal );
     }
 
-    /*
-    m_spCM->scheduleWakeupCall( m_subUpdate
-            , boost::bind( &SigBookBiasL2::updateVolatility, this, _1, _2 )
-            , m_spCM->getTime() + m_updatePeriod
-            , PRIORITY_CC_Misc );
-    */
+    if( spec.m_volFilterWindow > 0 )
+        m_spVol = VolatilityProvider::getShared( m_spCM, m_spBook
+            , spec.m_volEwma ? VolatilityProvider::EWMA : VolatilityProvider::WINDOW
+            , seconds(spec.m_volFilterWindow), m_updatePeriod );
 
     m_spCM->scheduleClockNotice( this, cm::clock_notice(cm::ENDOFDAY,0), PRIORITY_SIGNALS_Signal );
 
@@ -99,37 +103,64 @@ bool checkMhL2Book( const IBookPtr& book )
     //  && (getBestMarket(*book).getSpread() < 5*m_ticksize) ) //filter out wide market probably due to bad data)
     // && (fabs(getNthMarket(*book,4).getSpread()) < 15*ticksize); //filter out wide market probably due to bad data)
 }
-}
 
-/*
-void SigBookBiasL2::updateVolatility( const timeval_t& ctv, const timeval_t& swtv )
+/// Levels from arrays, iterated like an IBookLevelCIter.
+class ArrayLevelIter
 {
-    // schedule next call
-    m_spCM->scheduleWakeupCall( m_subUpdate
-            , boost::bind( &SigBookBiasL2::updateVolatility, this, _1, _2 )
-            , m_spCM->getTime() + m_updatePeriod
-            , PRIORITY_CC_Misc );
-
-    if ( m_isOK )
+public:
+    struct Level
     {
-        if( m_prevMidPx )
+        double px, sz;
+        double getPrice() const { return px; }
+        double getSize() const { return sz; }
+    };
+
+    ArrayLevelIter( const double* px, const double* sz, size_t n ) : m_px( px ), m_sz( sz ), m_n( n ), m_i( 0 ) {}
+
+    bool hasNext() const { return m_i < m_n; }
+    const Level* next() { m_level.px = m_px[m_i]; m_level.sz = m_sz[m_i]; ++m_i; return &m_level; }
+
+private:
+    const double* m_px;
+    const double* m_sz;
+    size_t m_n, m_i;
+    Level m_level;
+};
+
+/// Sum of price*weight and total weight of a side's levels below the top, within the depth
+/// truncation; the walk of recomputeState, over the book or over arrays.
+template<typename LevelIter>
+std::pair<double,double> sumSide( const SigBookBiasL2::Params& p, LevelIter& iter, double midpx, double lambda, double cutoff )
+{
+    double total_sz = 0;
+    double total_pxsz = 0;
+    int32_t levelCnt = 0;
+    while( iter.hasNext() )
+    {
+//        std::cout << "levelCnt:" << levelCnt << std::endl;
+        levelCnt = levelCnt + 1;
+        const auto level = iter.next();
+        double levelPrice = level->getPrice();
+        double levelSize = level->getSize();
+        if( SigBookBiasL2::beyondDepth( p, levelCnt, levelPrice, midpx, cutoff ) )
+            break;
+        if( GT(levelPrice,0) && (levelCnt>1)/*exclude top level*/ )
         {
-            double midpx = m_spBook->getMidPrice();
-            double midpx0 = m_prevMidPx.get();
-//            double ret = log( midpx / midpx0 ) * 10000;
-            double ret = midpx - midpx0;
-            m_volFilter.update( m_spCM->getTime(), ret );
-//            std::cout << "updateVolatility mid:" << midpx << " midpx0:" << midpx0
-//                    << "ret:" << ret << " volatility:" << m_volFilter.getVolatility() << std::endl;
+//                double adjust_sz = log( levelSize ) * exp( -m_lambda*distance/m_ticksize.get() );
+            SigBookBiasL2::addLevel( p, levelPrice, levelSize, midpx, lambda, total_pxsz, total_sz );
+//            fmt::print("side:{} lvl:{} px:{} sz:{} dist:{}\n", side, levelCnt, levelPrice, levelSize, distance);
         }
-        m_prevMidPx = m_spBook->getMidPrice();
     }
-
+    return std::pair<double,double>( total_pxsz, total_sz );
+}
 }
-*/
 
 void SigBookBiasL2::onMsg( const Msg& msg )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBookBiasL2", "onMsg", CYCLES_INPUT);
+    ++m_numInputs;
+    // listeners (an AsyncSignal in particular) must also hear of the book going bad
+    const bool wasOK = m_isOK;
     //m_isOK = checkMhL2Book(m_spBook,m_ticksize.get());
     m_isOK = checkMhL2Book(m_spBook);
 
@@ -138,9 +169,13 @@ void SigBookBiasL2::onMsg( const Msg& msg )
 //        std::cout << m_spCM->getTime() << " onMsg " << *market_data << std::endl;
         if( market_data->getInstr().sym == m_spBook->getInstrument().sym )
         {
-            if( m_isOK )
+            if( m_isOK || wasOK )
             {
-                notifySignalListeners(m_spCM->getTime());
+                if(!deferNotification(m_spCM->getTime()))
+                {
+                    LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                    notifySignalListeners(m_spCM->getTime());
+                }
             }
         }
     LONGBEACH_MESSAGE_CASE_END()
@@ -148,9 +183,13 @@ void SigBookBiasL2::onMsg( const Msg& msg )
 //        std::cout << m_spCM->getTime() << " onMsg " << *market_data << std::endl;
         if( market_data->getInstr() == m_spBook->getInstrument() )
         {
-            if( m_isOK )
+            if( m_isOK || wasOK )
             {
-                notifySignalListeners(m_spCM->getTime());
+                if(!deferNotification(m_spCM->getTime()))
+                {
+                    LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                    notifySignalListeners(m_spCM->getTime());
+                }
             }
         }
     LONGBEACH_MESSAGE_CASE_END()
@@ -158,9 +197,13 @@ void SigBookBiasL2::onMsg( const Msg& msg )
 //        std::cout << m_spCM->getTime() << " onMsg " << *market_data << std::endl;
         if( market_data->getInstr() == m_spBook->getInstrument() )
         {
-            if( m_isOK )
+            if( m_isOK || wasOK )
             {
-                notifySignalListeners(m_spCM->getTime());
+                if(!deferNotification(m_spCM->getTime()))
+                {
+                    LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                    notifySignalListeners(m_spCM->getTime());
+                }
             }
         }
     LONGBEACH_MESSAGE_CASE_END()
@@ -168,9 +211,13 @@ void SigBookBiasL2::onMsg( const Msg& msg )
 //        std::cout << m_spCM->getTime() << " onMsg " << *market_data << std::endl;
         if( market_data->getInstr() == m_spBook->getInstrument() )
         {
-            if( m_isOK )
+            if( m_isOK || wasOK )
             {
-                notifySignalListeners(m_spCM->getTime());
+                if(!deferNotification(m_spCM->getTime()))
+                {
+                    LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                    notifySignalListeners(m_spCM->getTime());
+                }
             }
         }
     LONGBEACH_MESSAGE_CASE_END()
@@ -181,7 +228,12 @@ void SigBookBiasL2::onMsg( const Msg& msg )
 
 void SigBookBiasL2::onBookFlushed( const IBook* pBook, const Msg* pMsg )
 {
-    notifySignalListeners(pBook->getLastChangeTime());
+    ++m_numInputs;
+    if(!deferNotification(pBook->getLastChangeTime()))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(pBook->getLastChangeTime());
+    }
 }
 
 
@@ -207,58 +259,191 @@ void SigBookBiasL2::_reset()
 {
     // reset the state
     m_state.assign( 1, 0 );
-    notifySignalListeners(timeval_t());
+    m_memo.invalidate();
+    if(!deferNotification(timeval_t()))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(timeval_t());
+    }
 }
     
-std::pair<double,double> SigBookBiasL2::evalSideWeightedAvgPriceSize( side_t side, double midpx ) const
+std::pair<double,double> SigBookBiasL2::evalSideWeightedPriceSize( side_t side, double midpx, double lambda, double cutoff ) const
 {
 //    std::cout << m_spCM->getTime() << std::endl << *m_spBook << std::endl;
-    double total_sz = 0;
-    double total_pxsz = 0;
+    IBookLevelCIterPtr iter = m_spBook->getBookLevelIter(side);
+    return sumSide( m_params, *iter, midpx, lambda, cutoff );
+}
+
+double SigBookBiasL2::evalLevels( const Params& p, double midpx, double lambda,
+                                  const double* bidPx, const double* bidSz, size_t numBids,
+                                  const double* askPx, const double* askSz, size_t numAsks )
+{
+    const double mid = modeMidPx( p, midpx );
+    const double cutoff = depthCutoff( p.maxRelDistance, p.minLevelWeight, lambda );
+    ArrayLevelIter bids( bidPx, bidSz, numBids ), asks( askPx, askSz, numAsks );
+    std::pair<double,double> bid = sumSide( p, bids, mid, lambda, cutoff );
+    std::pair<double,double> ask = sumSide( p, asks, mid, lambda, cutoff );
+    return biasFromSides( bid.first, bid.second, ask.first, ask.second, mid );
+}
+
+double SigBookBiasL2::levelWeight( double levelPrice, double levelSize, double midpx, double lambda )
+{
+    if( !GT(levelPrice,0) )
+        return 0.0;
+    double distance = fabs( levelPrice - midpx );
+    return log( levelSize ) * exp( -lambda*distance/midpx*1e3 );
+}
+
+double SigBookBiasL2::levelWeightTicks( int64_t px2, double levelSize, int64_t mid2, double lambda )
+{
+    if( px2 <= 0 )
+        return 0.0;
+    double distance = double( px2 > mid2 ? px2 - mid2 : mid2 - px2 );
+    return log( levelSize ) * exp( -lambda*distance/double(mid2)*1e3 );
+}
+
+double SigBookBiasL2::depthCutoff( double maxRelDistance, double minLevelWeight, double lambda )
+{
+    double cutoff = std::numeric_limits<double>::infinity();
+    if( maxRelDistance > 0 )
+        cutoff = maxRelDistance;
+    // exp( -lambda*distance/midpx*1e3 ) >= target  <=>  distance/midpx <= -log( target )/( lambda*1e3 )
+    if( minLevelWeight > 0 && lambda > 0 )
+        cutoff = std::min( cutoff, -log( minLevelWeight )/( lambda*1e3 ) );
+    return cutoff;
+}
+
+bool SigBookBiasL2::beyondDepth( const Params& p, int32_t levelCnt, double levelPrice, double mid, double cutoff )
+{
+    if( p.maxLevels && uint32_t(levelCnt) > p.maxLevels )
+        return true;
+    // a level with no price is skipped by the sums, not taken as the end of the side
+    if( !GT(levelPrice,0) )
+        return false;
+    const double px = p.tickSize > 0 ? 2*levelPrice/p.tickSize : levelPrice;
+    return fabs( px - mid ) > cutoff*mid;
+}
+
+double SigBookBiasL2::decayLambda( double mid ) const
+{
+    if( !m_spVol || !m_spVol->isReady() || !( m_spVol->getVolatility() > 0 ) )
+        return m_params.lambda;
+    // lambda'*distance/mid*1e3 == lambda*distance/vol, with mid and distance in the sums' units
+    const double unit = m_params.tickSize > 0 ? m_params.tickSize/2 : 1.0;
+    return m_params.lambda * mid*unit*1e-3 / m_spVol->getVolatility();
+}
+
+double SigBookBiasL2::modeMidPx( const Params& p, double midpx )
+{
+    return p.tickSize > 0 ? double( llround( 2*midpx/p.tickSize ) ) : midpx;
+}
+
+void SigBookBiasL2::addLevel( const Params& p, double levelPrice, double levelSize, double mid, double lambda,
+                              double& total_pxsz, double& total_sz )
+{
+    if( p.tickSize > 0 )
+    {
+        int64_t lots, pxTicks;
+        if( !ticks::toUnitsChecked( levelSize, p.sizeUnit, lots ) || lots <= 0
+            || !ticks::toUnitsChecked( levelPrice, p.tickSize, pxTicks ) )
+            return;
+        const int64_t px2 = 2*pxTicks;
+        double adjust_sz = levelWeightTicks( px2, lots*p.sizeUnit, int64_t(mid), lambda );
+        total_sz += adjust_sz;
+        total_pxsz += double(px2)*adjust_sz;
+        return;
+    }
+    double adjust_sz = levelWeight( levelPrice, levelSize, mid, lambda );
+    total_sz += adjust_sz;
+    total_pxsz += levelPrice*adjust_sz;
+}
+
+double SigBookBiasL2::biasFromSides( double bidPxSz, double bidSz, double askPxSz, double askSz, double midpx )
+{
+    double bidPx = (bidSz>0) ? bidPxSz/bidSz : midpx;
+    double askPx = (askSz>0) ? askPxSz/askSz : midpx;
+    // double avgpx = (bid.first*ask.second + ask.first*bid.second) / (bid.second + ask.second);
+    double avgpx = ((bidSz>0)&&(askSz>0)) ?
+            ((bidPx*askSz + askPx*bidSz) / (bidSz + askSz))
+            : midpx ;
+    return ( avgpx - midpx ) / midpx * 1e4;
+}
+
+void SigBookBiasL2::captureSide( side_t side, double mid, double cutoff, std::vector<double>& values ) const
+{
+    const size_t countIdx = values.size();
+    values.push_back( 0 );
     IBookLevelCIterPtr iter = m_spBook->getBookLevelIter(side);
     int32_t levelCnt = 0;
     while( iter->hasNext() )
     {
-//        std::cout << "levelCnt:" << levelCnt << std::endl;
         levelCnt = levelCnt + 1;
         BookLevelCPtr level = iter->next();
         double levelPrice = level->getPrice();
-        double levelSize = level->getSize();
+        if( beyondDepth( m_params, levelCnt, levelPrice, mid, cutoff ) )
+            break;
         if( GT(levelPrice,0) && (levelCnt>1)/*exclude top level*/ )
         {
-            double distance = fabs( levelPrice - midpx );
-//                double adjust_sz = log( levelSize ) * exp( -m_lambda * distance / vol );
-//                double adjust_sz = log( levelSize ) * exp( -m_lambda*distance/m_ticksize.get() );
-            double adjust_sz = log( levelSize ) * exp( -m_lambda*distance/midpx*1e3 );
-            total_sz += adjust_sz;
-            total_pxsz += levelPrice*adjust_sz;
-//            fmt::print("side:{} lvl:{} px:{} sz:{} dist:{}\n", side, levelCnt, levelPrice, levelSize, distance);
+            values.push_back( levelPrice );
+            values.push_back( level->getSize() );
         }
     }
-   // std::cout << " side:" << side
-   //    << " total_pxsz:" << total_pxsz
-   //    << " total_sz:" << total_sz
-   //    << " total_pxsz/total_sz:" << total_pxsz/total_sz
-   //    << " vol:" << vol
-   //    << std::endl;
-    double total_px = (total_sz>0) ? total_pxsz/total_sz : midpx;
-    return std::pair<double,double>( total_px, total_sz );
+    values[countIdx] = ( values.size() - countIdx - 1 ) / 2;
+}
+
+bool SigBookBiasL2::captureAsyncInput( AsyncSignalInput& in ) const
+{
+    if( !m_isOK )
+        return false;
+    in.values.clear();
+    // the volatility is read here, on the event thread
+    const double midpx = m_spBook->getMidPrice();
+    const double lambda = decayLambda( modeMidPx( m_params, midpx ) );
+    const double cutoff = depthCutoff( m_params.maxRelDistance, m_params.minLevelWeight, lambda );
+    in.values.push_back( midpx );
+    in.values.push_back( lambda );
+    captureSide( BID, modeMidPx( m_params, midpx ), cutoff, in.values );
+    captureSide( ASK, modeMidPx( m_params, midpx ), cutoff, in.values );
+    return true;
+}
+
+bool SigBookBiasL2::evalAsync( const AsyncSignalInput& in, std::vector<double>& state ) const
+{
+    LONGBEACH_TIME_SIGNAL_HANDLER("SigBookBiasL2", "evalAsync");
+    const double* v = &in.values[0];
+    const double midpx = modeMidPx( m_params, *v++ );
+    const double lambda = *v++;
+    double sides[2][2];     // (sum of price*weight, total weight) of BID, then ASK
+    for( int s = 0; s < 2; ++s )
+    {
+        const size_t n = size_t( *v++ );
+        double total_sz = 0;
+        double total_pxsz = 0;
+        for( size_t i = 0; i < n; ++i, v += 2 )
+            addLevel( m_params, v[0], v[1], midpx, lambda, total_pxsz, total_sz );
+        sides[s][0] = total_pxsz;
+        sides[s][1] = total_sz;
+    }
+    state[0] = biasFromSides( sides[0][0], sides[0][1], sides[1][0], sides[1][1], midpx );
+    return true;
 }
 
 void SigBookBiasL2::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBookBiasL2", "recomputeState", CYCLES_RECOMPUTE);
+    // repeated reads within one event walk the book once
+    RecomputeMemo::Key key;
+    key.add( m_numInputs ).add( m_spBook->getLastChangeTime() ).add( m_spVol ? m_spVol->getNumChanges() : 0 );
+    if( m_memo.check( key ) )
+        return;
     // std::cout << "\n" << *m_spBook << std::endl;
-    // double vol = m_volFilter.getVolatility();
-    // vol = std::min( std::max( vol, 0.1*m_ticksize.get() ), 5*m_ticksize.get() );
-    double midpx = m_spBook->getMidPrice();
-    std::pair<double,double> bid = evalSideWeightedAvgPriceSize( BID, midpx );
-    std::pair<double,double> ask = evalSideWeightedAvgPriceSize( ASK, midpx );
-    // double avgpx = (bid.first*ask.second + ask.first*bid.second) / (bid.second + ask.second);
-    double avgpx = ((bid.second>0)&&(ask.second>0)) ?
-            ((bid.first*ask.second + ask.first*bid.second) / (bid.second + ask.second))
-            : midpx ;
-//    std::cout << "bid:" << bid.second << " ask:" << ask.second << " avgpx:" << avgpx << " midpx:" << midpx << std::endl;
-    double sig = ( avgpx - midpx ) / midpx * 1e4;
+    // in tick mode the sums and the mid are in half ticks; the bias is a ratio either way
+    double midpx = modeMidPx( m_params, m_spBook->getMidPrice() );
+    const double lambda = decayLambda( midpx );
+    const double cutoff = depthCutoff( m_params.maxRelDistance, m_params.minLevelWeight, lambda );
+    std::pair<double,double> bid = evalSideWeightedPriceSize( BID, midpx, lambda, cutoff );
+    std::pair<double,double> ask = evalSideWeightedPriceSize( ASK, midpx, lambda, cutoff );
+    double sig = biasFromSides( bid.first, bid.second, ask.first, ask.second, midpx );
 //    sig = std::max( -vol, std::min( vol, sig ) ) / midpx * 1e4;
 //    double sig = bid.second - ask.second;
 //    std::cout << "refpx:" << refpx << " avgpx:" << avgpx << std::endl;
@@ -266,9 +451,20 @@ void SigBookBiasL2::recomputeState() const
     setSignalState( 0, sig );
 //    std::cout << m_spCM->getTime() << " SigBookBiasL2::recomputeState sig " << sig << std::endl;
 //    setSignalState( 1, vol );
+    m_memo.commit( key );
     return;
 }
 
+SigBookBiasL2::Params::Params( const SigBookBiasL2Spec& spec )
+    : lambda( spec.m_lambda )
+    , tickSize( spec.m_tickSize )
+    , sizeUnit( spec.m_sizeUnit )
+    , maxLevels( spec.m_maxLevels )
+    , maxRelDistance( spec.m_maxRelDistance )
+    , minLevelWeight( spec.m_minLevelWeight )
+{
+}
+
 /************************************************************************************************/
 // SigBookBiasL2Spec
 /************************************************************************************************/
@@ -276,35 +472,59 @@ void SigBookBiasL2::recomputeState() const
 SigBookBiasL2Spec::SigBookBiasL2Spec(const SigBookBiasL2Spec &e)
     : SignalSpec(e)
     , m_book(IBookSpec::clone(e.m_book))
-//    , m_volFilterWindow(300)
+    , m_volFilterWindow(e.m_volFilterWindow)
+    , m_volEwma(e.m_volEwma)
     , m_lambda(e.m_lambda)
+    , m_tickSize(e.m_tickSize)
+    , m_sizeUnit(e.m_sizeUnit)
+    , m_maxLevels(e.m_maxLevels)
+    , m_maxRelDistance(e.m_maxRelDistance)
+    , m_minLevelWeight(e.m_minLevelWeight)
 {
 }
 
 ISignalPtr SigBookBiasL2Spec::build(SignalBuilder *builder) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookBiasL2Spec", "build", m_description);
 //    IPriceProviderPtr priceProv = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
-    IBookPtr book = builder->getBookBuilder()->buildBook(m_book);
+    IBookPtr book;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildBook", m_description);
+        book = builder->getBookBuilder()->buildBook(m_book);
+    }
 
-    return ISignalPtr(new SigBookBiasL2(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookBiasL2", "construct", m_description);
+    return makeSignalObject<SigBookBiasL2>(
             book->getInstrument(),
             m_description,
             builder->getClientContext(),
             *this,
 //            priceProv,
-            book));
+            book);
 }
 
 void SigBookBiasL2Spec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookBiasL2Spec", "checkValid", m_description);
     SignalSpec::checkValid();
     if(!m_book)
         LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": book is null");
-//    if(m_volFilterWindow<0)
-//        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": vol_filter_window is negative");
+    if(m_volFilterWindow<0)
+        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": vol_filter_window is negative");
+    if(m_volFilterWindow>0 && m_volFilterWindow<10)
+        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": vol_filter_window is shorter than"
+            << " the 10s volatility sample period");
     if(m_lambda<0)
         LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": lambda is negative");
+    ticks::checkSpec("SigBookBiasL2Spec", m_description, m_tickSize, m_sizeUnit);
+    if(m_maxRelDistance<0)
+        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": max_rel_distance is negative");
+    if(m_minLevelWeight<0 || m_minLevelWeight>=1)
+        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": min_level_weight must be in [0, 1)");
+    if(m_minLevelWeight>0 && !(m_lambda>0))
+        LONGBEACH_THROW_ERROR_SS("SigBookBiasL2Spec " << m_description << ": min_level_weight needs a positive lambda");
     m_book->checkValid();
+    cacheHash();
 }
 
 SigBookBiasL2Spec *SigBookBiasL2Spec::clone() const
@@ -314,18 +534,40 @@ SigBookBiasL2Spec *SigBookBiasL2Spec::clone() const
 
 void SigBookBiasL2Spec::hashCombine(size_t &result) const
 {
-    SignalSpec::hashCombine(result);
-    boost::hash_combine(result, *m_book);
+    boost::hash_combine(result, specHash());
+}
+
+void SigBookBiasL2Spec::hashMembers(size_t &seed) const
+{
+    SignalSpec::hashCombine(seed);
+    boost::hash_combine(seed, *m_book);
+    boost::hash_combine(seed, m_volFilterWindow);
+    boost::hash_combine(seed, m_volEwma);
+    boost::hash_combine(seed, m_lambda);
+    boost::hash_combine(seed, m_tickSize);
+    boost::hash_combine(seed, m_sizeUnit);
+    boost::hash_combine(seed, m_maxLevels);
+    boost::hash_combine(seed, m_maxRelDistance);
+    boost::hash_combine(seed, m_minLevelWeight);
 }
 
 bool SigBookBiasL2Spec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     if(!SignalSpec::compare(other)) return false;
 
     const SigBookBiasL2Spec *b = dynamic_cast<const SigBookBiasL2Spec*>(other);
     if(!b) return false;
 
     if(*this->m_book != *b->m_book) return false;
+    if(this->m_volFilterWindow != b->m_volFilterWindow) return false;
+    if(this->m_volEwma != b->m_volEwma) return false;
+    if(this->m_lambda != b->m_lambda) return false;
+    if(this->m_tickSize != b->m_tickSize) return false;
+    if(this->m_sizeUnit != b->m_sizeUnit) return false;
+    if(this->m_maxLevels != b->m_maxLevels) return false;
+    if(this->m_maxRelDistance != b->m_maxRelDistance) return false;
+    if(this->m_minLevelWeight != b->m_minLevelWeight) return false;
     return true;
 }
 
@@ -340,16 +582,53 @@ void SigBookBiasL2Spec::print(std::ostream &o, const LuaPrintSettings &ps) const
       << onei.indent() << "sbbias.description = " << luaMode(m_description, onei) << std::endl
       << onei.indent() << "sbbias.refPxP = refPxP" << std::endl
       << onei.indent() << "sbbias.book = book" << std::endl
+      << onei.indent() << "sbbias.vol_filter_window = " << luaMode(m_volFilterWindow, onei) << std::endl
+      << onei.indent() << "sbbias.vol_ewma = " << luaMode(m_volEwma, onei) << std::endl
+      << onei.indent() << "sbbias.lambda = " << luaMode(m_lambda, onei) << std::endl
+      << onei.indent() << "sbbias.tick_size = " << luaMode(m_tickSize, onei) << std::endl
+      << onei.indent() << "sbbias.size_unit = " << luaMode(m_sizeUnit, onei) << std::endl
+      << onei.indent() << "sbbias.max_levels = " << luaMode(m_maxLevels, onei) << std::endl
+      << onei.indent() << "sbbias.max_rel_distance = " << luaMode(m_maxRelDistance, onei) << std::endl
+      << onei.indent() << "sbbias.min_level_weight = " << luaMode(m_minLevelWeight, onei) << std::endl
       << onei.indent() << "return sbbias" << std::endl
       << onei.indent() << "end)()";
 }
 
 void SigBookBiasL2Spec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookBiasL2Spec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     m_book->getDataRequirements(rqs);
 }
 
+void SigBookBiasL2Spec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(m_book);
+    ar.write(m_volFilterWindow);
+    ar.write(m_volEwma);
+    ar.write(m_lambda);
+    ar.write(m_tickSize);
+    ar.write(m_sizeUnit);
+    ar.write(m_maxLevels);
+    ar.write(m_maxRelDistance);
+    ar.write(m_minLevelWeight);
+}
+
+void SigBookBiasL2Spec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(m_book);
+    ar.read(m_volFilterWindow);
+    ar.read(m_volEwma);
+    ar.read(m_lambda);
+    ar.read(m_tickSize);
+    ar.read(m_sizeUnit);
+    ar.read(m_maxLevels);
+    ar.read(m_maxRelDistance);
+    ar.read(m_minLevelWeight);
+}
+
 bool SigBookBiasL2Spec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -358,8 +637,14 @@ bool SigBookBiasL2Spec::registerScripting(lua_State &state)
             luabind::class_<SigBookBiasL2Spec, SignalSpec, ISignalSpecPtr>("SigBookBiasL2Spec")
             .def( luabind::constructor<>() )
             .def_readwrite("book",      &SigBookBiasL2Spec::m_book)
-//            .def_readwrite("vol_filter_window",    &SigBookBiasL2Spec::m_volFilterWindow)
+            .def_readwrite("vol_filter_window",    &SigBookBiasL2Spec::m_volFilterWindow)
+            .def_readwrite("vol_ewma",  &SigBookBiasL2Spec::m_volEwma)
             .def_readwrite("lambda",    &SigBookBiasL2Spec::m_lambda)
+            .def_readwrite("tick_size", &SigBookBiasL2Spec::m_tickSize)
+            .def_readwrite("size_unit", &SigBookBiasL2Spec::m_sizeUnit)
+            .def_readwrite("max_levels",       &SigBookBiasL2Spec::m_maxLevels)
+            .def_readwrite("max_rel_distance", &SigBookBiasL2Spec::m_maxRelDistance)
+            .def_readwrite("min_level_weight", &SigBookBiasL2Spec::m_minLevelWeight)
             ];
     return true;
 }
@@ -4,8 +4,15 @@
 
 #include <longbeach/clientcore/IBook.h>
 #include <longbeach/clientcore/BookPriceProvider.h>
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/RecomputeMemo.h>
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/TickArithmetic.h>
+#include <longbeach/signals/VolatilityProvider.h>
 
 #include <longbeach/math/VolatilityFilter.h>
 
@@ -13,12 +20,23 @@ namespace longbeach {
 namespace signals {
 
 /// SignalSpec for SigBookBiasL2
-class SigBookBiasL2Spec : public SignalSpec
+class SigBookBiasL2Spec
+    : public SignalSpec
+    , public SpecHashCache<SigBookBiasL2Spec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
 
     SigBookBiasL2Spec()
+        : m_volFilterWindow(0)
+        , m_volEwma(false)
+        , m_lambda(0.0)
+        , m_tickSize(0.0)
+        , m_sizeUnit(1.0)
+        , m_maxLevels(0)
+        , m_maxRelDistance(0.0)
+        , m_minLevelWeight(0.0)
     {}
     SigBookBiasL2Spec(const SigBookBiasL2Spec &e);
 
@@ -31,15 +49,41 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SigBookBiasL2Spec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigBookBiasL2Spec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IBookSpecPtr    m_book;
-//    int32_t         m_volFilterWindow;
+    /// Seconds of mid volatility (VolatilityProvider, shared per book) that distances
+    /// are decayed by, exp(-lambda*distance/vol), in place of midpx*1e-3; 0 is off.
+    int32_t         m_volFilterWindow;
+    bool            m_volEwma;          // EWMA volatility rather than windowed
     double          m_lambda;
+    /// A positive tick size switches to integer ticks and lots of size_unit (see TickArithmetic.h).
+    double          m_tickSize;
+    double          m_sizeUnit;
+    /// Depth truncation, each off when 0: levels read per side (the unweighted top included),
+    /// relative distance |px - mid| / mid of the last level weighted, and the smallest weight
+    /// of a level relative to the same size at the mid, i.e. its distance decay factor.  The
+    /// walk stops at the first priced level past any of them.  min_level_weight bounds what
+    /// each dropped level would have weighed, not the error in the signal: on the synthetic
+    /// book of BiasL2TruncationError the mean error shrinks with it, but single rows whose
+    /// weights nearly cancel (log sizes below 1 are negative) can still move by many bps.
+    uint32_t        m_maxLevels;
+    double          m_maxRelDistance;
+    double          m_minLevelWeight;
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigBookBiasL2Spec);
 
 
 class SigBookBiasL2
     : public SignalStateImpl
+    , public EvalEngineNode
+    , public IAsyncEvaluable
+    , public IRecomputeMemoized
     , private IBookListener
     , private IClockListener
 {
@@ -56,10 +100,71 @@ public:
     virtual timeval_t getLastChangeTv() const
     {   return m_lastChangeTv; }
 
+    /// Log size of a level decayed by its distance from midpx; 0 for levels with no price.
+    /// Shared with the batch path (BatchSignalEval) so both produce the same numbers.
+    static double levelWeight( double levelPrice, double levelSize, double midpx, double lambda );
+
+    /// Tick mode counterpart of levelWeight: px2 and mid2 are twice the price in ticks, so the
+    /// distance from a mid between two ticks is still an exact integer.
+    static double levelWeightTicks( int64_t px2, double levelSize, int64_t mid2, double lambda );
+
+    /// The signal from each side's weight-averaged price sum and total weight.  Prices may be
+    /// in any unit, half ticks included, as long as midpx is in the same one.
+    static double biasFromSides( double bidPxSz, double bidSz, double askPxSz, double askSz, double midpx );
+
+    /// The relative distance past which levels are dropped, from max_rel_distance and
+    /// min_level_weight at a given lambda; infinite when neither is set.
+    static double depthCutoff( double maxRelDistance, double minLevelWeight, double lambda );
+
+    /// The spec's arithmetic and depth settings, as the kernels below take them.
+    struct Params
+    {
+        explicit Params( const SigBookBiasL2Spec& spec );
+
+        double   lambda;
+        double   tickSize;        // 0 unless in tick mode
+        double   sizeUnit;
+        uint32_t maxLevels;       // 0: all
+        double   maxRelDistance;
+        double   minLevelWeight;
+    };
+
+    /// midpx in the units the sums are kept in: price, or half ticks in tick mode.
+    static double modeMidPx( const Params& p, double midpx );
+    /// Adds a level below the top to its side's sums; mid is from modeMidPx.  In tick mode a
+    /// level whose price or size does not fit in integer ticks or lots is left out.
+    static void addLevel( const Params& p, double levelPrice, double levelSize, double mid, double lambda,
+                          double& total_pxsz, double& total_sz );
+    /// Whether the walk of a side stops at this level (1 is the top), with mid from modeMidPx.
+    /// A level with no price never stops it.
+    static bool beyondDepth( const Params& p, int32_t levelCnt, double levelPrice, double mid, double cutoff );
+
+    /// The signal from levels given as arrays, best first, walked exactly as recomputeState
+    /// walks the book, at the given lambda (see decayLambda).  For tests and benchmarks of the
+    /// arithmetic without a book.
+    static double evalLevels( const Params& p, double midpx, double lambda,
+                              const double* bidPx, const double* bidSz, size_t numBids,
+                              const double* askPx, const double* askSz, size_t numAsks );
+
+    /// Input layout: midpx, the lambda in effect, then for each of BID and ASK the number of
+    /// levels below the top with a price and within the depth truncation, followed by their
+    /// (price, size) pairs.  evalAsync on it gives, bit for bit, the state recomputeState
+    /// gives on the same book; tests/TestAsyncSignal.cc holds it to that.
+    virtual bool captureAsyncInput( AsyncSignalInput& in ) const;
+    virtual bool evalAsync( const AsyncSignalInput& in, std::vector<double>& state ) const;
+
+    /// Keyed on the messages and flushes taken, the book's last change time and the volatility
+    /// provider's changes.
+    virtual const RecomputeMemo& getRecomputeMemo() const { return m_memo; }
+
 private:
-//    void updateVolatility( const timeval_t& ctv, const timeval_t& swtv );
     void onMsg( const Msg& msg );
-    std::pair<double,double> evalSideWeightedAvgPriceSize( side_t side, double midpx ) const;
+    /// Sum of price*weight and total weight of the side's levels below the top.
+    std::pair<double,double> evalSideWeightedPriceSize( side_t side, double midpx, double lambda, double cutoff ) const;
+    void captureSide( side_t side, double mid, double cutoff, std::vector<double>& values ) const;
+    /// The lambda that, put in levelWeight or levelWeightTicks at mid (from modeMidPx), decays
+    /// by distance/vol when normalizing by volatility; the spec's lambda otherwise.
+    double decayLambda( double mid ) const;
 
     virtual void onBookFlushed( const IBook* pBook, const Msg* pMsg );
 
@@ -67,19 +172,21 @@ private:
 
     void _reset();
     virtual void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(tv); }
 
 private:
     ClockMonitorPtr       m_spCM;
     IBookPtr              m_spBook;
 
     //boost::optional<double> m_ticksize;
-    boost::optional<double> m_prevMidPx;
-    //math::VolatilityFilter m_volFilter;
-    duration_t            m_updatePeriod;
-    double                m_lambda;
+    VolatilityProviderPtr m_spVol;          // NULL unless vol_filter_window is set
+    duration_t            m_updatePeriod;   // of the volatility samples
+    const Params          m_params;
+
+    uint64_t              m_numInputs;        // messages and flushes taken, for m_memo
+    mutable RecomputeMemo m_memo;
 
     Subscription          m_subMsg;
-    Subscription          m_subUpdate;
 };
 LONGBEACH_DECLARE_SHARED_PTR( SigBookBiasL2 );
 
@@ -5,13 +5,21 @@
 #include <boost/bind.hpp>
 #include <longbeach/core/LuaCodeGen.h>
 #include <longbeach/core/LuabindScripting.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SignalLog.h>
 
 #include <math.h>
 
 namespace longbeach {
 namespace signals {
 
+namespace {
+SignalLogSite s_logReset("SigBookSizeBias resetting at open", "", 100);
+}
 
 SigBookSizeBias::SigBookSizeBias( const instrument_t& instr, const std::string &desc,
          ClockMonitorPtr cm,
@@ -19,7 +27,8 @@ SigBookSizeBias::SigBookSizeBias( const instrument_t& instr, const std::string &
          ptime_duration_t _interval,
          const intervals &interval_list,
          const uint32_t numLevels,
-         const double power, int vbose)
+         const double power, int vbose,
+         double sizeUnit)
     : SignalStateImpl(instr, desc)
     , m_spCM( cm )
     , m_spBook (spBook)
@@ -28,6 +37,7 @@ SigBookSizeBias::SigBookSizeBias( const instrument_t& instr, const std::string &
     , m_interval(_interval)
     , m_numLevels (numLevels)
     , m_power ( power)
+    , m_sizeUnit( sizeUnit )
     , m_last_check()
 {
     m_spBook->addBookListener( this );
@@ -64,7 +74,11 @@ void SigBookSizeBias::_reset()
     m_snapshot.reset();
     m_last_check = 0;
     m_state.assign( getStateSize(), 0 ); // <-- why is this correct?  this state has m_num * m_numSignals entries
-    notifySignalListeners(timeval_t());
+    if(!deferNotification(timeval_t()))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(timeval_t());
+    }
 }
 
 void SigBookSizeBias::check(timeval_t curtime)
@@ -78,35 +92,49 @@ void SigBookSizeBias::check(timeval_t curtime)
         PriceSize bid = m_spBook->getNthSide( i, BID );
         PriceSize ask = m_spBook->getNthSide( i, ASK );
         //std::cout << ", bdsz=" << bid.sz() << ", aksz=" << ask.sz();
-        double baseSize = 1.0;
-        if (m_power>0){
-            bookimbVec.push_back( pow(bid.sz()+baseSize, m_power) - pow(ask.sz()+baseSize, m_power) );
-        }
-        else{
-            bookimbVec.push_back( log(bid.sz()+baseSize) - log(ask.sz()+baseSize) );
-        }
+        bookimbVec.push_back( levelImbalance(bid.sz(), ask.sz(), m_power, m_sizeUnit) );
     }
 
     m_snapshot.onBeat(bookimbVec);
 }
 
+double SigBookSizeBias::levelImbalance(double bidSize, double askSize, double power)
+{
+    double baseSize = 1.0;
+    if (power>0){
+        return pow(bidSize+baseSize, power) - pow(askSize+baseSize, power);
+    }
+    else{
+        return log(bidSize+baseSize) - log(askSize+baseSize);
+    }
+}
+
 
 void SigBookSizeBias::onBookChanged( const IBook* pBook, const Msg* pMsg,
                             int32_t bidLevelChanged, int32_t askLevelChanged )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBookSizeBias", "onBookChanged", CYCLES_INPUT);
     if ( pBook->getLastChangeTime() == m_last_check ||
          ( (bidLevelChanged != -1 && uint32_t(bidLevelChanged) > m_numLevels ) &&
            (askLevelChanged != -1 && uint32_t(askLevelChanged) > m_numLevels ) ) )
         return;
 
     check( pBook->getLastChangeTime() );
-    notifySignalListeners(pBook->getLastChangeTime());
+    if(!deferNotification(pBook->getLastChangeTime()))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(pBook->getLastChangeTime());
+    }
 }
 
 
 void SigBookSizeBias::onBookFlushed( const IBook* pBook, const Msg* pMsg )
 {
-    notifySignalListeners(pBook->getLastChangeTime());
+    if(!deferNotification(pBook->getLastChangeTime()))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(pBook->getLastChangeTime());
+    }
 }
 
 
@@ -115,7 +143,7 @@ void SigBookSizeBias::onWakeupCall( const timeval_t& ctv, const timeval_t& swtv,
     // at open, reset
     if ( reason == cm::ATOPEN )
     {
-        std::cout << m_spCM->getTime() << " resetting " << getDesc() << std::endl;
+        SignalLog::instance().log(s_logReset, m_spCM->getTime(), getDesc());
         _reset();
     }
     // at endofday, schedule ATOPEN and next ENDOFDAY
@@ -132,6 +160,7 @@ void SigBookSizeBias::onWakeupCall( const timeval_t& ctv, const timeval_t& swtv,
 
 void SigBookSizeBias::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigBookSizeBias", "recomputeState", CYCLES_RECOMPUTE);
 
     m_isOK = m_spBook->isOK();
     if(!m_isOK)
@@ -164,14 +193,21 @@ SigBookSizeBiasSpec::SigBookSizeBiasSpec(const SigBookSizeBiasSpec &e)
     , m_book(IBookSpec::clone(e.m_book))
     , m_numLevels(e.m_numLevels)
     , m_power(e.m_power)
+    , m_sizeUnit(e.m_sizeUnit)
 {
 }
 
 ISignalPtr SigBookSizeBiasSpec::build(SignalBuilder *builder) const
 {
-    IBookPtr book = builder->getBookBuilder()->buildBook(m_book);
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSizeBiasSpec", "build", m_description);
+    IBookPtr book;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildBook", m_description);
+        book = builder->getBookBuilder()->buildBook(m_book);
+    }
 
-    return ISignalPtr(new SigBookSizeBias(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSizeBias", "construct", m_description);
+    return makeSignalObject<SigBookSizeBias>(
             book->getInstrument(),
             m_description,
             builder->getClockMonitor(),
@@ -180,12 +216,14 @@ ISignalPtr SigBookSizeBiasSpec::build(SignalBuilder *builder) const
             m_intervals,
             m_numLevels,
             m_power,
-            builder->getVerboseLevel() ));
+            builder->getVerboseLevel(),
+            m_sizeUnit );
 }
 
 
 void SigBookSizeBiasSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSizeBiasSpec", "checkValid", m_description);
     SignalSpec::checkValid();
     if(m_interval == ptime_duration_t())
         LONGBEACH_THROW_ERROR_SS("SigBookSizeBiasSpec " << m_description << ": interval is zero");
@@ -196,6 +234,9 @@ void SigBookSizeBiasSpec::checkValid() const
         LONGBEACH_THROW_ERROR_SS("SigBookSizeBiasSpec " << m_description << ": numLevels is zero");
     if (m_power < 0 )
         LONGBEACH_THROW_ERROR_SS("SigBookSizeBiasSpec " << m_description << ": m_power is negative");
+    if (m_sizeUnit < 0 )
+        LONGBEACH_THROW_ERROR_SS("SigBookSizeBiasSpec " << m_description << ": sizeUnit is negative");
+    cacheHash();
 }
 
 SigBookSizeBiasSpec *SigBookSizeBiasSpec::clone() const
@@ -205,17 +246,24 @@ SigBookSizeBiasSpec *SigBookSizeBiasSpec::clone() const
 
 void SigBookSizeBiasSpec::hashCombine(size_t &result) const
 {
-    SignalSpec::hashCombine(result);
-    boost::hash_combine(result, m_interval);
-    boost::hash_combine(result, m_intervals);
-    boost::hash_combine(result, *m_book);
-    boost::hash_combine(result, m_numLevels);
-    boost::hash_combine(result, m_power);
+    boost::hash_combine(result, specHash());
+}
+
+void SigBookSizeBiasSpec::hashMembers(size_t &seed) const
+{
+    SignalSpec::hashCombine(seed);
+    boost::hash_combine(seed, m_interval);
+    boost::hash_combine(seed, m_intervals);
+    boost::hash_combine(seed, *m_book);
+    boost::hash_combine(seed, m_numLevels);
+    boost::hash_combine(seed, m_power);
+    boost::hash_combine(seed, m_sizeUnit);
 }
 
 
 bool SigBookSizeBiasSpec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     if(!SignalSpec::compare(other)) return false;
 
     const SigBookSizeBiasSpec *b = dynamic_cast<const SigBookSizeBiasSpec*>(other);
@@ -226,6 +274,7 @@ bool SigBookSizeBiasSpec::compare(const ISignalSpec *other) const
     if(*this->m_book != *b->m_book) return false;
     if(this->m_numLevels != b->m_numLevels) return false;
     if(this->m_power != b->m_power) return false;
+    if(this->m_sizeUnit != b->m_sizeUnit) return false;
     return true;
 }
 
@@ -242,17 +291,41 @@ void SigBookSizeBiasSpec::print(std::ostream &o, const LuaPrintSettings &ps) con
       << onei.indent() << "sbszbias.book = book" << std::endl
       << onei.indent() << "sbszbias.numLevels = " << luaMode(m_numLevels, onei) << std::endl
       << onei.indent() << "sbszbias.power = " << luaMode(m_power, onei) << std::endl
+      << onei.indent() << "sbszbias.sizeUnit = " << luaMode(m_sizeUnit, onei) << std::endl
       << onei.indent() << "return sbszbias" << std::endl
       << onei.indent() << "end)()";
 }
 
 void SigBookSizeBiasSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBookSizeBiasSpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     m_book->getDataRequirements(rqs);
 }
 
 
+void SigBookSizeBiasSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.write(m_interval);
+    ar.write(m_intervals);
+    ar.writeExternal(m_book);
+    ar.write(m_numLevels);
+    ar.write(m_power);
+    ar.write(m_sizeUnit);
+}
+
+void SigBookSizeBiasSpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.read(m_interval);
+    ar.read(m_intervals);
+    ar.readExternal(m_book);
+    ar.read(m_numLevels);
+    ar.read(m_power);
+    ar.read(m_sizeUnit);
+}
+
 bool SigBookSizeBiasSpec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -265,6 +338,7 @@ bool SigBookSizeBiasSpec::registerScripting(lua_State &state)
             .def_readwrite("book",      &SigBookSizeBiasSpec::m_book)
             .def_readwrite("numLevels", &SigBookSizeBiasSpec::m_numLevels)
             .def_readwrite("power",     &SigBookSizeBiasSpec::m_power)
+            .def_readwrite("sizeUnit",  &SigBookSizeBiasSpec::m_sizeUnit)
     ];
     return true;
 }
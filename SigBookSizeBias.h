@@ -5,6 +5,10 @@
 #include <longbeach/clientcore/BookPriceProvider.h>
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/TickArithmetic.h>
 
 #include <longbeach/signals/SigSnap.h>
 
@@ -16,6 +20,7 @@ namespace signals {
 /// keep history of book size imbalances at multiple levels.
 class SigBookSizeBias
     : public SignalStateImpl
+    , public EvalEngineNode
     , private IBookListener
     , private IClockListener
 {
@@ -26,12 +31,25 @@ public:
              ClockMonitorPtr cm,
              IBookPtr spBook,
              ptime_duration_t _interval,
-             const intervals &interval_list, const uint32_t numLevels, const double power, int vbose);
+             const intervals &interval_list, const uint32_t numLevels, const double power, int vbose,
+             double sizeUnit = 0.0);
 
     virtual ~SigBookSizeBias();
 
     void setInterval(unsigned int i, unsigned int j); // J is in multiples of INTERVAL
 
+    /// Size imbalance of one level.  Shared with the batch path (BatchSignalEval) so both
+    /// produce the same numbers.
+    static double levelImbalance(double bidSize, double askSize, double power);
+
+    /// The imbalance check() feeds to the snapshot: of the sizes snapped to sizeUnit in tick
+    /// mode (sizeUnit > 0), as they are otherwise.
+    static double levelImbalance(double bidSize, double askSize, double power, double sizeUnit)
+    {
+        return sizeUnit > 0 ? levelImbalance(ticks::snapSize(bidSize, sizeUnit), ticks::snapSize(askSize, sizeUnit), power)
+                            : levelImbalance(bidSize, askSize, power);
+    }
+
 protected:
     // IClockListener interface
     virtual void onWakeupCall(const timeval_t& ctv, const timeval_t& swtv, int reason, void* pData );
@@ -44,6 +62,7 @@ protected:
     void _reset();
     void check(timeval_t curtime);
     void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(tv); }
 
     ClockMonitorPtr   m_spCM;
     IBookPtr          m_spBook;
@@ -53,6 +72,7 @@ protected:
     ptime_duration_t                    m_interval;
     const uint32_t                      m_numLevels;  // number of book levels.
     const double                        m_power;
+    const double                        m_sizeUnit;     // > 0: sizes are snapped to it (tick mode)
 
     timeval_t                           m_last_check;
     static const int R_CHECK = cm::USER_REASON + 1;
@@ -61,12 +81,15 @@ LONGBEACH_DECLARE_SHARED_PTR(SigBookSizeBias);
 
 
 /// SignalSpec for SigBookSizeBias
-class SigBookSizeBiasSpec : public SignalSpec
+class SigBookSizeBiasSpec
+    : public SignalSpec
+    , public SpecHashCache<SigBookSizeBiasSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
 
-    SigBookSizeBiasSpec() {}
+    SigBookSizeBiasSpec() : m_sizeUnit(0.0) {}
     SigBookSizeBiasSpec(const SigBookSizeBiasSpec &e);
 
     virtual instrument_t getInstrument() const { return m_book->getInstrument(); }
@@ -78,13 +101,21 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SigBookSizeBiasSpec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigBookSizeBiasSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     ptime_duration_t                    m_interval;
     std::vector<unsigned int>           m_intervals;
 
     IBookSpecCPtr                       m_book;
     uint32_t                            m_numLevels;
     double                              m_power;
-
+    /// A positive size unit snaps level sizes to whole lots of it (see TickArithmetic.h).
+    double                              m_sizeUnit;
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigBookSizeBiasSpec);
 
@@ -1,6 +1,10 @@
 #include "SigDiff.h"
 #include <boost/assign/list_of.hpp>
 #include <longbeach/clientcore/EventDist.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
 #include <longbeach/signals/SignalsPriority.h>
 #include <longbeach/clientcore/PriceProviderBuilder.h>
@@ -47,28 +51,66 @@ bool SigDiffSpec::registerScripting(lua_State &state)
     return true;
 }
 
+void SigDiffSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(a);
+}
+
+void SigDiffSpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(a);
+}
+
 void SigDiffSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigDiffSpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     a->getDataRequirements(rqs);
 }
 
 void SigDiffSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigDiffSpec", "checkValid", m_description);
     SignalSpec::checkValid();
     a->checkValid();
+    cacheHash();
+}
+
+void SigDiffSpec::hashCombine(size_t &result) const
+{
+    boost::hash_combine(result, specHash());
+}
+
+void SigDiffSpec::hashMembers(size_t &seed) const
+{
+    SignalSpecT2<SigDiffSpec>::hashCombine(seed);
+}
+
+bool SigDiffSpec::compare(const ISignalSpec* other) const
+{
+    if(fastReject(other)) return false;
+    return SignalSpecT2<SigDiffSpec>::compare(other);
 }
 
 ISignalPtr SigDiffSpec::build( SignalBuilder* builder ) const
 {
-    IPriceProviderPtr a_obj = builder->getPxPBuilder()->buildPxProvider(a);
-    IPriceProviderPtr b_obj = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
-    return ISignalPtr(new SigDiff( builder->getClientContext()
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigDiffSpec", "build", m_description);
+    IPriceProviderPtr a_obj, b_obj;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildPxProvider", m_description);
+        a_obj = builder->getPxPBuilder()->buildPxProvider(a);
+        b_obj = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
+    }
+
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigDiff", "construct", m_description);
+    return makeSignalObject<SigDiff>( builder->getClientContext()
             , a_obj
             , b_obj
             , getDescription()
             , builder->getVerboseLevel()
-            ));
+            );
 }
 
 /************************************************************************************************/
@@ -87,7 +129,7 @@ SigDiff::SigDiff( const ClientContextPtr& cc
     , m_a(a)
     , m_b(b)
     , m_bEvalScheduled(false)
-    , m_tw(seconds(5))
+    , m_tw(seconds(WindowSeconds))
 {
     using namespace boost::assign;
     initSignalStates( list_of("d0")("avg") );
@@ -101,6 +143,7 @@ SigDiff::SigDiff( const ClientContextPtr& cc
 
 void SigDiff::onInputChange( const IPriceProvider& pxp )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigDiff", "onInputChange", CYCLES_INPUT);
     if(pxp.isPriceOK())
     {
         if(!m_bEvalScheduled)
@@ -114,6 +157,7 @@ void SigDiff::onInputChange( const IPriceProvider& pxp )
 
 void SigDiff::eval()
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigDiff", "eval", CYCLES_INPUT);
     bool ok_a = m_a->isPriceOK();
     bool ok_b = m_b->isPriceOK();
     if( ok_a && ok_b )
@@ -127,22 +171,69 @@ void SigDiff::eval()
 
         setDirty(true);
         setOK(true);
-        notifySignalListeners();
+        if(!deferNotification())
+        {
+            LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+            notifySignalListeners();
+        }
     }
     else // not ok
     {
         if(isOK())
         {
             setOK(false);
-            notifySignalListeners();
+            if(!deferNotification())
+            {
+                LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+                notifySignalListeners();
+            }
         }
     }
     
     m_bEvalScheduled = false;
 }
 
+void SigDiff::writeCheckpoint(SpecOutArchive &ar) const
+{
+    ar.write(uint64_t(m_tw.data().size()));
+    BOOST_FOREACH( const TimeWindow<double>::Entry& e, m_tw.data() )
+    {
+        ar.write(e.time());
+        ar.write(e.data());
+    }
+}
+
+void SigDiff::readCheckpoint(SpecInArchive &ar, uint32_t version)
+{
+    if( version != 1 )
+        LONGBEACH_THROW_ERROR_SS( "SigDiff: unsupported checkpoint version " << version );
+    uint64_t n;
+    ar.read(n);
+    // the checkpoint replaces whatever the signal has taken in so far, so read it into a
+    // fresh window; entries older than the window are dropped by the next eval's flush_start
+    TimeWindow<double> tw( seconds(WindowSeconds) );
+    for( uint64_t i = 0; i < n; ++i )
+    {
+        timeval_t t;
+        double value;
+        ar.read(t);
+        ar.read(value);
+        tw.push_end( TimeWindow<double>::Entry( t, value ) );
+    }
+    requireCheckpointEnd(ar, version);
+    m_tw = tw;
+    setDirty(true);
+}
+
+size_t SigDiff::getHeapFootprint() const
+{
+    // TimeWindow does not expose its container's capacity; count the entries it holds
+    return m_tw.data().size() * sizeof(TimeWindow<double>::Entry) + footprint::of(m_subs);
+}
+
 void SigDiff::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigDiff", "recomputeState", CYCLES_RECOMPUTE);
     if(isOK())
     {
         // we only get here if a && b
@@ -4,6 +4,11 @@
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
 #include <longbeach/signals/SignalSpecMemberList.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/SignalCheckpoint.h>
+#include <longbeach/signals/SignalMemory.h>
 
 #include <longbeach/core/TimeWindow.h>
 
@@ -16,7 +21,10 @@ namespace signals {
 /// Note:m_refPxP is aliased to 'b'
 ///
 
-class SigDiffSpec : public SignalSpecT2<SigDiffSpec>
+class SigDiffSpec
+    : public SignalSpecT2<SigDiffSpec>
+    , public SpecHashCache<SigDiffSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -26,15 +34,26 @@ public:
     virtual instrument_t getInstrument() const { return a->getInstrument(); }
     virtual ISignalPtr build(SignalBuilder *builder) const;
     virtual void checkValid() const;
-    // virtual bool compare(const ISignalSpec* other) const;
+    virtual void hashCombine(size_t &result) const;
+    virtual bool compare(const ISignalSpec* other) const;
     // virtual void print(std::ostream &o, const LuaPrintSettings &ps) const;
     virtual void getDataRequirements(IDataRequirements *rqs) const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigDiffSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IPriceProviderSpecPtr a;
 };
 
 class SigDiff
     : public SignalSmonImpl
+    , public EvalEngineNode
+    , public ICheckpointable
+    , public IMemoryAccountable
 {
 public:
     SigDiff( const ClientContextPtr& cc
@@ -44,12 +63,23 @@ public:
         , bool vbose
         );
 
+    // ICheckpointable interface: the averaging window
+    virtual uint32_t checkpointVersion() const { return 1; }
+    virtual void writeCheckpoint(SpecOutArchive &ar) const;
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version);
+
+    // IMemoryAccountable interface
+    virtual size_t getHeapFootprint() const;
+
 private:
     void onInputChange( const IPriceProvider& pxp );
     void eval();
     void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
 
 private:
+    static const long WindowSeconds = 5;    // span of m_tw
+
     EventDistributorPtr m_spED;
     Priority m_evalPriority;
     IPriceProviderPtr m_a;
@@ -1,6 +1,7 @@
 #include <longbeach/signals/SigKalmanFilter.h>
 
 #include <iostream>
+#include <sstream>
 #include <boost/format.hpp>
 #include <boost/bind.hpp>
 #include <boost/assign/list_of.hpp>
@@ -9,7 +10,12 @@
 #include <longbeach/core/LuabindScripting.h>
 #include <longbeach/core/ptime.h>
 #include <longbeach/clientcore/ClientContext.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SignalLog.h>
 #include <longbeach/math/Workspace.h>
 
 namespace longbeach {
@@ -17,6 +23,19 @@ namespace signals {
 
 using std::cout;
 
+namespace {
+SignalLogSite s_logFinalCov("SigKalmanFilter final error cov", "", 100);
+
+/// The instrument of the provider the filter runs on, as SigMACD takes its own; the
+/// same as the spec's for a built filter, and needs no input spec when built by hand.
+const instrument_t &inputInstrument( const IPriceProviderPtr& pxp )
+{
+    if ( !pxp )
+        LONGBEACH_THROW_ERROR_SS("SigKalmanFilter: was passed a NULL refpp" );
+    return pxp->getInstrument();
+}
+}
+
 /************************************************************************************************/
 // SigKalmanFilterSpec
 /************************************************************************************************/
@@ -46,28 +65,47 @@ SigKalmanFilterSpec::SigKalmanFilterSpec()
 
 ISignalPtr SigKalmanFilterSpec::build(SignalBuilder *builder) const
 {
-    IPriceProviderPtr priceProv = builder->getPxPBuilder()->buildPxProvider(input);
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigKalmanFilterSpec", "build", m_description);
+    IPriceProviderPtr priceProv;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildPxProvider", m_description);
+        priceProv = builder->getPxPBuilder()->buildPxProvider(input);
+    }
     // IBookPtr book = builder->getBookBuilder()->buildBook(m_book);
 
-    std::auto_ptr<SigKalmanFilter> sb(new SigKalmanFilter(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigKalmanFilter", "construct", m_description);
+    SigKalmanFilterPtr sb = makeSignalObject<SigKalmanFilter>(
             builder->getClientContext(),
             m_description,
             *this,
             priceProv,
-            builder->getVerboseLevel() ));
+            builder->getVerboseLevel() );
     // sb->registerWithSourceMonitors(builder->getClientContext(), m_sources);
-    return ISignalPtr(sb);
+    return sb;
 }
 
 void SigKalmanFilterSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigKalmanFilterSpec", "checkValid", m_description);
     SignalSpec::checkValid();
     input->checkValid();
     // util::checkSourcesValid(m_sources);
+    cacheHash();
+}
+
+void SigKalmanFilterSpec::hashCombine(size_t &result) const
+{
+    boost::hash_combine(result, specHash());
+}
+
+void SigKalmanFilterSpec::hashMembers(size_t &seed) const
+{
+    SignalSpecT2<SigKalmanFilterSpec>::hashCombine(seed);
 }
 
 bool SigKalmanFilterSpec::compare(const ISignalSpec* other) const
 {
+    if(fastReject(other)) return false;
     return MemberList::compare( this, other );  // we should be able to use this too
 }
 
@@ -76,8 +114,31 @@ void SigKalmanFilterSpec::print(std::ostream &o, const LuaPrintSettings &ps) con
     MemberList::print( this, luaStream( o, ps ) );
 }
 
+void SigKalmanFilterSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(input);
+    ar.write(R);
+    ar.write(Q);
+    ar.write(step);
+    ar.write(P0);
+    ar.write(use_dynamic_deltas);
+}
+
+void SigKalmanFilterSpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(input);
+    ar.read(R);
+    ar.read(Q);
+    ar.read(step);
+    ar.read(P0);
+    ar.read(use_dynamic_deltas);
+}
+
 void SigKalmanFilterSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigKalmanFilterSpec", "getDataRequirements", m_description);
     SignalSpecT2::getDataRequirements(rqs);
     input->getDataRequirements(rqs);
 }
@@ -103,22 +164,13 @@ bool SigKalmanFilterSpec::registerScripting(lua_State &state)
 
 
 /************************************************************************************************/
-// SigKalmanFilter
+// KalmanPxFilter
 /************************************************************************************************/
 
-SigKalmanFilter::SigKalmanFilter( ClientContextPtr cc
-    , const std::string &desc
-    , const SigKalmanFilterSpec& spec_
-    , const IPriceProviderPtr& pxp
-    , int vbose
-    )
-    : SignalSmonImpl( spec_.getInstrument(), desc, cc->getClockMonitor(), vbose )
-    , m_spec(spec_)
-    , m_spInputPxP(pxp)
+KalmanPxFilter::KalmanPxFilter( const SigKalmanFilterSpec& spec_ )
+    : m_spec(spec_)
+    , m_stepCount(0)
 {
-    using namespace boost::assign;
-    initSignalStates(list_of("px_est")("v_est")("sig_est")("px_pred")("v_pred")("sig_pred"));
-
     // H = [1 0 0] if we consider px as the only real observation or [1 1 1]?
     double H_[] = { 1, 0, 0,
                     0, 1, 0,
@@ -132,54 +184,68 @@ SigKalmanFilter::SigKalmanFilter( ClientContextPtr cc
         );
     if( spec().P0.size() == m_kf.numKalmanStates()*m_kf.numKalmanStates() )
         m_kf.setP0(matrix_t( m_kf.numKalmanStates(), m_kf.numKalmanStates(), spec().P0.data() ));
-
-    if ( !m_spInputPxP )
-        LONGBEACH_THROW_ERROR_SS("SigKalmanFilter: was passed a NULL refpp" );
-
-    m_spInputPxP->addPriceListener( m_subPxP, boost::bind(&SigKalmanFilter::onPriceChanged, this, _1) );
-    // if (m_vboseLvl >= 2) {
-    //     cout << "Constructed " << m_desc << " with numw:" << m_numSBvars << std::endl;
-    // }
 }
 
-void SigKalmanFilter::onPriceChanged( const IPriceProvider& pp )
+double KalmanPxFilter::deltaT( const timeval_t& cur_time ) const
 {
-    timeval_t cur_time = pp.getLastChangeTime();
     double dt = 0.5;
     if( spec().use_dynamic_deltas && m_observations.size() > 0 )
     {
         timeval_t last_time = m_observations[0].getTime();
         dt = timeval_diff( cur_time, last_time ).total_microseconds()/1000000.0;
     }
-    const double A_[] = { 1, dt, 0.5 * dt * dt,
-                          0,  1,            dt,
-                          0,  0,             1,
-    };
-    matrix_t A = matrix_t( m_kf.numKalmanStates(), m_kf.numKalmanStates(), A_ );
+    return dt;
+}
 
+bool KalmanPxFilter::update( const timeval_t& cur_time, double px, double* state )
+{
     if( m_observations.size() == 0 )
     {
-        observation_t init(cur_time);
-        init[0] = pp.getRefPrice();
-        m_observations.push_front(init);
-        m_observations.push_front(init);
-        m_kf.update( init, A );  // update twice to prime the velocity estimation
-
+        prime( cur_time, px );
         m_stepCount = 0;
-        return;
+        return false;
     }
 
     if( m_stepCount % spec().step )
     {
         m_stepCount++;
-        return;
+        return false;
     }
     m_stepCount = 1;
 
+    step( cur_time, px, state );
+    return true;
+}
+
+void KalmanPxFilter::prime( const timeval_t& cur_time, double px )
+{
+    double dt = deltaT( cur_time );
+    const double A_[] = { 1, dt, 0.5 * dt * dt,
+                          0,  1,            dt,
+                          0,  0,             1,
+    };
+    matrix_t A = matrix_t( m_kf.numKalmanStates(), m_kf.numKalmanStates(), A_ );
+
+    observation_t init(cur_time);
+    init[0] = px;
+    m_observations.push_front(init);
+    m_observations.push_front(init);
+    m_kf.update( init, A );  // update twice to prime the velocity estimation
+}
+
+void KalmanPxFilter::step( const timeval_t& cur_time, double px, double* state )
+{
+    double dt = deltaT( cur_time );
+    const double A_[] = { 1, dt, 0.5 * dt * dt,
+                          0,  1,            dt,
+                          0,  0,             1,
+    };
+    matrix_t A = matrix_t( m_kf.numKalmanStates(), m_kf.numKalmanStates(), A_ );
+
     // update
     observation_t obs(cur_time);
     double last_v = m_kf.getLastEstimate()[1];
-    obs[0] = pp.getRefPrice();
+    obs[0] = px;
     obs[1] = (obs[0] - m_observations[1][0]) / (2*dt);
     obs[2] = (obs[1] - last_v) / dt;
 
@@ -189,33 +255,145 @@ void SigKalmanFilter::onPriceChanged( const IPriceProvider& pp )
 
     state_t x_pred = m_kf.predict(A);
 
-    setSignalState( 0, x_hat[0] );
-    setSignalState( 1, x_hat[1] );
-    setSignalState( 2, x_hat[0] - pp.getRefPrice() );
-    setSignalState( 3, x_pred[0] );
-    setSignalState( 4, x_pred[1] );
-    setSignalState( 5, x_pred[0] - pp.getRefPrice() );
+    state[0] = x_hat[0];
+    state[1] = x_hat[1];
+    state[2] = x_hat[0] - px;
+    state[3] = x_pred[0];
+    state[4] = x_pred[1];
+    state[5] = x_pred[0] - px;
+}
+
+void KalmanPxFilter::writeCheckpoint( SpecOutArchive& ar ) const
+{
+    // the filter matrices are a deterministic function of the observations it stepped on, so
+    // the observations are all that is saved; the priming one sits in the deque twice
+    ar.write( m_stepCount );
+    const size_t n = m_observations.empty() ? 0 : m_observations.size() - 1;
+    ar.write( uint64_t(n) );
+    for( size_t i = n; i > 0; --i )
+    {
+        ar.write( m_observations[i-1].getTime() );
+        ar.write( m_observations[i-1][0] );
+    }
+}
+
+bool KalmanPxFilter::readCheckpoint( SpecInArchive& ar, uint32_t version, double* state )
+{
+    int32_t stepCount;
+    uint64_t n;
+    ar.read( stepCount );
+    ar.read( n );
+    std::vector<std::pair<timeval_t, double> > obs( n );
+    for( uint64_t i = 0; i < n; ++i )
+    {
+        ar.read( obs[i].first );
+        ar.read( obs[i].second );
+    }
+    requireCheckpointEnd( ar, version );
+
+    reset();
+    for( uint64_t i = 0; i < n; ++i )
+    {
+        if( i == 0 )
+            prime( obs[i].first, obs[i].second );
+        else
+            step( obs[i].first, obs[i].second, state );
+    }
+    m_stepCount = stepCount;
+    return n > 1;
+}
+
+void KalmanPxFilter::reset()
+{
+    m_observations.clear();
+    m_kf.flush();
+    m_stepCount = 0;
+}
+
+/************************************************************************************************/
+// SigKalmanFilter
+/************************************************************************************************/
+
+SigKalmanFilter::SigKalmanFilter( ClientContextPtr cc
+    , const std::string &desc
+    , const SigKalmanFilterSpec& spec_
+    , const IPriceProviderPtr& pxp
+    , int vbose
+    )
+    : SignalSmonImpl( inputInstrument(pxp), desc, cc->getClockMonitor(), vbose )
+    , m_spec(spec_)
+    , m_spInputPxP(pxp)
+    , m_filter(spec_)
+{
+    using namespace boost::assign;
+    initSignalStates(list_of("px_est")("v_est")("sig_est")("px_pred")("v_pred")("sig_pred"));
+
+    m_spInputPxP->addPriceListener( m_subPxP, boost::bind(&SigKalmanFilter::onPriceChanged, this, _1) );
+    // if (m_vboseLvl >= 2) {
+    //     cout << "Constructed " << m_desc << " with numw:" << m_numSBvars << std::endl;
+    // }
+}
+
+void SigKalmanFilter::onPriceChanged( const IPriceProvider& pp )
+{
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigKalmanFilter", "onPriceChanged", CYCLES_INPUT);
+    double state[KalmanPxFilter::NumStates];
+    if( !m_filter.update( pp.getLastChangeTime(), pp.getRefPrice(), state ) )
+        return;
+
+    for( size_t i = 0; i < KalmanPxFilter::NumStates; ++i )
+        setSignalState( i, state[i] );
     setDirty(false);
-    notifySignalListeners();
+    if(!deferNotification())
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
+}
+
+void SigKalmanFilter::writeCheckpoint( SpecOutArchive& ar ) const
+{
+    m_filter.writeCheckpoint( ar );
+}
+
+void SigKalmanFilter::readCheckpoint( SpecInArchive& ar, uint32_t version )
+{
+    if( version != 1 )
+        LONGBEACH_THROW_ERROR_SS( "SigKalmanFilter: unsupported checkpoint version " << version );
+    double state[KalmanPxFilter::NumStates];
+    if( !m_filter.readCheckpoint( ar, version, state ) )
+        return;
+
+    for( size_t i = 0; i < KalmanPxFilter::NumStates; ++i )
+        setSignalState( i, state[i] );
+    setDirty(false);
+    if(!deferNotification())
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners();
+    }
 }
 
 SigKalmanFilter::~SigKalmanFilter()
 {
     if( m_vboseLvl > 1 )
-        std::cout << getDesc() << " Final Error Cov:\n" << m_kf.P() << std::endl;
+    {
+        std::ostringstream cov;
+        cov << '\n' << m_filter.filter().P();
+        SignalLog::instance().log( s_logFinalCov, getClockMonitor()->getTime(), getDesc(), cov.str() );
+    }
 }
 
 void SigKalmanFilter::reset()
 {
     // resetVars();
     SignalSmonImpl::reset();
-    m_observations.clear();
-    m_kf.flush();
-    m_stepCount = 0;
+    m_filter.reset();
 }
 
 void SigKalmanFilter::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigKalmanFilter", "recomputeState", CYCLES_RECOMPUTE);
     setOK( sourcesOk() && m_spInputPxP->isPriceOK() );
 
     if (!isOK()) {
@@ -1,16 +1,26 @@
 #ifndef LONGBEACH_SIGNALS_SIGKALMANFILTER_H
 #define LONGBEACH_SIGNALS_SIGKALMANFILTER_H
 
+#include <deque>
+
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
 #include <longbeach/math/KalmanFilter.h>
 #include <longbeach/signals/SignalSpecMemberList.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/SignalCheckpoint.h>
+#include <longbeach/signals/SignalMemory.h>
 
 namespace longbeach {
 namespace signals {
 
 /// SignalSpec for SigKalmanFilter
-class SigKalmanFilterSpec : public SignalSpecT2<SigKalmanFilterSpec>
+class SigKalmanFilterSpec
+    : public SignalSpecT2<SigKalmanFilterSpec>
+    , public SpecHashCache<SigKalmanFilterSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -20,10 +30,18 @@ public:
     virtual instrument_t getInstrument() const { return input->getInstrument(); }
     virtual ISignalPtr build(SignalBuilder *builder) const;
     virtual void checkValid() const;
+    virtual void hashCombine(size_t &result) const;
     virtual bool compare(const ISignalSpec* other) const;
     virtual void print(std::ostream &o, const LuaPrintSettings &ps) const;
     virtual void getDataRequirements(IDataRequirements *rqs) const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigKalmanFilterSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IPriceProviderSpecPtr input;
     double R;
     double Q;
@@ -33,8 +51,55 @@ public:
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigKalmanFilterSpec);
 
+/// The filter recurrence of SigKalmanFilter, apart from the price provider plumbing, so that
+/// the batch path (BatchSignalEval) steps exactly what the online signal steps.
+class KalmanPxFilter
+{
+public:
+    typedef KalmanFilter<3>::State state_t;
+    typedef KalmanFilter<3>::Observation observation_t;
+
+    /// px_est, v_est, sig_est, px_pred, v_pred, sig_pred
+    static const size_t NumStates = 6;
+
+    explicit KalmanPxFilter( const SigKalmanFilterSpec& spec );
+
+    /// Feeds the price observed at tv.  Returns true and fills state[NumStates] when the
+    /// filter stepped; the first price only primes it, and with step > 1 only every step'th
+    /// price after that is used.
+    bool update( const timeval_t& tv, double px, double* state );
+    void reset();
+
+    /// Saves the observations the filter stepped on; restoring replays them through a reset
+    /// filter, which reproduces its estimate and covariance exactly.  readCheckpoint expects
+    /// ar to hold nothing after the filter, and returns true and fills state[NumStates] with
+    /// the last step if there was one.
+    void writeCheckpoint( SpecOutArchive& ar ) const;
+    bool readCheckpoint( SpecInArchive& ar, uint32_t version, double* state );
+
+    /// Heap bytes of the observation history, which grows by one entry per step.
+    size_t getHeapFootprint() const { return footprint::of(m_observations); }
+
+    KalmanFilter<3>& filter() { return m_kf; }
+    const std::deque<observation_t>& getObservations() const { return m_observations; }
+
+private:
+    const SigKalmanFilterSpec& spec() const { return m_spec; }
+    double deltaT( const timeval_t& tv ) const;
+    void prime( const timeval_t& tv, double px );
+    void step( const timeval_t& tv, double px, double* state );
+
+    const SigKalmanFilterSpec m_spec;
+    int32_t m_stepCount;
+    std::deque<observation_t> m_observations; // may not need this later
+    KalmanFilter<3> m_kf;
+};
+
 class SigKalmanFilter
     : public SignalSmonImpl
+    , public EvalEngineNode
+    , public ICheckpointable
+    , public IMemoryAccountable
     , protected IBookListener
 {
 public:
@@ -47,9 +112,18 @@ public:
 
     virtual void reset();
 
+    // ICheckpointable interface
+    virtual uint32_t checkpointVersion() const { return 1; }
+    virtual void writeCheckpoint(SpecOutArchive &ar) const;
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version);
+
+    // IMemoryAccountable interface
+    virtual size_t getHeapFootprint() const { return m_filter.getHeapFootprint(); }
+
 protected:
     const SigKalmanFilterSpec& spec() const { return m_spec; }
     virtual void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
 
     // IPriceProvider Listener
     void onPriceChanged( const IPriceProvider& pp );
@@ -59,12 +133,7 @@ protected:
     IPriceProviderPtr m_spInputPxP;
     Subscription m_subPxP;
 
-    int32_t m_stepCount;
-
-    typedef KalmanFilter<3>::State state_t;
-    typedef KalmanFilter<3>::Observation observation_t;
-    std::deque<observation_t> m_observations; // may not need this later
-    KalmanFilter<3> m_kf;
+    KalmanPxFilter m_filter;
 };
 LONGBEACH_DECLARE_SHARED_PTR(SigKalmanFilter);
 
@@ -5,13 +5,22 @@
 #include <longbeach/core/Error.h>
 #include <longbeach/core/LuaCodeGen.h>
 #include <longbeach/core/LuabindScripting.h>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SignalLog.h>
 #include <longbeach/clientcore/clientcoreutils.h>
 #include <longbeach/clientcore/ShfeTickProvider.h>
 
 namespace longbeach {
 namespace signals {
 
+namespace {
+SignalLogSite s_logTakingSample("BaselineRollingWindow::update taking sample", "sampled_history", 10);
+}
+
 TradedQuantity::TradedQuantity( const TradeTick& trade_tick, const IBookPtr book, const double last_best_bid
                                 , const double last_best_ask, const double last_midprice
                                 , const boost::optional<double> notional_price)
@@ -146,6 +155,89 @@ void RollingWindow::expireTradedQuantities(const timeval_t current_time)
         m_tradedQuantities.erase( m_tradedQuantities.begin(), m_tradedQuantities.begin()+number_to_erase );
 
 }
+namespace {
+
+void writeTradedQuantities(SpecOutArchive &ar, const std::vector<TradedQuantity> &tqs)
+{
+    ar.write(uint64_t(tqs.size()));
+    for(std::vector<TradedQuantity>::const_iterator it = tqs.begin(); it != tqs.end(); ++it)
+    {
+        ar.write(it->getTradeTime());
+        ar.write(it->getTradedQuantity());
+    }
+}
+
+void readTradedQuantities(SpecInArchive &ar, std::vector<TradedQuantity> &tqs)
+{
+    uint64_t n;
+    ar.read(n);
+    tqs.clear();
+    for(uint64_t i = 0; i < n; ++i)
+    {
+        timeval_t t;
+        int32_t q;
+        ar.read(t);
+        ar.read(q);
+        tqs.push_back(TradedQuantity(t, q));
+    }
+}
+
+void writeHistory(SpecOutArchive &ar, const std::deque<WindowAtTime> &h)
+{
+    ar.write(uint64_t(h.size()));
+    for(std::deque<WindowAtTime>::const_iterator it = h.begin(); it != h.end(); ++it)
+    {
+        ar.write(it->getTotal());
+        ar.write(it->getTime());
+    }
+}
+
+void readHistory(SpecInArchive &ar, std::deque<WindowAtTime> &h)
+{
+    uint64_t n;
+    ar.read(n);
+    h.clear();
+    for(uint64_t i = 0; i < n; ++i)
+    {
+        double total;
+        timeval_t t;
+        ar.read(total);
+        ar.read(t);
+        h.push_back(WindowAtTime(total, t));
+    }
+}
+
+} // anonymous namespace
+
+void RollingWindow::writeCheckpoint(SpecOutArchive &ar) const
+{
+    ar.write(m_signal);
+    ar.write(m_smoothExpiryAdjustment);
+    writeTradedQuantities(ar, m_tradedQuantities);
+}
+
+void RollingWindow::readCheckpoint(SpecInArchive &ar, uint32_t version)
+{
+    double signal, adjustment;
+    std::vector<TradedQuantity> tqs;
+    ar.read(signal);
+    ar.read(adjustment);
+    readTradedQuantities(ar, tqs);
+    m_signal = signal;
+    m_smoothExpiryAdjustment = adjustment;
+    m_tradedQuantities.swap(tqs);
+}
+
+RollingWindowPtr RollingWindow::clone() const
+{
+    return makeSignalObject<RollingWindow>(*this);
+}
+
+size_t RollingWindow::getHeapFootprint() const
+{
+    return footprint::of(m_tradedQuantities);
+}
+
 SigLastTradedQuantity::SigLastTradedQuantity(
         const instrument_t& instr, const std::string &desc, 
         ClientContextPtr cc,
@@ -183,7 +275,7 @@ SigLastTradedQuantity::SigLastTradedQuantity(
     for ( uint32_t i = 0; i < vWindowDurations.size(); ++i )
     {
         allocState( boost::str(boost::format("wd%1%") % i) );
-        m_rollingWindows.push_back( new RollingWindow(vWindowDurations[i], expire_smoothing_factor) );
+        m_rollingWindows.push_back( makeSignalObject<RollingWindow>(vWindowDurations[i], expire_smoothing_factor) );
     }
 }
 
@@ -204,8 +296,77 @@ void SigLastTradedQuantity::reset()
 }
 
 
+void SigLastTradedQuantity::writeCheckpoint(SpecOutArchive &ar) const
+{
+    ar.write(uint64_t(m_rollingWindows.size()));
+    for( uint32_t i = 0; i < m_rollingWindows.size(); i++ )
+        m_rollingWindows[i]->writeCheckpoint(ar);
+    ar.write(m_currentBestBidPrice);
+    ar.write(m_currentBestAskPrice);
+    ar.write(m_currentMidPrice);
+    ar.write(m_lastBestBidPrice);
+    ar.write(m_lastBestAskPrice);
+    ar.write(m_lastMidPrice);
+    ar.write(m_lastBookUpdateTime);
+}
+
+void SigLastTradedQuantity::readCheckpoint(SpecInArchive &ar, uint32_t version)
+{
+    if( version != 1 )
+        LONGBEACH_THROW_ERROR_SS( "SigLastTradedQuantity: unsupported checkpoint version " << version );
+    uint64_t n;
+    ar.read(n);
+    if( n != m_rollingWindows.size() )
+        LONGBEACH_THROW_ERROR_SS( "SigLastTradedQuantity: checkpoint has " << n << " windows, signal has "
+                                  << m_rollingWindows.size() );
+    // read everything into copies before changing anything, like RollingWindow does, so that
+    // a truncated or corrupt checkpoint leaves the signal as it was
+    std::vector<RollingWindowPtr> windows;
+    for( uint32_t i = 0; i < m_rollingWindows.size(); i++ )
+    {
+        windows.push_back( m_rollingWindows[i]->clone() );
+        windows.back()->readCheckpoint(ar, version);
+    }
+    double currentBestBidPrice, currentBestAskPrice, currentMidPrice;
+    double lastBestBidPrice, lastBestAskPrice, lastMidPrice;
+    timeval_t lastBookUpdateTime;
+    ar.read(currentBestBidPrice);
+    ar.read(currentBestAskPrice);
+    ar.read(currentMidPrice);
+    ar.read(lastBestBidPrice);
+    ar.read(lastBestAskPrice);
+    ar.read(lastMidPrice);
+    ar.read(lastBookUpdateTime);
+    requireCheckpointEnd(ar, version);
+
+    m_rollingWindows.swap(windows);
+    m_currentBestBidPrice = currentBestBidPrice;
+    m_currentBestAskPrice = currentBestAskPrice;
+    m_currentMidPrice = currentMidPrice;
+    m_lastBestBidPrice = lastBestBidPrice;
+    m_lastBestAskPrice = lastBestAskPrice;
+    m_lastMidPrice = lastMidPrice;
+    m_lastBookUpdateTime = lastBookUpdateTime;
+
+    updateState();
+    if(!deferNotification(m_lastBookUpdateTime))
+    {
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        notifySignalListeners(m_lastBookUpdateTime);
+    }
+}
+
+size_t SigLastTradedQuantity::getHeapFootprint() const
+{
+    size_t bytes = footprint::of(m_vWindowDurations) + footprint::of(m_rollingWindows);
+    for( uint32_t i = 0; i < m_rollingWindows.size(); i++ )
+        bytes += m_rollingWindows[i]->getHeapFootprint();
+    return bytes;
+}
+
 void SigLastTradedQuantity::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigLastTradedQuantity", "recomputeState", CYCLES_RECOMPUTE);
     updateState();
 }
 
@@ -249,6 +410,7 @@ void SigLastTradedQuantity::onWakeupCall( const timeval_t& ctv, const timeval_t&
 void SigLastTradedQuantity::onBookChanged( const IBook* pBook, const Msg* pMsg,
                                 int32_t bidLevelChanged, int32_t askLevelChanged )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigLastTradedQuantity", "onBookChanged", CYCLES_INPUT);
     // Book updated first, as expected
     m_lastBestBidPrice = m_currentBestBidPrice;
     m_lastBestAskPrice = m_currentBestAskPrice;
@@ -263,6 +425,7 @@ void SigLastTradedQuantity::onBookChanged( const IBook* pBook, const Msg* pMsg,
 
 void SigLastTradedQuantity::onTickReceived( const ITickProvider* tp, const TradeTick& tick )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigLastTradedQuantity", "onTickReceived", CYCLES_INPUT);
     m_isOK = m_spBook->isOK() && m_spTickProvider->isLastTickOK();
     if( m_isOK )
     {
@@ -313,14 +476,19 @@ void SigLastTradedQuantity::onTickReceived( const ITickProvider* tp, const Trade
                                                     , avg_notional_price) );
         }
         updateState();
-        notifySignalListeners(trade_time);
+        if(!deferNotification(trade_time))
+        {
+            LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+            notifySignalListeners(trade_time);
+        }
     }
 }
 
-BaselineRollingWindow::BaselineRollingWindow( longbeach::ptime_duration_t window_length,
+BaselineRollingWindow::BaselineRollingWindow( const std::string& desc, longbeach::ptime_duration_t window_length,
                                               double expire_smoothing_factor, longbeach::ptime_duration_t sample_period
                                               , uint32_t history_length, double smoothing_factor )
     : RollingWindow( window_length, expire_smoothing_factor )
+    , m_desc( desc )
     , m_numberOfHistorySamples( history_length )
     , m_samplePeriod( sample_period )
     , m_smoothingFactor( smoothing_factor )
@@ -371,10 +539,8 @@ void BaselineRollingWindow::update(TradedQuantity traded_quantity )
     {
         m_sampledHistory.push_back( WindowAtTime(window_total, current_time) );
 
-         std::cout << "BaselineRollingWindow::update taking_sample: start_time:"
-                   <<  m_sampledHistory.back().getTime()
-                   << " sampled_history:" << m_sampledHistory.size()
-                   << std::endl;
+        SignalLog::instance().log(s_logTakingSample, m_sampledHistory.back().getTime(), m_desc,
+                                  m_sampledHistory.size());
 
     }
 
@@ -383,6 +549,38 @@ void BaselineRollingWindow::update(TradedQuantity traded_quantity )
         m_sampledHistory.pop_front();
 }
 
+void BaselineRollingWindow::writeCheckpoint(SpecOutArchive &ar) const
+{
+    RollingWindow::writeCheckpoint(ar);
+    ar.write(m_smoothedTotalAtStart);
+    writeHistory(ar, m_sampledHistory);
+    writeHistory(ar, m_recentHistory);
+}
+
+void BaselineRollingWindow::readCheckpoint(SpecInArchive &ar, uint32_t version)
+{
+    RollingWindow::readCheckpoint(ar, version);
+    double smoothedTotalAtStart;
+    std::deque<WindowAtTime> sampled, recent;
+    ar.read(smoothedTotalAtStart);
+    readHistory(ar, sampled);
+    readHistory(ar, recent);
+    m_smoothedTotalAtStart = smoothedTotalAtStart;
+    m_sampledHistory.swap(sampled);
+    m_recentHistory.swap(recent);
+}
+
+RollingWindowPtr BaselineRollingWindow::clone() const
+{
+    return makeSignalObject<BaselineRollingWindow>(*this);
+}
+
+size_t BaselineRollingWindow::getHeapFootprint() const
+{
+    return RollingWindow::getHeapFootprint() + footprint::of(m_tradedQuantities)
+        + footprint::of(m_sampledHistory) + footprint::of(m_recentHistory) + footprint::of(m_desc);
+}
+
 double BaselineRollingWindow::getSignal() const
 {
     double average_magnitude = 0.0;
@@ -410,8 +608,6 @@ double BaselineRollingWindow::getSignal() const
 //                  << " historic_average: " << average_magnitude
 //                  << std::endl;
     }
-    std::cout << "BaslineRollingWindow debug: signal:"
-              << signal << std::endl;
     return signal;
 }
 
@@ -437,7 +633,7 @@ SigBaselineLastTradedQuantity::SigBaselineLastTradedQuantity(
     {
         ptime_duration_t sample_period = vWindowDurations[i]
             * ( double(windows_to_sample) / double(window_history_length) );
-        m_rollingWindows.push_back( new BaselineRollingWindow(vWindowDurations[i], expire_smoothing_factor
+        m_rollingWindows.push_back( makeSignalObject<BaselineRollingWindow>(desc, vWindowDurations[i], expire_smoothing_factor
                                                           , sample_period, window_history_length
                                                           , smoothing_factor) );
     }
@@ -471,21 +667,32 @@ SigLastTradedQuantitySpec::SigLastTradedQuantitySpec( const SigLastTradedQuantit
 
 ISignalPtr SigLastTradedQuantitySpec::build(SignalBuilder *builder) const
 {
-    ITickProviderCPtr spTP = builder->getSourceTickFactory()->getTickProvider( m_inputBook->getInstrument(), m_tickSource, true );
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigLastTradedQuantitySpec", "build", m_description);
+    ITickProviderCPtr spTP;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "getTickProvider", m_description);
+        spTP = builder->getSourceTickFactory()->getTickProvider( m_inputBook->getInstrument(), m_tickSource, true );
+    }
     if ( !spTP )
         LONGBEACH_THROW_ERROR_SS( "handleSigDecayTick cannot create SourceTick for " << m_tickSource );
 
-    IBookPtr book = builder->getBookBuilder()->buildBook(m_inputBook);
+    IBookPtr book;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildBook", m_description);
+        book = builder->getBookBuilder()->buildBook(m_inputBook);
+    }
 
-    return ISignalPtr(new SigLastTradedQuantity(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigLastTradedQuantity", "construct", m_description);
+    return makeSignalObject<SigLastTradedQuantity>(
             m_inputBook->getInstrument(), m_description,
             builder->getClientContext(),
             builder->getClockMonitor(),
-            m_vWindowDurations, m_expireSmoothingFactor, book, spTP, m_returnMode));
+            m_vWindowDurations, m_expireSmoothingFactor, book, spTP, m_returnMode);
 }
 
 void SigLastTradedQuantitySpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigLastTradedQuantitySpec", "checkValid", m_description);
     SignalSpec::checkValid();
     if(!m_inputBook)
         LONGBEACH_THROW_ERROR_SS("SigLastTradedQuantity " << m_description << ": inputBook is NULL");
@@ -495,6 +702,7 @@ void SigLastTradedQuantitySpec::checkValid() const
         LONGBEACH_THROW_ERROR_SS("SigLastTradedQuantity " << m_description << ": WindowDurations.size() is 0");
     if(m_expireSmoothingFactor > 1.0 || m_expireSmoothingFactor < 0.0 )
         LONGBEACH_THROW_ERROR_SS("SigLastTradedQuantity " << m_description << ": expiry smoothing factor is not <= 1.0");
+    cacheHash();
 }
 
 SigLastTradedQuantitySpec *SigLastTradedQuantitySpec::clone() const
@@ -504,16 +712,22 @@ SigLastTradedQuantitySpec *SigLastTradedQuantitySpec::clone() const
 
 void SigLastTradedQuantitySpec::hashCombine(size_t &result) const
 {
-    SignalSpec::hashCombine(result);
-    boost::hash_combine(result, *m_inputBook);
-    boost::hash_combine(result, m_tickSource);
-    boost::hash_combine(result, m_vWindowDurations);
-    boost::hash_combine(result, m_expireSmoothingFactor);
-    boost::hash_combine(result, m_returnMode);
+    boost::hash_combine(result, specHash());
+}
+
+void SigLastTradedQuantitySpec::hashMembers(size_t &seed) const
+{
+    SignalSpec::hashCombine(seed);
+    boost::hash_combine(seed, *m_inputBook);
+    boost::hash_combine(seed, m_tickSource);
+    boost::hash_combine(seed, m_vWindowDurations);
+    boost::hash_combine(seed, m_expireSmoothingFactor);
+    boost::hash_combine(seed, m_returnMode);
 }
 
 bool SigLastTradedQuantitySpec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     if(!SignalSpec::compare(other)) return false;
 
     const SigLastTradedQuantitySpec *b = dynamic_cast<const SigLastTradedQuantitySpec*>(other);
@@ -545,11 +759,32 @@ void SigLastTradedQuantitySpec::print(std::ostream &o, const LuaPrintSettings &p
 
 void SigLastTradedQuantitySpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigLastTradedQuantitySpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     m_inputBook->getDataRequirements(rqs);
 //    m_inputTickProvider->getDataRequirements(rqs);
 }
 
+void SigLastTradedQuantitySpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(m_inputBook);
+    ar.writeExternal(m_tickSource);
+    ar.write(m_vWindowDurations);
+    ar.write(m_expireSmoothingFactor);
+    ar.write(m_returnMode);
+}
+
+void SigLastTradedQuantitySpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(m_inputBook);
+    ar.readExternal(m_tickSource);
+    ar.read(m_vWindowDurations);
+    ar.read(m_expireSmoothingFactor);
+    ar.read(m_returnMode);
+}
+
 bool SigLastTradedQuantitySpec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -584,22 +819,33 @@ SigBaselineLastTradedQuantitySpec::SigBaselineLastTradedQuantitySpec( const SigB
 
 ISignalPtr SigBaselineLastTradedQuantitySpec::build(SignalBuilder *builder) const
 {
-    ITickProviderCPtr spTP = builder->getSourceTickFactory()->getTickProvider( m_inputBook->getInstrument(), m_tickSource, true );
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBaselineLastTradedQuantitySpec", "build", m_description);
+    ITickProviderCPtr spTP;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "getTickProvider", m_description);
+        spTP = builder->getSourceTickFactory()->getTickProvider( m_inputBook->getInstrument(), m_tickSource, true );
+    }
     if ( !spTP )
         LONGBEACH_THROW_ERROR_SS( "handleSigDecayTick cannot create SourceTick for " << m_tickSource );
 
-    IBookPtr book = builder->getBookBuilder()->buildBook(m_inputBook);
+    IBookPtr book;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildBook", m_description);
+        book = builder->getBookBuilder()->buildBook(m_inputBook);
+    }
 
-    return ISignalPtr(new SigBaselineLastTradedQuantity(
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBaselineLastTradedQuantity", "construct", m_description);
+    return makeSignalObject<SigBaselineLastTradedQuantity>(
             m_inputBook->getInstrument(), m_description,
             builder->getClientContext(),
             builder->getClockMonitor(),
             m_vWindowDurations, m_numberOfHistorySamples, m_windowsToSample, m_cutoff
-            , m_expireSmoothingFactor, m_smoothingFactor, book, spTP));
+            , m_expireSmoothingFactor, m_smoothingFactor, book, spTP);
 }
 
 void SigBaselineLastTradedQuantitySpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBaselineLastTradedQuantitySpec", "checkValid", m_description);
     SignalSpec::checkValid();
     if(!m_inputBook)
         LONGBEACH_THROW_ERROR_SS("SigBaselineLastTradedQuantity " << m_description << ": inputBook is NULL");
@@ -615,6 +861,7 @@ void SigBaselineLastTradedQuantitySpec::checkValid() const
         LONGBEACH_THROW_ERROR_SS("SigBaselineLastTradedQuantity " << m_description << ": expire smoothing factor is not <= 1.0");
     if(m_smoothingFactor > 1.0 || m_smoothingFactor < 0.0 )
         LONGBEACH_THROW_ERROR_SS("SigBaselineLastTradedQuantity " << m_description << ": smoothing factor is not <= 1.0");
+    cacheHash();
 }
 
 SigBaselineLastTradedQuantitySpec *SigBaselineLastTradedQuantitySpec::clone() const
@@ -624,19 +871,25 @@ SigBaselineLastTradedQuantitySpec *SigBaselineLastTradedQuantitySpec::clone() co
 
 void SigBaselineLastTradedQuantitySpec::hashCombine(size_t &result) const
 {
-    SignalSpec::hashCombine(result);
-    boost::hash_combine(result, *m_inputBook);
-    boost::hash_combine(result, m_tickSource);
-    boost::hash_combine(result, m_vWindowDurations);
-    boost::hash_combine(result, m_numberOfHistorySamples);
-    boost::hash_combine(result, m_windowsToSample);
-    boost::hash_combine(result, m_cutoff);
-    boost::hash_combine(result, m_expireSmoothingFactor);
-    boost::hash_combine(result, m_smoothingFactor);
+    boost::hash_combine(result, specHash());
+}
+
+void SigBaselineLastTradedQuantitySpec::hashMembers(size_t &seed) const
+{
+    SignalSpec::hashCombine(seed);
+    boost::hash_combine(seed, *m_inputBook);
+    boost::hash_combine(seed, m_tickSource);
+    boost::hash_combine(seed, m_vWindowDurations);
+    boost::hash_combine(seed, m_numberOfHistorySamples);
+    boost::hash_combine(seed, m_windowsToSample);
+    boost::hash_combine(seed, m_cutoff);
+    boost::hash_combine(seed, m_expireSmoothingFactor);
+    boost::hash_combine(seed, m_smoothingFactor);
 }
 
 bool SigBaselineLastTradedQuantitySpec::compare(const ISignalSpec *other) const
 {
+    if(fastReject(other)) return false;
     if(!SignalSpec::compare(other)) return false;
 
     const SigBaselineLastTradedQuantitySpec *b = dynamic_cast<const SigBaselineLastTradedQuantitySpec*>(other);
@@ -674,11 +927,38 @@ void SigBaselineLastTradedQuantitySpec::print(std::ostream &o, const LuaPrintSet
 
 void SigBaselineLastTradedQuantitySpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigBaselineLastTradedQuantitySpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
     m_inputBook->getDataRequirements(rqs);
 //    m_inputTickProvider->getDataRequirements(rqs);
 }
 
+void SigBaselineLastTradedQuantitySpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.writeExternal(m_inputBook);
+    ar.writeExternal(m_tickSource);
+    ar.write(m_vWindowDurations);
+    ar.write(m_numberOfHistorySamples);
+    ar.write(m_cutoff);
+    ar.write(m_windowsToSample);
+    ar.write(m_expireSmoothingFactor);
+    ar.write(m_smoothingFactor);
+}
+
+void SigBaselineLastTradedQuantitySpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.readExternal(m_inputBook);
+    ar.readExternal(m_tickSource);
+    ar.read(m_vWindowDurations);
+    ar.read(m_numberOfHistorySamples);
+    ar.read(m_cutoff);
+    ar.read(m_windowsToSample);
+    ar.read(m_expireSmoothingFactor);
+    ar.read(m_smoothingFactor);
+}
+
 bool SigBaselineLastTradedQuantitySpec::registerScripting(lua_State &state)
 {
     // each Spec class must be added to registerScripting in Signals_Scripting.cc
@@ -9,6 +9,11 @@
 
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/SignalCheckpoint.h>
+#include <longbeach/signals/SignalMemory.h>
 
 
 namespace longbeach {
@@ -24,6 +29,12 @@ public:
     TradedQuantity( const TradeTick& trade_tick, const IBookPtr book, const double last_best_bid, const double last_best_ask
                     , const double last_midprice, const boost::optional<double> notional_price );
 
+    /// A quantity as previously classified, for restoring checkpoints.
+    TradedQuantity( const timeval_t trade_time, const int32_t traded_quantity )
+        : m_tradeTime( trade_time )
+        , m_tradedQuantity( traded_quantity )
+    {}
+
     const bool isExpired( const timeval_t expiration_time ) const { return (m_tradeTime <= expiration_time);}
 
     const bool inWindow(const timeval_t current_time, ptime_duration_t window_duration) const
@@ -55,6 +66,15 @@ public:
     void reset();
 
     void expireTradedQuantities(const timeval_t current_time);
+
+    /// Checkpoint support for SigLastTradedQuantity, which restores into clones so that a
+    /// failed read leaves its windows untouched.
+    virtual void writeCheckpoint(SpecOutArchive &ar) const;
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version);
+    virtual boost::shared_ptr<RollingWindow> clone() const;
+
+    /// Heap bytes of the window's trade lists and histories.
+    virtual size_t getHeapFootprint() const;
 protected:
     double smooth( double old_value, double new_value, double smoothing_factor);
 
@@ -67,10 +87,14 @@ private:
     double m_expireSmoothingFactor;
     double m_smoothExpiryAdjustment;
 };
+LONGBEACH_DECLARE_SHARED_PTR( RollingWindow );
 
 
 class SigLastTradedQuantity
     : public SignalStateImpl
+    , public EvalEngineNode
+    , public ICheckpointable
+    , public IMemoryAccountable
     , private IClockListener
     , private ITickListener
     , private IBookListener
@@ -91,6 +115,14 @@ public:
     const std::vector<longbeach::ptime_duration_t>& getWindowDurations() const
     {   return m_vWindowDurations; }
 
+    // ICheckpointable interface
+    virtual uint32_t checkpointVersion() const { return 1; }
+    virtual void writeCheckpoint(SpecOutArchive &ar) const;
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version);
+
+    // IMemoryAccountable interface
+    virtual size_t getHeapFootprint() const;
+
 private:
     // IClockListener interface
     virtual void onWakeupCall( const timeval_t& ctv, const timeval_t& swtv, int reason, void* pData);
@@ -115,6 +147,7 @@ private:
 
     void reset();
     virtual void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(tv); }
 
     virtual void updateState() const ;
 protected:
@@ -126,7 +159,7 @@ protected:
 
     boost::optional<double> m_lotSize;
 
-    std::vector<RollingWindow*> m_rollingWindows;
+    std::vector<RollingWindowPtr> m_rollingWindows;
 
     double m_currentBestBidPrice;
     double m_currentBestAskPrice;
@@ -144,7 +177,10 @@ LONGBEACH_DECLARE_SHARED_PTR( SigLastTradedQuantity );
 
 
 /// SignalSpec for SigLastTradedQuantity
-class SigLastTradedQuantitySpec : public SignalSpec
+class SigLastTradedQuantitySpec
+    : public SignalSpec
+    , public SpecHashCache<SigLastTradedQuantitySpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -164,6 +200,13 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SigLastTradedQuantitySpec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigLastTradedQuantitySpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IBookSpecPtr  m_inputBook;
     source_t m_tickSource;
     std::vector<longbeach::ptime_duration_t> m_vWindowDurations;
@@ -194,15 +237,23 @@ class BaselineRollingWindow
 {
 public:
 
-    BaselineRollingWindow( longbeach::ptime_duration_t window_length, double expire_smoothing_factor, longbeach::ptime_duration_t sample_period
-                           , uint32_t history_length, double smoothing_factor );
+    /// desc is the owning signal's description, for the window's log records.
+    BaselineRollingWindow( const std::string& desc, longbeach::ptime_duration_t window_length, double expire_smoothing_factor
+                           , longbeach::ptime_duration_t sample_period, uint32_t history_length, double smoothing_factor );
 
     virtual ~BaselineRollingWindow(){};
 
     virtual void update(TradedQuantity traded_quantity);
     virtual double getSignal() const;
 
+    virtual void writeCheckpoint(SpecOutArchive &ar) const;
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version);
+    virtual boost::shared_ptr<RollingWindow> clone() const;
+
+    virtual size_t getHeapFootprint() const;
+
 private:
+    std::string m_desc;
     uint32_t m_numberOfHistorySamples;
     longbeach::ptime_duration_t m_samplePeriod;
     std::vector<TradedQuantity> m_tradedQuantities;
@@ -240,7 +291,10 @@ LONGBEACH_DECLARE_SHARED_PTR( SigBaselineLastTradedQuantity );
 
 
 /// SignalSpec for SigBaselineLastTradedQuantity
-class SigBaselineLastTradedQuantitySpec : public SignalSpec
+class SigBaselineLastTradedQuantitySpec
+    : public SignalSpec
+    , public SpecHashCache<SigBaselineLastTradedQuantitySpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -264,6 +318,13 @@ public:
     virtual void getDataRequirements(IDataRequirements *rqs) const;
     virtual SigBaselineLastTradedQuantitySpec *clone() const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigBaselineLastTradedQuantitySpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     IBookSpecPtr  m_inputBook;
     source_t m_tickSource;
     std::vector<longbeach::ptime_duration_t> m_vWindowDurations;
@@ -1,6 +1,9 @@
 #include "SigMA.h"
 #include <boost/assign/list_of.hpp>
 #include <boost/lexical_cast.hpp>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
 #include <longbeach/signals/SignalsPriority.h>
 #include <longbeach/signals/Signals_Scripting.h>
@@ -51,20 +54,64 @@ namespace longbeach{
 	    return true;
 	}
 
+	void SigMASpec::writeBinary( SpecOutArchive &ar ) const
+	{
+	    ar.writeSignalSpecBase( *this );
+	    ar.writeExternal( m_source );
+	    ar.write( windows );
+	    ar.write( periods );
+	    ar.write( m_mode );
+	}
+
+	void SigMASpec::readBinary( SpecInArchive &ar )
+	{
+	    ar.readSignalSpecBase( *this );
+	    ar.readExternal( m_source );
+	    ar.read( windows );
+	    ar.read( periods );
+	    ar.read( m_mode );
+	}
+
 	void SigMASpec::getDataRequirements( IDataRequirements *rqs ) const
 	{
+	    LONGBEACH_PROFILE_BUILD_SCOPE( "SigMASpec", "getDataRequirements", m_description );
 	    SignalSpec::getDataRequirements( rqs );
 	}
 
 	void SigMASpec::checkValid() const
 	{
+	    LONGBEACH_PROFILE_BUILD_SCOPE( "SigMASpec", "checkValid", m_description );
 	    SignalSpec::checkValid();
+	    cacheHash();
+	}
+
+	void SigMASpec::hashCombine( size_t &result ) const
+	{
+	    boost::hash_combine( result, specHash() );
+	}
+
+	void SigMASpec::hashMembers( size_t &seed ) const
+	{
+	    SignalSpecT2<SigMASpec>::hashCombine( seed );
+	}
+
+	bool SigMASpec::compare( const ISignalSpec *other ) const
+	{
+	    if( fastReject( other ) ) return false;
+	    return SignalSpecT2<SigMASpec>::compare( other );
 	}
 
 	ISignalPtr SigMASpec::build( SignalBuilder* builder ) const
 	{
-	    IPriceProviderPtr ref_pxp = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
-	    return ISignalPtr(new SigMA( builder->getClientContext()
+	    LONGBEACH_PROFILE_BUILD_SCOPE( "SigMASpec", "build", m_description );
+	    IPriceProviderPtr ref_pxp;
+	    {
+		LONGBEACH_PROFILE_BUILD_SCOPE( "SignalBuilder", "buildPxProvider", m_description );
+		ref_pxp = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
+	    }
+
+	    LONGBEACH_PROFILE_BUILD_SCOPE( "SigMA", "construct", m_description );
+	    return makeSignalObject<SigMA>( builder->getClientContext()
                                      , builder->getCandlesticksFactory()
                                      , getDescription()
                                      , ref_pxp
@@ -73,7 +120,7 @@ namespace longbeach{
                                      , periods
                                      , m_mode
                                      , builder->getVerboseLevel()
-                              ));
+                              );
 	} 
 
 	/********************************************/
@@ -126,26 +173,37 @@ namespace longbeach{
 	void SigMA::onUpdate( const longbeach::ICandlestickSeries* series
 			      , const longbeach::Candlestick& entry )
 	{
+	    LONGBEACH_PROFILE_SIGNAL_HANDLER( "SigMA", "onUpdate", CYCLES_INPUT );
 	    for( std::vector<int>::size_type i = 0; i != periods.size(); i ++ )
 		{
 		    m_ma[i] = technicals::ma( technicals::close( m_spSeries[i] ), periods[i] );
 		}
-	    notifySignalListeners();
+	    if( !deferNotification() )
+	    {
+	        LONGBEACH_SIGNAL_CYCLES( CYCLES_NOTIFY );
+	        notifySignalListeners();
+	    }
 	}
 
 	void SigMA::onInputChange( const IPriceProvider& pxp )
 	{
+	    LONGBEACH_PROFILE_SIGNAL_HANDLER( "SigMA", "onInputChange", CYCLES_INPUT );
 	    if( pxp.isPriceOK() )
 		{
 		    px = pxp.getRefPrice();
 		    setDirty( true );
 		    setOK( true );
-		    notifySignalListeners();
+		    if( !deferNotification() )
+		    {
+		        LONGBEACH_SIGNAL_CYCLES( CYCLES_NOTIFY );
+		        notifySignalListeners();
+		    }
 		}
 	}
 
 	void SigMA::recomputeState() const
 	{
+	    LONGBEACH_PROFILE_SIGNAL_HANDLER( "SigMA", "recomputeState", CYCLES_RECOMPUTE );
       
 	    if( isOK() )
 		{
@@ -167,5 +225,11 @@ namespace longbeach{
 		    setDirty( false );
 		}
 	}
+
+	size_t SigMA::getHeapFootprint() const
+	{
+	    return footprint::of( m_spSeries ) + footprint::of( m_subs ) + footprint::of( windows )
+	        + footprint::of( periods ) + footprint::of( m_ma ) + footprint::of( diff );
+	}
     }
 }
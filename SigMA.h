@@ -6,6 +6,11 @@
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
 #include <longbeach/signals/SignalSpecMemberList.h> 
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalMemory.h>
+#include <longbeach/signals/SignalEvalEngine.h>
 
 #include <longbeach/clientcore/technicals.h>
 
@@ -20,7 +25,10 @@ template <typename T> int sign(T val) {
     return (T(0) < val) - (val < T(0));
 }
 
-class SigMASpec : public SignalSpecT2<SigMASpec>
+class SigMASpec
+    : public SignalSpecT2<SigMASpec>
+    , public SpecHashCache<SigMASpec>
+    , public IBinarySpec
 {
 public: 
     LONGBEACH_DECLARE_SCRIPTING();
@@ -30,9 +38,18 @@ public:
 
     virtual instrument_t getInstrument() const { return m_refPxP->getInstrument(); }
     virtual void checkValid() const;
+    virtual void hashCombine( size_t &result ) const;
+    virtual bool compare( const ISignalSpec *other ) const;
     virtual void getDataRequirements( IDataRequirements *rqs ) const;
     virtual ISignalPtr build( SignalBuilder *builder ) const;
 
+    void hashMembers( size_t &seed ) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigMASpec"; }
+    virtual void writeBinary( SpecOutArchive &ar ) const;
+    virtual void readBinary( SpecInArchive &ar );
+
     source_t m_source;
     std::vector<double> windows;
     std::vector<uint32_t> periods;
@@ -42,6 +59,8 @@ public:
 
 class SigMA 
     : public SignalSmonImpl
+    , public EvalEngineNode
+    , public IMemoryAccountable
     , public ICandlestickListener
 {
  public:
@@ -55,11 +74,15 @@ class SigMA
            , ReturnMode _mode 
            , bool _vbose 
         );
+
+    // IMemoryAccountable interface: the candle series belong to the CandlesticksFactory
+    virtual size_t getHeapFootprint() const;
  private:
     void onUpdate( const longbeach::ICandlestickSeries* series,
 		   const longbeach::Candlestick& entry );
     void onInputChange( const IPriceProvider& pxp );
     void recomputeState() const;
+    void deliverNotification( const timeval_t& tv ) { notifySignalListeners(); }
 
     CandlesticksFactoryPtr m_spCandlesticksFactory;
     std::vector<ICandlestickSeriesPtr> m_spSeries;
@@ -68,8 +91,8 @@ class SigMA
 
     std::vector<double> windows;
     std::vector<uint32_t> periods;
-    std::vector<double> m_ma;
-    std::vector<double> diff;
+    arena_vector<double>::type m_ma;
+    arena_vector<double>::type diff;
     double px;
     ReturnMode m_mode;
 };
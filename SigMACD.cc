@@ -1,5 +1,9 @@
 #include "SigMACD.h"
 #include <boost/assign/list_of.hpp>
+#include <longbeach/signals/BuildProfiler.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalCycleCounters.h>
 #include <longbeach/signals/SignalBuilder.h>
 #include <longbeach/signals/SignalsPriority.h>
 #include <longbeach/clientcore/PriceProviderBuilder.h>
@@ -48,27 +52,69 @@ bool SigMACDSpec::registerScripting(lua_State &state)
     return true;
 }
 
+void SigMACDSpec::writeBinary(SpecOutArchive &ar) const
+{
+    ar.writeSignalSpecBase(*this);
+    ar.write(short_window);
+    ar.write(long_window);
+    ar.write(mid_window);
+}
+
+void SigMACDSpec::readBinary(SpecInArchive &ar)
+{
+    ar.readSignalSpecBase(*this);
+    ar.read(short_window);
+    ar.read(long_window);
+    ar.read(mid_window);
+}
+
 void SigMACDSpec::getDataRequirements(IDataRequirements *rqs) const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigMACDSpec", "getDataRequirements", m_description);
     SignalSpec::getDataRequirements(rqs);
 }
 
 void SigMACDSpec::checkValid() const
 {
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigMACDSpec", "checkValid", m_description);
     SignalSpec::checkValid();
+    cacheHash();
+}
+
+void SigMACDSpec::hashCombine(size_t &result) const
+{
+    boost::hash_combine(result, specHash());
+}
+
+void SigMACDSpec::hashMembers(size_t &seed) const
+{
+    SignalSpecT2<SigMACDSpec>::hashCombine(seed);
+}
+
+bool SigMACDSpec::compare(const ISignalSpec* other) const
+{
+    if(fastReject(other)) return false;
+    return SignalSpecT2<SigMACDSpec>::compare(other);
 }
 
 ISignalPtr SigMACDSpec::build( SignalBuilder* builder ) const
 {
-    IPriceProviderPtr ref_pxp = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
-    return ISignalPtr(new SigMACD( builder->getClientContext()
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigMACDSpec", "build", m_description);
+    IPriceProviderPtr ref_pxp;
+    {
+        LONGBEACH_PROFILE_BUILD_SCOPE("SignalBuilder", "buildPxProvider", m_description);
+        ref_pxp = builder->getPxPBuilder()->buildPxProvider(m_refPxP);
+    }
+
+    LONGBEACH_PROFILE_BUILD_SCOPE("SigMACD", "construct", m_description);
+    return makeSignalObject<SigMACD>( builder->getClientContext()
                                    , ref_pxp
                                    , short_window
                                    , long_window
                                    , mid_window
                                    , getDescription()
                                    , builder->getVerboseLevel()
-                          ));
+                          );
 }
 
 /************************************************************************************************/
@@ -95,6 +141,7 @@ SigMACD::SigMACD( const ClientContextPtr& cc
 
 void SigMACD::onInputChange( const IPriceProvider& pxp )
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigMACD", "onInputChange", CYCLES_INPUT);
     if(pxp.isPriceOK())
     {
         double px = pxp.getRefPrice();
@@ -103,12 +150,17 @@ void SigMACD::onInputChange( const IPriceProvider& pxp )
 
         setDirty(true);
         setOK(true);
-        notifySignalListeners();
+        if(!deferNotification())
+        {
+            LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+            notifySignalListeners();
+        }
     }
 }
 
 void SigMACD::recomputeState() const
 {
+    LONGBEACH_PROFILE_SIGNAL_HANDLER("SigMACD", "recomputeState", CYCLES_RECOMPUTE);
     if(isOK() && m_macd.get_dea())
     {
         setSignalState( 0, m_macd.get_osc().get() );
@@ -4,6 +4,9 @@
 #include <longbeach/signals/Signal.h>
 #include <longbeach/signals/SignalSpec.h>
 #include <longbeach/signals/SignalSpecMemberList.h>
+#include <longbeach/signals/SpecArchive.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SignalEvalEngine.h>
 
 #include <longbeach/clientcore/technicals.h>
 
@@ -14,7 +17,10 @@ namespace signals {
 /// Signal computing MACD on give ref px
 ///
 
-class SigMACDSpec : public SignalSpecT2<SigMACDSpec>
+class SigMACDSpec
+    : public SignalSpecT2<SigMACDSpec>
+    , public SpecHashCache<SigMACDSpec>
+    , public IBinarySpec
 {
 public:
     LONGBEACH_DECLARE_SCRIPTING();
@@ -24,10 +30,18 @@ public:
     virtual instrument_t getInstrument() const { return m_refPxP->getInstrument(); }
     virtual ISignalPtr build(SignalBuilder *builder) const;
     virtual void checkValid() const;
-    // virtual bool compare(const ISignalSpec* other) const;
+    virtual void hashCombine(size_t &result) const;
+    virtual bool compare(const ISignalSpec* other) const;
     // virtual void print(std::ostream &o, const LuaPrintSettings &ps) const;
     virtual void getDataRequirements(IDataRequirements *rqs) const;
 
+    void hashMembers(size_t &seed) const;
+
+    // IBinarySpec interface
+    virtual const char *binaryClassName() const { return "SigMACDSpec"; }
+    virtual void writeBinary(SpecOutArchive &ar) const;
+    virtual void readBinary(SpecInArchive &ar);
+
     int32_t short_window;
     int32_t long_window;
     int32_t mid_window;
@@ -35,6 +49,7 @@ public:
 
 class SigMACD
     : public SignalSmonImpl
+    , public EvalEngineNode
 {
 public:
     SigMACD( const ClientContextPtr& cc
@@ -49,6 +64,7 @@ public:
 private:
     void onInputChange( const IPriceProvider& pxp );
     void recomputeState() const;
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(); }
 
 private:
     IPriceProviderPtr m_ref_pxp;
@@ -0,0 +1,152 @@
+#include <longbeach/signals/SignalArena.h>
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+const size_t HugePageSize = 2 << 20;
+
+inline size_t roundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+thread_local const SignalArenaPtr *t_pCurrentArena = NULL;
+
+} // anonymous namespace
+
+/************************************************************************************************/
+// SignalArena
+/************************************************************************************************/
+
+SignalArena::SignalArena(const Options &options)
+    : m_options(options)
+    , m_pCur(NULL)
+    , m_pEnd(NULL)
+    , m_bytesAllocated(0)
+    , m_bytesReserved(0)
+    , m_numHugePageBlocks(0)
+{
+    if(m_options.blockSize < 4096)
+        LONGBEACH_THROW_ERROR_SS("SignalArena: block size " << m_options.blockSize << " is below a page");
+}
+
+SignalArena::~SignalArena()
+{
+    for(size_t i = 0; i < m_blocks.size(); ++i)
+        munmap(m_blocks[i].base, m_blocks[i].size);
+}
+
+const SignalArenaPtr &SignalArena::current()
+{
+    static const SignalArenaPtr s_none;
+    return t_pCurrentArena ? *t_pCurrentArena : s_none;
+}
+
+void *SignalArena::allocate(size_t bytes, size_t align)
+{
+    if(bytes == 0)
+        bytes = 1;
+    boost::mutex::scoped_lock lock(m_mutex);
+    char *p = reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(m_pCur), align));
+    if(!m_pCur || p + bytes > m_pEnd)
+    {
+        if(bytes > m_options.blockSize / 4)
+        {
+            // a block of its own, so the current one is not abandoned half used; blocks are
+            // page aligned already
+            bool huge = false;
+            Block b = mapBlock(align > 4096 ? bytes + align : bytes, huge);
+            m_blocks.push_back(b);
+            m_bytesReserved += b.size;
+            m_numHugePageBlocks += huge;
+            m_bytesAllocated += bytes;
+            return reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(b.base), align));
+        }
+        newBlock(bytes + align);
+        p = reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(m_pCur), align));
+    }
+    m_pCur = p + bytes;
+    m_bytesAllocated += bytes;
+    return p;
+}
+
+void SignalArena::newBlock(size_t minBytes)
+{
+    bool huge = false;
+    Block b = mapBlock(std::max(minBytes, m_options.blockSize), huge);
+    m_blocks.push_back(b);
+    m_bytesReserved += b.size;
+    m_numHugePageBlocks += huge;
+    m_pCur = b.base;
+    m_pEnd = b.base + b.size;
+}
+
+SignalArena::Block SignalArena::mapBlock(size_t bytes, bool &huge) const
+{
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    huge = false;
+    if(m_options.bHugePages)
+    {
+        const size_t size = roundUp(bytes, HugePageSize);
+#ifdef MAP_HUGETLB
+        // only succeeds if huge pages were reserved (vm.nr_hugepages)
+        void *p = mmap(NULL, size, prot, flags | MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED)
+        {
+            huge = true;
+            Block b = { static_cast<char*>(p), size };
+            return b;
+        }
+#endif
+#ifdef MADV_HUGEPAGE
+        // transparent huge pages need the range aligned to a huge page: map one more and trim
+        void *q = mmap(NULL, size + HugePageSize, prot, flags, -1, 0);
+        if(q != MAP_FAILED)
+        {
+            char *raw = static_cast<char*>(q);
+            char *base = reinterpret_cast<char*>(roundUp(reinterpret_cast<size_t>(raw), HugePageSize));
+            if(base > raw)
+                munmap(raw, base - raw);
+            if(base + size < raw + size + HugePageSize)
+                munmap(base + size, raw + size + HugePageSize - (base + size));
+            huge = madvise(base, size, MADV_HUGEPAGE) == 0;
+            Block b = { base, size };
+            return b;
+        }
+#endif
+    }
+
+    const size_t size = roundUp(bytes, 4096);
+    void *p = mmap(NULL, size, prot, flags, -1, 0);
+    if(p == MAP_FAILED)
+        LONGBEACH_THROW_ERROR_SS("SignalArena: cannot map " << size << " bytes: " << strerror(errno));
+    Block b = { static_cast<char*>(p), size };
+    return b;
+}
+
+/************************************************************************************************/
+// SignalArenaScope
+/************************************************************************************************/
+
+SignalArenaScope::SignalArenaScope(const SignalArenaPtr &arena)
+    : m_spArena(arena)
+    , m_pPrev(t_pCurrentArena)
+{
+    t_pCurrentArena = &m_spArena;
+}
+
+SignalArenaScope::~SignalArenaScope()
+{
+    t_pCurrentArena = m_pPrev;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,163 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALARENA_H
+#define LONGBEACH_SIGNALS_SIGNALARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <longbeach/clientcore/EventDist.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Monotonic memory for the signals of one builder and the buffers they size at construction.
+///
+/// Memory is carved sequentially out of large blocks, so objects built one after the other
+/// (a signal, its windows, its state vectors, then the next signal of the instrument) sit next
+/// to each other instead of being scattered over the heap, and the hot path touches a handful
+/// of pages instead of one per object.  Blocks can be backed by huge pages, which also takes
+/// them off the TLB.  Nothing is freed individually: destructors still run, but the memory
+/// goes back in bulk when the arena is destroyed, which happens once the builder's scope and
+/// every object allocated from it (each holds a reference) are gone.
+///
+/// Meant for allocations made while building.  Buffers that keep growing afterwards should
+/// stay on the heap, since the arena never reuses what they leave behind.
+class SignalArena : private boost::noncopyable
+{
+public:
+    struct Options
+    {
+        Options() : blockSize(2 << 20), bHugePages(false) {}
+
+        size_t blockSize;   // bytes per block; allocations over a quarter of it get their own
+        bool bHugePages;    // try MAP_HUGETLB, then transparent huge pages
+    };
+
+    explicit SignalArena(const Options &options = Options());
+    ~SignalArena();
+
+    /// Thread-safe, though normally only the building thread allocates.
+    void *allocate(size_t bytes, size_t align);
+
+    size_t getBytesAllocated() const { return m_bytesAllocated; }
+    size_t getBytesReserved() const { return m_bytesReserved; }
+    size_t getNumBlocks() const { return m_blocks.size(); }
+
+    /// Blocks on reserved huge pages, or advised to use transparent ones.
+    size_t getNumHugePageBlocks() const { return m_numHugePageBlocks; }
+
+    /// Arena of the innermost SignalArenaScope on this thread, or NULL.
+    static const boost::shared_ptr<SignalArena> &current();
+
+private:
+    struct Block
+    {
+        char *base;
+        size_t size;
+    };
+
+    void newBlock(size_t minBytes);
+    Block mapBlock(size_t bytes, bool &huge) const;
+
+    Options m_options;
+    boost::mutex m_mutex;
+    std::vector<Block> m_blocks;
+    char *m_pCur;
+    char *m_pEnd;
+    size_t m_bytesAllocated;
+    size_t m_bytesReserved;
+    size_t m_numHugePageBlocks;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SignalArena);
+
+/// Makes arena the current arena of the calling thread until destroyed; a NULL arena makes
+/// allocations go to the heap again.  Scopes nest.
+class SignalArenaScope : private boost::noncopyable
+{
+public:
+    explicit SignalArenaScope(const SignalArenaPtr &arena);
+    ~SignalArenaScope();
+
+private:
+    SignalArenaPtr m_spArena;
+    const SignalArenaPtr *m_pPrev;
+};
+
+/// Standard allocator over a SignalArena, falling back to the heap without one.  A default
+/// constructed allocator picks up SignalArena::current(), so containers that are members of
+/// an object built in a scope land in the scope's arena with no change at the call site.
+template<typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template<typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator() : m_spArena(SignalArena::current()) {}
+    explicit ArenaAllocator(const SignalArenaPtr &arena) : m_spArena(arena) {}
+    template<typename U> ArenaAllocator(const ArenaAllocator<U> &o) : m_spArena(o.getArena()) {}
+
+    T *allocate(size_t n)
+    {
+        if(m_spArena)
+            return static_cast<T*>(m_spArena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        if(!m_spArena)
+            ::operator delete(p);
+    }
+
+    template<typename U, typename... Args>
+    void construct(U *p, Args&&... args) { ::new((void*)p) U(std::forward<Args>(args)...); }
+    template<typename U>
+    void destroy(U *p) { p->~U(); }
+
+    size_t max_size() const { return size_t(-1) / sizeof(T); }
+
+    const SignalArenaPtr &getArena() const { return m_spArena; }
+
+private:
+    SignalArenaPtr m_spArena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.getArena() == b.getArena(); }
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return !(a == b); }
+
+/// A vector whose buffer is allocated from the current arena when it is constructed.
+template<typename T>
+struct arena_vector
+{
+    typedef std::vector<T, ArenaAllocator<T> > type;
+};
+
+/// Creates a signal or one of its parts: in the current arena, object and reference count
+/// together, if there is one, else with plain new.
+template<typename T, typename... Args>
+boost::shared_ptr<T> makeSignalObject(Args&&... args)
+{
+    if(const SignalArenaPtr &arena = SignalArena::current())
+        return boost::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+    return boost::shared_ptr<T>(new T(std::forward<Args>(args)...));
+}
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALARENA_H
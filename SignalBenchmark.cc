@@ -0,0 +1,82 @@
+#include <longbeach/signals/SignalBenchmark.h>
+
+#include <iomanip>
+#include <ostream>
+
+#include <boost/lexical_cast.hpp>
+
+#include <longbeach/signals/BuildProfiler.h>
+
+namespace longbeach {
+namespace signals {
+
+SignalBenchmarkResult SignalBenchmark::run(const std::string &name, const op_t &op, uint64_t iterations, uint64_t warmup)
+{
+    for(uint64_t i = 0; i < warmup; ++i)
+        op();
+
+    SignalBenchmarkResult r;
+    r.name = name;
+    r.iterations = iterations;
+
+    const uint64_t allocs0 = BuildProfiler::threadAllocCount();
+    const uint64_t bytes0 = BuildProfiler::threadAllocBytes();
+    const uint64_t start = SignalLatencyProfiler::now();
+    for(uint64_t i = 0; i < iterations; ++i)
+    {
+        // sample a few ops individually; timing every one would double the cost of cheap ops
+        if(i % SampleEvery == 0)
+        {
+            const uint64_t t0 = SignalLatencyProfiler::now();
+            op();
+            r.perOpNs.record(SignalLatencyProfiler::now() - t0);
+        }
+        else
+        {
+            op();
+        }
+    }
+    r.totalNs = SignalLatencyProfiler::now() - start;
+    r.allocs = BuildProfiler::threadAllocCount() - allocs0;
+    r.allocBytes = BuildProfiler::threadAllocBytes() - bytes0;
+    return r;
+}
+
+std::vector<SignalBenchmarkResult> SignalBenchmark::sweep(const std::string &name, const std::string &paramName,
+    const std::vector<size_t> &values, const setup_t &setup, uint64_t iterations, uint64_t warmup)
+{
+    std::vector<SignalBenchmarkResult> results;
+    for(std::vector<size_t>::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        SignalBenchmarkResult r = run(name, setup(*it), iterations, warmup);
+        r.paramName = paramName;
+        r.param = *it;
+        results.push_back(r);
+    }
+    return results;
+}
+
+void SignalBenchmark::print(std::ostream &o, const std::vector<SignalBenchmarkResult> &results)
+{
+    const bool bAllocs = BuildProfiler::countsAllocs();
+    for(std::vector<SignalBenchmarkResult>::const_iterator it = results.begin(); it != results.end(); ++it)
+    {
+        std::string label = it->name;
+        if(!it->paramName.empty())
+            label += "/" + it->paramName + "=" + boost::lexical_cast<std::string>(it->param);
+        o << std::left << std::setw(48) << label << std::right
+          << std::fixed << std::setprecision(1)
+          << std::setw(10) << it->nsPerOp() << " ns/op"
+          << "  p50=" << std::setw(7) << it->perOpNs.valueAtPercentile(50)
+          << "  p99=" << std::setw(7) << it->perOpNs.valueAtPercentile(99);
+        if(bAllocs)
+            o << std::setprecision(3) << "  allocs/op=" << it->allocsPerOp()
+              << "  bytes/op=" << (it->iterations ? double(it->allocBytes) / it->iterations : 0.0);
+        else
+            o << "  allocs/op=n/a";
+        o << std::endl;
+    }
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,60 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALBENCHMARK_H
+#define LONGBEACH_SIGNALS_SIGNALBENCHMARK_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <longbeach/signals/LatencyHistogram.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Timing of one benchmark case.
+struct SignalBenchmarkResult
+{
+    SignalBenchmarkResult() : param(0), iterations(0), totalNs(0), allocs(0), allocBytes(0) {}
+
+    std::string name;
+    std::string paramName;      // empty unless part of a sweep
+    size_t param;
+    uint64_t iterations;
+    uint64_t totalNs;
+    uint64_t allocs;            // 0 unless compiled with LONGBEACH_SIGNALS_PROFILE_ALLOCS
+    uint64_t allocBytes;
+    LatencyHistogram perOpNs;   // sampled every SampleEvery ops
+
+    double nsPerOp() const { return iterations ? double(totalNs) / iterations : 0.0; }
+    double allocsPerOp() const { return iterations ? double(allocs) / iterations : 0.0; }
+};
+
+/// Small harness for timing a signal's hot loop in isolation, typically fed by a
+/// SyntheticMarket: each op applies one synthetic event to the signal's inputs and reads the
+/// signal back.
+class SignalBenchmark
+{
+public:
+    typedef boost::function<void ()> op_t;
+
+    /// Builds the op for one point of a sweep (e.g. a book depth or a window count).
+    typedef boost::function<op_t (size_t param)> setup_t;
+
+    static const uint64_t SampleEvery = 64;
+
+    /// Runs op warmup times untimed, then iterations times timed.
+    static SignalBenchmarkResult run(const std::string &name, const op_t &op, uint64_t iterations, uint64_t warmup = 1000);
+
+    /// One run per value of the parameter, for scaling curves.
+    static std::vector<SignalBenchmarkResult> sweep(const std::string &name, const std::string &paramName,
+        const std::vector<size_t> &values, const setup_t &setup, uint64_t iterations, uint64_t warmup = 1000);
+
+    /// One line per result: ns/op, p50/p99 of the sampled ops, allocs/op.
+    static void print(std::ostream &o, const std::vector<SignalBenchmarkResult> &results);
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALBENCHMARK_H
@@ -0,0 +1,245 @@
+#include <longbeach/signals/SignalCheckpoint.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+const char Magic[8] = { 'L', 'B', 'C', 'H', 'K', 'P', 'T', '\0' };
+}
+
+SignalCheckpointer::SignalCheckpointer()
+    : m_bWriting(false)
+    , m_bStop(false)
+{
+    m_writer = boost::thread(boost::bind(&SignalCheckpointer::writerLoop, this));
+}
+
+SignalCheckpointer::~SignalCheckpointer()
+{
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cond.notify_all();
+    m_writer.join();
+}
+
+bool SignalCheckpointer::add(const ISignalSpecCPtr &spec, const ISignalPtr &signal)
+{
+    if(!spec || !signal)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: null spec or signal");
+    ICheckpointable *pc = dynamic_cast<ICheckpointable*>(signal.get());
+    if(!pc)
+        return false;
+
+    for(std::vector<Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+        if(it->desc == signal->getDesc())
+            LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: already tracking a signal described " << it->desc);
+
+    size_t hash = 0;
+    spec->hashCombine(hash);
+    Entry e = { signal->getDesc(), uint64_t(hash), signal, pc };
+    m_entries.push_back(e);
+    return true;
+}
+
+std::string SignalCheckpointer::capture(const timeval_t &tv) const
+{
+    SpecOutArchive ar;
+    ar.write(FormatVersion);
+    ar.write(tv);
+    ar.write(uint64_t(m_entries.size()));
+    for(std::vector<Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        SpecOutArchive payload;
+        it->pCheckpointable->writeCheckpoint(payload);
+        ar.write(it->desc);
+        ar.write(it->specHash);
+        ar.write(it->pCheckpointable->checkpointVersion());
+        ar.write(payload.buffer());
+    }
+    return std::string(Magic, sizeof(Magic)) + ar.buffer();
+}
+
+void SignalCheckpointer::checkpointAsync(const timeval_t &tv, const std::string &path)
+{
+    std::string bytes = capture(tv);
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_pending = std::make_pair(path, std::string());
+        m_pending->second.swap(bytes);
+    }
+    m_cond.notify_all();
+}
+
+void SignalCheckpointer::checkpoint(const timeval_t &tv, const std::string &path) const
+{
+    writeFile(path, capture(tv));
+}
+
+void SignalCheckpointer::flush()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    while(m_pending || m_bWriting)
+        m_cond.wait(lock);
+}
+
+void SignalCheckpointer::writeFile(const std::string &path, const std::string &bytes)
+{
+    const std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if(!f)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: cannot open " << tmp << ": " << strerror(errno));
+    const bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size()
+        && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    const int err = errno;
+    fclose(f);
+    if(!ok)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: cannot write " << tmp << ": " << strerror(err));
+    if(rename(tmp.c_str(), path.c_str()) != 0)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: cannot rename " << tmp << " to " << path << ": " << strerror(errno));
+}
+
+void SignalCheckpointer::writerLoop()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    for(;;)
+    {
+        while(!m_pending && !m_bStop)
+            m_cond.wait(lock);
+        if(!m_pending)
+            return;
+
+        std::pair<std::string, std::string> job;
+        job.swap(*m_pending);
+        m_pending = boost::none;
+        m_bWriting = true;
+        lock.unlock();
+        try
+        {
+            writeFile(job.first, job.second);
+        }
+        catch(const std::exception &e)
+        {
+            // nobody to throw to on this thread; the next checkpoint tries again
+            std::cerr << e.what() << std::endl;
+        }
+        lock.lock();
+        m_bWriting = false;
+        m_cond.notify_all();
+    }
+}
+
+void SignalCheckpointer::schedulePeriodic(const ClockMonitorPtr &cm, const ptime_duration_t &period, const std::string &path)
+{
+    if(!cm)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: Bad ClockMonitor");
+    m_spCM = cm;
+    m_period = period;
+    m_periodicPath = path;
+    m_spCM->scheduleWakeupCall( m_subTimer
+        , boost::bind( &SignalCheckpointer::onTimer, this, _1, _2 )
+        , m_spCM->getTime() + m_period
+        , PRIORITY_CC_Misc );
+}
+
+void SignalCheckpointer::onTimer(const timeval_t &ctv, const timeval_t &swtv)
+{
+    m_spCM->scheduleWakeupCall( m_subTimer
+        , boost::bind( &SignalCheckpointer::onTimer, this, _1, _2 )
+        , m_spCM->getTime() + m_period
+        , PRIORITY_CC_Misc );
+    checkpointAsync(ctv, m_periodicPath);
+}
+
+CheckpointRestoreResult SignalCheckpointer::restore(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: cannot open " << path);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return restoreFrom(bytes);
+}
+
+CheckpointRestoreResult SignalCheckpointer::restoreFrom(const std::string &bytes)
+{
+    if(bytes.size() < sizeof(Magic) || std::memcmp(bytes.data(), Magic, sizeof(Magic)) != 0)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: not a signal checkpoint");
+    SpecInArchive ar(bytes.data() + sizeof(Magic), bytes.size() - sizeof(Magic));
+
+    uint32_t format;
+    ar.read(format);
+    if(format != FormatVersion)
+        LONGBEACH_THROW_ERROR_SS("SignalCheckpointer: unsupported checkpoint format " << format);
+
+    CheckpointRestoreResult result;
+    ar.read(result.captureTime);
+
+    // add() keeps the descriptions unique
+    std::map<std::string, const Entry*> byDesc;
+    for(std::vector<Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+        byDesc[it->desc] = &*it;
+    std::set<std::string> seen;
+
+    uint64_t n;
+    ar.read(n);
+    for(uint64_t i = 0; i < n; ++i)
+    {
+        std::string desc, payload;
+        uint64_t specHash;
+        uint32_t version;
+        ar.read(desc);
+        ar.read(specHash);
+        ar.read(version);
+        ar.read(payload);
+
+        if(!seen.insert(desc).second)
+        {
+            result.failed.push_back(desc + ": more than one entry in the checkpoint");
+            continue;
+        }
+        std::map<std::string, const Entry*>::iterator it = byDesc.find(desc);
+        if(it == byDesc.end())
+            continue;
+        const Entry &e = *it->second;
+        byDesc.erase(it);
+        if(specHash != e.specHash)
+        {
+            result.specChanged.push_back(desc);
+            continue;
+        }
+        try
+        {
+            // readCheckpoint checks the payload was all read before applying it
+            SpecInArchive p(payload.data(), payload.size());
+            e.pCheckpointable->readCheckpoint(p, version);
+            ++result.numRestored;
+        }
+        catch(const std::exception &ex)
+        {
+            result.failed.push_back(desc + ": " + ex.what());
+        }
+    }
+
+    for(std::map<std::string, const Entry*>::const_iterator it = byDesc.begin(); it != byDesc.end(); ++it)
+        result.notFound.push_back(it->first);
+    return result;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,137 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALCHECKPOINT_H
+#define LONGBEACH_SIGNALS_SIGNALCHECKPOINT_H
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/ClockMonitor.h>
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Implemented by signals whose internal state (windows, filters, histories) can be saved
+/// and restored, so that a restarted process does not have to warm them up again.
+class ICheckpointable
+{
+public:
+    virtual ~ICheckpointable() {}
+
+    /// Layout version of what writeCheckpoint writes; bump it whenever that changes, and keep
+    /// readCheckpoint able to read the versions still found in old files.
+    virtual uint32_t checkpointVersion() const = 0;
+    virtual void writeCheckpoint(SpecOutArchive &ar) const = 0;
+
+    /// Restores state written by writeCheckpoint at version; throws if it cannot.  ar holds
+    /// exactly one writeCheckpoint's bytes: read all of them, call requireCheckpointEnd, and
+    /// only then change the signal, so a checkpoint that does not read back leaves it as it was.
+    virtual void readCheckpoint(SpecInArchive &ar, uint32_t version) = 0;
+};
+
+/// Throws if ar has bytes left, i.e. the state was written in some other layout than the one
+/// read.  For readCheckpoint, between reading its state and applying it.
+inline void requireCheckpointEnd(const SpecInArchive &ar, uint32_t version)
+{
+    if(!ar.atEnd())
+        LONGBEACH_THROW_ERROR_SS("trailing bytes after version " << version << " state");
+}
+
+/// Outcome of SignalCheckpointer::restore.
+struct CheckpointRestoreResult
+{
+    CheckpointRestoreResult() : numRestored(0) {}
+
+    timeval_t captureTime;
+    size_t numRestored;
+    std::vector<std::string> specChanged;   // entries whose spec hash no longer matches; skipped
+    std::vector<std::string> failed;        // "desc: reason" for entries that did not read back,
+                                            // or that the file has more than once
+    std::vector<std::string> notFound;      // tracked signals without an entry in the file
+};
+
+/// Saves the internal state of a set of signals to a file and restores it.
+///
+/// An entry is keyed by the signal's description and carries the hash of the spec it was
+/// built from, so a signal is only restored from state produced by an identical spec.  The
+/// hash is the in-process spec hash, so checkpoints are meant to be read back by the same
+/// build.
+///
+/// Capturing has to run on the thread that owns the signals, but it only copies their state
+/// into a buffer; checkpointAsync hands the buffer to a writer thread that does the file I/O,
+/// writing a temporary file and renaming it over path so a crash never leaves a torn file.
+class SignalCheckpointer : private boost::noncopyable
+{
+public:
+    SignalCheckpointer();
+
+    /// Writes whatever is still queued, then stops the writer thread.
+    ~SignalCheckpointer();
+
+    /// Tracks signal, built from spec.  Returns false (and ignores it) if the signal is not
+    /// ICheckpointable.  Entries are keyed by description, so throws if a tracked signal
+    /// already has signal's.
+    bool add(const ISignalSpecCPtr &spec, const ISignalPtr &signal);
+
+    /// Serializes every tracked signal.
+    std::string capture(const timeval_t &tv) const;
+
+    /// capture(), then queues the bytes for the writer thread.  If the previous checkpoint is
+    /// still waiting to be written it is replaced, since only the latest one matters.
+    void checkpointAsync(const timeval_t &tv, const std::string &path);
+
+    /// capture() and write on the calling thread.
+    void checkpoint(const timeval_t &tv, const std::string &path) const;
+
+    /// Checkpoints to path asynchronously every period of cm's clock.
+    void schedulePeriodic(const ClockMonitorPtr &cm, const ptime_duration_t &period, const std::string &path);
+
+    /// Blocks until the writer thread has written everything queued so far.
+    void flush();
+
+    CheckpointRestoreResult restore(const std::string &path);
+    CheckpointRestoreResult restoreFrom(const std::string &bytes);
+
+    static const uint32_t FormatVersion = 1;
+
+private:
+    struct Entry
+    {
+        std::string desc;
+        uint64_t specHash;
+        ISignalPtr signal;
+        ICheckpointable *pCheckpointable;
+    };
+
+    static void writeFile(const std::string &path, const std::string &bytes);
+    void writerLoop();
+    void onTimer(const timeval_t &ctv, const timeval_t &swtv);
+
+    std::vector<Entry> m_entries;
+
+    ClockMonitorPtr m_spCM;
+    Subscription m_subTimer;
+    ptime_duration_t m_period;
+    std::string m_periodicPath;
+
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    boost::optional<std::pair<std::string, std::string> > m_pending;    // path, bytes
+    bool m_bWriting;
+    bool m_bStop;
+    boost::thread m_writer;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALCHECKPOINT_H
@@ -0,0 +1,258 @@
+#include <longbeach/signals/SignalCycleCounters.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <boost/make_shared.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+std::atomic<bool> SignalCycleCounters::s_bEnabled(false);
+thread_local SignalCycleFrame *SignalCycleFrame::t_pTop = NULL;
+
+namespace {
+
+struct Counters
+{
+    Counters()
+    {
+        for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+        {
+            cycles[p].store(0, std::memory_order_relaxed);
+            calls[p].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // only the owning thread writes; relaxed atomics let a report read them from another
+    std::atomic<uint64_t> cycles[CYCLES_NUM_PHASES];
+    std::atomic<uint64_t> calls[CYCLES_NUM_PHASES];
+};
+
+inline void add(std::atomic<uint64_t> &a, uint64_t v)
+{
+    a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+} // anonymous namespace
+
+/// One thread's counters, in fixed-size chunks allocated on first use so that growing the slab
+/// never moves counters a report might be reading.
+struct SignalCycleCounters::ThreadSlab
+{
+    static const size_t ChunkSize = 1024;
+    static const size_t MaxChunks = 4096;   // 4M instances
+
+    ThreadSlab()
+    {
+        for(size_t i = 0; i < MaxChunks; ++i)
+            chunks[i].store(NULL, std::memory_order_relaxed);
+    }
+
+    Counters *find(size_t slot) const
+    {
+        const size_t c = slot / ChunkSize;
+        if(c >= MaxChunks)
+            return NULL;
+        Counters *chunk = chunks[c].load(std::memory_order_acquire);
+        return chunk ? &chunk[slot % ChunkSize] : NULL;
+    }
+
+    Counters *get(size_t slot)
+    {
+        const size_t c = slot / ChunkSize;
+        if(c >= MaxChunks)
+            return NULL;
+        Counters *chunk = chunks[c].load(std::memory_order_relaxed);
+        if(!chunk)
+        {
+            chunk = new Counters[ChunkSize];
+            chunks[c].store(chunk, std::memory_order_release);
+        }
+        return &chunk[slot % ChunkSize];
+    }
+
+    std::atomic<Counters*> chunks[MaxChunks];
+};
+
+namespace {
+thread_local SignalCycleCounters::ThreadSlab *t_pSlab = NULL;
+}
+
+SignalCycleCounters &SignalCycleCounters::instance()
+{
+    static SignalCycleCounters s_instance;
+    return s_instance;
+}
+
+SignalCycleCounters::ThreadSlab &SignalCycleCounters::threadSlab()
+{
+    if(!t_pSlab)
+    {
+        t_pSlab = new ThreadSlab;
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_slabs.push_back(t_pSlab);
+    }
+    return *t_pSlab;
+}
+
+size_t SignalCycleCounters::registerInstance(const std::string &desc)
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_descs.push_back(desc);
+    return m_descs.size() - 1;
+}
+
+void SignalCycleCounters::record(size_t slot, CyclePhase phase, uint64_t cycles)
+{
+    if(Counters *c = threadSlab().get(slot))
+    {
+        add(c->cycles[phase], cycles);
+        add(c->calls[phase], 1);
+    }
+}
+
+SignalCycleCounters::Totals::Totals()
+{
+    for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+    {
+        cycles[p] = 0;
+        calls[p] = 0;
+    }
+}
+
+std::vector<SignalCycleCounters::Totals> SignalCycleCounters::readTotals() const
+{
+    std::vector<Totals> totals(m_descs.size());
+    for(size_t slot = 0; slot < m_descs.size(); ++slot)
+        for(size_t s = 0; s < m_slabs.size(); ++s)
+            if(const Counters *c = m_slabs[s]->find(slot))
+                for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+                {
+                    totals[slot].cycles[p] += c->cycles[p].load(std::memory_order_relaxed);
+                    totals[slot].calls[p] += c->calls[p].load(std::memory_order_relaxed);
+                }
+    return totals;
+}
+
+void SignalCycleCounters::reset()
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_baseline = readTotals();
+}
+
+void SignalCycleCounters::printReport(std::ostream &o, size_t topN) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    printTotals(o, readTotals(), topN);
+}
+
+void SignalCycleCounters::printTotals(std::ostream &o, const std::vector<Totals> &totals, size_t topN) const
+{
+    struct Row
+    {
+        size_t slot;
+        uint64_t total;
+        Totals counts;
+        bool operator<(const Row &r) const { return total > r.total; }
+    };
+
+    std::vector<Row> rows;
+    for(size_t slot = 0; slot < totals.size(); ++slot)
+    {
+        Row r;
+        r.slot = slot;
+        r.total = 0;
+        r.counts = totals[slot];
+        if(slot < m_baseline.size())
+            for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+            {
+                r.counts.cycles[p] -= m_baseline[slot].cycles[p];
+                r.counts.calls[p] -= m_baseline[slot].calls[p];
+            }
+        for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+            r.total += r.counts.cycles[p];
+        if(r.total)
+            rows.push_back(r);
+    }
+    std::sort(rows.begin(), rows.end());
+    if(rows.size() > topN)
+        rows.resize(topN);
+
+    static const char *phaseNames[CYCLES_NUM_PHASES] = { "input", "recompute", "notify" };
+    o << "signal cycle counters: " << rows.size() << " busiest instances" << std::endl;
+    for(size_t i = 0; i < rows.size(); ++i)
+    {
+        const Row &r = rows[i];
+        o << std::setw(14) << r.total << "  " << m_descs[r.slot];
+        for(size_t p = 0; p < CYCLES_NUM_PHASES; ++p)
+            if(r.counts.calls[p])
+                o << "  " << phaseNames[p] << "=" << r.counts.calls[p] << "x" << r.counts.cycles[p] / r.counts.calls[p];
+        o << std::endl;
+    }
+}
+
+void SignalCycleCounters::onEndOfDay(const timeval_t &ctv)
+{
+    if(!isEnabled())
+        return;
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(ctv == m_lastEndOfDay)
+        return;
+    m_lastEndOfDay = ctv;
+    // report and restart from the same reading, so that no count falls between two days
+    const std::vector<Totals> totals = readTotals();
+    printTotals(m_pReportStream ? *m_pReportStream : std::cout, totals, 100);
+    m_baseline = totals;
+}
+
+/************************************************************************************************/
+// DailyReport
+/************************************************************************************************/
+
+/// Calls onEndOfDay at every ENDOFDAY of one instrument's session.
+class SignalCycleCounters::DailyReport
+    : public IClockListener
+    , private boost::noncopyable
+{
+public:
+    DailyReport(const ClockMonitorPtr &spCM, const instrument_t &instr)
+        : m_spCM(spCM)
+        , m_instr(instr)
+    {
+        m_spCM->scheduleClockNotice( this, cm::clock_notice(cm::ENDOFDAY,0), PRIORITY_CC_Misc );
+    }
+
+    const ClockMonitorPtr &getClockMonitor() const { return m_spCM; }
+
+    virtual void onWakeupCall(const timeval_t &ctv, const timeval_t &swtv, int reason, void *pData)
+    {
+        if ( reason != cm::ENDOFDAY )
+            return;
+        SignalCycleCounters::instance().onEndOfDay( ctv );
+        std::vector<cm::clock_notice> cns = cm::getClockNotice( m_spCM->getSessionParams(), m_instr, m_spCM->getYMDDate(), cm::ENDOFDAY );
+        if ( cns.size() > 0 )
+            m_spCM->scheduleClockNotices( this, cns, PRIORITY_CC_Misc );
+    }
+
+private:
+    ClockMonitorPtr m_spCM;
+    instrument_t m_instr;
+};
+
+void SignalCycleCounters::scheduleDailyReport(const ClockMonitorPtr &cm, const instrument_t &instr)
+{
+    if(!cm)
+        LONGBEACH_THROW_ERROR_SS("SignalCycleCounters: Bad ClockMonitor");
+    boost::mutex::scoped_lock lock(m_mutex);
+    for(size_t i = 0; i < m_dailyReports.size(); ++i)
+        if(m_dailyReports[i]->getClockMonitor() == cm)
+            return;
+    m_dailyReports.push_back(boost::make_shared<DailyReport>(cm, instr));
+}
+
+} // namespace signals
+} // namespace longbeach
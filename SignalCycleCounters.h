@@ -0,0 +1,251 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALCYCLECOUNTERS_H
+#define LONGBEACH_SIGNALS_SIGNALCYCLECOUNTERS_H
+
+#include <atomic>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/ClockMonitor.h>
+#include <longbeach/signals/LatencyHistogram.h>
+
+namespace longbeach {
+namespace signals {
+
+/// What a cycle count is attributed to.  Counts are exclusive: a phase is charged only for the
+/// cycles not charged to a phase nested inside it, on the same instance or another one.
+enum CyclePhase
+{
+    CYCLES_INPUT,       // book/tick/msg/price/candle handlers, less their recompute and notify
+    CYCLES_RECOMPUTE,   // recomputeState
+    CYCLES_NOTIFY,      // notifySignalListeners fan-out, less the listeners' own counted phases
+    CYCLES_NUM_PHASES
+};
+
+/// Per signal instance cycle and call counts around the input handlers, recomputeState and
+/// listener fan-out.
+///
+/// Only compiled into the signals when the library is built with
+/// LONGBEACH_SIGNALS_CYCLE_COUNTERS; without it LONGBEACH_SIGNAL_CYCLES expands to nothing.
+/// With it, a disabled counter costs one predictable branch.  Each thread counts into its own
+/// slab, indexed by a slot the instance takes on its first count, so counting never locks.
+/// Since phases are exclusive, an instance's total is the cycles spent in its own code, and
+/// the totals of all instances add up to the time spent in counted code.
+///
+/// scheduleDailyReport() writes one report per trading day, most expensive instances first,
+/// and starts the counts over.
+class SignalCycleCounters : private boost::noncopyable
+{
+public:
+    static SignalCycleCounters &instance();
+
+    static bool isEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled) { s_bEnabled.store(enabled, std::memory_order_relaxed); }
+
+    /// Where reports go; std::cout unless set.
+    void setReportStream(std::ostream *o) { m_pReportStream = o; }
+
+    static uint64_t readCycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#endif
+    }
+
+    /// Returns a new slot for an instance described by desc.
+    size_t registerInstance(const std::string &desc);
+
+    void record(size_t slot, CyclePhase phase, uint64_t cycles);
+
+    /// Writes the report at every ENDOFDAY of instr's session on cm's clock.  Call once per
+    /// ClientContext (e.g. once per shard), with any instrument it trades.
+    void scheduleDailyReport(const ClockMonitorPtr &cm, const instrument_t &instr);
+
+    /// Writes the report for the day ending at ctv and starts the counts over.  Later calls with
+    /// the same ctv (from the other clocks' ENDOFDAY notices) do nothing.
+    void onEndOfDay(const timeval_t &ctv);
+
+    /// Writes the topN instances by total cycles since the last reset.  Counts of other threads
+    /// are read while they may still be counting, so they can be a few calls behind.
+    void printReport(std::ostream &o, size_t topN = 100) const;
+
+    /// Starts the counts over.  Safe while other threads count: the counters themselves are
+    /// only ever written by their own thread, and a reset just moves the baseline reports
+    /// subtract.
+    void reset();
+
+    struct ThreadSlab;
+    class DailyReport;
+
+private:
+    SignalCycleCounters() : m_pReportStream(NULL) {}
+
+    struct Totals
+    {
+        Totals();
+        uint64_t cycles[CYCLES_NUM_PHASES];
+        uint64_t calls[CYCLES_NUM_PHASES];
+    };
+
+    ThreadSlab &threadSlab();
+    /// Sums of every slot over all threads.  Caller holds m_mutex.
+    std::vector<Totals> readTotals() const;
+    void printTotals(std::ostream &o, const std::vector<Totals> &totals, size_t topN) const;
+
+    static std::atomic<bool> s_bEnabled;
+
+    mutable boost::mutex m_mutex;
+    std::vector<std::string> m_descs;
+    std::vector<ThreadSlab*> m_slabs;       // never freed, so counts survive thread exit
+    std::vector<Totals> m_baseline;         // [slot], totals at the last reset
+    std::vector<boost::shared_ptr<DailyReport> > m_dailyReports;
+    std::ostream *m_pReportStream;
+    timeval_t m_lastEndOfDay;
+};
+
+/// A counted scope on its thread's stack of enabled scopes.  On exit it charges its instance
+/// with its cycles less those its nested scopes already charged, and hands its own cycles up
+/// to the scope enclosing it, so no cycle is counted twice.
+class SignalCycleFrame
+{
+protected:
+    SignalCycleFrame() : m_start(0), m_pParent(NULL), m_childCycles(0) {}
+
+    void enter()
+    {
+        m_start = SignalCycleCounters::readCycles();
+        m_pParent = t_pTop;
+        t_pTop = this;
+    }
+    void leave(size_t slot, CyclePhase phase)
+    {
+        const uint64_t cycles = SignalCycleCounters::readCycles() - m_start;
+        t_pTop = m_pParent;
+        if(m_pParent)
+            m_pParent->m_childCycles += cycles;
+        SignalCycleCounters::instance().record(slot, phase, cycles - m_childCycles);
+    }
+
+    uint64_t m_start;       // 0 unless entered
+
+private:
+    static thread_local SignalCycleFrame *t_pTop;
+
+    SignalCycleFrame *m_pParent;
+    uint64_t m_childCycles;
+};
+
+/// RAII helper behind LONGBEACH_SIGNAL_CYCLES.
+template<typename NodeT>
+class SignalCycleScope : private SignalCycleFrame, private boost::noncopyable
+{
+public:
+    SignalCycleScope(const NodeT *node, CyclePhase phase)
+        : m_node(node)
+        , m_phase(phase)
+    {
+        if(SignalCycleCounters::isEnabled())
+            enter();
+    }
+    ~SignalCycleScope()
+    {
+        if(m_start)
+            leave(m_node->getCycleSlot(), m_phase);
+    }
+
+private:
+    const NodeT *m_node;
+    const CyclePhase m_phase;
+};
+
+/// RAII helper behind LONGBEACH_PROFILE_SIGNAL_HANDLER: a SignalLatencyScope and a
+/// SignalCycleScope in one, which costs a single branch on entry and on exit while both
+/// profilers are off.
+template<typename NodeT>
+class SignalHandlerScope : private SignalCycleFrame, private boost::noncopyable
+{
+public:
+    SignalHandlerScope(std::atomic<size_t> &site, const char *signalClass, const char *handler,
+            const NodeT *node, CyclePhase phase)
+        : m_site(site)
+        , m_signalClass(signalClass)
+        , m_handler(handler)
+        , m_node(node)
+        , m_phase(phase)
+        , m_latencyStart(0)
+    {
+        if(SignalLatencyProfiler::isEnabled() | SignalCycleCounters::isEnabled())
+            start();
+    }
+    ~SignalHandlerScope()
+    {
+        if(m_latencyStart | m_start)
+            stop();
+    }
+
+private:
+    void start()
+    {
+        if(SignalCycleCounters::isEnabled())
+            enter();
+        if(SignalLatencyProfiler::isEnabled())
+            m_latencyStart = SignalLatencyProfiler::now();
+    }
+    void stop()
+    {
+        if(m_latencyStart)
+            SignalLatencyScope::record(m_site, m_signalClass, m_handler, m_latencyStart);
+        if(m_start)
+            leave(m_node->getCycleSlot(), m_phase);
+    }
+
+    std::atomic<size_t> &m_site;
+    const char *m_signalClass;
+    const char *m_handler;
+    const NodeT *m_node;
+    const CyclePhase m_phase;
+    uint64_t m_latencyStart;
+};
+
+#ifdef LONGBEACH_SIGNALS_CYCLE_COUNTERS
+#define LONGBEACH_SIGNAL_CYCLES_CAT2(a, b) a##b
+#define LONGBEACH_SIGNAL_CYCLES_CAT(a, b) LONGBEACH_SIGNAL_CYCLES_CAT2(a, b)
+/// Counts the cycles of the rest of the enclosing scope against this signal instance.
+#define LONGBEACH_SIGNAL_CYCLES(phase) \
+    ::longbeach::signals::SignalCycleScope< ::longbeach::signals::EvalEngineNode> \
+        LONGBEACH_SIGNAL_CYCLES_CAT(_lb_cycleScope, __LINE__)(this, ::longbeach::signals::phase)
+/// LONGBEACH_TIME_SIGNAL_HANDLER(signalClass, handler) and LONGBEACH_SIGNAL_CYCLES(phase)
+/// together, for the top of a handler.
+#define LONGBEACH_PROFILE_SIGNAL_HANDLER(signalClass, handler, phase) \
+    static std::atomic<size_t> LONGBEACH_SIGNAL_CYCLES_CAT(_lb_latencySite, __LINE__)( \
+        ::longbeach::signals::SignalLatencyScope::NoSite); \
+    ::longbeach::signals::SignalHandlerScope< ::longbeach::signals::EvalEngineNode> \
+        LONGBEACH_SIGNAL_CYCLES_CAT(_lb_handlerScope, __LINE__)( \
+            LONGBEACH_SIGNAL_CYCLES_CAT(_lb_latencySite, __LINE__), signalClass, handler, \
+            this, ::longbeach::signals::phase)
+#else
+#define LONGBEACH_SIGNAL_CYCLES(phase) do {} while(0)
+#define LONGBEACH_PROFILE_SIGNAL_HANDLER(signalClass, handler, phase) \
+    LONGBEACH_TIME_SIGNAL_HANDLER(signalClass, handler)
+#endif
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALCYCLECOUNTERS_H
@@ -0,0 +1,282 @@
+#include <longbeach/signals/SignalEvalEngine.h>
+
+#include <algorithm>
+#include <deque>
+
+#include <boost/bind.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+/************************************************************************************************/
+// SignalEvalEngine
+/************************************************************************************************/
+
+SignalEvalEngine::SignalEvalEngine(EventDistributorPtr spED, Priority flushPriority)
+    : m_spED(spED)
+    , m_flushPriority(flushPriority)
+    , m_bOrderValid(true)
+    , m_bFlushScheduled(false)
+    , m_bFlushing(false)
+    , m_numMarked(0)
+    , m_numDelivered(0)
+{
+    if(!m_spED)
+        LONGBEACH_THROW_ERROR_SS("SignalEvalEngine: was passed a NULL EventDistributor");
+}
+
+size_t SignalEvalEngine::getIndex(const ISignal *sig)
+{
+    std::map<const ISignal*, size_t>::const_iterator it = m_index.find(sig);
+    if(it != m_index.end())
+        return it->second;
+
+    size_t idx = m_nodes.size();
+    m_nodes.push_back(Node());
+    m_index.insert(std::make_pair(sig, idx));
+    m_bOrderValid = false;
+    return idx;
+}
+
+void SignalEvalEngine::attach(EvalEngineNode *node, const ISignal *sig)
+{
+    m_nodes[getIndex(sig)].pNode = node;
+}
+
+void SignalEvalEngine::detach(const ISignal *sig)
+{
+    std::map<const ISignal*, size_t>::const_iterator it = m_index.find(sig);
+    if(it != m_index.end())
+        m_nodes[it->second].pNode = NULL;
+}
+
+void SignalEvalEngine::addDependency(const ISignal *upstream, const ISignal *downstream)
+{
+    size_t up = getIndex(upstream);
+    size_t down = getIndex(downstream);
+    std::vector<size_t> &edges = m_nodes[up].downstream;
+    if(std::find(edges.begin(), edges.end(), down) != edges.end())
+        return;
+    edges.push_back(down);
+    m_bOrderValid = false;
+}
+
+void SignalEvalEngine::computeOrder()
+{
+    // Kahn's algorithm; ties go in attach order so the delivery order is reproducible
+    std::vector<size_t> indegree(m_nodes.size(), 0);
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        for(std::vector<size_t>::const_iterator it = m_nodes[i].downstream.begin(); it != m_nodes[i].downstream.end(); ++it)
+            ++indegree[*it];
+
+    std::deque<size_t> ready;
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        if(indegree[i] == 0)
+            ready.push_back(i);
+
+    size_t rank = 0;
+    while(!ready.empty())
+    {
+        size_t i = ready.front();
+        ready.pop_front();
+        m_nodes[i].rank = rank++;
+        for(std::vector<size_t>::const_iterator it = m_nodes[i].downstream.begin(); it != m_nodes[i].downstream.end(); ++it)
+            if(--indegree[*it] == 0)
+                ready.push_back(*it);
+    }
+    if(rank != m_nodes.size())
+        LONGBEACH_THROW_ERROR_SS("SignalEvalEngine: signal dependency graph has a cycle");
+
+    // anything already queued was queued with the old ranks
+    m_dirty = dirty_queue_t();
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        if(m_nodes[i].bDirty)
+            m_dirty.push(rank_idx_t(m_nodes[i].rank, i));
+
+    m_bOrderValid = true;
+}
+
+void SignalEvalEngine::markDirty(const ISignal *sig, const timeval_t &tv)
+{
+    ++m_numMarked;
+    if(!m_bOrderValid)
+        computeOrder();
+
+    Node &n = m_nodes[m_index.find(sig)->second];
+    if(n.dirtyTv < tv)
+        n.dirtyTv = tv;
+    if(n.bDirty)
+        return;
+    n.bDirty = true;
+    m_dirty.push(rank_idx_t(n.rank, &n - &m_nodes[0]));
+
+    if(!m_bFlushScheduled && !m_bFlushing)
+    {
+        // outside of an event there is no work queue to batch in, so deliver now rather than
+        // leave the node dirty until some later event happens to schedule a flush
+        if(!scheduleFlush())
+            flush();
+    }
+}
+
+bool SignalEvalEngine::scheduleFlush()
+{
+    m_bFlushScheduled = m_spED->addWork(boost::bind(&SignalEvalEngine::flush, this), m_flushPriority);
+    return m_bFlushScheduled;
+}
+
+void SignalEvalEngine::flush()
+{
+    m_bFlushScheduled = false;
+    m_bFlushing = true;
+    try
+    {
+        // nodes marked while delivering are downstream, so they still come out of the queue
+        // after the node that marked them
+        while(!m_dirty.empty())
+        {
+            size_t idx = m_dirty.top().second;
+            m_dirty.pop();
+
+            Node &n = m_nodes[idx];
+            if(!n.bDirty)
+                continue;
+            n.bDirty = false;
+            timeval_t tv = n.dirtyTv;
+            n.dirtyTv = timeval_t();
+            if(n.pNode)
+            {
+                ++m_numDelivered;
+                n.pNode->deliver(tv);
+            }
+        }
+    }
+    catch(...)
+    {
+        // the nodes behind the one that threw are still dirty; deliver them in a later flush
+        m_bFlushing = false;
+        if(!m_dirty.empty() && !m_bFlushScheduled)
+            scheduleFlush();
+        throw;
+    }
+    m_bFlushing = false;
+}
+
+/************************************************************************************************/
+// EvalEngineNode
+/************************************************************************************************/
+
+EvalEngineNode::~EvalEngineNode()
+{
+    if(m_pEvalEngine)
+        m_pEvalEngine->detach(m_pEvalSignal);
+}
+
+void EvalEngineNode::attachEvalEngine(SignalEvalEngine *engine)
+{
+    if(m_pEvalEngine)
+        m_pEvalEngine->detach(m_pEvalSignal);
+    m_pEvalEngine = engine;
+    if(engine)
+    {
+        engine->attach(this, evalSignal());
+        for(size_t i = 0; i < m_evalUpstream.size(); ++i)
+            engine->addDependency(m_evalUpstream[i], m_pEvalSignal);
+    }
+}
+
+void EvalEngineNode::addEvalUpstream(const ISignal *upstream)
+{
+    if(std::find(m_evalUpstream.begin(), m_evalUpstream.end(), upstream) != m_evalUpstream.end())
+        return;
+    m_evalUpstream.push_back(upstream);
+    if(m_pEvalEngine)
+        m_pEvalEngine->addDependency(upstream, m_pEvalSignal);
+}
+
+void EvalEngineNode::enableStatePublishing(bool enable)
+{
+    if(!enable)
+        m_spPublisher.reset();
+    else if(!m_spPublisher)
+        m_spPublisher.reset(new SignalStatePublisher(evalSignal()->getStateSize()));
+    updateHasHooks();
+}
+
+void EvalEngineNode::attachStateStore(SignalStateStore *store)
+{
+    if(store && store != m_pStateStore)
+    {
+        // a store cannot drop a row, so one this signal already has is taken up again
+        size_t i = 0;
+        while(i < m_stateStoreRows.size() && m_stateStoreRows[i].first != store)
+            ++i;
+        if(i == m_stateStoreRows.size())
+            m_stateStoreRows.push_back(std::make_pair(store, store->add(evalSignal())));
+        m_stateStoreId = m_stateStoreRows[i].second;
+    }
+    m_pStateStore = store;
+    updateHasHooks();
+}
+
+void EvalEngineNode::addNotificationObserver(IEvalNotificationObserver *observer)
+{
+    evalSignal();
+    if(std::find(m_observers.begin(), m_observers.end(), observer) == m_observers.end())
+        m_observers.push_back(observer);
+    updateHasHooks();
+}
+
+void EvalEngineNode::removeNotificationObserver(IEvalNotificationObserver *observer)
+{
+    m_observers.erase(std::remove(m_observers.begin(), m_observers.end(), observer), m_observers.end());
+    updateHasHooks();
+}
+
+void EvalEngineNode::publishState()
+{
+    const ISignal *sig = m_pEvalSignal;
+    m_spPublisher->publish(sig->getSignalState(), sig->isOK(), sig->getLastChangeTv());
+}
+
+void EvalEngineNode::writeStateStore()
+{
+    const ISignal *sig = m_pEvalSignal;
+    m_pStateStore->write(m_stateStoreId, sig->getSignalState(), sig->isOK(), sig->getLastChangeTv());
+}
+
+void EvalEngineNode::runHooks(const timeval_t &tv)
+{
+    if(m_spPublisher)
+        publishState();
+    if(m_pStateStore)
+        writeStateStore();
+    for(size_t i = 0; i < m_observers.size(); ++i)
+        m_observers[i]->onSignalNotified(m_pEvalSignal, tv);
+}
+
+size_t EvalEngineNode::getCycleSlot() const
+{
+    if(m_cycleSlot == NoCycleSlot)
+    {
+        const ISignal *sig = dynamic_cast<const ISignal*>(this);
+        m_cycleSlot = SignalCycleCounters::instance().registerInstance(sig ? sig->getDesc() : "?");
+    }
+    return m_cycleSlot;
+}
+
+const ISignal *EvalEngineNode::evalSignal()
+{
+    // the engine keys nodes by the ISignal the rest of the graph knows this signal as.
+    // looked up once, outside the destructor, where the dynamic type is already gone
+    if(!m_pEvalSignal)
+        m_pEvalSignal = dynamic_cast<const ISignal*>(this);
+    if(!m_pEvalSignal)
+        LONGBEACH_THROW_ERROR_SS("EvalEngineNode: object is not an ISignal");
+    return m_pEvalSignal;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,223 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALEVALENGINE_H
+#define LONGBEACH_SIGNALS_SIGNALEVALENGINE_H
+
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/clientcore/EventDist.h>
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalCycleCounters.h>
+#include <longbeach/signals/SignalStatePublisher.h>
+#include <longbeach/signals/SignalStateStore.h>
+
+namespace longbeach {
+namespace signals {
+
+class EvalEngineNode;
+
+/// Batches the notifications of one event and delivers them once per signal, in dependency order.
+///
+/// By default a signal notifies its listeners as soon as one of its inputs changes, so a node
+/// fed by several changing inputs (a diamond) is notified, and recomputed, several times per
+/// event.  Signals attached to an engine instead mark themselves dirty; when the event has been
+/// handled the engine walks the dirty set in topological order of the dependency DAG and
+/// notifies each dirty signal exactly once.  The DAG holds the edges signals record at
+/// construction for the signals they wrap (EvalEngineNode::addEvalUpstream), and any added
+/// with addDependency.  Since signals recompute lazily
+/// on the first read after a notification, each one also recomputes at most once per event.
+///
+/// The engine must outlive the signals attached to it, or they must be detached first.
+class SignalEvalEngine : private boost::noncopyable
+{
+public:
+    /// The flush runs as EventDistributor work at flushPriority, which must be lower than the
+    /// priority of the handlers that mark signals dirty (see SigDiff for the same pattern).
+    SignalEvalEngine(EventDistributorPtr spED, Priority flushPriority);
+
+    /// Records that downstream reads upstream, for inputs no signal records itself.  Either may
+    /// be attached before or after.
+    void addDependency(const ISignal *upstream, const ISignal *downstream);
+
+    /// Notifies every dirty signal once, in topological order.  Normally called from the
+    /// scheduled EventDistributor work; may be called directly at the end of an event.  Run
+    /// outside of an event, when there is no work to schedule it as, by markDirty itself.
+    /// If a listener throws, the signals not yet delivered get a flush scheduled of their own.
+    void flush();
+
+    uint64_t getNumMarked() const { return m_numMarked; }
+    uint64_t getNumDelivered() const { return m_numDelivered; }
+
+private:
+    friend class EvalEngineNode;
+
+    void attach(EvalEngineNode *node, const ISignal *sig);
+    void detach(const ISignal *sig);
+    void markDirty(const ISignal *sig, const timeval_t &tv);
+    bool scheduleFlush();
+
+    size_t getIndex(const ISignal *sig);
+    void computeOrder();
+
+    struct Node
+    {
+        Node() : pNode(NULL), rank(0), bDirty(false) {}
+        EvalEngineNode *pNode;          // NULL if the signal is not (or no longer) attached
+        std::vector<size_t> downstream;
+        size_t rank;                    // position in topological order
+        bool bDirty;
+        timeval_t dirtyTv;
+    };
+    typedef std::pair<size_t, size_t> rank_idx_t;
+    typedef std::priority_queue<rank_idx_t, std::vector<rank_idx_t>, std::greater<rank_idx_t> > dirty_queue_t;
+
+    EventDistributorPtr m_spED;
+    Priority m_flushPriority;
+
+    std::vector<Node> m_nodes;
+    std::map<const ISignal*, size_t> m_index;
+    dirty_queue_t m_dirty;
+    bool m_bOrderValid;
+    bool m_bFlushScheduled;
+    bool m_bFlushing;
+
+    uint64_t m_numMarked;
+    uint64_t m_numDelivered;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SignalEvalEngine);
+
+
+/// Told whenever an EvalEngineNode notifies its listeners, after any batching by its engine.
+class IEvalNotificationObserver
+{
+public:
+    virtual ~IEvalNotificationObserver() {}
+    virtual void onSignalNotified(const ISignal *sig, const timeval_t &tv) = 0;
+};
+
+/// Mixin for signals that can run under a SignalEvalEngine.  With no engine attached a signal
+/// notifies immediately, exactly as before.
+///
+/// It is also where a signal's notifications can optionally publish its state for readers on
+/// other threads: with publishing enabled, each notification first copies the (recomputed)
+/// state into a SignalStatePublisher.  Likewise a signal attached to a SignalStateStore copies
+/// it into its row of the store.
+class EvalEngineNode
+{
+public:
+    /// Attaches this signal to engine, or detaches it (back to immediate notifications) if NULL.
+    void attachEvalEngine(SignalEvalEngine *engine);
+    SignalEvalEngine *getEvalEngine() const { return m_pEvalEngine; }
+
+    /// Starts or stops publishing this signal's state on every notification.  Publishing forces
+    /// the state to be recomputed at notification time rather than on the first read.
+    void enableStatePublishing(bool enable);
+
+    /// The publisher other threads should read from; NULL unless publishing is enabled.
+    /// Readers may keep it after publishing is disabled; it just stops changing.
+    const SignalStatePublisherPtr &getStatePublisher() const { return m_spPublisher; }
+
+    /// Adds this signal to store, which must outlive it, and mirrors its state there on every
+    /// notification; like publishing, this forces the state to be recomputed at notification
+    /// time.  NULL stops mirroring (the row keeps its last values).  Attaching again to a store
+    /// the signal already has a row in reuses that row.
+    void attachStateStore(SignalStateStore *store);
+    SignalStateStore *getStateStore() const { return m_pStateStore; }
+    size_t getStateStoreId() const { return m_stateStoreId; }
+
+    /// Observers are not owned and must be removed before they are destroyed.
+    void addNotificationObserver(IEvalNotificationObserver *observer);
+    void removeNotificationObserver(IEvalNotificationObserver *observer);
+
+    /// This instance's slot in SignalCycleCounters, taken on first use.
+    size_t getCycleSlot() const;
+
+    /// While suppressed the signal still takes in its inputs, but neither notifies its
+    /// listeners nor its engine, publisher or observers (see SignalWarmup).  Must be changed
+    /// on the thread that drives the signal, or while nothing does.
+    void suppressNotifications(bool suppress) { m_bSuppressed = suppress; }
+    bool areNotificationsSuppressed() const { return m_bSuppressed; }
+
+protected:
+    /// Records that this signal reads upstream, so that an engine delivers upstream first.
+    /// Signals built on another signal call it from their constructor.
+    void addEvalUpstream(const ISignal *upstream);
+
+    EvalEngineNode() : m_pEvalEngine(NULL), m_pEvalSignal(NULL), m_pStateStore(NULL), m_stateStoreId(0)
+        , m_bHasHooks(false), m_bSuppressed(false), m_cycleSlot(NoCycleSlot) {}
+    virtual ~EvalEngineNode();
+
+    /// Call instead of notifying.  Returns true if the engine took the notification, or
+    /// notifications are suppressed, in which case the caller must not notify itself.
+    /// Otherwise publishes the state if enabled and tells the observers.
+    bool deferNotification(const timeval_t &tv = timeval_t())
+    {
+        if(m_bSuppressed)
+            return true;
+        if(!m_pEvalEngine)
+        {
+            if(m_bHasHooks)
+                runHooks(tv);
+            return false;
+        }
+        m_pEvalEngine->markDirty(m_pEvalSignal, tv);
+        return true;
+    }
+
+    /// Brings the published and stored state up to date after a change that does not go
+    /// through deferNotification, such as a reset or a change in the status of the signal's
+    /// sources.
+    void refreshPublishedState()
+    {
+        if(m_bSuppressed)
+            return;
+        if(m_spPublisher)
+            publishState();
+        if(m_pStateStore)
+            writeStateStore();
+    }
+
+    /// Called by the engine at flush time with the latest tv passed to deferNotification.
+    virtual void deliverNotification(const timeval_t &tv) = 0;
+
+private:
+    friend class SignalEvalEngine;
+
+    /// What the engine calls at flush time.
+    void deliver(const timeval_t &tv)
+    {
+        if(m_bHasHooks)
+            runHooks(tv);
+        LONGBEACH_SIGNAL_CYCLES(CYCLES_NOTIFY);
+        deliverNotification(tv);
+    }
+
+    void runHooks(const timeval_t &tv);
+    void publishState();
+    void writeStateStore();
+    void updateHasHooks() { m_bHasHooks = m_spPublisher || m_pStateStore || !m_observers.empty(); }
+    const ISignal *evalSignal();
+
+    SignalEvalEngine *m_pEvalEngine;
+    const ISignal *m_pEvalSignal;
+    std::vector<const ISignal*> m_evalUpstream;
+    SignalStatePublisherPtr m_spPublisher;
+    SignalStateStore *m_pStateStore;
+    size_t m_stateStoreId;
+    std::vector<std::pair<SignalStateStore*, size_t> > m_stateStoreRows;   // every store and row taken
+    std::vector<IEvalNotificationObserver*> m_observers;
+    bool m_bHasHooks;   // publisher, store or observers present
+    bool m_bSuppressed;
+
+    static const size_t NoCycleSlot = size_t(-1);
+    mutable size_t m_cycleSlot;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALEVALENGINE_H
@@ -0,0 +1,109 @@
+#include <longbeach/signals/SignalGroup.h>
+
+#include <boost/bind.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+// word layout: timeval, one ok flag per signal, then all states back to back
+size_t numStateWords(const std::vector<ISignalPtr> &signals)
+{
+    size_t n = 0;
+    for(size_t i = 0; i < signals.size(); ++i)
+    {
+        if(!signals[i])
+            LONGBEACH_THROW_ERROR_SS("SignalGroup: signal " << i << " is NULL");
+        n += signals[i]->getStateSize();
+    }
+    return n;
+}
+
+} // anonymous namespace
+
+SignalGroup::SignalGroup(EventDistributorPtr spED, Priority publishPriority, const std::vector<ISignalPtr> &signals)
+    : m_spED(spED)
+    , m_publishPriority(publishPriority)
+    , m_signals(signals)
+    , m_okWord(SeqlockDoubleBuffer::TvWords)
+    , m_stateWord(m_okWord + signals.size())
+    , m_bPublishScheduled(false)
+    , m_buffer(SeqlockDoubleBuffer::TvWords + signals.size() + numStateWords(signals))
+{
+    if(!m_spED)
+        LONGBEACH_THROW_ERROR_SS("SignalGroup: was passed a NULL EventDistributor");
+
+    m_offsets.push_back(0);
+    for(size_t i = 0; i < m_signals.size(); ++i)
+    {
+        m_offsets.push_back(m_offsets.back() + m_signals[i]->getStateSize());
+
+        EvalEngineNode *node = dynamic_cast<EvalEngineNode*>(m_signals[i].get());
+        if(!node)
+            LONGBEACH_THROW_ERROR_SS("SignalGroup: " << m_signals[i]->getDesc() << " cannot be observed");
+        m_nodes.push_back(node);
+    }
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        m_nodes[i]->addNotificationObserver(this);
+}
+
+SignalGroup::~SignalGroup()
+{
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        m_nodes[i]->removeNotificationObserver(this);
+}
+
+void SignalGroup::onSignalNotified(const ISignal *sig, const timeval_t &tv)
+{
+    if(m_lastTv < tv)
+        m_lastTv = tv;
+    if(!m_bPublishScheduled)
+        m_bPublishScheduled = m_spED->addWork(boost::bind(&SignalGroup::publish, this), m_publishPriority);
+}
+
+void SignalGroup::publish()
+{
+    m_bPublishScheduled = false;
+
+    std::atomic<uint64_t> *w = m_buffer.beginWrite();
+    SeqlockDoubleBuffer::storeTv(w, m_lastTv);
+    for(size_t i = 0; i < m_signals.size(); ++i)
+    {
+        const ISignal &sig = *m_signals[i];
+        const std::vector<double> &state = sig.getSignalState();
+        w[m_okWord + i].store(sig.isOK(), std::memory_order_relaxed);
+
+        std::atomic<uint64_t> *row = w + m_stateWord + m_offsets[i];
+        const size_t n = m_offsets[i + 1] - m_offsets[i];
+        for(size_t j = 0; j < n; ++j)
+            SeqlockDoubleBuffer::storeDouble(row[j], j < state.size() ? state[j] : 0.0);
+    }
+    m_buffer.endWrite();
+}
+
+bool SignalGroup::tryRead(SignalGroupFrame &out, size_t maxAttempts) const
+{
+    std::vector<uint64_t> &words = out.words;
+    words.resize(m_buffer.getNumWords());
+    const uint64_t epoch = m_buffer.tryRead(&words[0], maxAttempts);
+    if(epoch == 0 || epoch == SeqlockDoubleBuffer::Busy)
+        return false;
+
+    out.epoch = epoch;
+    out.tv = SeqlockDoubleBuffer::loadTv(&words[0]);
+    if(out.offsets.size() != m_offsets.size())
+        out.offsets = m_offsets;
+    out.ok.resize(m_signals.size());
+    for(size_t i = 0; i < m_signals.size(); ++i)
+        out.ok[i] = words[m_okWord + i] != 0;
+    out.matrix.resize(m_offsets.back());
+    for(size_t j = 0; j < out.matrix.size(); ++j)
+        out.matrix[j] = SeqlockDoubleBuffer::loadDouble(words[m_stateWord + j]);
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,93 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALGROUP_H
+#define LONGBEACH_SIGNALS_SIGNALGROUP_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/clientcore/EventDist.h>
+#include <longbeach/signals/Signal.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/SignalStatePublisher.h>
+
+namespace longbeach {
+namespace signals {
+
+/// One consistent view of every signal in a SignalGroup.  The states are stored back to back in
+/// one contiguous block, row i being signal i's state.
+struct SignalGroupFrame
+{
+    SignalGroupFrame() : epoch(0) {}
+
+    const double *row(size_t i) const { return &matrix[offsets[i]]; }
+    size_t rowSize(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    bool isOK(size_t i) const { return ok[i] != 0; }
+
+    uint64_t epoch;                 // number of frames published so far, including this one
+    timeval_t tv;                   // latest notification time of the event this frame follows
+    std::vector<double> matrix;
+    std::vector<size_t> offsets;    // numSignals + 1 entries
+    std::vector<char> ok;
+
+    std::vector<uint64_t> words;    // scratch for read(), kept so repeated reads do not allocate
+};
+
+/// Publishes the states of a fixed set of signals together, once per event, as one versioned
+/// frame that readers on any thread can take without locks.
+///
+/// Whenever a member signal notifies, the group schedules a single publish as EventDistributor
+/// work at publishPriority, which must be lower than the priority of the handlers driving the
+/// members (and of any SignalEvalEngine flush they run under).  By the time it runs every
+/// member has seen the event, so the frame holds one event's worth of states under one epoch.
+/// The frame is written through a SeqlockDoubleBuffer, as SignalStatePublisher does for one
+/// signal.
+///
+/// Members must be EvalEngineNodes, which all signals in this library are.
+class SignalGroup
+    : private IEvalNotificationObserver
+    , private boost::noncopyable
+{
+public:
+    SignalGroup(EventDistributorPtr spED, Priority publishPriority, const std::vector<ISignalPtr> &signals);
+    ~SignalGroup();
+
+    size_t getNumSignals() const { return m_signals.size(); }
+    const ISignalPtr &getSignal(size_t i) const { return m_signals[i]; }
+
+    /// Writes a frame from the current states now.  Normally called from the scheduled work.
+    void publish();
+
+    /// Reader side; any thread.  Returns false if no frame has been published yet.  out is
+    /// sized on the first call and reused after that.  Lock-free but not wait-free: the copy is
+    /// retried for as long as publishes keep tearing it, which takes the publisher lapping the
+    /// reader twice within one copy.
+    bool read(SignalGroupFrame &out) const { return tryRead(out, 0); }
+
+    /// Reader side, wait-free: as read, but gives up after maxAttempts torn copies and returns
+    /// false, leaving the frame in out as it was; getEpoch() tells that apart from nothing
+    /// published yet.  0 attempts is no bound, as read.
+    bool tryRead(SignalGroupFrame &out, size_t maxAttempts) const;
+
+    /// Epoch of the last published frame, 0 if none.
+    uint64_t getEpoch() const { return m_buffer.getVersion(); }
+
+private:
+    virtual void onSignalNotified(const ISignal *sig, const timeval_t &tv);
+
+    EventDistributorPtr m_spED;
+    Priority m_publishPriority;
+    std::vector<ISignalPtr> m_signals;
+    std::vector<EvalEngineNode*> m_nodes;
+    std::vector<size_t> m_offsets;
+    size_t m_okWord, m_stateWord;
+
+    bool m_bPublishScheduled;
+    timeval_t m_lastTv;
+    SeqlockDoubleBuffer m_buffer;   // timeval, ok flags, states
+};
+LONGBEACH_DECLARE_SHARED_PTR(SignalGroup);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALGROUP_H
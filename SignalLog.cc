@@ -0,0 +1,248 @@
+#include <longbeach/signals/SignalLog.h>
+
+#include <string.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/ShardQueue.h>
+
+namespace longbeach {
+namespace signals {
+
+/************************************************************************************************/
+// SignalLogSite
+/************************************************************************************************/
+
+SignalLogSite::SignalLogSite(const char *name, const char *fields, uint32_t maxPerSecond)
+    : m_name(name)
+    , m_maxPerSecond(maxPerSecond)
+    , m_bRegistered(false)
+    , m_windowStartNs(0)
+    , m_windowCount(0)
+    , m_unreported(0)
+    , m_numLogged(0)
+    , m_numSuppressed(0)
+    , m_numDropped(0)
+{
+    for(const char *f = fields; f && *f; )
+    {
+        const char *end = strchr(f, ',');
+        m_fieldNames.push_back(end ? std::string(f, end) : std::string(f));
+        f = end ? end + 1 : NULL;
+    }
+}
+
+bool SignalLogSite::admit(uint64_t nowNs)
+{
+    if(m_maxPerSecond == 0)
+        return true;
+    // a window per second of wall time; threads racing at the turn may admit a few extra
+    uint64_t start = m_windowStartNs.load(std::memory_order_relaxed);
+    if(nowNs - start >= 1000000000ULL
+        && m_windowStartNs.compare_exchange_strong(start, nowNs, std::memory_order_relaxed))
+        m_windowCount.store(0, std::memory_order_relaxed);
+    if(m_windowCount.fetch_add(1, std::memory_order_relaxed) < m_maxPerSecond)
+        return true;
+    m_numSuppressed.fetch_add(1, std::memory_order_relaxed);
+    m_unreported.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+/************************************************************************************************/
+// SignalLog
+/************************************************************************************************/
+
+struct SignalLog::ThreadQueue : public CacheAligned
+{
+    ThreadQueue() : queue(QueueCapacity), numPushed(0), numWritten(0) {}
+
+    SpscQueue<Record> queue;
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<uint64_t> numPushed;     // logging thread
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<uint64_t> numWritten;    // writer thread
+};
+
+namespace {
+thread_local SignalLog::ThreadQueue *t_pLogQueue = NULL;
+const uint32_t IdleSleepUs = 1000;
+}
+
+SignalLog &SignalLog::instance()
+{
+    static SignalLog s_instance;
+    return s_instance;
+}
+
+SignalLog::SignalLog()
+    : m_pStream(&std::cout)
+    , m_bStop(false)
+{
+    m_thread = boost::thread(boost::bind(&SignalLog::run, this));
+}
+
+SignalLog::~SignalLog()
+{
+    m_bStop.store(true, std::memory_order_relaxed);
+    m_thread.join();
+    drain();
+}
+
+void SignalLog::setStream(std::ostream *o)
+{
+    m_pStream.store(o ? o : &std::cout, std::memory_order_relaxed);
+}
+
+SignalLog::ThreadQueue &SignalLog::threadQueue()
+{
+    if(!t_pLogQueue)
+    {
+        t_pLogQueue = new ThreadQueue;
+        boost::mutex::scoped_lock lock(m_mutex);
+        m_queues.push_back(t_pLogQueue);
+    }
+    return *t_pLogQueue;
+}
+
+bool SignalLog::prepare(SignalLogSite &site, const timeval_t &tv, const std::string &desc, Record &r)
+{
+    if(!site.admit(SignalLatencyProfiler::now()))
+        return false;
+    if(!site.m_bRegistered.load(std::memory_order_acquire))
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        if(!site.m_bRegistered.load(std::memory_order_relaxed))
+        {
+            m_sites.push_back(&site);
+            site.m_bRegistered.store(true, std::memory_order_release);
+        }
+    }
+    r.site = &site;
+    r.tv = tv;
+    r.unreported = site.m_unreported.exchange(0, std::memory_order_relaxed);
+    const size_t n = std::min(desc.size(), size_t(MaxDescLength));
+    memcpy(r.desc, desc.data(), n);
+    r.desc[n] = '\0';
+    return true;
+}
+
+void SignalLog::push(Record &r)
+{
+    ThreadQueue &q = threadQueue();
+    if(!q.queue.push(r))
+    {
+        r.site->m_numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    r.site->m_numLogged.fetch_add(1, std::memory_order_relaxed);
+    q.numPushed.store(q.numPushed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void SignalLog::logValues(SignalLogSite &site, const timeval_t &tv, const std::string &desc,
+                          const double *values, size_t numValues)
+{
+    Record r;
+    if(!prepare(site, tv, desc, r))
+        return;
+    r.numValues = std::min(numValues, size_t(MaxValues));
+    std::copy(values, values + r.numValues, r.values);
+    push(r);
+}
+
+void SignalLog::log(SignalLogSite &site, const timeval_t &tv, const std::string &desc, const std::string &text)
+{
+    Record r;
+    if(!prepare(site, tv, desc, r))
+        return;
+    r.text = text;
+    push(r);
+}
+
+void SignalLog::flush()
+{
+    std::vector<std::pair<ThreadQueue*, uint64_t> > targets;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        for(size_t i = 0; i < m_queues.size(); ++i)
+            targets.push_back(std::make_pair(m_queues[i], m_queues[i]->numPushed.load(std::memory_order_acquire)));
+    }
+    for(size_t i = 0; i < targets.size(); ++i)
+        while(targets[i].first->numWritten.load(std::memory_order_acquire) < targets[i].second)
+            boost::this_thread::sleep_for(boost::chrono::microseconds(IdleSleepUs / 10));
+}
+
+void SignalLog::run()
+{
+    while(!m_bStop.load(std::memory_order_relaxed))
+        if(!drain())
+            boost::this_thread::sleep_for(boost::chrono::microseconds(IdleSleepUs));
+}
+
+size_t SignalLog::drain()
+{
+    std::vector<ThreadQueue*> queues;
+    {
+        boost::mutex::scoped_lock lock(m_mutex);
+        queues = m_queues;
+    }
+    std::ostream &o = *m_pStream.load(std::memory_order_relaxed);
+    size_t numWritten = 0;
+    Record r;
+    for(size_t i = 0; i < queues.size(); ++i)
+    {
+        uint64_t n = 0;
+        while(queues[i]->queue.pop(r))
+        {
+            write(r);
+            ++n;
+        }
+        if(n)
+        {
+            // flushed before counting, so flush() returns with the records out
+            o.flush();
+            queues[i]->numWritten.fetch_add(n, std::memory_order_release);
+            numWritten += n;
+        }
+    }
+    return numWritten;
+}
+
+void SignalLog::write(const Record &r)
+{
+    std::ostream &o = *m_pStream.load(std::memory_order_relaxed);
+    o << r.tv << ' ';
+    if(r.desc[0])
+        o << r.desc << ' ';
+    o << r.site->getName() << ':';
+    const std::vector<std::string> &names = r.site->getFieldNames();
+    for(size_t i = 0; i < r.numValues; ++i)
+    {
+        o << ' ';
+        if(i < names.size())
+            o << names[i] << '=';
+        o << r.values[i];
+    }
+    if(!r.text.empty())
+        o << ' ' << r.text;
+    if(r.unreported)
+        o << " (" << r.unreported << " suppressed)";
+    o << '\n';
+}
+
+void SignalLog::printStats(std::ostream &o) const
+{
+    boost::mutex::scoped_lock lock(m_mutex);
+    o << std::setw(48) << std::left << "site" << std::right
+      << std::setw(12) << "logged" << std::setw(12) << "suppressed" << std::setw(12) << "dropped" << '\n';
+    for(size_t i = 0; i < m_sites.size(); ++i)
+        o << std::setw(48) << std::left << m_sites[i]->getName() << std::right
+          << std::setw(12) << m_sites[i]->getNumLogged()
+          << std::setw(12) << m_sites[i]->getNumSuppressed()
+          << std::setw(12) << m_sites[i]->getNumDropped() << '\n';
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,146 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALLOG_H
+#define LONGBEACH_SIGNALS_SIGNALLOG_H
+
+#include <atomic>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/core/ptime.h>
+
+namespace longbeach {
+namespace signals {
+
+/// A place in the code that writes diagnostics to the SignalLog, with its own rate limit and
+/// counters.  Declared once per call site, at file scope, so its limit and counts cover every
+/// signal instance that logs there.
+class SignalLogSite : private boost::noncopyable
+{
+public:
+    /// fields names the values of each record, comma separated.  At most maxPerSecond records
+    /// are admitted in each second of wall time, 0 meaning no limit; the others are counted
+    /// and reported with the next record admitted.
+    SignalLogSite(const char *name, const char *fields, uint32_t maxPerSecond);
+
+    const char *getName() const { return m_name; }
+    const std::vector<std::string> &getFieldNames() const { return m_fieldNames; }
+    uint32_t getMaxPerSecond() const { return m_maxPerSecond; }
+
+    uint64_t getNumLogged() const { return m_numLogged.load(std::memory_order_relaxed); }
+    /// Records over the rate limit.
+    uint64_t getNumSuppressed() const { return m_numSuppressed.load(std::memory_order_relaxed); }
+    /// Records admitted but lost because the writer thread had fallen a full queue behind.
+    uint64_t getNumDropped() const { return m_numDropped.load(std::memory_order_relaxed); }
+
+private:
+    friend class SignalLog;
+
+    /// Counts the record against the limit; returns false, counting it as suppressed, if over.
+    bool admit(uint64_t nowNs);
+
+    const char *m_name;
+    std::vector<std::string> m_fieldNames;
+    const uint32_t m_maxPerSecond;
+
+    std::atomic<bool> m_bRegistered;        // with the SignalLog, on the first record
+    std::atomic<uint64_t> m_windowStartNs;
+    std::atomic<uint32_t> m_windowCount;
+    std::atomic<uint64_t> m_unreported;     // suppressed since the last record admitted
+
+    std::atomic<uint64_t> m_numLogged;
+    std::atomic<uint64_t> m_numSuppressed;
+    std::atomic<uint64_t> m_numDropped;
+};
+
+/// Asynchronous diagnostics channel for signal internals: clamps, resets, teardown dumps.
+///
+/// Logging copies the record into a lock-free queue owned by the calling thread and returns;
+/// a writer thread drains the queues and does all the formatting and I/O, so the event thread
+/// never blocks on the stream.  Each record is one line:
+///
+///     <tv> <desc> <site>: <field>=<value> ... <text> (<n> suppressed)
+///
+/// With per-site rate limits (SignalLogSite), verbose diagnostics can stay on in production.
+/// Records from one thread are written in order; records from different threads may
+/// interleave.
+class SignalLog : private boost::noncopyable
+{
+public:
+    static const size_t MaxValues = 6;
+    static const size_t MaxDescLength = 63;
+    static const size_t QueueCapacity = 4096;   // records per logging thread
+
+    static SignalLog &instance();
+
+    /// Where the writer thread writes; std::cout unless set.  The stream is only touched by
+    /// the writer thread once set, so it should not be written from elsewhere.
+    void setStream(std::ostream *o);
+
+    /// Logs numValues (at most MaxValues) values named by the site's fields.  desc is
+    /// truncated to MaxDescLength characters.
+    void logValues(SignalLogSite &site, const timeval_t &tv, const std::string &desc,
+                   const double *values, size_t numValues);
+
+    /// Logs free text, for records that are not a few numbers.  Allocates, so best kept off
+    /// the hot paths.
+    void log(SignalLogSite &site, const timeval_t &tv, const std::string &desc, const std::string &text);
+
+    void log(SignalLogSite &site, const timeval_t &tv, const std::string &desc)
+        { logValues(site, tv, desc, NULL, 0); }
+    void log(SignalLogSite &site, const timeval_t &tv, const std::string &desc, double v0)
+        { logValues(site, tv, desc, &v0, 1); }
+    void log(SignalLogSite &site, const timeval_t &tv, const std::string &desc, double v0, double v1)
+        { const double v[] = { v0, v1 }; logValues(site, tv, desc, v, 2); }
+    void log(SignalLogSite &site, const timeval_t &tv, const std::string &desc, double v0, double v1, double v2)
+        { const double v[] = { v0, v1, v2 }; logValues(site, tv, desc, v, 3); }
+
+    /// Blocks until every record logged before the call is written and the stream flushed.
+    void flush();
+
+    /// Logged, suppressed and dropped counts of every site that has logged.
+    void printStats(std::ostream &o) const;
+
+    struct Record
+    {
+        Record() : site(NULL), unreported(0), numValues(0) { desc[0] = '\0'; }
+
+        SignalLogSite *site;
+        timeval_t tv;
+        uint64_t unreported;            // suppressed at the site before this record
+        uint32_t numValues;
+        double values[MaxValues];
+        char desc[MaxDescLength + 1];
+        std::string text;
+    };
+
+    struct ThreadQueue;
+
+private:
+    SignalLog();
+    ~SignalLog();
+
+    ThreadQueue &threadQueue();
+    bool prepare(SignalLogSite &site, const timeval_t &tv, const std::string &desc, Record &r);
+    void push(Record &r);
+
+    void run();
+    /// Writes whatever is queued; returns the number of records written.
+    size_t drain();
+    void write(const Record &r);
+
+    mutable boost::mutex m_mutex;
+    std::vector<ThreadQueue*> m_queues;     // never freed, so records survive thread exit
+    std::vector<SignalLogSite*> m_sites;    // sites that have logged, in order of first record
+    std::atomic<std::ostream*> m_pStream;
+    std::atomic<bool> m_bStop;
+    boost::thread m_thread;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALLOG_H
@@ -0,0 +1,205 @@
+#include <longbeach/signals/SignalMemory.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <typeinfo>
+
+#include <boost/bind.hpp>
+#include <boost/core/demangle.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+std::string typeName(const ISignal &signal)
+{
+    std::string name = boost::core::demangle(typeid(signal).name());
+    std::string::size_type colons = name.rfind("::");
+    return colons == std::string::npos ? name : name.substr(colons + 2);
+}
+
+typedef std::pair<std::string, std::pair<size_t, size_t> > total_entry_t;
+
+bool byBytesDesc(const total_entry_t &a, const total_entry_t &b)
+{
+    return a.second.first > b.second.first;
+}
+
+bool byTotalDesc(const SignalFootprint &a, const SignalFootprint &b)
+{
+    return a.total() > b.total();
+}
+
+void printTotals(std::ostream &o, const char *title, const std::map<std::string, std::pair<size_t, size_t> > &totals)
+{
+    std::vector<total_entry_t> rows(totals.begin(), totals.end());
+    std::sort(rows.begin(), rows.end(), byBytesDesc);
+    o << "  by " << title << ":" << std::endl;
+    for(size_t i = 0; i < rows.size(); ++i)
+        o << std::setw(14) << rows[i].second.first << "  " << std::setw(6) << rows[i].second.second
+          << "  " << rows[i].first << std::endl;
+}
+
+} // anonymous namespace
+
+SignalMemoryReport::SignalMemoryReport()
+    : m_signalBudget(0)
+    , m_instrumentBudget(0)
+    , m_totalBudget(0)
+{
+}
+
+void SignalMemoryReport::add(const ISignalPtr &signal)
+{
+    if(!signal)
+        LONGBEACH_THROW_ERROR_SS("SignalMemoryReport: null signal");
+    m_signals.push_back(signal);
+}
+
+void SignalMemoryReport::add(const std::vector<ISignalPtr> &signals)
+{
+    for(size_t i = 0; i < signals.size(); ++i)
+        add(signals[i]);
+}
+
+size_t SignalMemoryReport::stateFootprint(const ISignal &signal)
+{
+    // getSignalState would recompute a dirty signal; the state is sized once, at construction
+    size_t bytes = signal.getStateSize() * sizeof(double);
+    const std::vector<std::string> &names = signal.getStateNames();
+    bytes += footprint::of(names);
+    for(size_t i = 0; i < names.size(); ++i)
+        bytes += footprint::of(names[i]);
+    return bytes;
+}
+
+std::vector<SignalFootprint> SignalMemoryReport::measure() const
+{
+    std::vector<SignalFootprint> result(m_signals.size());
+    for(size_t i = 0; i < m_signals.size(); ++i)
+    {
+        const ISignal &sig = *m_signals[i];
+        SignalFootprint &f = result[i];
+        f.desc = sig.getDesc();
+        f.type = typeName(sig);
+        std::ostringstream instr;
+        instr << sig.getInstrument();
+        f.instrument = instr.str();
+        f.stateBytes = stateFootprint(sig);
+        if(const IMemoryAccountable *ma = dynamic_cast<const IMemoryAccountable*>(&sig))
+        {
+            f.ownedBytes = ma->getHeapFootprint();
+            f.bAccountable = true;
+        }
+    }
+    return result;
+}
+
+void SignalMemoryReport::addTo(totals_t &totals, const std::string &key, size_t bytes)
+{
+    std::pair<size_t, size_t> &t = totals[key];
+    t.first += bytes;
+    ++t.second;
+}
+
+size_t SignalMemoryReport::checkBudgets(std::ostream &o) const
+{
+    const std::vector<SignalFootprint> fps = measure();
+    totals_t byType, byInstrument;
+    size_t total = 0, numExceeded = 0;
+    for(size_t i = 0; i < fps.size(); ++i)
+    {
+        const SignalFootprint &f = fps[i];
+        addTo(byType, f.type, f.total());
+        addTo(byInstrument, f.instrument, f.total());
+        total += f.total();
+        if(m_signalBudget && f.total() > m_signalBudget)
+        {
+            o << "SignalMemoryReport: " << f.desc << " (" << f.type << ") uses " << f.total()
+              << " bytes, over the per-signal budget of " << m_signalBudget << std::endl;
+            ++numExceeded;
+        }
+    }
+    for(std::map<std::string, size_t>::const_iterator it = m_typeBudgets.begin(); it != m_typeBudgets.end(); ++it)
+    {
+        totals_t::const_iterator t = byType.find(it->first);
+        if(it->second && t != byType.end() && t->second.first > it->second)
+        {
+            o << "SignalMemoryReport: " << t->second.second << " " << it->first << " signals use "
+              << t->second.first << " bytes, over their budget of " << it->second << std::endl;
+            ++numExceeded;
+        }
+    }
+    if(m_instrumentBudget)
+        for(totals_t::const_iterator it = byInstrument.begin(); it != byInstrument.end(); ++it)
+            if(it->second.first > m_instrumentBudget)
+            {
+                o << "SignalMemoryReport: the " << it->second.second << " signals on " << it->first << " use "
+                  << it->second.first << " bytes, over the per-instrument budget of " << m_instrumentBudget << std::endl;
+                ++numExceeded;
+            }
+    if(m_totalBudget && total > m_totalBudget)
+    {
+        o << "SignalMemoryReport: " << fps.size() << " signals use " << total
+          << " bytes, over the total budget of " << m_totalBudget << std::endl;
+        ++numExceeded;
+    }
+    return numExceeded;
+}
+
+void SignalMemoryReport::printReport(std::ostream &o, size_t topN) const
+{
+    std::vector<SignalFootprint> fps = measure();
+    totals_t byType, byInstrument;
+    size_t total = 0, numUnaccounted = 0;
+    for(size_t i = 0; i < fps.size(); ++i)
+    {
+        addTo(byType, fps[i].type, fps[i].total());
+        addTo(byInstrument, fps[i].instrument, fps[i].total());
+        total += fps[i].total();
+        numUnaccounted += !fps[i].bAccountable;
+    }
+
+    o << "signal memory: " << total << " bytes in " << fps.size() << " signals";
+    if(numUnaccounted)
+        o << " (" << numUnaccounted << " count their state only)";
+    o << std::endl;
+    printTotals(o, "type", byType);
+    printTotals(o, "instrument", byInstrument);
+
+    std::sort(fps.begin(), fps.end(), byTotalDesc);
+    if(fps.size() > topN)
+        fps.resize(topN);
+    o << "  largest signals:" << std::endl;
+    for(size_t i = 0; i < fps.size(); ++i)
+        o << std::setw(14) << fps[i].total() << "  " << fps[i].desc << " (" << fps[i].type << ")" << std::endl;
+}
+
+void SignalMemoryReport::schedulePeriodicCheck(const ClockMonitorPtr &cm, const ptime_duration_t &period)
+{
+    if(!cm)
+        LONGBEACH_THROW_ERROR_SS("SignalMemoryReport: Bad ClockMonitor");
+    m_spCM = cm;
+    m_period = period;
+    m_spCM->scheduleWakeupCall( m_subTimer
+        , boost::bind( &SignalMemoryReport::onTimer, this, _1, _2 )
+        , m_spCM->getTime() + m_period
+        , PRIORITY_CC_Misc );
+}
+
+void SignalMemoryReport::onTimer(const timeval_t &ctv, const timeval_t &swtv)
+{
+    m_spCM->scheduleWakeupCall( m_subTimer
+        , boost::bind( &SignalMemoryReport::onTimer, this, _1, _2 )
+        , m_spCM->getTime() + m_period
+        , PRIORITY_CC_Misc );
+    checkBudgets(std::cerr);
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,126 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALMEMORY_H
+#define LONGBEACH_SIGNALS_SIGNALMEMORY_H
+
+#include <algorithm>
+#include <deque>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/ClockMonitor.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Implemented by signals that own containers whose size changes at run time (trade windows,
+/// histories, observation queues), so their growth can be attributed.
+class IMemoryAccountable
+{
+public:
+    virtual ~IMemoryAccountable() {}
+
+    /// Approximate heap bytes the signal owns beyond its own object and its state vector and
+    /// state names, which SignalMemoryReport counts for every signal.  Called on the thread
+    /// that drives the signal.
+    virtual size_t getHeapFootprint() const = 0;
+};
+
+/// Heap bytes of standard containers, for implementing getHeapFootprint.  Capacities are
+/// counted, not sizes, since that is what stays allocated.
+namespace footprint {
+
+template<typename T, typename A>
+inline size_t of(const std::vector<T, A> &v) { return v.capacity() * sizeof(T); }
+
+/// libstdc++ layout: 512-byte nodes (one element per node for larger ones) and a map of node
+/// pointers with room for at least 8.
+template<typename T, typename A>
+inline size_t of(const std::deque<T, A> &d)
+{
+    const size_t perNode = sizeof(T) < 512 ? 512 / sizeof(T) : 1;
+    const size_t nodes = d.size() / perNode + 1;
+    return nodes * perNode * sizeof(T) + std::max<size_t>(8, nodes + 2) * sizeof(void*);
+}
+
+/// Beyond the small-string buffer.
+inline size_t of(const std::string &s) { return s.capacity() > 15 ? s.capacity() + 1 : 0; }
+
+} // namespace footprint
+
+/// What SignalMemoryReport measured for one signal.
+struct SignalFootprint
+{
+    SignalFootprint() : stateBytes(0), ownedBytes(0), bAccountable(false) {}
+
+    size_t total() const { return stateBytes + ownedBytes; }
+
+    std::string desc;
+    std::string type;           // class of the signal, without namespaces
+    std::string instrument;
+    size_t stateBytes;          // state vector and state names
+    size_t ownedBytes;          // IMemoryAccountable::getHeapFootprint, 0 if not implemented
+    bool bAccountable;
+};
+
+/// Memory used by a set of built signals, aggregated by signal type and by instrument, with
+/// optional soft budgets.
+///
+/// Budgets only warn: checkBudgets writes a line for each one exceeded, so a slow leak shows up
+/// in the logs with the signal type and instrument responsible long before the process runs
+/// out of memory.  Measuring walks every signal's containers and must run on the thread that
+/// drives them.
+class SignalMemoryReport : private boost::noncopyable
+{
+public:
+    SignalMemoryReport();
+
+    void add(const ISignalPtr &signal);
+    void add(const std::vector<ISignalPtr> &signals);
+
+    /// Soft budgets in bytes; 0, the default, means none.
+    void setSignalBudget(size_t bytes) { m_signalBudget = bytes; }
+    void setTypeBudget(const std::string &type, size_t bytes) { m_typeBudgets[type] = bytes; }
+    void setInstrumentBudget(size_t bytes) { m_instrumentBudget = bytes; }
+    void setTotalBudget(size_t bytes) { m_totalBudget = bytes; }
+
+    std::vector<SignalFootprint> measure() const;
+
+    /// Measures, then writes a warning to o for every budget exceeded and returns how many.
+    size_t checkBudgets(std::ostream &o) const;
+
+    /// Totals by type and by instrument, largest first, then the topN largest signals.
+    void printReport(std::ostream &o, size_t topN = 20) const;
+
+    /// Runs checkBudgets to std::cerr every period of cm's clock.
+    void schedulePeriodicCheck(const ClockMonitorPtr &cm, const ptime_duration_t &period);
+
+    /// Bytes of a signal's state vector and state names.  Does not read the state, so it never
+    /// makes the signal recompute.
+    static size_t stateFootprint(const ISignal &signal);
+
+private:
+    typedef std::map<std::string, std::pair<size_t, size_t> > totals_t;  // key -> (bytes, count)
+
+    static void addTo(totals_t &totals, const std::string &key, size_t bytes);
+    void onTimer(const timeval_t &ctv, const timeval_t &swtv);
+
+    std::vector<ISignalPtr> m_signals;
+    size_t m_signalBudget;
+    size_t m_instrumentBudget;
+    size_t m_totalBudget;
+    std::map<std::string, size_t> m_typeBudgets;
+
+    ClockMonitorPtr m_spCM;
+    Subscription m_subTimer;
+    ptime_duration_t m_period;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALMEMORY_H
@@ -0,0 +1,180 @@
+#include <longbeach/signals/SignalStatePublisher.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace longbeach {
+namespace signals {
+
+/************************************************************************************************/
+// SeqlockDoubleBuffer
+/************************************************************************************************/
+
+SeqlockDoubleBuffer::SeqlockDoubleBuffer(size_t numWords)
+    : m_numWords(numWords)
+    , m_writeSeq(0)
+    , m_version(0)
+    , m_numRetries(0)
+{
+    // whole cache lines per slot, so that the two slots never share one
+    const size_t bytes = ((m_numWords + 1) * sizeof(uint64_t) + LONGBEACH_CACHE_LINE_SIZE - 1)
+        / LONGBEACH_CACHE_LINE_SIZE * LONGBEACH_CACHE_LINE_SIZE;
+    for(size_t s = 0; s < 2; ++s)
+    {
+        void *p = NULL;
+        if(posix_memalign(&p, LONGBEACH_CACHE_LINE_SIZE, bytes) != 0)
+            throw std::bad_alloc();
+        m_slots[s].words = static_cast<std::atomic<uint64_t>*>(p);
+        for(size_t i = 0; i <= m_numWords; ++i)
+            new (&m_slots[s].words[i]) std::atomic<uint64_t>(0);
+    }
+}
+
+std::atomic<uint64_t> *SeqlockDoubleBuffer::beginWrite()
+{
+    const uint64_t version = m_version.load(std::memory_order_relaxed) + 1;
+    Slot &slot = m_slots[version & 1];
+
+    m_writeSeq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(m_writeSeq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.words[0].store(version, std::memory_order_relaxed);
+    return &slot.words[1];
+}
+
+void SeqlockDoubleBuffer::endWrite()
+{
+    const uint64_t version = m_version.load(std::memory_order_relaxed) + 1;
+    m_slots[version & 1].seq.store(m_writeSeq + 2, std::memory_order_release);
+    m_version.store(version, std::memory_order_release);
+}
+
+namespace {
+
+struct WordCopy
+{
+    explicit WordCopy(uint64_t *out) : m_out(out) {}
+    void operator()(size_t i, uint64_t w) { m_out[i] = w; }
+    uint64_t *m_out;
+};
+
+} // anonymous namespace
+
+uint64_t SeqlockDoubleBuffer::read(uint64_t *out) const
+{
+    WordCopy copy(out);
+    return read(copy);
+}
+
+uint64_t SeqlockDoubleBuffer::tryRead(uint64_t *out, size_t maxAttempts) const
+{
+    WordCopy copy(out);
+    return tryRead(copy, maxAttempts);
+}
+
+void SeqlockDoubleBuffer::storeDouble(std::atomic<uint64_t> &w, double d)
+{
+    uint64_t v;
+    std::memcpy(&v, &d, sizeof(v));
+    w.store(v, std::memory_order_relaxed);
+}
+
+double SeqlockDoubleBuffer::loadDouble(uint64_t w)
+{
+    double d;
+    std::memcpy(&d, &w, sizeof(d));
+    return d;
+}
+
+void SeqlockDoubleBuffer::storeTv(std::atomic<uint64_t> *w, const timeval_t &tv)
+{
+    // timeval_t is plain data; copy it word by word
+    uint64_t words[TvWords] = {};
+    std::memcpy(words, &tv, sizeof(timeval_t));
+    for(size_t i = 0; i < TvWords; ++i)
+        w[i].store(words[i], std::memory_order_relaxed);
+}
+
+timeval_t SeqlockDoubleBuffer::loadTv(const uint64_t *w)
+{
+    timeval_t tv;
+    std::memcpy(static_cast<void*>(&tv), w, sizeof(timeval_t));
+    return tv;
+}
+
+/************************************************************************************************/
+// SignalStatePublisher
+/************************************************************************************************/
+
+namespace {
+// word layout of a SignalStatePublisher buffer
+const size_t IsOKWord = 0;
+const size_t TvWord   = 1;
+const size_t StateWord = TvWord + SeqlockDoubleBuffer::TvWords;
+}
+
+SignalStatePublisher::SignalStatePublisher(size_t stateSize)
+    : m_stateSize(stateSize)
+    , m_buffer(StateWord + stateSize)
+{
+}
+
+void SignalStatePublisher::publish(const std::vector<double> &state, bool isOK, const timeval_t &lastChangeTv)
+{
+    std::atomic<uint64_t> *w = m_buffer.beginWrite();
+    w[IsOKWord].store(isOK, std::memory_order_relaxed);
+    SeqlockDoubleBuffer::storeTv(w + TvWord, lastChangeTv);
+
+    const size_t n = std::min(state.size(), m_stateSize);
+    for(size_t i = 0; i < n; ++i)
+        SeqlockDoubleBuffer::storeDouble(w[StateWord + i], state[i]);
+    for(size_t i = n; i < m_stateSize; ++i)
+        SeqlockDoubleBuffer::storeDouble(w[StateWord + i], 0.0);
+    m_buffer.endWrite();
+}
+
+namespace {
+
+/// Decodes a SignalStatePublisher buffer word by word into a snapshot.
+struct SnapshotCopy
+{
+    explicit SnapshotCopy(SignalStateSnapshot &out) : m_out(out), m_isOK(0)
+    {
+        std::fill(m_tv, m_tv + SeqlockDoubleBuffer::TvWords, 0);
+    }
+
+    void operator()(size_t i, uint64_t w)
+    {
+        if(i >= StateWord)
+            m_out.state[i - StateWord] = SeqlockDoubleBuffer::loadDouble(w);
+        else if(i >= TvWord)
+            m_tv[i - TvWord] = w;
+        else
+            m_isOK = w;
+    }
+
+    SignalStateSnapshot &m_out;
+    uint64_t m_isOK;
+    uint64_t m_tv[SeqlockDoubleBuffer::TvWords];
+};
+
+} // anonymous namespace
+
+bool SignalStatePublisher::read(SignalStateSnapshot &out) const
+{
+    out.state.resize(m_stateSize);
+    SnapshotCopy copy(out);
+    const uint64_t version = m_buffer.read(copy);
+    if(version == 0)
+        return false;
+
+    out.version = version;
+    out.isOK = copy.m_isOK != 0;
+    out.lastChangeTv = SeqlockDoubleBuffer::loadTv(copy.m_tv);
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,169 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALSTATEPUBLISHER_H
+#define LONGBEACH_SIGNALS_SIGNALSTATEPUBLISHER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/signals/ShardQueue.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Seqlock-protected double buffer of plain 64-bit words, for one writer thread and any number
+/// of reader threads.
+///
+/// There are two slots, each guarded by its own sequence counter.  The writer always fills the
+/// slot readers were not directed to by the last publish, so it never waits and readers only
+/// retry if the writer laps them twice during one copy.  Every word is a relaxed atomic so that
+/// a torn read is detected by the sequence check rather than being a data race.  Each slot's
+/// words start on a cache line of their own, so the writer filling one slot never shares a
+/// line with readers copying the other.
+class SeqlockDoubleBuffer
+    : public CacheAligned
+    , private boost::noncopyable
+{
+public:
+    /// Number of words a timeval_t takes up.
+    static const size_t TvWords = (sizeof(timeval_t) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    explicit SeqlockDoubleBuffer(size_t numWords);
+
+    /// Writer side: returns the numWords words to fill (with relaxed stores), which become
+    /// visible to readers at endWrite().
+    std::atomic<uint64_t> *beginWrite();
+    void endWrite();
+
+    /// Reader side: copies a consistent set of numWords words into out and returns their
+    /// version, or returns 0 if nothing has been published yet.  Lock-free but not wait-free:
+    /// it retries for as long as the writer keeps tearing its copy.
+    uint64_t read(uint64_t *out) const;
+
+    /// Reader side, without an intermediate copy: calls store(i, word) for each of the
+    /// numWords words in order and returns their version, or 0 if nothing has been published
+    /// yet.  If the copy is torn the words are stored again, so only what is stored by the
+    /// last round counts.
+    template<typename StoreT>
+    uint64_t read(StoreT &store) const { return tryRead(store, 0); }
+
+    /// What tryRead returns when every attempt was torn.
+    static const uint64_t Busy = ~uint64_t(0);
+
+    /// Reader side, wait-free: as read, but copies at most maxAttempts times and returns Busy
+    /// if every copy was torn, in which case what was stored is not a consistent set.  0
+    /// attempts is no bound, as read.
+    uint64_t tryRead(uint64_t *out, size_t maxAttempts) const;
+    template<typename StoreT>
+    uint64_t tryRead(StoreT &store, size_t maxAttempts) const;
+
+    /// Version of the last publish, 0 if none; incremented by one on each publish.
+    uint64_t getVersion() const { return m_version.load(std::memory_order_acquire); }
+    size_t getNumWords() const { return m_numWords; }
+
+    /// Number of times a reader had to retry, for diagnostics.
+    uint64_t getNumRetries() const { return m_numRetries.load(std::memory_order_relaxed); }
+
+    static void storeDouble(std::atomic<uint64_t> &w, double d);
+    static double loadDouble(uint64_t w);
+    static void storeTv(std::atomic<uint64_t> *w, const timeval_t &tv);
+    static timeval_t loadTv(const uint64_t *w);
+
+private:
+    struct alignas(LONGBEACH_CACHE_LINE_SIZE) Slot
+    {
+        Slot() : seq(0), words(NULL) {}
+        ~Slot() { free(words); }
+        std::atomic<uint64_t> seq;                      // odd while the writer is filling the slot
+        std::atomic<uint64_t> *words;                   // cache-line aligned, whole lines
+    };
+
+    size_t m_numWords;      // payload words; each slot has one more, for its version
+    Slot m_slots[2];
+    uint64_t m_writeSeq;    // writer only: sequence of the slot being filled
+
+    alignas(LONGBEACH_CACHE_LINE_SIZE) std::atomic<uint64_t> m_version;
+    alignas(LONGBEACH_CACHE_LINE_SIZE) mutable std::atomic<uint64_t> m_numRetries;
+};
+
+template<typename StoreT>
+uint64_t SeqlockDoubleBuffer::tryRead(StoreT &store, size_t maxAttempts) const
+{
+    for(size_t attempt = 0; maxAttempts == 0 || attempt < maxAttempts; ++attempt)
+    {
+        const uint64_t latest = m_version.load(std::memory_order_acquire);
+        if(latest == 0)
+            return 0;
+        const Slot &slot = m_slots[latest & 1];
+
+        const uint64_t seq0 = slot.seq.load(std::memory_order_acquire);
+        if(seq0 & 1)
+        {
+            m_numRetries.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // the slot may hold a newer version than the one that sent us here; the copy is still
+        // consistent as long as the sequence did not move, and carries its own version
+        const uint64_t version = slot.words[0].load(std::memory_order_relaxed);
+        for(size_t i = 0; i < m_numWords; ++i)
+            store(i, slot.words[i + 1].load(std::memory_order_relaxed));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(slot.seq.load(std::memory_order_relaxed) == seq0)
+            return version;
+        m_numRetries.fetch_add(1, std::memory_order_relaxed);
+    }
+    return Busy;
+}
+
+/// A consistent copy of a signal's published state.
+struct SignalStateSnapshot
+{
+    SignalStateSnapshot() : isOK(false), version(0) {}
+
+    std::vector<double> state;
+    bool isOK;
+    timeval_t lastChangeTv;
+    uint64_t version;       // 1 for the first publish, incremented on each one after
+};
+
+/// Publishes (state, isOK, lastChangeTv) from the thread that owns a signal to readers on any
+/// other thread, without locks, through a SeqlockDoubleBuffer.
+class SignalStatePublisher
+    : public CacheAligned
+    , private boost::noncopyable
+{
+public:
+    explicit SignalStatePublisher(size_t stateSize);
+
+    /// Writer side; one thread only.  A state longer than stateSize is truncated, a shorter one
+    /// padded with zeroes.
+    void publish(const std::vector<double> &state, bool isOK, const timeval_t &lastChangeTv);
+
+    /// Reader side; any thread.  Returns false if nothing has been published yet.  Copies
+    /// straight into out, which allocates only the first time it is read into.
+    bool read(SignalStateSnapshot &out) const;
+
+    /// Version of the last publish, 0 if none.
+    uint64_t getVersion() const { return m_buffer.getVersion(); }
+
+    size_t getStateSize() const { return m_stateSize; }
+
+    /// Number of times a reader had to retry, for diagnostics.
+    uint64_t getNumRetries() const { return m_buffer.getNumRetries(); }
+
+private:
+    size_t m_stateSize;
+    SeqlockDoubleBuffer m_buffer;   // isOK, timeval, state
+};
+LONGBEACH_DECLARE_SHARED_PTR(SignalStatePublisher);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALSTATEPUBLISHER_H
@@ -0,0 +1,82 @@
+#include <longbeach/signals/SignalStateStore.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/ShardQueue.h>
+
+namespace longbeach {
+namespace signals {
+
+SignalStateStore::SignalStateStore(size_t maxValues)
+    : m_maxValues(maxValues)
+    , m_numValues(0)
+    , m_pValues(NULL)
+    , m_offsets(1, 0)
+{
+    if(m_maxValues >= size_t(column_t(-1)))
+        LONGBEACH_THROW_ERROR_SS("SignalStateStore: " << m_maxValues << " values do not fit a column index");
+    void *p = NULL;
+    if(posix_memalign(&p, LONGBEACH_CACHE_LINE_SIZE, std::max<size_t>(m_maxValues, 1) * sizeof(double)) != 0)
+        throw std::bad_alloc();
+    m_pValues = static_cast<double*>(p);
+    std::memset(m_pValues, 0, m_maxValues * sizeof(double));
+}
+
+SignalStateStore::~SignalStateStore()
+{
+    free(m_pValues);
+}
+
+size_t SignalStateStore::add(const ISignal *sig)
+{
+    if(!sig)
+        LONGBEACH_THROW_ERROR_SS("SignalStateStore: null signal");
+    const size_t n = sig->getStateSize();
+    if(m_numValues + n > m_maxValues)
+        LONGBEACH_THROW_ERROR_SS("SignalStateStore: no room for the " << n << " values of " << sig->getDesc()
+            << "; " << m_numValues << " of " << m_maxValues << " used");
+    m_numValues += n;
+    m_offsets.push_back(m_numValues);
+    m_signals.push_back(sig);
+    m_ok.push_back(0);
+    m_lastChangeTvs.push_back(timeval_t());
+    m_versions.push_back(0);
+    return m_signals.size() - 1;
+}
+
+SignalStateStore::column_t SignalStateStore::getColumn(size_t id, size_t stateIdx) const
+{
+    if(id >= m_signals.size())
+        LONGBEACH_THROW_ERROR_SS("SignalStateStore: no signal " << id);
+    if(stateIdx >= getStateSize(id))
+        LONGBEACH_THROW_ERROR_SS("SignalStateStore: " << m_signals[id]->getDesc() << " has no state " << stateIdx);
+    return column_t(m_offsets[id] + stateIdx);
+}
+
+void SignalStateStore::gather(const column_t *cols, size_t n, double *out) const
+{
+    const double *__restrict values = m_pValues;
+    for(size_t i = 0; i < n; ++i)
+        out[i] = values[cols[i]];
+}
+
+void SignalStateStore::write(size_t id, const std::vector<double> &state, bool isOK, const timeval_t &lastChangeTv)
+{
+    double *row = m_pValues + m_offsets[id];
+    const size_t n = getStateSize(id);
+    const size_t m = std::min(n, state.size());
+    if(m)
+        std::memcpy(row, &state[0], m * sizeof(double));
+    if(m < n)
+        std::memset(row + m, 0, (n - m) * sizeof(double));
+    m_ok[id] = isOK;
+    m_lastChangeTvs[id] = lastChangeTv;
+    ++m_versions[id];
+}
+
+} // namespace signals
+} // namespace longbeach
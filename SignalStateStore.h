@@ -0,0 +1,83 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALSTATESTORE_H
+#define LONGBEACH_SIGNALS_SIGNALSTATESTORE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/EventDist.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+/// One contiguous slab holding the states of many signals, for consumers that read thousands
+/// of signal values per decision.
+///
+/// Each signal added gets a row of getStateSize() doubles.  Rows are packed back to back, in
+/// the order signals were added, from a cache-line aligned base that never moves.  isOK, last
+/// change time and a version live in parallel arrays indexed by the same id.  A signal attached
+/// with EvalEngineNode::attachStateStore copies its state into its row each time it notifies
+/// (after any batching by its engine), so the slab holds every signal's state as of its last
+/// notification.  Consumers resolve the values they need to columns once, with getColumn, and
+/// then read them with get, getRow or gather without touching the signals.
+///
+/// The store is not thread-safe: its signals and readers must run on one thread, e.g. one
+/// store per shard.  Readers on other threads go through SignalStatePublisher.
+class SignalStateStore : private boost::noncopyable
+{
+public:
+    /// Flat index of one value in the slab.
+    typedef uint32_t column_t;
+
+    /// maxValues bounds the total state size of all the signals added.
+    explicit SignalStateStore(size_t maxValues);
+    ~SignalStateStore();
+
+    /// Gives sig a row and returns its id.  Throws if the slab has no room left.
+    size_t add(const ISignal *sig);
+
+    size_t getNumSignals() const { return m_signals.size(); }
+    size_t getNumValues() const { return m_numValues; }
+    const ISignal *getSignal(size_t id) const { return m_signals[id]; }
+    size_t getStateSize(size_t id) const { return m_offsets[id + 1] - m_offsets[id]; }
+
+    /// Column of value stateIdx of signal id; throws if either is out of range.
+    column_t getColumn(size_t id, size_t stateIdx) const;
+
+    double get(column_t col) const { return m_pValues[col]; }
+    const double *getRow(size_t id) const { return m_pValues + m_offsets[id]; }
+    const double *getValues() const { return m_pValues; }
+
+    bool isOK(size_t id) const { return m_ok[id] != 0; }
+    const timeval_t &getLastChangeTv(size_t id) const { return m_lastChangeTvs[id]; }
+
+    /// Number of writes to the row so far; 0 until the signal first notifies.
+    uint64_t getVersion(size_t id) const { return m_versions[id]; }
+
+    /// out[i] = get(cols[i]) for i < n.  A plain indexed load loop, which compilers turn into
+    /// vector gathers where the target has them.
+    void gather(const column_t *cols, size_t n, double *out) const;
+
+    /// Writer side, called on notification.  A state longer than the row is truncated, a
+    /// shorter one padded with zeroes.
+    void write(size_t id, const std::vector<double> &state, bool isOK, const timeval_t &lastChangeTv);
+
+private:
+    size_t m_maxValues;
+    size_t m_numValues;
+    double *m_pValues;
+    std::vector<size_t> m_offsets;      // row of id is [m_offsets[id], m_offsets[id + 1])
+    std::vector<const ISignal*> m_signals;
+    std::vector<uint8_t> m_ok;
+    std::vector<timeval_t> m_lastChangeTvs;
+    std::vector<uint64_t> m_versions;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SignalStateStore);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALSTATESTORE_H
@@ -0,0 +1,109 @@
+#include <longbeach/signals/SignalWarmup.h>
+
+#include <iomanip>
+#include <ostream>
+
+#include <boost/bind.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/LatencyHistogram.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+
+namespace longbeach {
+namespace signals {
+
+SignalWarmup::SignalWarmup(ShardedSignalEngine &engine, const std::vector<ISignalPtr> &signals)
+    : m_engine(engine)
+    , m_pStep(NULL)
+    , m_report(engine.getNumShards())
+    , m_startNs(engine.getNumShards(), 0)
+    , m_errors(engine.getNumShards())
+    , m_wallNs(0)
+{
+    for(size_t i = 0; i < signals.size(); ++i)
+    {
+        ++m_report[m_engine.getShardOf(i)].numSignals;
+        if(EvalEngineNode *node = dynamic_cast<EvalEngineNode*>(signals[i].get()))
+            m_nodes.push_back(node);
+    }
+}
+
+SignalWarmup::~SignalWarmup()
+{
+    setSuppressed(false);
+}
+
+void SignalWarmup::setSuppressed(bool suppress)
+{
+    for(size_t i = 0; i < m_nodes.size(); ++i)
+        m_nodes[i]->suppressNotifications(suppress);
+}
+
+bool SignalWarmup::step(size_t shard)
+{
+    ShardReport &r = m_report[shard];
+    const uint64_t t0 = SignalLatencyProfiler::now();
+    if(!r.numSteps)
+        m_startNs[shard] = t0;
+    ++r.numSteps;
+
+    bool more = false;
+    try
+    {
+        more = (*m_pStep)(shard);
+    }
+    catch(const std::exception &e)
+    {
+        // an exception would take the shard's thread, and the process, down with it
+        m_errors[shard] = e.what();
+    }
+    catch(...)
+    {
+        m_errors[shard] = "unknown exception";
+    }
+    r.wallNs = SignalLatencyProfiler::now() - m_startNs[shard];
+    return more;
+}
+
+void SignalWarmup::run(const ShardedSignalEngine::event_loop_step_t &step)
+{
+    for(size_t s = 0; s < m_report.size(); ++s)
+    {
+        m_report[s].numSteps = 0;
+        m_report[s].wallNs = 0;
+        m_errors[s].clear();
+    }
+
+    // the signals are driven only by the shard threads, which are not running yet
+    setSuppressed(true);
+    m_pStep = &step;
+    const uint64_t t0 = SignalLatencyProfiler::now();
+    m_engine.run(boost::bind(&SignalWarmup::step, this, _1));
+    m_wallNs = SignalLatencyProfiler::now() - t0;
+    m_pStep = NULL;
+    setSuppressed(false);
+
+    for(size_t s = 0; s < m_errors.size(); ++s)
+        if(!m_errors[s].empty())
+            LONGBEACH_THROW_ERROR_SS("SignalWarmup: shard " << s << " failed: " << m_errors[s]);
+}
+
+void SignalWarmup::printReport(std::ostream &o) const
+{
+    o << "signal warmup: " << m_report.size() << " shards in "
+      << std::fixed << std::setprecision(3) << m_wallNs / 1e9 << "s" << std::endl;
+    for(size_t s = 0; s < m_report.size(); ++s)
+    {
+        const ShardReport &r = m_report[s];
+        o << "  shard " << std::setw(3) << s
+          << "  signals=" << std::setw(6) << r.numSignals
+          << "  steps=" << std::setw(10) << r.numSteps
+          << "  " << std::setprecision(3) << r.wallNs / 1e9 << "s";
+        if(!m_errors[s].empty())
+            o << "  FAILED: " << m_errors[s];
+        o << std::endl;
+    }
+}
+
+} // namespace signals
+} // namespace longbeach
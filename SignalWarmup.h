@@ -0,0 +1,81 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALWARMUP_H
+#define LONGBEACH_SIGNALS_SIGNALWARMUP_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/signals/ShardedSignalEngine.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+class EvalEngineNode;
+
+/// Brings freshly built signals up to date by replaying recent history before they go live.
+///
+/// Every shard of a ShardedSignalEngine replays its own instruments' history (typically a
+/// MarketDataReplay per shard, started at now minus the warmup period) on its own thread, so
+/// the warmup takes as long as the slowest shard rather than the sum of all of them.  While it
+/// runs, notifications of the signals are suppressed: their windows, candles and filters take
+/// in the history, but nothing downstream (listeners, eval engine, publishers, observers) sees
+/// it.  When run() returns the signals notify again, and the caller wires the shards to their
+/// live feeds and calls ShardedSignalEngine::run with the live step.  The first live input of
+/// each signal is its first notification.
+///
+/// A warmup is not a measurement: replay with MarketDataReplay::run(maxRecords, false), so
+/// that the shards do not time every handler of the history into SignalLatencyProfiler.
+///
+/// Signals that are not EvalEngineNodes cannot be muted and notify during the warmup as usual.
+class SignalWarmup : private boost::noncopyable
+{
+public:
+    struct ShardReport
+    {
+        ShardReport() : numSignals(0), numSteps(0), wallNs(0) {}
+
+        size_t numSignals;      // signals built on the shard
+        uint64_t numSteps;      // replay steps until the shard's step returned false
+        uint64_t wallNs;        // from the shard's first step to its last
+    };
+
+    /// signals are the result of engine.build(), in the same order.
+    SignalWarmup(ShardedSignalEngine &engine, const std::vector<ISignalPtr> &signals);
+
+    /// Unmutes the signals if run() did not get to.
+    ~SignalWarmup();
+
+    /// Runs step on every shard in parallel until each returns false, with the signals'
+    /// notifications suppressed.  A shard whose step throws stops there; once every shard is
+    /// done the signals are unmuted and the first failure is rethrown.
+    void run(const ShardedSignalEngine::event_loop_step_t &step);
+
+    const std::vector<ShardReport> &getReport() const { return m_report; }
+
+    /// Wall time of the whole warmup, i.e. of the slowest shard plus thread start-up.
+    uint64_t getWallNs() const { return m_wallNs; }
+
+    void printReport(std::ostream &o) const;
+
+private:
+    bool step(size_t shard);
+    void setSuppressed(bool suppress);
+
+    ShardedSignalEngine &m_engine;
+    const ShardedSignalEngine::event_loop_step_t *m_pStep;
+    std::vector<EvalEngineNode*> m_nodes;
+
+    // per shard, each written only by that shard's thread during run()
+    std::vector<ShardReport> m_report;
+    std::vector<uint64_t> m_startNs;
+    std::vector<std::string> m_errors;
+    uint64_t m_wallNs;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALWARMUP_H
@@ -0,0 +1,156 @@
+#include <longbeach/signals/Signals_LazyScripting.h>
+
+#include <cstring>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/core/LuabindScripting.h>
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/SampleAndHoldSignal.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SigDiff.h>
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SigLastTradedQuantity.h>
+#include <longbeach/signals/SigMA.h>
+#include <longbeach/signals/SigMACD.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+typedef bool (*register_fn_t)(lua_State &);
+
+struct LazySpecClass
+{
+    const char *globalName;
+    register_fn_t registerFn;
+};
+
+// each Spec class must be listed here under every global name its registerScripting defines
+const LazySpecClass LazySpecClasses[] = {
+    { "SigBookSpec",                       &SigBookSpec::registerScripting },
+    { "SigBookBiasL2Spec",                 &SigBookBiasL2Spec::registerScripting },
+    { "SigBookSizeBiasSpec",               &SigBookSizeBiasSpec::registerScripting },
+    { "SigLastTradedQuantitySpec",         &SigLastTradedQuantitySpec::registerScripting },
+    { "SigBaselineLastTradedQuantitySpec", &SigBaselineLastTradedQuantitySpec::registerScripting },
+    { "SampleAndHoldSignalSpec",           &SampleAndHoldSignalSpec::registerScripting },
+    { "AsyncSignalSpec",                   &AsyncSignalSpec::registerScripting },
+    { "SigMASpec",                         &SigMASpec::registerScripting },
+    { "SigMA",                             &SigMASpec::registerScripting },
+    { "SigMACDSpec",                       &SigMACDSpec::registerScripting },
+    { "SigMACD",                           &SigMACDSpec::registerScripting },
+    { "SigDiffSpec",                       &SigDiffSpec::registerScripting },
+    { "SigDiff",                           &SigDiffSpec::registerScripting },
+    { "SigKalmanFilterSpec",               &SigKalmanFilterSpec::registerScripting },
+    { "SigKalmanFilter",                   &SigKalmanFilterSpec::registerScripting },
+};
+const size_t NumLazySpecClasses = sizeof(LazySpecClasses) / sizeof(LazySpecClasses[0]);
+
+const LazySpecClass *findLazySpecClass(const char *name)
+{
+    for(size_t i = 0; i < NumLazySpecClasses; ++i)
+        if(std::strcmp(LazySpecClasses[i].globalName, name) == 0)
+            return &LazySpecClasses[i];
+    return NULL;
+}
+
+void pushGlobals(lua_State *L)
+{
+#if LUA_VERSION_NUM >= 502
+    lua_pushglobaltable(L);
+#else
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+#endif
+}
+
+// registry key guarding against re-entry while a class is being registered
+const char *const InProgressKey = "longbeach::signals::LazyScripting::inProgress";
+
+/// __index(globals, key); upvalue 1 is the previous __index (or nil)
+int lazyGlobalsIndex(lua_State *L)
+{
+    if(lua_type(L, 2) == LUA_TSTRING)
+    {
+        const LazySpecClass *cls = findLazySpecClass(lua_tostring(L, 2));
+        if(cls)
+        {
+            lua_getfield(L, LUA_REGISTRYINDEX, InProgressKey);
+            const bool inProgress = lua_toboolean(L, -1);
+            lua_pop(L, 1);
+
+            if(!inProgress)
+            {
+                lua_pushboolean(L, 1);
+                lua_setfield(L, LUA_REGISTRYINDEX, InProgressKey);
+                bool ok = (*cls->registerFn)(*L);
+                lua_pushnil(L);
+                lua_setfield(L, LUA_REGISTRYINDEX, InProgressKey);
+                if(!ok)
+                    return luaL_error(L, "lazy registration of %s failed", cls->globalName);
+
+                lua_pushvalue(L, 2);
+                lua_rawget(L, 1);
+                if(!lua_isnil(L, -1))
+                    return 1;
+                lua_pop(L, 1);
+            }
+        }
+    }
+
+    // not a spec class: defer to whatever __index was there before us
+    switch(lua_type(L, lua_upvalueindex(1)))
+    {
+    case LUA_TFUNCTION:
+        lua_pushvalue(L, lua_upvalueindex(1));
+        lua_pushvalue(L, 1);
+        lua_pushvalue(L, 2);
+        lua_call(L, 2, 1);
+        return 1;
+    case LUA_TTABLE:
+        lua_pushvalue(L, 2);
+        lua_gettable(L, lua_upvalueindex(1));
+        return 1;
+    default:
+        lua_pushnil(L);
+        return 1;
+    }
+}
+
+} // anonymous namespace
+
+bool registerScriptingLazily(lua_State &state)
+{
+    lua_State *L = &state;
+    pushGlobals(L);                             // G
+    if(!lua_getmetatable(L, -1))                // G mt?
+    {
+        lua_newtable(L);                        // G mt
+        lua_pushvalue(L, -1);                   // G mt mt
+        lua_setmetatable(L, -3);                // G mt
+    }
+    lua_getfield(L, -1, "__index");             // G mt oldIndex
+    lua_pushcclosure(L, &lazyGlobalsIndex, 1);  // G mt closure
+    lua_setfield(L, -2, "__index");             // G mt
+    lua_pop(L, 2);
+    return true;
+}
+
+bool registerSpecClassesEagerly(lua_State &state)
+{
+    register_fn_t last = NULL;
+    for(size_t i = 0; i < NumLazySpecClasses; ++i)
+    {
+        // aliases share a registration function with the class they follow
+        if(LazySpecClasses[i].registerFn == last)
+            continue;
+        last = LazySpecClasses[i].registerFn;
+        if(!(*last)(state))
+            return false;
+    }
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
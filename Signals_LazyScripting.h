@@ -0,0 +1,26 @@
+#ifndef LONGBEACH_SIGNALS_SIGNALS_LAZYSCRIPTING_H
+#define LONGBEACH_SIGNALS_SIGNALS_LAZYSCRIPTING_H
+
+struct lua_State;
+
+namespace longbeach {
+namespace signals {
+
+/// Lazy alternative to registering every signal spec class up front.
+///
+/// Installs an __index hook on the globals table of state.  The first time a script reads the
+/// global name of a spec class (e.g. "SigBookSpec", or an alias such as "SigMA"), the hook runs
+/// that class's registerScripting and returns the freshly bound class.  Classes a script never
+/// touches are never bound, which makes short-lived lua_States much cheaper to create.
+///
+/// SignalSpec and the other base classes must already be registered.  Any __index metamethod
+/// already installed on the globals is chained to for names that are not spec classes.
+bool registerScriptingLazily(lua_State &state);
+
+/// Registers every spec class handled by registerScriptingLazily immediately.
+bool registerSpecClassesEagerly(lua_State &state);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SIGNALS_LAZYSCRIPTING_H
@@ -0,0 +1,165 @@
+#include <longbeach/signals/SpecArchive.h>
+
+#include <longbeach/signals/SpecCache.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+// tags for nested signal specs
+const uint8_t NestedNull     = 0;
+const uint8_t NestedNative   = 1;
+const uint8_t NestedExternal = 2;
+}
+
+/************************************************************************************************/
+// SpecOutArchive
+/************************************************************************************************/
+
+void SpecOutArchive::write(const std::string &v)
+{
+    write(uint64_t(v.size()));
+    m_buffer.append(v);
+}
+
+uint32_t SpecOutArchive::internExternal(const std::string &text)
+{
+    std::map<std::string, uint32_t>::const_iterator it = m_externalIndex.find(text);
+    if(it != m_externalIndex.end())
+        return it->second;
+
+    uint32_t idx = m_externals.size();
+    m_externals.push_back(text);
+    m_externalIndex.insert(std::make_pair(text, idx));
+    return idx;
+}
+
+void SpecOutArchive::writeSignalSpecBase(const SignalSpec &spec)
+{
+    write(spec.m_description);
+    writeExternal(spec.m_refPxP);
+}
+
+void SpecOutArchive::writeSpec(const ISignalSpecCPtr &spec)
+{
+    if(!spec)
+    {
+        writeRaw(NestedNull);
+        return;
+    }
+
+    const IBinarySpec *bin = dynamic_cast<const IBinarySpec*>(spec.get());
+    if(bin)
+    {
+        writeRaw(NestedNative);
+        write(std::string(bin->binaryClassName()));
+        bin->writeBinary(*this);
+    }
+    else
+    {
+        writeRaw(NestedExternal);
+        writeExternal(spec);
+    }
+}
+
+/************************************************************************************************/
+// SpecInArchive
+/************************************************************************************************/
+
+SpecInArchive::SpecInArchive(const char *data, size_t size, const std::vector<std::string> &externals, lua_State &state)
+    : m_data(data)
+    , m_size(size)
+    , m_pos(0)
+    , m_externals(externals)
+    , m_pState(&state)
+{
+}
+
+namespace {
+const std::vector<std::string> &noExternals()
+{
+    static const std::vector<std::string> s_none;
+    return s_none;
+}
+}
+
+SpecInArchive::SpecInArchive(const char *data, size_t size)
+    : m_data(data)
+    , m_size(size)
+    , m_pos(0)
+    , m_externals(noExternals())
+    , m_pState(NULL)
+{
+}
+
+void SpecInArchive::read(std::string &v)
+{
+    uint64_t n;
+    read(n);
+    if(n > m_size - m_pos)
+        LONGBEACH_THROW_ERROR_SS("SpecInArchive: truncated string");
+    v.assign(m_data + m_pos, n);
+    m_pos += n;
+}
+
+void SpecInArchive::read(ptime_duration_t &v)
+{
+    int64_t ticks;
+    readRaw(ticks);
+    v = ptime_duration_t(0, 0, 0, ticks);
+}
+
+void SpecInArchive::readSignalSpecBase(SignalSpec &spec)
+{
+    read(spec.m_description);
+    readExternal(spec.m_refPxP);
+}
+
+ISignalSpecPtr SpecInArchive::readSpec()
+{
+    uint8_t tag;
+    readRaw(tag);
+    if(tag == NestedNull)
+        return ISignalSpecPtr();
+
+    if(tag == NestedNative)
+    {
+        std::string className;
+        read(className);
+        ISignalSpecPtr spec = SpecCache::createSpec(className);
+        dynamic_cast<IBinarySpec&>(*spec).readBinary(*this);
+        return spec;
+    }
+
+    if(tag != NestedExternal)
+        LONGBEACH_THROW_ERROR_SS("SpecInArchive: bad nested spec tag " << int(tag));
+    ISignalSpecPtr spec;
+    readExternal(spec);
+    return spec;
+}
+
+const luabind::object &SpecInArchive::resolveExternal(uint32_t idx)
+{
+    std::map<uint32_t, luabind::object>::const_iterator it = m_resolved.find(idx);
+    if(it != m_resolved.end())
+        return it->second;
+
+    if(!m_pState)
+        LONGBEACH_THROW_ERROR_SS("SpecInArchive: external value in a native-only record");
+    if(idx >= m_externals.size())
+        LONGBEACH_THROW_ERROR_SS("SpecInArchive: external index " << idx << " out of range");
+
+    const std::string chunk = "return " + m_externals[idx];
+    if(luaL_dostring(m_pState, chunk.c_str()) != 0)
+    {
+        std::string err = lua_tostring(m_pState, -1);
+        lua_pop(m_pState, 1);
+        LONGBEACH_THROW_ERROR_SS("SpecInArchive: failed to evaluate external value: " << err);
+    }
+    luabind::object obj(luabind::from_stack(m_pState, -1));
+    lua_pop(m_pState, 1);
+    return m_resolved.insert(std::make_pair(idx, obj)).first->second;
+}
+
+} // namespace signals
+} // namespace longbeach
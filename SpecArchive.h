@@ -0,0 +1,192 @@
+#ifndef LONGBEACH_SIGNALS_SPECARCHIVE_H
+#define LONGBEACH_SIGNALS_SPECARCHIVE_H
+
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/is_enum.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/core/LuaCodeGen.h>
+#include <longbeach/core/LuabindScripting.h>
+#include <longbeach/core/ptime.h>
+#include <longbeach/signals/SignalSpec.h>
+
+namespace longbeach {
+namespace signals {
+
+class SpecOutArchive;
+class SpecInArchive;
+
+/// Implemented by every spec class that can be written to the binary spec cache.
+/// The class name is the key the reader uses to find the matching factory (see SpecCache.cc).
+class IBinarySpec
+{
+public:
+    virtual ~IBinarySpec() {}
+    virtual const char *binaryClassName() const = 0;
+    virtual void writeBinary(SpecOutArchive &ar) const = 0;
+    virtual void readBinary(SpecInArchive &ar) = 0;
+};
+
+/// Binary writer for spec fields.
+///
+/// Fields owned by this library are written natively.  Sub-specs and values owned by other
+/// libraries (books, price providers, sources) are written as their Lua text, interned so that
+/// each distinct one is stored -- and later evaluated -- only once per cache file.
+class SpecOutArchive
+{
+public:
+    void write(bool v)              { writeRaw(v); }
+    void write(int32_t v)           { writeRaw(v); }
+    void write(uint32_t v)          { writeRaw(v); }
+    void write(int64_t v)           { writeRaw(v); }
+    void write(uint64_t v)          { writeRaw(v); }
+    void write(double v)            { writeRaw(v); }
+    void write(const std::string &v);
+    void write(const ptime_duration_t &v) { writeRaw(int64_t(v.ticks())); }
+    void write(const timeval_t &v)  { writeRaw(v); }
+
+    template<typename E>
+    typename boost::enable_if<boost::is_enum<E> >::type write(E v) { writeRaw(int32_t(v)); }
+
+    template<typename T>
+    void write(const std::vector<T> &v)
+    {
+        write(uint64_t(v.size()));
+        for(typename std::vector<T>::const_iterator it = v.begin(); it != v.end(); ++it)
+            write(*it);
+    }
+
+    /// Writes a value owned by another library through its Lua representation.
+    template<typename T>
+    void writeExternal(const T &v)
+    {
+        std::ostringstream os;
+        os << luaMode(v, LuaPrintSettings());
+        write(internExternal(os.str()));
+    }
+
+    template<typename T>
+    void writeExternal(const boost::shared_ptr<T> &p)
+    {
+        if(!p)
+            write(NullExternal);
+        else
+            writeExternal(*p);
+    }
+
+    /// Writes the members every SignalSpec carries.
+    void writeSignalSpecBase(const SignalSpec &spec);
+
+    /// Writes a nested signal spec, natively if it is an IBinarySpec.
+    void writeSpec(const ISignalSpecCPtr &spec);
+
+    const std::string &buffer() const { return m_buffer; }
+    const std::vector<std::string> &externals() const { return m_externals; }
+
+    static const uint32_t NullExternal = 0xffffffff;
+
+private:
+    template<typename T>
+    void writeRaw(const T &v) { m_buffer.append(reinterpret_cast<const char*>(&v), sizeof(T)); }
+
+    uint32_t internExternal(const std::string &text);
+
+    std::string m_buffer;
+    std::vector<std::string> m_externals;
+    std::map<std::string, uint32_t> m_externalIndex;
+};
+
+/// Binary reader matching SpecOutArchive.  External values are evaluated in the given
+/// lua_State the first time they are referenced and reused afterwards.
+class SpecInArchive
+{
+public:
+    SpecInArchive(const char *data, size_t size, const std::vector<std::string> &externals, lua_State &state);
+
+    /// Reader for records with native fields only (e.g. signal checkpoints); reading an
+    /// external value from it throws.
+    SpecInArchive(const char *data, size_t size);
+
+    void read(bool &v)              { readRaw(v); }
+    void read(int32_t &v)           { readRaw(v); }
+    void read(uint32_t &v)          { readRaw(v); }
+    void read(int64_t &v)           { readRaw(v); }
+    void read(uint64_t &v)          { readRaw(v); }
+    void read(double &v)            { readRaw(v); }
+    void read(std::string &v);
+    void read(ptime_duration_t &v);
+    void read(timeval_t &v)         { readRaw(v); }
+
+    template<typename E>
+    typename boost::enable_if<boost::is_enum<E> >::type read(E &v) { int32_t i; readRaw(i); v = E(i); }
+
+    template<typename T>
+    void read(std::vector<T> &v)
+    {
+        uint64_t n;
+        read(n);
+        if(n > m_size - m_pos)      // each element takes at least a byte
+            LONGBEACH_THROW_ERROR_SS("SpecInArchive: truncated vector");
+        v.resize(n);
+        for(typename std::vector<T>::iterator it = v.begin(); it != v.end(); ++it)
+            read(*it);
+    }
+
+    template<typename T>
+    void readExternal(T &v)
+    {
+        uint32_t idx;
+        read(idx);
+        if(idx == SpecOutArchive::NullExternal)
+            LONGBEACH_THROW_ERROR_SS("SpecInArchive: unexpected null external value");
+        v = luabind::object_cast<T>(resolveExternal(idx));
+    }
+
+    template<typename T>
+    void readExternal(boost::shared_ptr<T> &p)
+    {
+        uint32_t idx;
+        read(idx);
+        if(idx == SpecOutArchive::NullExternal)
+            p.reset();
+        else
+            p = luabind::object_cast<boost::shared_ptr<T> >(resolveExternal(idx));
+    }
+
+    void readSignalSpecBase(SignalSpec &spec);
+    ISignalSpecPtr readSpec();
+
+    size_t position() const { return m_pos; }
+    bool atEnd() const { return m_pos == m_size; }
+
+private:
+    template<typename T>
+    void readRaw(T &v)
+    {
+        if(m_pos + sizeof(T) > m_size)
+            LONGBEACH_THROW_ERROR_SS("SpecInArchive: truncated record");
+        std::memcpy(&v, m_data + m_pos, sizeof(T));
+        m_pos += sizeof(T);
+    }
+
+    const luabind::object &resolveExternal(uint32_t idx);
+
+    const char *m_data;
+    size_t m_size;
+    size_t m_pos;
+    const std::vector<std::string> &m_externals;
+    lua_State *m_pState;
+    std::map<uint32_t, luabind::object> m_resolved;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SPECARCHIVE_H
@@ -0,0 +1,169 @@
+#include <longbeach/signals/SpecCache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#include <longbeach/core/Error.h>
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/SampleAndHoldSignal.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SigDiff.h>
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SigLastTradedQuantity.h>
+#include <longbeach/signals/SigMA.h>
+#include <longbeach/signals/SigMACD.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+
+const char Magic[8] = { 'L', 'B', 'S', 'P', 'E', 'C', 'S', '\0' };
+
+template<typename T>
+ISignalSpecPtr createSpecT()
+{
+    return ISignalSpecPtr(new T());
+}
+
+typedef ISignalSpecPtr (*spec_factory_t)();
+typedef std::map<std::string, spec_factory_t> factory_map_t;
+
+// each Spec class that implements IBinarySpec must be added here
+const factory_map_t &getFactories()
+{
+    static factory_map_t factories;
+    if(factories.empty())
+    {
+        factories["SigBookSpec"]                       = &createSpecT<SigBookSpec>;
+        factories["SigBookBiasL2Spec"]                 = &createSpecT<SigBookBiasL2Spec>;
+        factories["SigBookSizeBiasSpec"]               = &createSpecT<SigBookSizeBiasSpec>;
+        factories["SigLastTradedQuantitySpec"]         = &createSpecT<SigLastTradedQuantitySpec>;
+        factories["SigBaselineLastTradedQuantitySpec"] = &createSpecT<SigBaselineLastTradedQuantitySpec>;
+        factories["SigMASpec"]                         = &createSpecT<SigMASpec>;
+        factories["SigMACDSpec"]                       = &createSpecT<SigMACDSpec>;
+        factories["SigDiffSpec"]                       = &createSpecT<SigDiffSpec>;
+        factories["SigKalmanFilterSpec"]               = &createSpecT<SigKalmanFilterSpec>;
+        factories["SampleAndHoldSignalSpec"]           = &createSpecT<SampleAndHoldSignalSpec>;
+        factories["AsyncSignalSpec"]                   = &createSpecT<AsyncSignalSpec>;
+    }
+    return factories;
+}
+
+size_t hashSpec(const ISignalSpec &spec)
+{
+    size_t h = 0;
+    spec.hashCombine(h);
+    return h;
+}
+
+} // anonymous namespace
+
+ISignalSpecPtr SpecCache::createSpec(const std::string &className)
+{
+    const factory_map_t &factories = getFactories();
+    factory_map_t::const_iterator it = factories.find(className);
+    if(it == factories.end())
+        LONGBEACH_THROW_ERROR_SS("SpecCache: unknown spec class " << className);
+    return (*it->second)();
+}
+
+void SpecCache::save(const std::string &path, uint64_t configKey, const std::vector<ISignalSpecCPtr> &specs)
+{
+    SpecOutArchive body;
+    for(std::vector<ISignalSpecCPtr>::const_iterator it = specs.begin(); it != specs.end(); ++it)
+    {
+        if(!dynamic_cast<const IBinarySpec*>(it->get()))
+            LONGBEACH_THROW_ERROR_SS("SpecCache: spec " << (*it)->getDescription() << " has no binary form");
+        body.write(uint64_t(hashSpec(**it)));
+        body.writeSpec(*it);
+    }
+
+    SpecOutArchive header;
+    header.write(Version);
+    header.write(configKey);
+    header.write(body.externals());
+    header.write(uint64_t(specs.size()));
+
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+        if(!out)
+            LONGBEACH_THROW_ERROR_SS("SpecCache: cannot open " << tmpPath << " for writing");
+        out.write(Magic, sizeof(Magic));
+        out.write(header.buffer().data(), header.buffer().size());
+        out.write(body.buffer().data(), body.buffer().size());
+        if(!out)
+            LONGBEACH_THROW_ERROR_SS("SpecCache: failed writing " << tmpPath);
+    }
+    // readers never see a half written cache
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        LONGBEACH_THROW_ERROR_SS("SpecCache: cannot rename " << tmpPath << " to " << path);
+}
+
+bool SpecCache::load(const std::string &path, uint64_t configKey, lua_State &state,
+                     std::vector<ISignalSpecPtr> &specs)
+{
+    specs.clear();
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if(!in)
+        return false;
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(data.size() < sizeof(Magic) || data.compare(0, sizeof(Magic), Magic, sizeof(Magic)) != 0)
+        return false;
+
+    // a cache that cannot be decoded is as good as a missing one: the caller falls back to Lua
+    try
+    {
+        std::vector<std::string> externals;
+        SpecInArchive header(data.data() + sizeof(Magic), data.size() - sizeof(Magic), externals, state);
+        uint32_t version;
+        uint64_t key;
+        header.read(version);
+        if(version != Version)
+            return false;
+        header.read(key);
+        if(key != configKey)
+            return false;
+        header.read(externals);
+        uint64_t numSpecs;
+        header.read(numSpecs);
+
+        const size_t bodyStart = sizeof(Magic) + header.position();
+
+        SpecInArchive body(data.data() + bodyStart, data.size() - bodyStart, externals, state);
+        // every record is at least its hash, so a corrupt count cannot reserve more than the file
+        specs.reserve(std::min<uint64_t>(numSpecs, (data.size() - bodyStart) / sizeof(uint64_t)));
+        for(uint64_t i = 0; i < numSpecs; ++i)
+        {
+            uint64_t hash;
+            body.read(hash);
+            ISignalSpecPtr spec = body.readSpec();
+            if(!spec)
+                LONGBEACH_THROW_ERROR_SS("null spec in record " << i);
+            spec->checkValid();
+            if(hashSpec(*spec) != hash)
+                LONGBEACH_THROW_ERROR_SS("spec " << spec->getDescription() << " does not match its recorded hash");
+            specs.push_back(spec);
+        }
+        if(!body.atEnd())
+            LONGBEACH_THROW_ERROR_SS("trailing data after " << numSpecs << " specs");
+    }
+    catch(const std::exception &e)
+    {
+        std::cerr << "SpecCache: " << path << ": " << e.what() << ", ignoring cache" << std::endl;
+        specs.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,42 @@
+#ifndef LONGBEACH_SIGNALS_SPECCACHE_H
+#define LONGBEACH_SIGNALS_SPECCACHE_H
+
+#include <string>
+#include <vector>
+
+#include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/SpecArchive.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Precompiled binary cache of a fully evaluated set of signal specs.
+///
+/// The file is keyed by a caller-supplied config key (typically a hash of the config files);
+/// when the key matches, load() rebuilds the specs without running the universe script.
+/// Each record carries the spec hash it was written with, and load() refuses the file if a
+/// decoded spec does not hash back to the same value.
+class SpecCache
+{
+public:
+    static const uint32_t Version = 4;
+
+    /// Writes specs to path.  Every spec must implement IBinarySpec.
+    static void save(const std::string &path, uint64_t configKey, const std::vector<ISignalSpecCPtr> &specs);
+
+    /// Reads specs written by save().  Returns false if the file is missing, or was written for
+    /// a different config key or format version; the caller then falls back to the Lua path.
+    /// A file that is truncated, corrupt or has data past its last spec is logged and also
+    /// gives false, never an exception.
+    /// state is used only to evaluate the sub-specs owned by other libraries.
+    static bool load(const std::string &path, uint64_t configKey, lua_State &state,
+                     std::vector<ISignalSpecPtr> &specs);
+
+    /// Creates an empty spec for one of the binaryClassName()s known to this library.
+    static ISignalSpecPtr createSpec(const std::string &className);
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SPECCACHE_H
@@ -0,0 +1,83 @@
+#ifndef LONGBEACH_SIGNALS_SPECHASHCACHE_H
+#define LONGBEACH_SIGNALS_SPECHASHCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <typeinfo>
+
+#include <longbeach/signals/SignalSpec.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Memoizes the hash of a spec once checkValid has passed, and gives compare() a cheap
+/// early-out on a hash mismatch between specs of the same class, before any dynamic_cast or
+/// member-by-member check.
+///
+/// SpecT must provide "void hashMembers(size_t &seed) const", which walks the full spec
+/// tree exactly as hashCombine used to.  Specs are treated as immutable after checkValid:
+/// nothing notices an edit made after it (from Lua, say), so the cached hash goes stale, and
+/// compare may reject a spec the edit made equal, until checkValid runs again.  Copies (and
+/// therefore clones) start uncached, since they are usually about to be edited.
+/// A sub-spec shared by several specs may be validated by several threads at once (see
+/// ParallelSignalBuild); they all cache the same hash, so the cache only has to be atomic.
+template<typename SpecT>
+class SpecHashCache
+{
+public:
+    /// Returns the hash of the spec, from the cache if checkValid has already passed.
+    size_t specHash() const
+    {
+        if( m_bHashCached.load( std::memory_order_acquire ) )
+            return m_hash.load( std::memory_order_relaxed );
+        return computeHash();
+    }
+
+    bool isHashCached() const { return m_bHashCached.load( std::memory_order_acquire ); }
+
+protected:
+    SpecHashCache() : m_bHashCached(false), m_hash(0) {}
+    SpecHashCache( const SpecHashCache& ) : m_bHashCached(false), m_hash(0) {}
+    SpecHashCache& operator=( const SpecHashCache& ) { clearHashCache(); return *this; }
+
+    /// Call at the end of checkValid, once the spec is known to be good.
+    void cacheHash() const
+    {
+        m_hash.store( computeHash(), std::memory_order_relaxed );
+        m_bHashCached.store( true, std::memory_order_release );
+    }
+
+    void clearHashCache() const { m_bHashCached.store( false, std::memory_order_relaxed ); }
+
+    /// Returns true if other is certainly not equal to this spec: it is NULL, or it is of
+    /// exactly this spec's class and both hashes are cached and differ.  A false result means a
+    /// full compare is needed; that includes a spec of another class, which compare's own
+    /// dynamic_cast accepts when it derives from this one, as it always has.
+    bool fastReject( const ISignalSpec *other ) const
+    {
+        if( !other )
+            return true;
+        const SpecT *self = static_cast<const SpecT*>(this);
+        if( typeid(*other) != typeid(*self) )
+            return false;
+        const SpecHashCache *b = static_cast<const SpecT*>(other);
+        return isHashCached() && b->isHashCached()
+            && m_hash.load( std::memory_order_relaxed ) != b->m_hash.load( std::memory_order_relaxed );
+    }
+
+private:
+    size_t computeHash() const
+    {
+        size_t seed = 0;
+        static_cast<const SpecT*>(this)->hashMembers( seed );
+        return seed;
+    }
+
+    mutable std::atomic<bool>   m_bHashCached;
+    mutable std::atomic<size_t> m_hash;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SPECHASHCACHE_H
@@ -0,0 +1,136 @@
+#include <longbeach/signals/SyntheticInputs.h>
+
+#include <algorithm>
+
+#include <boost/make_shared.hpp>
+
+#include <longbeach/clientcore/ClientCore_Scripting.h>
+#include <longbeach/clientcore/HistClientContext.h>
+#include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/Signals_LazyScripting.h>
+
+namespace longbeach {
+namespace signals {
+
+ClientContextPtr makeSyntheticClientContext(const timeval_t &start)
+{
+    return ClientContextPtr(new HistClientContext(start));
+}
+
+boost::shared_ptr<SignalBuilder> makeSyntheticBuilder(const ClientContextPtr &cc)
+{
+    return boost::make_shared<SignalBuilder>(cc);
+}
+
+lua_State *makeSyntheticLuaState()
+{
+    lua_State *L = luaL_newstate();
+    luabind::open(L);
+    registerClientCoreScripting(*L);
+    SignalSpec::registerScripting(*L);
+    registerSpecClassesEagerly(*L);
+    return L;
+}
+
+std::string syntheticBookSpecLua(const std::string &instr, const std::string &source)
+{
+    return "SourceBookSpec(instrument_t.fromString(\"" + instr + "\"), source_t.fromString(\"" + source + "\"))";
+}
+
+namespace {
+
+/// The levels of one side of a SyntheticBook, best first.
+class SyntheticLevelIter : public IBookLevelCIter
+{
+public:
+    explicit SyntheticLevelIter(const std::vector<BookLevelCPtr> &levels) : m_levels(levels), m_i(0) {}
+
+    virtual bool hasNext() const { return m_i < m_levels.size(); }
+    virtual BookLevelCPtr next() { return m_levels[m_i++]; }
+
+private:
+    const std::vector<BookLevelCPtr> m_levels;  // a copy: the book may change while iterated
+    size_t m_i;
+};
+
+void setSide(std::vector<BookLevelCPtr> &levels, const instrument_t &instr, side_t side,
+    const std::vector<double> &px, const std::vector<double> &sz)
+{
+    levels.clear();
+    for(size_t l = 0; l < px.size() && l < sz.size() && sz[l] > 0; ++l)
+        levels.push_back(boost::make_shared<BookLevel>(instr, side, px[l], sz[l]));
+}
+
+} // anonymous namespace
+
+SyntheticBook::SyntheticBook(const instrument_t &instr, const source_t &source)
+    : m_instr(instr)
+    , m_source(source)
+    , m_bOK(false)
+{
+}
+
+void SyntheticBook::set(const std::vector<double> &bidPx, const std::vector<double> &bidSz,
+    const std::vector<double> &askPx, const std::vector<double> &askSz,
+    bool ok, const timeval_t &tv, int32_t bidLevelChanged, int32_t askLevelChanged)
+{
+    setSide(m_levels[BID], m_instr, BID, bidPx, bidSz);
+    setSide(m_levels[ASK], m_instr, ASK, askPx, askSz);
+    m_bOK = ok;
+    m_lastChangeTv = tv;
+    // a copy, since a listener may remove itself
+    const std::vector<IBookListener*> listeners(m_listeners);
+    for(size_t i = 0; i < listeners.size(); ++i)
+        listeners[i]->onBookChanged(this, NULL, bidLevelChanged, askLevelChanged);
+}
+
+void SyntheticBook::flush(const timeval_t &tv)
+{
+    m_levels[BID].clear();
+    m_levels[ASK].clear();
+    m_bOK = false;
+    m_lastChangeTv = tv;
+    const std::vector<IBookListener*> listeners(m_listeners);
+    for(size_t i = 0; i < listeners.size(); ++i)
+        listeners[i]->onBookFlushed(this, NULL);
+}
+
+double SyntheticBook::getMidPrice() const
+{
+    if(m_levels[BID].empty() || m_levels[ASK].empty())
+        return 0.0;
+    return (m_levels[BID][0]->getPrice() + m_levels[ASK][0]->getPrice()) / 2;
+}
+
+PriceSize SyntheticBook::getNthSide(size_t depth, side_t side) const
+{
+    if(depth >= m_levels[side].size())
+        return PriceSize();
+    return PriceSize(m_levels[side][depth]->getPrice(), m_levels[side][depth]->getSize());
+}
+
+IBookLevelCIterPtr SyntheticBook::getBookLevelIter(side_t side) const
+{
+    return IBookLevelCIterPtr(new SyntheticLevelIter(m_levels[side]));
+}
+
+bool SyntheticBook::addBookListener(IBookListener *listener)
+{
+    if(std::find(m_listeners.begin(), m_listeners.end(), listener) != m_listeners.end())
+        return false;
+    m_listeners.push_back(listener);
+    return true;
+}
+
+bool SyntheticBook::removeBookListener(IBookListener *listener)
+{
+    std::vector<IBookListener*>::iterator it = std::find(m_listeners.begin(), m_listeners.end(), listener);
+    if(it == m_listeners.end())
+        return false;
+    m_listeners.erase(it);
+    return true;
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,109 @@
+#ifndef LONGBEACH_SIGNALS_SYNTHETICINPUTS_H
+#define LONGBEACH_SIGNALS_SYNTHETICINPUTS_H
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/core/LuabindScripting.h>
+
+#include <longbeach/clientcore/BookLevel.h>
+#include <longbeach/clientcore/ClientContext.h>
+#include <longbeach/clientcore/IBook.h>
+#include <longbeach/clientcore/PriceProvider.h>
+
+namespace longbeach {
+namespace signals {
+
+class SignalBuilder;
+
+/// A ClientContext of its own, on a historical clock starting at start and with no feed
+/// attached, for running real signals outside of a live or replayed feed (tests, benchmarks).
+/// Its signals take their inputs from whatever the caller drives by hand.
+ClientContextPtr makeSyntheticClientContext(const timeval_t &start = timeval_t());
+
+/// A SignalBuilder on cc.
+boost::shared_ptr<SignalBuilder> makeSyntheticBuilder(const ClientContextPtr &cc);
+
+/// A lua_State as a config script finds it: luabind open, clientcore's classes and every spec
+/// class of this library bound.  The caller closes it.
+lua_State *makeSyntheticLuaState();
+
+/// The Lua a config script writes for the spec of the book on instr from source.
+std::string syntheticBookSpecLua(const std::string &instr, const std::string &source);
+
+/// A reference price set by hand; every set() notifies the listeners, as a feed would.
+class SyntheticPriceProvider : public PriceProviderImpl
+{
+public:
+    explicit SyntheticPriceProvider(const instrument_t &instr)
+        : m_instr(instr), m_px(0.0), m_bOK(false) {}
+
+    virtual double getRefPrice(bool *pSuccess = NULL) const
+    {
+        if(pSuccess)
+            *pSuccess = m_bOK;
+        return m_px;
+    }
+    virtual bool isPriceOK() const { return m_bOK; }
+    virtual const instrument_t &getInstrument() const { return m_instr; }
+    virtual timeval_t getLastChangeTime() const { return m_lastChangeTv; }
+
+    void set(double px, bool ok, const timeval_t &tv)
+    {
+        m_px = px;
+        m_bOK = ok;
+        m_lastChangeTv = tv;
+        notifyPriceListeners();
+    }
+
+private:
+    instrument_t m_instr;
+    double m_px;
+    bool m_bOK;
+    timeval_t m_lastChangeTv;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SyntheticPriceProvider);
+
+/// A book set by hand, level 0 first on each side; every set() or flush() notifies the
+/// listeners, as a feed would.  A level with no size is not in the book, and ends its side.
+class SyntheticBook : public IBook
+{
+public:
+    explicit SyntheticBook(const instrument_t &instr, const source_t &source = source_t());
+
+    /// Replaces both sides.  bidLevelChanged and askLevelChanged are passed on to
+    /// IBookListener::onBookChanged: negative if a side did not change, else the 0-based depth.
+    void set(const std::vector<double> &bidPx, const std::vector<double> &bidSz,
+             const std::vector<double> &askPx, const std::vector<double> &askSz,
+             bool ok, const timeval_t &tv, int32_t bidLevelChanged, int32_t askLevelChanged);
+
+    /// Empties the book.
+    void flush(const timeval_t &tv);
+
+    // IBook interface
+    virtual const instrument_t &getInstrument() const { return m_instr; }
+    virtual source_t getSource() const { return m_source; }
+    virtual bool isOK() const { return m_bOK; }
+    virtual timeval_t getLastChangeTime() const { return m_lastChangeTv; }
+    virtual double getMidPrice() const;
+    virtual PriceSize getNthSide(size_t depth, side_t side) const;
+    virtual IBookLevelCIterPtr getBookLevelIter(side_t side) const;
+    virtual bool addBookListener(IBookListener *listener);
+    virtual bool removeBookListener(IBookListener *listener);
+
+private:
+    instrument_t m_instr;
+    source_t m_source;
+    std::vector<BookLevelCPtr> m_levels[2];     // BID, ASK
+    bool m_bOK;
+    timeval_t m_lastChangeTv;
+    std::vector<IBookListener*> m_listeners;
+};
+LONGBEACH_DECLARE_SHARED_PTR(SyntheticBook);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SYNTHETICINPUTS_H
@@ -0,0 +1,111 @@
+#include <longbeach/signals/SyntheticMarket.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+SyntheticMarket::SyntheticMarket(const SyntheticMarketConfig &config)
+    : m_config(config)
+    , m_state(config.seed ? config.seed : 0x9e3779b97f4a7c15ULL)
+    , m_mid(config.initialMid)
+    , m_timeUs(0)
+    , m_numEvents(0)
+{
+    if(m_config.depth == 0)
+        LONGBEACH_THROW_ERROR_SS("SyntheticMarket: depth must be positive");
+    if(m_config.tickSize <= 0)
+        LONGBEACH_THROW_ERROR_SS("SyntheticMarket: tickSize must be positive");
+
+    for(int side = 0; side < 2; ++side)
+    {
+        m_px[side].resize(m_config.depth);
+        m_sz[side].resize(m_config.depth);
+        for(size_t l = 0; l < m_config.depth; ++l)
+            m_sz[side][l] = std::ceil(exponential(m_config.meanSize));
+    }
+    layoutBook();
+    m_lastUpdate = BookUpdate();
+    m_lastTrade = Trade();
+}
+
+uint64_t SyntheticMarket::nextRandom()
+{
+    // xorshift64*
+    m_state ^= m_state >> 12;
+    m_state ^= m_state << 25;
+    m_state ^= m_state >> 27;
+    return m_state * 0x2545f4914f6cdd1dULL;
+}
+
+double SyntheticMarket::uniform()
+{
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double SyntheticMarket::exponential(double mean)
+{
+    return -mean * std::log(1.0 - uniform());
+}
+
+void SyntheticMarket::layoutBook()
+{
+    const double halfTick = m_config.tickSize / 2;
+    for(size_t l = 0; l < m_config.depth; ++l)
+    {
+        m_px[0][l] = m_mid - halfTick - l * m_config.tickSize;
+        m_px[1][l] = m_mid + halfTick + l * m_config.tickSize;
+    }
+}
+
+SyntheticMarket::EventType SyntheticMarket::next()
+{
+    ++m_numEvents;
+    m_timeUs += int64_t(exponential(m_config.meanIntervalUs)) + 1;
+
+    if(uniform() < m_config.tradeFraction)
+    {
+        Trade &t = m_lastTrade;
+        t.aggressorSide = uniform() < 0.5 ? 0 : 1;
+        const int hit = 1 - t.aggressorSide; // a buyer lifts the ask
+        t.price = m_px[hit][0];
+        t.size = std::min(m_sz[hit][0], std::ceil(exponential(m_config.meanSize / 2)));
+        m_sz[hit][0] -= t.size;
+        if(m_sz[hit][0] <= 0)
+            m_sz[hit][0] = std::ceil(exponential(m_config.meanSize));
+        return TRADE;
+    }
+
+    BookUpdate &u = m_lastUpdate;
+    u.side = uniform() < 0.5 ? 0 : 1;
+    u.bShift = uniform() < m_config.midMoveFraction;
+    if(u.bShift)
+    {
+        // mid moves a tick towards this side; levels slide over and a fresh one appears at the back
+        const int dir = u.side == 0 ? -1 : 1;
+        m_mid += dir * m_config.tickSize;
+        const int shrinking = u.side;       // the side the mid moves into loses its best level
+        const int growing = 1 - u.side;
+        m_sz[shrinking].erase(m_sz[shrinking].begin());
+        m_sz[shrinking].push_back(std::ceil(exponential(m_config.meanSize)));
+        m_sz[growing].insert(m_sz[growing].begin(), std::ceil(exponential(m_config.meanSize)));
+        m_sz[growing].pop_back();
+        layoutBook();
+        u.level = 0;
+    }
+    else
+    {
+        u.level = (m_config.depth == 1 || uniform() < m_config.topOfBookFraction)
+            ? 0 : 1 + size_t(uniform() * (m_config.depth - 1));
+        m_sz[u.side][u.level] = std::ceil(exponential(m_config.meanSize));
+    }
+    u.price = m_px[u.side][u.level];
+    u.size = m_sz[u.side][u.level];
+    return BOOK_UPDATE;
+}
+
+} // namespace signals
+} // namespace longbeach
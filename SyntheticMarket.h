@@ -0,0 +1,102 @@
+#ifndef LONGBEACH_SIGNALS_SYNTHETICMARKET_H
+#define LONGBEACH_SIGNALS_SYNTHETICMARKET_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+namespace longbeach {
+namespace signals {
+
+/// Parameters of a SyntheticMarket.
+struct SyntheticMarketConfig
+{
+    SyntheticMarketConfig()
+        : depth(10)
+        , topOfBookFraction(0.8)
+        , tradeFraction(0.1)
+        , midMoveFraction(0.02)
+        , tickSize(0.01)
+        , initialMid(100.0)
+        , meanSize(100.0)
+        , meanIntervalUs(100.0)
+        , seed(1)
+    {
+    }
+
+    size_t depth;               // levels per side
+    double topOfBookFraction;   // share of book updates that touch level 0
+    double tradeFraction;       // share of events that are trades
+    double midMoveFraction;     // share of book updates that shift the whole book by one tick
+    double tickSize;
+    double initialMid;
+    double meanSize;            // mean of the (exponential) level and trade sizes
+    double meanIntervalUs;      // mean of the (exponential) time between events
+    uint64_t seed;
+};
+
+/// A deterministic stream of book updates and trades, for driving signals in isolation from
+/// feed handling (benchmarks, regression checks).
+///
+/// The book always has depth levels a side, one tick apart around a mid that random-walks one
+/// tick at a time.  The random source is a fixed xorshift generator, so a given config produces
+/// the same stream on every platform.
+class SyntheticMarket
+{
+public:
+    enum EventType { BOOK_UPDATE, TRADE };
+
+    struct BookUpdate
+    {
+        int side;           // 0 bid, 1 ask
+        size_t level;
+        double price;
+        double size;
+        bool bShift;        // the whole book moved; every level changed
+    };
+
+    struct Trade
+    {
+        int aggressorSide;  // 0 buyer, 1 seller
+        double price;
+        double size;
+    };
+
+    explicit SyntheticMarket(const SyntheticMarketConfig &config);
+
+    /// Generates the next event and returns what kind it is.
+    EventType next();
+
+    const BookUpdate &getLastUpdate() const { return m_lastUpdate; }
+    const Trade &getLastTrade() const { return m_lastTrade; }
+    int64_t getTimeUs() const { return m_timeUs; }
+    uint64_t getNumEvents() const { return m_numEvents; }
+
+    /// Current book, level 0 first.
+    const std::vector<double> &getPrices(int side) const { return m_px[side]; }
+    const std::vector<double> &getSizes(int side) const { return m_sz[side]; }
+    double getMid() const { return m_mid; }
+
+    const SyntheticMarketConfig &getConfig() const { return m_config; }
+
+private:
+    uint64_t nextRandom();
+    double uniform();
+    double exponential(double mean);
+    void layoutBook();
+
+    SyntheticMarketConfig m_config;
+    uint64_t m_state;
+    double m_mid;
+    int64_t m_timeUs;
+    uint64_t m_numEvents;
+    std::vector<double> m_px[2];
+    std::vector<double> m_sz[2];
+    BookUpdate m_lastUpdate;
+    Trade m_lastTrade;
+};
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_SYNTHETICMARKET_H
@@ -0,0 +1,64 @@
+#ifndef LONGBEACH_SIGNALS_TICKARITHMETIC_H
+#define LONGBEACH_SIGNALS_TICKARITHMETIC_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Integer prices and sizes for the tick mode of the book signals (SigBook, SigBookSizeBias,
+/// SigBookBiasL2), enabled by a positive tick_size on their specs.
+///
+/// Prices become whole ticks and sizes whole multiples of the size unit, so sums over levels
+/// are exact and do not depend on the order of the additions or on how the book's doubles were
+/// rounded.  Results go back to double once, at the output, which makes them reproducible to
+/// the bit across machines and between backtest and live.  Sums of price * size ticks must fit
+/// in 63 bits, e.g. 10^6-tick prices times 10^12 lots; the signals check, and go not OK rather
+/// than wrap.
+namespace ticks {
+
+inline int64_t toTicks(double px, double tickSize) { return int64_t(llround(px / tickSize)); }
+inline int64_t toLots(double sz, double sizeUnit) { return int64_t(llround(sz / sizeUnit)); }
+
+/// x in whole units, false if it does not fit in 62 bits (leaving headroom for the sums).
+inline bool toUnitsChecked(double x, double unit, int64_t &out)
+{
+    const double q = x / unit;
+    if(!(fabs(q) < 4.6e18))
+        return false;
+    out = int64_t(llround(q));
+    return true;
+}
+
+/// acc += a * b, false instead of overflowing (acc is then meaningless).
+inline bool mulAdd(int64_t &acc, int64_t a, int64_t b)
+{
+    int64_t prod;
+    return !__builtin_mul_overflow(a, b, &prod) && !__builtin_add_overflow(acc, prod, &acc);
+}
+
+/// Volume-weighted price of summed ticks * lots over summed lots, in price units.
+inline double vwap(int64_t pxsz, int64_t sz, double tickSize) { return double(pxsz) / double(sz) * tickSize; }
+
+/// A size snapped to its unit.
+inline double snapSize(double sz, double sizeUnit) { return double(toLots(sz, sizeUnit)) * sizeUnit; }
+
+/// Validation shared by the specs: tickSize 0 is the double path.
+inline void checkSpec(const char *specName, const std::string &desc, double tickSize, double sizeUnit)
+{
+    if(tickSize < 0)
+        LONGBEACH_THROW_ERROR_SS(specName << " " << desc << ": tick_size is negative");
+    if(!(sizeUnit > 0))
+        LONGBEACH_THROW_ERROR_SS(specName << " " << desc << ": size_unit must be positive");
+}
+
+} // namespace ticks
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_TICKARITHMETIC_H
@@ -0,0 +1,141 @@
+#include <longbeach/signals/VolatilityProvider.h>
+
+#include <math.h>
+#include <algorithm>
+#include <numeric>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <longbeach/core/Error.h>
+
+namespace longbeach {
+namespace signals {
+
+namespace {
+double toSeconds(const ptime_duration_t &d)
+{
+    return d.total_microseconds() / 1000000.0;
+}
+}
+
+VolatilityProvider::VolatilityProvider(ClockMonitorPtr spCM, IBookPtr spBook, Mode mode,
+                                       const ptime_duration_t &window, const ptime_duration_t &samplePeriod)
+    : m_spCM(spCM)
+    , m_spBook(spBook)
+    , m_mode(mode)
+    , m_window(window)
+    , m_samplePeriod(samplePeriod)
+    , m_alpha(0.0)
+    , m_next(0)
+    , m_sumSquares(0.0)
+    , m_bHavePrevMid(false)
+    , m_prevMid(0.0)
+    , m_numChanges(0)
+    , m_vol(0.0)
+{
+    if(!m_spCM)
+        LONGBEACH_THROW_ERROR_SS("VolatilityProvider: Bad ClockMonitor");
+    if(!m_spBook)
+        LONGBEACH_THROW_ERROR_SS("VolatilityProvider: Bad IBook");
+    const double period = toSeconds(m_samplePeriod);
+    if(!(period > 0) || !(toSeconds(m_window) >= period))
+        LONGBEACH_THROW_ERROR_SS("VolatilityProvider: window " << toSeconds(m_window) << "s must be at least"
+            << " the sample period " << period << "s, which must be positive");
+
+    if(m_mode == EWMA)
+        m_alpha = 1.0 - exp(-period / toSeconds(m_window));
+    else
+        m_squares.assign(size_t(toSeconds(m_window) / period + 0.5), 0.0);
+
+    scheduleSample();
+}
+
+VolatilityProviderPtr VolatilityProvider::getShared(ClockMonitorPtr spCM, IBookPtr spBook, Mode mode,
+                                                    const ptime_duration_t &window, const ptime_duration_t &samplePeriod)
+{
+    struct Entry
+    {
+        // the provider holds both, so neither address can be reused while the entry is live
+        const ClockMonitor *cm;
+        const IBook *book;
+        Mode mode;
+        ptime_duration_t window;
+        ptime_duration_t samplePeriod;
+        boost::weak_ptr<VolatilityProvider> wp;
+    };
+    // signals may be built on several threads (ParallelSignalBuild)
+    static boost::mutex s_mutex;
+    static std::vector<Entry> s_entries;
+
+    boost::mutex::scoped_lock lock(s_mutex);
+    for(size_t i = 0; i < s_entries.size(); )
+    {
+        const Entry &e = s_entries[i];
+        VolatilityProviderPtr sp = e.wp.lock();
+        if(!sp)
+        {
+            s_entries.erase(s_entries.begin() + i);
+            continue;
+        }
+        if(e.cm == spCM.get() && e.book == spBook.get() && e.mode == mode && e.window == window && e.samplePeriod == samplePeriod)
+            return sp;
+        ++i;
+    }
+    VolatilityProviderPtr sp(new VolatilityProvider(spCM, spBook, mode, window, samplePeriod));
+    Entry e = { spCM.get(), spBook.get(), mode, window, samplePeriod, sp };
+    s_entries.push_back(e);
+    return sp;
+}
+
+void VolatilityProvider::scheduleSample()
+{
+    m_spCM->scheduleWakeupCall( m_subSample
+        , boost::bind( &VolatilityProvider::onSample, this, _1, _2 )
+        , m_spCM->getTime() + m_samplePeriod
+        , PRIORITY_CC_Misc );
+}
+
+void VolatilityProvider::onSample(const timeval_t &ctv, const timeval_t &swtv)
+{
+    scheduleSample();
+    if(!m_spBook->isOK())
+    {
+        // no change is taken across a gap in the book, such as the night
+        m_bHavePrevMid = false;
+        return;
+    }
+    const double mid = m_spBook->getMidPrice();
+    if(m_bHavePrevMid)
+        update(mid - m_prevMid);
+    m_prevMid = mid;
+    m_bHavePrevMid = true;
+}
+
+void VolatilityProvider::update(double change)
+{
+    const double sq = change * change;
+    ++m_numChanges;
+    if(m_mode == EWMA)
+    {
+        // the first change seeds the average, rather than being damped from 0
+        m_sumSquares = (m_numChanges == 1) ? sq : m_sumSquares + m_alpha * (sq - m_sumSquares);
+        m_vol = sqrt(m_sumSquares);
+        return;
+    }
+
+    m_sumSquares += sq - m_squares[m_next];
+    m_squares[m_next] = sq;
+    if(++m_next == m_squares.size())
+    {
+        // re-add once per lap so the running sum cannot drift
+        m_next = 0;
+        m_sumSquares = std::accumulate(m_squares.begin(), m_squares.end(), 0.0);
+    }
+    const size_t n = std::min<uint64_t>(m_numChanges, m_squares.size());
+    m_vol = sqrt(std::max(m_sumSquares, 0.0) / n);
+}
+
+} // namespace signals
+} // namespace longbeach
@@ -0,0 +1,83 @@
+#ifndef LONGBEACH_SIGNALS_VOLATILITYPROVIDER_H
+#define LONGBEACH_SIGNALS_VOLATILITYPROVIDER_H
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/ClockMonitor.h>
+#include <longbeach/clientcore/IBook.h>
+#include <longbeach/signals/Signal.h>
+
+namespace longbeach {
+namespace signals {
+
+/// Streaming volatility of one book's mid price, shared by every signal that asks for it.
+///
+/// The mid is sampled every samplePeriod while the book is OK, and the volatility is the root
+/// mean square of the changes between samples, in price units per sample period.  Both modes
+/// update in O(1) per sample:
+///   - EWMA: exponentially weighted, with window as the time constant;
+///   - WINDOW: equally weighted over the last window / samplePeriod changes.
+///
+/// Use getShared, which hands out one provider per (clock, book, mode, window, sample period),
+/// so N signals on a book cost one sample instead of N.  Books are told apart by identity, not
+/// by instrument and source: two book objects on the same instrument may differ in how they
+/// are built, and so in their mid.
+class VolatilityProvider : private boost::noncopyable
+{
+public:
+    enum Mode { EWMA, WINDOW };
+
+    VolatilityProvider(ClockMonitorPtr spCM, IBookPtr spBook, Mode mode,
+                       const ptime_duration_t &window, const ptime_duration_t &samplePeriod);
+
+    /// The provider for these parameters, built on first use and kept while anyone holds it.
+    /// Signals share one only if they hold the same book object.
+    static boost::shared_ptr<VolatilityProvider> getShared(ClockMonitorPtr spCM, IBookPtr spBook, Mode mode,
+                       const ptime_duration_t &window, const ptime_duration_t &samplePeriod);
+
+    /// 0 until isReady.
+    double getVolatility() const { return m_vol; }
+
+    /// Whether a change between two samples has been seen.
+    bool isReady() const { return m_numChanges > 0; }
+
+    uint64_t getNumChanges() const { return m_numChanges; }
+    const IBookPtr &getBook() const { return m_spBook; }
+    Mode getMode() const { return m_mode; }
+    const ptime_duration_t &getWindow() const { return m_window; }
+    const ptime_duration_t &getSamplePeriod() const { return m_samplePeriod; }
+
+    /// Adds one change of the mid; normally called from the sampling timer.
+    void update(double change);
+
+private:
+    void onSample(const timeval_t &ctv, const timeval_t &swtv);
+    void scheduleSample();
+
+    ClockMonitorPtr m_spCM;
+    IBookPtr m_spBook;
+    const Mode m_mode;
+    const ptime_duration_t m_window;
+    const ptime_duration_t m_samplePeriod;
+
+    double m_alpha;                     // EWMA weight of the newest change
+    std::vector<double> m_squares;      // WINDOW ring of squared changes
+    size_t m_next;
+    double m_sumSquares;
+
+    bool m_bHavePrevMid;
+    double m_prevMid;
+    uint64_t m_numChanges;
+    double m_vol;
+
+    Subscription m_subSample;
+};
+LONGBEACH_DECLARE_SHARED_PTR(VolatilityProvider);
+
+} // namespace signals
+} // namespace longbeach
+
+#endif // LONGBEACH_SIGNALS_VOLATILITYPROVIDER_H
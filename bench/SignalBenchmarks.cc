@@ -0,0 +1,560 @@
+/// Per-signal-class benchmark families over SyntheticMarket streams.
+///
+/// Each plain family times the arithmetic its signal runs per input (the static kernels and
+/// filter classes the online signals and BatchSignalEval share), swept over the parameter its
+/// cost scales with.  The ".built" families time a built signal instead, on a SyntheticBook and
+/// SyntheticPriceProvider, through its input handler and, for ".recompute", the read of its
+/// state that runs a deferred recomputeState; ".notify" stops at the handler.  The LuaState
+/// families time creating a config's lua_State, with the spec classes registered up front or on
+/// first use.
+///
+/// Not covered: SigMA, whose per-input work is technicals::ma over a CandlesticksFactory
+/// series that nothing synthetic here feeds; SigBookBiasL2 and the traded quantity signals as
+/// built instances, since they take their inputs from the event distributor or a tick
+/// provider rather than the book and price listeners the synthetic inputs drive.
+///
+///     SignalBenchmarks [family ...]       (default: all families)
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/core/LuabindScripting.h>
+#include <longbeach/core/TimeWindow.h>
+#include <longbeach/core/ptime.h>
+#include <longbeach/clientcore/technicals.h>
+#include <longbeach/signals/SampleAndHoldSignal.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SigLastTradedQuantity.h>
+#include <longbeach/signals/SigMACD.h>
+#include <longbeach/signals/SignalBenchmark.h>
+#include <longbeach/signals/SignalSpec.h>
+#include <longbeach/signals/Signals_LazyScripting.h>
+#include <longbeach/signals/SyntheticInputs.h>
+#include <longbeach/signals/SyntheticMarket.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const uint64_t Iterations = 1000000;
+
+typedef std::vector<SignalBenchmarkResult> results_t;
+
+std::vector<size_t> values(size_t a, size_t b, size_t c, size_t d)
+{
+    std::vector<size_t> v;
+    v.push_back(a);
+    v.push_back(b);
+    v.push_back(c);
+    v.push_back(d);
+    return v;
+}
+
+SyntheticMarketConfig marketConfig(size_t depth)
+{
+    SyntheticMarketConfig config;
+    config.depth = depth;
+    config.tradeFraction = 0.0;
+    return config;
+}
+
+timeval_t timeAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/************************************************************************************************/
+// book signals
+/************************************************************************************************/
+
+struct SigBookOp
+{
+    explicit SigBookOp(size_t depth)
+        : market(boost::make_shared<SyntheticMarket>(marketConfig(depth)))
+        , bavg(depth), aavg(depth), vars(2 * depth - 1) {}
+
+    void operator()()
+    {
+        market->next();
+        const size_t n = bavg.size();
+        size_t failed;
+        SigBook::cumulativePrices(&market->getPrices(0)[0], &market->getSizes(0)[0], n, 0.0, 1.0, &bavg[0], failed);
+        SigBook::cumulativePrices(&market->getPrices(1)[0], &market->getSizes(1)[0], n, 0.0, 1.0, &aavg[0], failed);
+        SigBook::varsFromPrices(&bavg[0], &aavg[0], n, market->getMid(), &vars[0]);
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    std::vector<double> bavg, aavg, vars;
+};
+
+SignalBenchmark::op_t sigBookSetup(size_t depth) { return SigBookOp(depth); }
+
+struct BiasL2Op
+{
+    BiasL2Op(size_t depth, const SigBookBiasL2Spec &spec)
+        : market(boost::make_shared<SyntheticMarket>(marketConfig(depth))), params(spec), bias(0) {}
+
+    void operator()()
+    {
+        market->next();
+        const std::vector<double> &bpx = market->getPrices(0), &apx = market->getPrices(1);
+        const double midpx = (bpx[0] + apx[0]) / 2;
+        bias += SigBookBiasL2::evalLevels(params, midpx, params.lambda,
+            &bpx[0], &market->getSizes(0)[0], bpx.size(), &apx[0], &market->getSizes(1)[0], apx.size());
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    SigBookBiasL2::Params params;
+    double bias;
+};
+
+SigBookBiasL2Spec biasL2Spec()
+{
+    SigBookBiasL2Spec spec;
+    spec.m_lambda = 0.5;
+    return spec;
+}
+
+SignalBenchmark::op_t biasL2Setup(size_t depth) { return BiasL2Op(depth, biasL2Spec()); }
+
+/// Depth truncation against the full walk, on a deep book: one level is one basis point from
+/// the next, and a parameter of 0 (no truncation) is the full-depth baseline.
+const size_t TruncationDepth = 50;
+
+SignalBenchmark::op_t biasL2MaxLevelsSetup(size_t maxLevels)
+{
+    SigBookBiasL2Spec spec = biasL2Spec();
+    spec.m_maxLevels = uint32_t(maxLevels);
+    return BiasL2Op(TruncationDepth, spec);
+}
+
+SignalBenchmark::op_t biasL2MaxDistanceSetup(size_t maxBps)
+{
+    SigBookBiasL2Spec spec = biasL2Spec();
+    spec.m_maxRelDistance = maxBps * 1e-4;
+    return BiasL2Op(TruncationDepth, spec);
+}
+
+SignalBenchmark::op_t biasL2MinWeightSetup(size_t minWeightPct)
+{
+    SigBookBiasL2Spec spec = biasL2Spec();
+    spec.m_minLevelWeight = minWeightPct * 1e-2;
+    return BiasL2Op(TruncationDepth, spec);
+}
+
+struct SizeBiasOp
+{
+    explicit SizeBiasOp(size_t depth)
+        : market(boost::make_shared<SyntheticMarket>(marketConfig(depth))), bias(0) {}
+
+    void operator()()
+    {
+        market->next();
+        const std::vector<double> &bsz = market->getSizes(0), &asz = market->getSizes(1);
+        for(size_t l = 0; l < bsz.size(); ++l)
+            bias += SigBookSizeBias::levelImbalance(bsz[l], asz[l], 0.5, 0.0);
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    double bias;
+};
+
+SignalBenchmark::op_t sizeBiasSetup(size_t depth) { return SizeBiasOp(depth); }
+
+/************************************************************************************************/
+// trade signals
+/************************************************************************************************/
+
+/// SigLastTradedQuantity's per-trade work: one window update per configured window.
+struct TradedQuantityOp
+{
+    TradedQuantityOp(size_t windowSecs)
+        : market(boost::make_shared<SyntheticMarket>(tradeConfig()))
+        , window(boost::make_shared<RollingWindow>(boost::posix_time::seconds(windowSecs), 0.2)), signal(0) {}
+
+    static SyntheticMarketConfig tradeConfig()
+    {
+        SyntheticMarketConfig config;
+        config.tradeFraction = 1.0;
+        config.meanIntervalUs = 10000.0;
+        return config;
+    }
+
+    void operator()()
+    {
+        market->next();
+        const SyntheticMarket::Trade &t = market->getLastTrade();
+        const int32_t qty = int32_t(t.size) * (t.aggressorSide == 0 ? 1 : -1);
+        window->update(TradedQuantity(timeAt(market->getTimeUs()), qty));
+        signal += window->getSignal();
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    boost::shared_ptr<RollingWindow> window;
+    double signal;
+};
+
+SignalBenchmark::op_t tradedQuantitySetup(size_t windowSecs) { return TradedQuantityOp(windowSecs); }
+
+/// SigBaselineLastTradedQuantity's per-trade work: the rolling window plus the sampled history
+/// it is compared against, ten samples a window and twenty kept.
+struct BaselineTradedQuantityOp
+{
+    BaselineTradedQuantityOp(size_t windowSecs)
+        : market(boost::make_shared<SyntheticMarket>(TradedQuantityOp::tradeConfig()))
+        , window(boost::make_shared<BaselineRollingWindow>("baseline", boost::posix_time::seconds(windowSecs), 0.2,
+            boost::posix_time::milliseconds(500 * windowSecs), 20, 0.12))
+        , signal(0) {}
+
+    void operator()()
+    {
+        market->next();
+        const SyntheticMarket::Trade &t = market->getLastTrade();
+        const int32_t qty = int32_t(t.size) * (t.aggressorSide == 0 ? 1 : -1);
+        window->update(TradedQuantity(timeAt(market->getTimeUs()), qty));
+        signal += window->getSignal();
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    boost::shared_ptr<BaselineRollingWindow> window;
+    double signal;
+};
+
+SignalBenchmark::op_t baselineTradedQuantitySetup(size_t windowSecs) { return BaselineTradedQuantityOp(windowSecs); }
+
+/************************************************************************************************/
+// price signals
+/************************************************************************************************/
+
+struct MACDOp
+{
+    explicit MACDOp(size_t longWindow)
+        : market(boost::make_shared<SyntheticMarket>(marketConfig(1)))
+        , macd(boost::make_shared<technicals::macd_t>(int32_t(longWindow / 2), int32_t(longWindow), int32_t(longWindow / 3)))
+        , osc(0) {}
+
+    void operator()()
+    {
+        market->next();
+        macd->update(market->getMid());
+        if(macd->get_dea())
+            osc += macd->get_osc().get();
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    boost::shared_ptr<technicals::macd_t> macd;
+    double osc;
+};
+
+SignalBenchmark::op_t macdSetup(size_t longWindow) { return MACDOp(longWindow); }
+
+/// SigKalmanFilter's filter, stepping on every step'th mid.
+struct KalmanOp
+{
+    explicit KalmanOp(size_t step)
+        : market(boost::make_shared<SyntheticMarket>(marketConfig(1)))
+        , filter(boost::make_shared<KalmanPxFilter>(kalmanSpec(step))), est(0) {}
+
+    static SigKalmanFilterSpec kalmanSpec(size_t step)
+    {
+        SigKalmanFilterSpec spec;
+        spec.R = 1e-4;
+        spec.Q = 1e-6;
+        spec.step = int32_t(step);
+        spec.use_dynamic_deltas = true;
+        return spec;
+    }
+
+    void operator()()
+    {
+        market->next();
+        // the observation history grows by one per step; bound it as a day boundary would
+        if(filter->getObservations().size() > 100000)
+            filter->reset();
+        if(filter->update(timeAt(market->getTimeUs()), market->getMid(), state))
+            est += state[0];
+    }
+
+    boost::shared_ptr<SyntheticMarket> market;
+    boost::shared_ptr<KalmanPxFilter> filter;
+    double state[KalmanPxFilter::NumStates];
+    double est;
+};
+
+SignalBenchmark::op_t kalmanSetup(size_t step) { return KalmanOp(step); }
+
+/// SigDiff's per-evaluation work: the difference of two prices into its time window.
+struct DiffOp
+{
+    explicit DiffOp(size_t windowSecs)
+        : a(boost::make_shared<SyntheticMarket>(marketConfig(1)))
+        , b(boost::make_shared<SyntheticMarket>(legConfig()))
+        , tw(boost::make_shared<TimeWindow<double> >(boost::posix_time::seconds(windowSecs))) {}
+
+    static SyntheticMarketConfig legConfig()
+    {
+        SyntheticMarketConfig config = marketConfig(1);
+        config.seed = 2;
+        return config;
+    }
+
+    void operator()()
+    {
+        a->next();
+        b->next();
+        TimeWindow<double>::Entry e(timeAt(a->getTimeUs()), a->getMid() - b->getMid());
+        tw->push_end(e);
+        tw->flush_start();
+    }
+
+    boost::shared_ptr<SyntheticMarket> a, b;
+    boost::shared_ptr<TimeWindow<double> > tw;
+};
+
+SignalBenchmark::op_t diffSetup(size_t windowSecs) { return DiffOp(windowSecs); }
+
+/************************************************************************************************/
+// built signals
+/************************************************************************************************/
+
+/// A SyntheticMarket played into a SyntheticBook and a SyntheticPriceProvider, for built
+/// signals to listen to.
+class SyntheticFeed : private boost::noncopyable
+{
+public:
+    explicit SyntheticFeed(size_t depth)
+        : m_market(marketConfig(depth))
+        , m_depth(depth)
+        , cc(makeSyntheticClientContext())
+        , book(new SyntheticBook(instrument_t::fromString("SYN0")))
+        , ref(new SyntheticPriceProvider(book->getInstrument())) {}
+
+    /// One market event: the mid to the price provider and, with bBook, the levels to the book.
+    void next(bool bBook)
+    {
+        m_market.next();
+        tv = timeAt(m_market.getTimeUs());
+        ref->set(m_market.getMid(), true, tv);
+        if(!bBook)
+            return;
+        const SyntheticMarket::BookUpdate &u = m_market.getLastUpdate();
+        const int32_t changed = u.bShift ? int32_t(m_depth - 1) : int32_t(u.level);
+        book->set(m_market.getPrices(0), m_market.getSizes(0), m_market.getPrices(1), m_market.getSizes(1),
+                  true, tv, (u.bShift || u.side == 0) ? changed : -1, (u.bShift || u.side == 1) ? changed : -1);
+    }
+
+private:
+    SyntheticMarket m_market;
+    size_t m_depth;
+
+public:
+    ClientContextPtr cc;
+    SyntheticBookPtr book;
+    SyntheticPriceProviderPtr ref;
+    timeval_t tv;
+};
+typedef boost::shared_ptr<SyntheticFeed> SyntheticFeedPtr;
+
+/// A built signal fed one market event per op; with bRead its state is then read as a listener
+/// would, which runs recomputeState on a signal that defers it.  The timings include the
+/// synthetic inputs' own work, notably a BookLevel per level on every book update.
+struct InstanceOp
+{
+    InstanceOp(const SyntheticFeedPtr &feed, const ISignalPtr &signal, bool bBook, bool bRead)
+        : feed(feed), signal(signal), bBook(bBook), bRead(bRead), sum(0) {}
+
+    void operator()()
+    {
+        feed->next(bBook);
+        if(bRead)
+            sum += signal->getSignalState()[0];
+    }
+
+    SyntheticFeedPtr feed;
+    ISignalPtr signal;
+    bool bBook, bRead;
+    double sum;
+};
+
+ISignalPtr buildSigBook(const SyntheticFeed &feed, size_t depth)
+{
+    return ISignalPtr(new SigBook(feed.book->getInstrument(), "sigbook", feed.cc->getClockMonitor(),
+        feed.ref, feed.book, depth, 2 * depth - 1, 0, DIFF));
+}
+
+SignalBenchmark::op_t sigBookNotifySetup(size_t depth)
+{
+    SyntheticFeedPtr feed = boost::make_shared<SyntheticFeed>(depth);
+    return InstanceOp(feed, buildSigBook(*feed, depth), true, false);
+}
+
+SignalBenchmark::op_t sigBookRecomputeSetup(size_t depth)
+{
+    SyntheticFeedPtr feed = boost::make_shared<SyntheticFeed>(depth);
+    return InstanceOp(feed, buildSigBook(*feed, depth), true, true);
+}
+
+SignalBenchmark::op_t sizeBiasInstanceSetup(size_t depth)
+{
+    SyntheticFeedPtr feed = boost::make_shared<SyntheticFeed>(depth);
+    std::vector<unsigned> intervals;
+    intervals.push_back(1);
+    intervals.push_back(10);
+    intervals.push_back(100);
+    return InstanceOp(feed, ISignalPtr(new SigBookSizeBias(feed->book->getInstrument(), "sizebias",
+        feed->cc->getClockMonitor(), feed->book, boost::posix_time::seconds(1), intervals,
+        uint32_t(depth), 0.5, 0)), true, true);
+}
+
+SignalBenchmark::op_t macdInstanceSetup(size_t longWindow)
+{
+    SyntheticFeedPtr feed = boost::make_shared<SyntheticFeed>(1);
+    return InstanceOp(feed, ISignalPtr(new SigMACD(feed->cc, feed->ref, int32_t(longWindow / 2),
+        int32_t(longWindow), int32_t(longWindow / 3), "macd", false)), false, true);
+}
+
+SignalBenchmark::op_t kalmanInstanceSetup(size_t step)
+{
+    SyntheticFeedPtr feed = boost::make_shared<SyntheticFeed>(1);
+    return InstanceOp(feed, ISignalPtr(new SigKalmanFilter(feed->cc, "kalman", KalmanOp::kalmanSpec(step),
+        feed->ref, 0)), false, true);
+}
+
+/// A SampleAndHoldSignal woken by hand on every op rather than by the clock.
+class HandWokenSample : public SampleAndHoldSignal
+{
+public:
+    HandWokenSample(ClockMonitor *cm, const ISignalPtr &subSignal)
+        : SampleAndHoldSignal(cm, subSignal, boost::posix_time::seconds(1), boost::posix_time::seconds(0), 0) {}
+
+    void wake(const timeval_t &tv) { onPeriodicWakeup(tv, tv); }
+};
+
+/// SampleAndHoldSignal over a SigBook of the given depth: one book update, then one sample,
+/// which reads (and so recomputes) the SigBook and copies its changed state.
+struct SampleOp
+{
+    explicit SampleOp(size_t depth)
+        : feed(boost::make_shared<SyntheticFeed>(depth))
+        , sampler(boost::make_shared<HandWokenSample>(feed->cc->getClockMonitor().get(), buildSigBook(*feed, depth)))
+        , sum(0) {}
+
+    void operator()()
+    {
+        feed->next(true);
+        sampler->wake(feed->tv);
+        sum += sampler->getSignalState()[0];
+    }
+
+    SyntheticFeedPtr feed;
+    boost::shared_ptr<HandWokenSample> sampler;
+    double sum;
+};
+
+SignalBenchmark::op_t sampleSetup(size_t depth) { return SampleOp(depth); }
+
+/************************************************************************************************/
+// Lua states
+/************************************************************************************************/
+
+// the global names a config script reads, one per spec class, most used first
+const char *const SpecClassNames[] = {
+    "SigBookSpec", "SigBookBiasL2Spec", "SigMASpec", "SigKalmanFilterSpec", "SigLastTradedQuantitySpec",
+    "SigBookSizeBiasSpec", "SigMACDSpec", "SigDiffSpec", "SigBaselineLastTradedQuantitySpec",
+    "SampleAndHoldSignalSpec", "AsyncSignalSpec",
+};
+const size_t NumSpecClasses = sizeof(SpecClassNames) / sizeof(SpecClassNames[0]);
+
+/// Creates a lua_State with the spec base classes bound, registers the spec classes eagerly or
+/// lazily, reads the first numUsed class names as a config script would, and closes it.
+struct LuaStateOp
+{
+    LuaStateOp(bool bLazy, size_t numUsed) : bLazy(bLazy), numUsed(std::min(numUsed, NumSpecClasses)) {}
+
+    void operator()()
+    {
+        lua_State *L = luaL_newstate();
+        luabind::open(L);
+        SignalSpec::registerScripting(*L);
+        if(bLazy)
+            registerScriptingLazily(*L);
+        else
+            registerSpecClassesEagerly(*L);
+        for(size_t i = 0; i < numUsed; ++i)
+        {
+            lua_getglobal(L, SpecClassNames[i]);
+            lua_pop(L, 1);
+        }
+        lua_close(L);
+    }
+
+    bool bLazy;
+    size_t numUsed;
+};
+
+SignalBenchmark::op_t eagerLuaStateSetup(size_t numUsed) { return LuaStateOp(false, numUsed); }
+SignalBenchmark::op_t lazyLuaStateSetup(size_t numUsed) { return LuaStateOp(true, numUsed); }
+
+/// A lua_State costs far more than a signal update.
+const uint64_t LuaStateIterations = 2000;
+
+/************************************************************************************************/
+
+struct Family
+{
+    const char *name;
+    const char *paramName;
+    size_t v0, v1, v2, v3;
+    SignalBenchmark::op_t (*setup)(size_t param);
+    uint64_t iterations;        // 0: Iterations
+};
+
+const Family Families[] = {
+    { "SigBook",                        "depth",                 1,  3,   5,  10, &sigBookSetup },
+    { "SigBookBiasL2",                  "depth",                 5, 10,  20,  50, &biasL2Setup },
+    { "SigBookBiasL2.maxLevels",        "max_levels",            0, 20,  10,   5, &biasL2MaxLevelsSetup },
+    { "SigBookBiasL2.maxRelDistance",   "max_rel_distance_bps",  0, 20,  10,   5, &biasL2MaxDistanceSetup },
+    { "SigBookBiasL2.minLevelWeight",   "min_level_weight_pct",  0,  1,   5,  20, &biasL2MinWeightSetup },
+    { "SigBookSizeBias",                "depth",                 1,  3,   5,  10, &sizeBiasSetup },
+    { "SigLastTradedQuantity",          "window_s",              1, 10,  60, 300, &tradedQuantitySetup },
+    { "SigBaselineLastTradedQuantity",  "window_s",              1, 10,  60, 300, &baselineTradedQuantitySetup },
+    { "SigMACD",                        "long_window",          26, 60, 120, 600, &macdSetup },
+    { "SigKalmanFilter",                "step",                  1,  2,   5,  10, &kalmanSetup },
+    { "SigDiff",                        "window_s",              1,  5,  30, 300, &diffSetup },
+    { "SigBook.built.notify",           "depth",                 1,  3,   5,  10, &sigBookNotifySetup },
+    { "SigBook.built.recompute",        "depth",                 1,  3,   5,  10, &sigBookRecomputeSetup },
+    { "SigBookSizeBias.built",          "depth",                 1,  3,   5,  10, &sizeBiasInstanceSetup },
+    { "SigMACD.built",                  "long_window",          26, 60, 120, 600, &macdInstanceSetup },
+    { "SigKalmanFilter.built",          "step",                  1,  2,   5,  10, &kalmanInstanceSetup },
+    { "SampleAndHoldSignal.built",      "depth",                 1,  3,   5,  10, &sampleSetup },
+    { "LuaState.eager",                 "classes_used",          0,  1,   3,  11, &eagerLuaStateSetup, LuaStateIterations },
+    { "LuaState.lazy",                  "classes_used",          0,  1,   3,  11, &lazyLuaStateSetup, LuaStateIterations },
+};
+
+} // anonymous namespace
+
+int main(int argc, char **argv)
+{
+    const std::vector<std::string> wanted(argv + 1, argv + argc);
+    for(size_t f = 0; f < sizeof(Families) / sizeof(Families[0]); ++f)
+    {
+        const Family &family = Families[f];
+        if(!wanted.empty() && std::find(wanted.begin(), wanted.end(), family.name) == wanted.end())
+            continue;
+        const results_t results = SignalBenchmark::sweep(family.name, family.paramName,
+            values(family.v0, family.v1, family.v2, family.v3), family.setup,
+            family.iterations ? family.iterations : Iterations);
+        SignalBenchmark::print(std::cout, results);
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/ShardQueue.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SyntheticInputs.h>
+#include <longbeach/signals/SyntheticMarket.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+timeval_t tvAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/// A mailbox value that a torn read would show: every word carries the sequence number.
+struct Stamped
+{
+    Stamped() : seq(0), words(32, 0) {}
+
+    uint64_t seq;
+    std::vector<uint64_t> words;
+};
+
+const uint64_t NumPublished = 50000;
+const uint64_t CatchUpEvery = 64;
+
+struct MailboxRun
+{
+    MailboxRun() : lastSeen(0), numReplaced(0), numTaken(0), numTorn(0), numOutOfOrder(0), lastTaken(0) {}
+
+    void produce()
+    {
+        for(uint64_t seq = 1; seq <= NumPublished; ++seq)
+        {
+            Stamped &s = mailbox.writeSlot();
+            s.seq = seq;
+            for(size_t i = 0; i < s.words.size(); ++i)
+                s.words[i] = seq;
+            if(mailbox.publish())
+                ++numReplaced;
+            // now and then let the consumer catch up, so that the two interleave even on
+            // one core rather than one finishing within a time slice of the other
+            if(seq % CatchUpEvery == 0)
+                while(lastSeen.load(std::memory_order_acquire) + CatchUpEvery < seq)
+                    boost::this_thread::yield();
+        }
+    }
+
+    void consume()
+    {
+        uint64_t last = 0;
+        while(last < NumPublished)
+        {
+            if(!mailbox.take())
+                continue;
+            const Stamped &s = mailbox.readSlot();
+            ++numTaken;
+            for(size_t i = 0; i < s.words.size(); ++i)
+                if(s.words[i] != s.seq)
+                {
+                    ++numTorn;
+                    break;
+                }
+            if(s.seq <= last)
+                ++numOutOfOrder;
+            last = s.seq;
+            lastSeen.store(last, std::memory_order_release);
+        }
+        lastTaken = last;
+    }
+
+    LatestValueMailbox<Stamped> mailbox;
+    std::atomic<uint64_t> lastSeen;
+    uint64_t numReplaced;       // producer-owned until joined
+    uint64_t numTaken, numTorn, numOutOfOrder, lastTaken;     // consumer-owned until joined
+};
+
+/// SigBookBiasL2 on a SyntheticBook.  The signal takes its book updates from feed messages
+/// on the event distributor; bookChanged() does what onMsg does with one, short of notifying.
+class BiasL2Probe : public SigBookBiasL2
+{
+public:
+    BiasL2Probe(const ClientContextPtr &cc, const SigBookBiasL2Spec &spec, const SyntheticBookPtr &book)
+        : SigBookBiasL2(book->getInstrument(), "biasl2", cc, spec, book), m_spSyntheticBook(book) {}
+
+    void bookChanged()
+    {
+        m_isOK = m_spSyntheticBook->isOK();
+        setDirty(true);
+    }
+
+private:
+    SyntheticBookPtr m_spSyntheticBook;
+};
+
+SigBookBiasL2Spec biasL2Spec(double tickSize, uint32_t maxLevels, double maxRelDistance, double minLevelWeight)
+{
+    SigBookBiasL2Spec spec;
+    spec.m_lambda = 0.5;
+    spec.m_tickSize = tickSize;
+    spec.m_maxLevels = maxLevels;
+    spec.m_maxRelDistance = maxRelDistance;
+    spec.m_minLevelWeight = minLevelWeight;
+    return spec;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(AsyncEval)
+
+BOOST_AUTO_TEST_CASE(MailboxHandsOverWholeValuesInOrder)
+{
+    MailboxRun run;
+    boost::thread consumer(boost::bind(&MailboxRun::consume, &run));
+    boost::thread producer(boost::bind(&MailboxRun::produce, &run));
+    producer.join();
+    consumer.join();
+
+    BOOST_CHECK_EQUAL(run.numTorn, 0u);
+    BOOST_CHECK_EQUAL(run.numOutOfOrder, 0u);
+    BOOST_CHECK_EQUAL(run.lastTaken, NumPublished);
+    // every value was either taken or replaced before it could be, never both or neither
+    BOOST_CHECK_EQUAL(run.numTaken + run.numReplaced, NumPublished);
+    BOOST_CHECK_GE(run.numTaken, NumPublished / (2 * CatchUpEvery));
+    BOOST_TEST_MESSAGE(run.numTaken << " of " << NumPublished << " values taken");
+}
+
+BOOST_AUTO_TEST_CASE(MailboxWithoutNewValueKeepsReadSlot)
+{
+    LatestValueMailbox<Stamped> mailbox;
+    BOOST_CHECK(!mailbox.take());
+    mailbox.writeSlot().seq = 1;
+    BOOST_CHECK(!mailbox.publish());
+    mailbox.writeSlot().seq = 2;
+    BOOST_CHECK(mailbox.publish());     // 1 was never taken
+    BOOST_REQUIRE(mailbox.take());
+    BOOST_CHECK_EQUAL(mailbox.readSlot().seq, 2u);
+    BOOST_CHECK(!mailbox.take());
+    BOOST_CHECK_EQUAL(mailbox.readSlot().seq, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(BiasL2EvalAsyncMatchesRecompute)
+{
+    const double tickSize[] = { 0.0, 0.0, 0.0, 0.0, 0.01 };
+    const uint32_t maxLevels[] = { 0, 5, 0, 0, 5 };
+    const double maxRelDistance[] = { 0.0, 0.0, 0.001, 0.0, 0.001 };
+    const double minLevelWeight[] = { 0.0, 0.0, 0.0, 0.5, 0.0 };
+    for(size_t c = 0; c < 5; ++c)
+    {
+        SyntheticMarketConfig config;
+        config.depth = 20;
+        config.tradeFraction = 0.0;
+        config.seed = 7 + c;
+        SyntheticMarket market(config);
+        const ClientContextPtr cc = makeSyntheticClientContext();
+        const SyntheticBookPtr book(new SyntheticBook(instrument_t::fromString("SYN0")));
+        BiasL2Probe sig(cc, biasL2Spec(tickSize[c], maxLevels[c], maxRelDistance[c], minLevelWeight[c]), book);
+
+        AsyncSignalInput in;
+        std::vector<double> state(1);
+        size_t numDiffs = 0, numCaptured = 0;
+        for(size_t r = 0; r < 5000; ++r)
+        {
+            market.next();
+            const bool ok = r % 37 != 0;
+            book->set(market.getPrices(0), market.getSizes(0), market.getPrices(1), market.getSizes(1),
+                      ok, tvAt(market.getTimeUs()), -1, -1);
+            sig.bookChanged();
+
+            // as the event thread and then the helper would see it
+            const bool captured = sig.captureAsyncInput(in);
+            BOOST_CHECK_EQUAL(captured, ok);
+            if(!captured)
+                continue;
+            ++numCaptured;
+            in.tv = book->getLastChangeTime();
+            const bool asyncOK = sig.evalAsync(in, state);
+            const double online = sig.getSignalState()[0];
+            if((!asyncOK || state[0] != online) && numDiffs++ == 0)
+                BOOST_ERROR("case " << c << " row " << r << ": evalAsync " << state[0]
+                    << ", recomputeState " << online);
+        }
+        BOOST_CHECK_GT(numCaptured, 0u);
+        BOOST_CHECK_MESSAGE(numDiffs == 0, "case " << c << ": " << numDiffs << " rows differ");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,453 @@
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <longbeach/signals/BatchSignalEval.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SigMACD.h>
+#include <longbeach/signals/SyntheticInputs.h>
+#include <longbeach/signals/SyntheticMarket.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+// a few blocks and a ragged tail, so the chunked kernels cross BlockRows boundaries
+const size_t NumRows = 3 * BatchSignalEval::BlockRows + 123;
+const size_t NumThreads = 4;
+
+timeval_t tvAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/// The book after each of a synthetic market's book updates, in columns, with the inputs the
+/// online signals see going bad now and then: every 97th row the book is not ok, every 53rd the
+/// reference price is not ok, and every 61st the book is a level short on the bid.  Three days.
+struct RandomHistory
+{
+    RandomHistory(size_t depth, uint64_t seed)
+    {
+        SyntheticMarketConfig config;
+        config.depth = depth;
+        config.seed = seed;
+        SyntheticMarket m(config);
+
+        book.resize(NumRows, depth);
+        book.bidLevelChanged.resize(NumRows);
+        book.askLevelChanged.resize(NumRows);
+        book.dayStarts.push_back(0);
+        book.dayStarts.push_back(NumRows / 3);
+        book.dayStarts.push_back(2 * NumRows / 3);
+        ref.resize(NumRows);
+        for(size_t r = 0; r < NumRows; ++r)
+        {
+            while(m.next() != SyntheticMarket::BOOK_UPDATE)
+                ;
+            const SyntheticMarket::BookUpdate &u = m.getLastUpdate();
+            const int32_t changed = u.bShift ? int32_t(depth - 1) : int32_t(u.level);
+            book.bidLevelChanged[r] = (u.bShift || u.side == 0) ? changed : -1;
+            book.askLevelChanged[r] = (u.bShift || u.side == 1) ? changed : -1;
+
+            for(size_t l = 0; l < depth; ++l)
+            {
+                book.bidPxs[l * NumRows + r] = m.getPrices(0)[l];
+                book.bidSzs[l * NumRows + r] = m.getSizes(0)[l];
+                book.askPxs[l * NumRows + r] = m.getPrices(1)[l];
+                book.askSzs[l * NumRows + r] = m.getSizes(1)[l];
+            }
+            if(r % 61 == 0)
+                book.bidPxs[(depth - 1) * NumRows + r] = book.bidSzs[(depth - 1) * NumRows + r] = 0.0;
+
+            book.times[r] = tvAt(m.getTimeUs());
+            book.midPx[r] = (book.bidPxs[r] + book.askPxs[r]) / 2;
+            book.bookOK[r] = r % 97 != 0;
+            ref.times[r] = book.times[r];
+            ref.px[r] = m.getMid();
+            ref.pxOK[r] = r % 53 != 0;
+        }
+    }
+
+    /// Row r of one side, level 0 first, as the online signal reads it off the book.
+    std::vector<double> level(const std::vector<double> &column, size_t r) const
+    {
+        std::vector<double> out(book.numLevels);
+        for(size_t l = 0; l < book.numLevels; ++l)
+            out[l] = column[l * NumRows + r];
+        return out;
+    }
+
+    ColumnarBookHistory book;
+    ColumnarPriceSeries ref;
+};
+
+/// Compares a batch column with the online values row by row, reporting the first difference
+/// and how many rows differ rather than one failure per row.
+class ColumnCheck
+{
+public:
+    ColumnCheck(const char *what, size_t state) : m_what(what), m_state(state), m_numDiffs(0) {}
+
+    void check(size_t row, double batch, double online)
+    {
+        // bit for bit: the two paths share their arithmetic
+        if(batch == online)
+            return;
+        if(m_numDiffs++ == 0)
+        {
+            std::ostringstream ss;
+            ss.precision(17);
+            ss << "row " << row << ": batch " << batch << ", online " << online;
+            m_first = ss.str();
+        }
+    }
+
+    ~ColumnCheck()
+    {
+        BOOST_CHECK_MESSAGE(m_numDiffs == 0, m_what << " state " << m_state << ": " << m_numDiffs
+            << " rows differ, first at " << m_first);
+    }
+
+private:
+    const char *m_what;
+    size_t m_state;
+    size_t m_numDiffs;
+    std::string m_first;
+};
+
+/// The rows of a RandomHistory played through a book and a reference price, for the online
+/// signals to be built on and read after each row.
+struct OnlineFeed
+{
+    explicit OnlineFeed(const RandomHistory &history)
+        : h(history)
+        , cc(makeSyntheticClientContext())
+        , book(new SyntheticBook(instrument_t::fromString("SYN")))
+        , ref(new SyntheticPriceProvider(instrument_t::fromString("SYN")))
+    {
+    }
+
+    /// Row r: the reference price, then the book, as two events of a feed.
+    void feed(size_t r)
+    {
+        ref->set(h.ref.px[r], h.ref.pxOK[r], h.ref.times[r]);
+        book->set(h.level(h.book.bidPxs, r), h.level(h.book.bidSzs, r),
+                  h.level(h.book.askPxs, r), h.level(h.book.askSzs, r),
+                  h.book.bookOK[r], h.book.times[r], h.book.bidLevelChanged[r], h.book.askLevelChanged[r]);
+    }
+
+    const RandomHistory &h;
+    ClientContextPtr cc;
+    SyntheticBookPtr book;
+    SyntheticPriceProviderPtr ref;
+};
+
+/// A signal's state and isOK after each row it was fed.
+struct OnlineStates
+{
+    void read(size_t r, const ISignal &sig)
+    {
+        const std::vector<double> &state = sig.getSignalState();
+        if(values.empty())
+            values.resize(state.size() * NumRows);
+        for(size_t k = 0; k < state.size(); ++k)
+            values[k * NumRows + r] = state[k];
+        ok.push_back(sig.isOK());
+    }
+
+    double at(size_t k, size_t r) const { return values[k * NumRows + r]; }
+
+    std::vector<double> values;     // state-major, like BatchSignalOutput
+    std::vector<uint8_t> ok;
+};
+
+void checkOK(const char *what, const BatchSignalOutput &out, size_t r, bool online, size_t &numDiffs)
+{
+    if(bool(out.ok[r]) != online && numDiffs++ == 0)
+        BOOST_ERROR(what << ": isOK differs first at row " << r);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(BatchEval)
+
+BOOST_AUTO_TEST_CASE(SigBookBatchMatchesOnline)
+{
+    const RandomHistory h(5, 41);
+    const ReturnMode modes[] = { DIFF, ARITH, LOG };
+    for(size_t m = 0; m < 3; ++m)
+    {
+        SigBookSpec spec;
+        spec.m_numLevels = 5;
+        spec.m_numSBvars = 9;
+        spec.m_returnMode = modes[m];
+
+        OnlineFeed feed(h);
+        SigBookPtr sig(new SigBook(feed.book->getInstrument(), "sigbook", feed.cc->getClockMonitor(),
+            feed.ref, feed.book, spec.m_numLevels, spec.m_numSBvars, 0, spec.m_returnMode));
+        OnlineStates online;
+        for(size_t r = 0; r < NumRows; ++r)
+        {
+            feed.feed(r);
+            online.read(r, *sig);
+        }
+
+        for(size_t threads = 0; threads <= NumThreads; threads += NumThreads)
+        {
+            const BatchSignalOutput out = BatchSignalEval(threads).evalSigBook(spec, h.book, h.ref);
+            BOOST_REQUIRE_EQUAL(out.names.size(), spec.m_numSBvars);
+            size_t numOKDiffs = 0;
+            for(size_t r = 0; r < NumRows; ++r)
+                checkOK("SigBook", out, r, online.ok[r], numOKDiffs);
+            for(size_t k = 0; k < spec.m_numSBvars; ++k)
+            {
+                ColumnCheck col("SigBook", k);
+                for(size_t r = 0; r < NumRows; ++r)
+                    col.check(r, out.column(k)[r], online.at(k, r));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BiasL2BatchMatchesOnline)
+{
+    const size_t depth = 40;
+    const RandomHistory h(depth, 42);
+    // full depth, then each truncation on its own
+    const uint32_t maxLevels[] = { 0, 10, 0, 0 };
+    const double maxRelDistance[] = { 0.0, 0.0, 0.001, 0.0 };
+    const double minLevelWeight[] = { 0.0, 0.0, 0.0, 0.05 };
+    for(size_t c = 0; c < 4; ++c)
+    {
+        SigBookBiasL2Spec spec;
+        spec.m_lambda = 0.5;
+        spec.m_maxLevels = maxLevels[c];
+        spec.m_maxRelDistance = maxRelDistance[c];
+        spec.m_minLevelWeight = minLevelWeight[c];
+        const SigBookBiasL2::Params params(spec);
+        for(size_t threads = 0; threads <= NumThreads; threads += NumThreads)
+        {
+            const BatchSignalOutput out = BatchSignalEval(threads).evalBiasL2(spec, h.book);
+            ColumnCheck col("SigBookBiasL2", c);
+            size_t numOKDiffs = 0;
+            for(size_t r = 0; r < NumRows; ++r)
+            {
+                const std::vector<double> bpx = h.level(h.book.bidPxs, r), bsz = h.level(h.book.bidSzs, r);
+                const std::vector<double> apx = h.level(h.book.askPxs, r), asz = h.level(h.book.askSzs, r);
+                const double bias = SigBookBiasL2::evalLevels(params, h.book.midPx[r], params.lambda,
+                    &bpx[0], &bsz[0], depth, &apx[0], &asz[0], depth);
+                checkOK("SigBookBiasL2", out, r, h.book.bookOK[r], numOKDiffs);
+                if(h.book.bookOK[r])
+                    col.check(r, out.column(0)[r], bias);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BiasL2TruncationError)
+{
+    // at lambda 2 the weights fall to 0.2 about 8 bps from the mid and to 0.001 about 35 bps
+    // out, so the 40 levels a side are cut short at every weight below
+    const size_t depth = 40;
+    const RandomHistory h(depth, 42);
+    SigBookBiasL2Spec spec;
+    spec.m_lambda = 2.0;
+    const BatchSignalOutput full = BatchSignalEval().evalBiasL2(spec, h.book);
+    double meanBias = 0;
+    for(size_t r = 0; r < NumRows; ++r)
+        meanBias += fabs(full.column(0)[r]) / NumRows;
+
+    // the weight bounds each dropped level, not the signal: only the mean error is checked
+    const double minLevelWeight[] = { 0.2, 0.05, 0.01, 0.001 };
+    double lastError = std::numeric_limits<double>::infinity();
+    for(size_t w = 0; w < 4; ++w)
+    {
+        spec.m_minLevelWeight = minLevelWeight[w];
+        const BatchSignalOutput cut = BatchSignalEval().evalBiasL2(spec, h.book);
+        double meanError = 0;
+        for(size_t r = 0; r < NumRows; ++r)
+            meanError += fabs(cut.column(0)[r] - full.column(0)[r]) / NumRows;
+        BOOST_TEST_MESSAGE("min_level_weight " << minLevelWeight[w] << ": mean error " << meanError
+            << " bps, mean |bias| " << meanBias << " bps");
+        BOOST_CHECK_GT(meanError, 0.0);
+        BOOST_CHECK_LT(meanError, lastError);
+        lastError = meanError;
+    }
+    BOOST_CHECK_LT(lastError, 0.01 * meanBias);
+}
+
+BOOST_AUTO_TEST_CASE(ZeroPriceLevelsDoNotEndTheWalk)
+{
+    // the second bid level has no price; with a cutoff set the levels under it still count
+    const double bidPx[] = { 99.99, 0.0, 99.97, 99.96 }, bidSz[] = { 5, 0, 30, 40 };
+    const double askPx[] = { 100.01, 100.02, 100.03, 100.04 }, askSz[] = { 7, 20, 25, 50 };
+    const double holeless[] = { 99.99, 99.97, 99.96 }, holelessSz[] = { 5, 30, 40 };
+    const double midpx = 100.0;
+
+    SigBookBiasL2Spec spec;
+    spec.m_lambda = 0.5;
+    spec.m_maxRelDistance = 0.001;
+    const SigBookBiasL2::Params params(spec);
+    const double expected = SigBookBiasL2::evalLevels(params, midpx, params.lambda,
+        holeless, holelessSz, 3, askPx, askSz, 4);
+    BOOST_CHECK_EQUAL(SigBookBiasL2::evalLevels(params, midpx, params.lambda,
+        bidPx, bidSz, 4, askPx, askSz, 4), expected);
+    // and not the same as stopping at the hole
+    BOOST_CHECK_NE(SigBookBiasL2::evalLevels(params, midpx, params.lambda, bidPx, bidSz, 1, askPx, askSz, 4),
+        expected);
+
+    ColumnarBookHistory book;
+    book.resize(1, 4);
+    book.times[0] = tvAt(0);
+    book.midPx[0] = midpx;
+    book.bookOK[0] = 1;
+    for(size_t l = 0; l < 4; ++l)
+    {
+        book.bidPxs[l] = bidPx[l];
+        book.bidSzs[l] = bidSz[l];
+        book.askPxs[l] = askPx[l];
+        book.askSzs[l] = askSz[l];
+    }
+    BOOST_CHECK_EQUAL(BatchSignalEval().evalBiasL2(spec, book).column(0)[0], expected);
+}
+
+BOOST_AUTO_TEST_CASE(SizeBiasBatchMatchesOnline)
+{
+    const RandomHistory h(5, 43);
+    const double power[] = { 0.0, 0.5 };
+    for(size_t p = 0; p < 2; ++p)
+    {
+        SigBookSizeBiasSpec spec;
+        spec.m_numLevels = 3;
+        spec.m_power = power[p];
+        spec.m_sizeUnit = 1.0;
+        spec.m_intervals.push_back(1);
+        spec.m_intervals.push_back(10);
+        spec.m_intervals.push_back(100);
+        const size_t numStates = spec.m_intervals.size() * spec.m_numLevels;
+
+        // a new signal each day stands in for the reset the clock delivers at the open
+        OnlineFeed feed(h);
+        OnlineStates online;
+        for(size_t day = 0; day < h.book.dayStarts.size(); ++day)
+        {
+            const size_t end = day + 1 < h.book.dayStarts.size() ? h.book.dayStarts[day + 1] : NumRows;
+            SigBookSizeBiasPtr sig(new SigBookSizeBias(feed.book->getInstrument(), "sizebias",
+                feed.cc->getClockMonitor(), feed.book, spec.m_interval, spec.m_intervals,
+                spec.m_numLevels, spec.m_power, 0, spec.m_sizeUnit));
+            for(size_t r = h.book.dayStarts[day]; r < end; ++r)
+            {
+                feed.feed(r);
+                online.read(r, *sig);
+            }
+        }
+
+        for(size_t threads = 0; threads <= NumThreads; threads += NumThreads)
+        {
+            const BatchSignalOutput out = BatchSignalEval(threads).evalSizeBias(spec, h.book);
+            BOOST_REQUIRE_EQUAL(out.names.size(), numStates);
+            size_t numOKDiffs = 0;
+            for(size_t r = 0; r < NumRows; ++r)
+                checkOK("SigBookSizeBias", out, r, online.ok[r], numOKDiffs);
+            for(size_t k = 0; k < numStates; ++k)
+            {
+                ColumnCheck col("SigBookSizeBias", k);
+                for(size_t r = 0; r < NumRows; ++r)
+                    col.check(r, out.column(k)[r], online.at(k, r));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(KalmanBatchMatchesOnline)
+{
+    const RandomHistory h(1, 44);
+    const int32_t steps[] = { 1, 3 };
+    for(size_t s = 0; s < 2; ++s)
+    {
+        SigKalmanFilterSpec spec;
+        spec.step = steps[s];
+        const BatchSignalOutput out = BatchSignalEval().evalKalman(spec, h.ref);
+        BOOST_REQUIRE_EQUAL(out.names.size(), KalmanPxFilter::NumStates);
+
+        OnlineFeed feed(h);
+        SigKalmanFilterPtr sig(new SigKalmanFilter(feed.cc, "kalman", spec, feed.ref, 0));
+        OnlineStates online;
+        for(size_t r = 0; r < NumRows; ++r)
+        {
+            feed.ref->set(h.ref.px[r], h.ref.pxOK[r], h.ref.times[r]);
+            online.read(r, *sig);
+        }
+
+        size_t numOKDiffs = 0;
+        for(size_t r = 0; r < NumRows; ++r)
+            checkOK("SigKalmanFilter", out, r, online.ok[r], numOKDiffs);
+        for(size_t k = 0; k < KalmanPxFilter::NumStates; ++k)
+        {
+            ColumnCheck col("SigKalmanFilter", k);
+            for(size_t r = 0; r < NumRows; ++r)
+                col.check(r, out.column(k)[r], online.at(k, r));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MACDBatchMatchesOnline)
+{
+    const RandomHistory h(1, 45);
+    const int32_t longWindows[] = { 26, 120 };
+    for(size_t w = 0; w < 2; ++w)
+    {
+        SigMACDSpec spec;
+        spec.short_window = 12;
+        spec.long_window = longWindows[w];
+        spec.mid_window = 9;
+        const BatchSignalOutput out = BatchSignalEval().evalMACD(spec, h.ref);
+        BOOST_REQUIRE_EQUAL(out.names.size(), 3u);
+
+        OnlineFeed feed(h);
+        boost::shared_ptr<SigMACD> sig(new SigMACD(feed.cc, feed.ref, spec.short_window,
+            spec.long_window, spec.mid_window, "macd", false));
+        OnlineStates online;
+        for(size_t r = 0; r < NumRows; ++r)
+        {
+            feed.ref->set(h.ref.px[r], h.ref.pxOK[r], h.ref.times[r]);
+            online.read(r, *sig);
+        }
+
+        size_t numOKDiffs = 0;
+        for(size_t r = 0; r < NumRows; ++r)
+            checkOK("SigMACD", out, r, online.ok[r], numOKDiffs);
+        for(size_t k = 0; k < 3; ++k)
+        {
+            ColumnCheck col("SigMACD", k);
+            for(size_t r = 0; r < NumRows; ++r)
+                col.check(r, out.column(k)[r], online.at(k, r));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ChunkFailuresAreRethrown)
+{
+    struct Throws
+    {
+        static void chunk(size_t begin, size_t)
+        {
+            if(begin == BatchSignalEval::BlockRows)
+                throw 42;   // not a std::exception
+        }
+    };
+    std::vector<size_t> starts;
+    for(size_t r = 0; r < NumRows; r += BatchSignalEval::BlockRows)
+        starts.push_back(r);
+    BOOST_CHECK_THROW(BatchSignalEval(NumThreads).forEachChunk(starts, NumRows, &Throws::chunk), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
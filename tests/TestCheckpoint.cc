@@ -0,0 +1,221 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SignalCheckpoint.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+timeval_t tvAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/// The spec a filter is tracked under.  It stands in for SigKalmanFilterSpec, whose input
+/// provider spec this tree cannot build.  The checkpointer only hashes it, so it carries a
+/// revision that a test can change.
+class FilterKeySpec
+    : public ISignalSpec
+    , public SpecHashCache<FilterKeySpec>
+{
+public:
+    FilterKeySpec(const std::string &desc, int revision) : m_desc(desc), m_revision(revision) {}
+
+    virtual instrument_t getInstrument() const { return instrument_t::fromString("SYN0"); }
+    virtual std::string getDescription() const { return m_desc; }
+    virtual ISignalPtr build(SignalBuilder *builder) const { return ISignalPtr(); }
+    virtual void checkValid() const { cacheHash(); }
+    virtual void hashCombine(size_t &result) const { boost::hash_combine(result, specHash()); }
+    virtual bool compare(const ISignalSpec *other) const
+    {
+        if(fastReject(other)) return false;
+        const FilterKeySpec *b = dynamic_cast<const FilterKeySpec*>(other);
+        if(!b) return false;
+        return m_desc == b->m_desc && m_revision == b->m_revision;
+    }
+    virtual void print(std::ostream &o, const LuaPrintSettings &ps) const { o << "FilterKeySpec(\"" << m_desc << "\")"; }
+    virtual void getDataRequirements(IDataRequirements *rqs) const {}
+    virtual FilterKeySpec *clone() const { return new FilterKeySpec(*this); }
+
+    void hashMembers(size_t &seed) const
+    {
+        boost::hash_combine(seed, m_desc);
+        boost::hash_combine(seed, m_revision);
+    }
+
+private:
+    std::string m_desc;
+    int m_revision;
+};
+
+/// Two Kalman filters on prices of their own, and the specs they are tracked under.
+struct Filters
+{
+    explicit Filters(int revision = 0) : cc(makeSyntheticClientContext())
+    {
+        SigKalmanFilterSpec spec;
+        spec.R = 1e-4;
+        spec.Q = 1e-6;
+        spec.step = 1;
+        const char *descs[] = { "kalman.a", "kalman.b" };
+        for(size_t i = 0; i < 2; ++i)
+        {
+            prices.push_back(SyntheticPriceProviderPtr(new SyntheticPriceProvider(instrument_t::fromString("SYN0"))));
+            signals.push_back(SigKalmanFilterPtr(new SigKalmanFilter(cc, descs[i], spec, prices[i], 0)));
+            specs.push_back(ISignalSpecCPtr(new FilterKeySpec(descs[i], revision)));
+        }
+    }
+
+    /// Prices first to last, the same on every Filters.
+    void feed(size_t first, size_t last)
+    {
+        for(size_t n = first; n < last; ++n)
+            for(size_t i = 0; i < prices.size(); ++i)
+                prices[i]->set(100.0 + 0.01 * double((n * (7 + i)) % 23), true, tvAt(int64_t(n) * 1000));
+    }
+
+    void track(SignalCheckpointer &cp) const
+    {
+        for(size_t i = 0; i < signals.size(); ++i)
+            BOOST_REQUIRE(cp.add(specs[i], signals[i]));
+    }
+
+    ClientContextPtr cc;
+    std::vector<SyntheticPriceProviderPtr> prices;
+    std::vector<SigKalmanFilterPtr> signals;
+    std::vector<ISignalSpecCPtr> specs;
+};
+
+void checkSameStates(const Filters &a, const Filters &b)
+{
+    for(size_t i = 0; i < a.signals.size(); ++i)
+    {
+        const std::vector<double> &sa = a.signals[i]->getSignalState(), &sb = b.signals[i]->getSignalState();
+        BOOST_CHECK_EQUAL_COLLECTIONS(sa.begin(), sa.end(), sb.begin(), sb.end());
+    }
+}
+
+/// A checkpoint holding payload for desc, copies times over, laid out as
+/// SignalCheckpointer::capture writes it.
+std::string oneEntryCheckpoint(const ISignalSpec &spec, const std::string &desc, const std::string &payload, size_t copies = 1)
+{
+    size_t hash = 0;
+    spec.hashCombine(hash);
+    SpecOutArchive ar;
+    ar.write(SignalCheckpointer::FormatVersion);
+    ar.write(tvAt(0));
+    ar.write(uint64_t(copies));
+    for(size_t c = 0; c < copies; ++c)
+    {
+        ar.write(desc);
+        ar.write(uint64_t(hash));
+        ar.write(uint32_t(1));
+        ar.write(payload);
+    }
+    return std::string("LBCHKPT\0", 8) + ar.buffer();
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(Checkpoint)
+
+BOOST_AUTO_TEST_CASE(RoundTripRestoresFilters)
+{
+    const std::string path = "TestCheckpoint.bin";
+    Filters live;
+    SignalCheckpointer cpLive;
+    live.track(cpLive);
+    live.feed(0, 500);
+    cpLive.checkpoint(tvAt(500000), path);
+
+    Filters restored;
+    SignalCheckpointer cpRestored;
+    restored.track(cpRestored);
+    const CheckpointRestoreResult result = cpRestored.restore(path);
+    std::remove(path.c_str());
+    BOOST_CHECK_EQUAL(result.captureTime, tvAt(500000));
+    BOOST_CHECK_EQUAL(result.numRestored, 2u);
+    BOOST_CHECK(result.specChanged.empty());
+    BOOST_CHECK(result.failed.empty());
+    BOOST_CHECK(result.notFound.empty());
+    checkSameStates(live, restored);
+
+    // the replayed filters carry on exactly as the live ones
+    live.feed(500, 600);
+    restored.feed(500, 600);
+    checkSameStates(live, restored);
+}
+
+BOOST_AUTO_TEST_CASE(ChangedSpecIsNotRestored)
+{
+    Filters live;
+    SignalCheckpointer cpLive;
+    live.track(cpLive);
+    live.feed(0, 100);
+    const std::string bytes = cpLive.capture(tvAt(100000));
+
+    Filters edited(1), fresh(1);
+    SignalCheckpointer cpEdited;
+    edited.track(cpEdited);
+    const CheckpointRestoreResult result = cpEdited.restoreFrom(bytes);
+    BOOST_CHECK_EQUAL(result.numRestored, 0u);
+    BOOST_REQUIRE_EQUAL(result.specChanged.size(), 2u);
+    BOOST_CHECK_EQUAL(result.specChanged[0], "kalman.a");
+    BOOST_CHECK_EQUAL(result.specChanged[1], "kalman.b");
+    BOOST_CHECK(result.failed.empty());
+    checkSameStates(edited, fresh);
+}
+
+BOOST_AUTO_TEST_CASE(TrailingBytesLeaveTheSignalAsItWas)
+{
+    Filters source;
+    source.feed(0, 100);
+    SpecOutArchive state;
+    source.signals[0]->writeCheckpoint(state);
+
+    Filters target, untouched;
+    target.feed(0, 10);
+    untouched.feed(0, 10);
+    SignalCheckpointer cp;
+    target.track(cp);
+    const CheckpointRestoreResult result =
+        cp.restoreFrom(oneEntryCheckpoint(*target.specs[0], "kalman.a", state.buffer() + '\0'));
+    BOOST_CHECK_EQUAL(result.numRestored, 0u);
+    BOOST_CHECK_EQUAL(result.failed.size(), 1u);
+    checkSameStates(target, untouched);
+
+    // nor does it throw the filter's history away: it still steps as the untouched one does
+    target.feed(10, 20);
+    untouched.feed(10, 20);
+    checkSameStates(target, untouched);
+}
+
+BOOST_AUTO_TEST_CASE(DuplicateDescriptionsAreRefused)
+{
+    Filters filters;
+    SignalCheckpointer cp;
+    filters.track(cp);
+    Filters other;
+    BOOST_CHECK_THROW(cp.add(other.specs[0], other.signals[0]), std::exception);
+
+    // and a second entry for a signal in the file is reported rather than passed over
+    SpecOutArchive state;
+    filters.signals[0]->writeCheckpoint(state);
+    const CheckpointRestoreResult result =
+        cp.restoreFrom(oneEntryCheckpoint(*filters.specs[0], "kalman.a", state.buffer(), 2));
+    BOOST_CHECK_EQUAL(result.numRestored, 1u);
+    BOOST_REQUIRE_EQUAL(result.failed.size(), 1u);
+    BOOST_CHECK_EQUAL(result.failed[0].compare(0, 9, "kalman.a:"), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
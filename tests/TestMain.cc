@@ -0,0 +1,2 @@
+#define BOOST_TEST_MODULE longbeach_signals
+#include <boost/test/included/unit_test.hpp>
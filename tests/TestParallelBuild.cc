@@ -0,0 +1,318 @@
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/signals/ParallelSignalBuild.h>
+#include <longbeach/signals/ShardedSignalEngine.h>
+#include <longbeach/signals/SignalArena.h>
+#include <longbeach/signals/SignalBuilder.h>
+#include <longbeach/signals/SignalEvalEngine.h>
+#include <longbeach/signals/SpecHashCache.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+/// A spec tree node hashing and validating like the real specs do: children first, then
+/// cacheHash(), with children shared between parents.
+class TreeSpec : public SpecHashCache<TreeSpec>
+{
+public:
+    explicit TreeSpec(int value) : m_value(value) {}
+
+    void checkValid() const
+    {
+        for(size_t i = 0; i < m_children.size(); ++i)
+            m_children[i]->checkValid();
+        cacheHash();
+    }
+
+    void hashMembers(size_t &seed) const
+    {
+        boost::hash_combine(seed, m_value);
+        for(size_t i = 0; i < m_children.size(); ++i)
+            boost::hash_combine(seed, m_children[i]->specHash());
+    }
+
+    int m_value;
+    std::vector<boost::shared_ptr<const TreeSpec> > m_children;
+};
+typedef boost::shared_ptr<TreeSpec> TreeSpecPtr;
+
+/// Roots over a few levels of heavily shared sub-specs; the same shape on every call.
+std::vector<TreeSpecPtr> makeForest()
+{
+    std::vector<TreeSpecPtr> leaves, mids, roots;
+    for(int i = 0; i < 16; ++i)
+        leaves.push_back(boost::make_shared<TreeSpec>(i));
+    for(int i = 0; i < 64; ++i)
+    {
+        mids.push_back(boost::make_shared<TreeSpec>(100 + i));
+        for(int k = 0; k < 4; ++k)
+            mids.back()->m_children.push_back(leaves[(i * 3 + k) % leaves.size()]);
+    }
+    for(int i = 0; i < 512; ++i)
+    {
+        roots.push_back(boost::make_shared<TreeSpec>(1000 + i));
+        for(int k = 0; k < 3; ++k)
+            roots.back()->m_children.push_back(mids[(i * 7 + k * 5) % mids.size()]);
+    }
+    return roots;
+}
+
+void validateAll(boost::barrier *start, const std::vector<TreeSpecPtr> *roots, size_t offset)
+{
+    start->wait();
+    for(size_t i = 0; i < roots->size(); ++i)
+        (*roots)[(i + offset) % roots->size()]->checkValid();
+}
+
+/// A signal that only records what it was built on: the signals it reads, wired in as
+/// EvalEngineNode upstreams like a wrapper's input, and its builder's client context.
+class WiredSignal
+    : public SignalStateImpl
+    , public EvalEngineNode
+{
+public:
+    WiredSignal(const instrument_t &instr, const std::string &desc, const ClientContext *pContext,
+                const std::vector<ISignalPtr> &upstream)
+        : SignalStateImpl(instr, desc)
+        , m_pContext(pContext)
+        , m_upstream(upstream)
+    {
+        for(size_t i = 0; i < m_upstream.size(); ++i)
+            addEvalUpstream(m_upstream[i].get());
+        allocState("v");
+    }
+
+    const ClientContext *getContext() const { return m_pContext; }
+    const std::vector<ISignalPtr> &getUpstream() const { return m_upstream; }
+
+protected:
+    void recomputeState() const {}
+    virtual void deliverNotification(const timeval_t &tv) { notifySignalListeners(tv); }
+
+private:
+    const ClientContext *m_pContext;
+    std::vector<ISignalPtr> m_upstream;
+};
+
+/// Spec of a WiredSignal; its children are built through the builder, so shared ones are
+/// interned like any sub-signal.
+class WiredSpec
+    : public ISignalSpec
+    , public SpecHashCache<WiredSpec>
+{
+public:
+    WiredSpec(const instrument_t &instr, const std::string &desc) : m_instr(instr), m_desc(desc) {}
+
+    virtual instrument_t getInstrument() const { return m_instr; }
+    virtual std::string getDescription() const { return m_desc; }
+
+    virtual ISignalPtr build(SignalBuilder *builder) const
+    {
+        std::vector<ISignalPtr> upstream;
+        for(size_t i = 0; i < m_children.size(); ++i)
+            upstream.push_back(builder->buildSignal(m_children[i]));
+        return makeSignalObject<WiredSignal>(m_instr, m_desc, builder->getClientContext().get(), upstream);
+    }
+
+    virtual void checkValid() const
+    {
+        for(size_t i = 0; i < m_children.size(); ++i)
+            m_children[i]->checkValid();
+        cacheHash();
+    }
+
+    virtual void hashCombine(size_t &result) const { boost::hash_combine(result, specHash()); }
+
+    virtual bool compare(const ISignalSpec *other) const
+    {
+        if(fastReject(other)) return false;
+        const WiredSpec *b = dynamic_cast<const WiredSpec*>(other);
+        if(!b) return false;
+        if(m_instr != b->m_instr || m_desc != b->m_desc || m_children.size() != b->m_children.size())
+            return false;
+        for(size_t i = 0; i < m_children.size(); ++i)
+            if(*m_children[i] != *b->m_children[i])
+                return false;
+        return true;
+    }
+
+    virtual void print(std::ostream &o, const LuaPrintSettings &ps) const { o << "WiredSpec(\"" << m_desc << "\")"; }
+    virtual void getDataRequirements(IDataRequirements *rqs) const {}
+    virtual WiredSpec *clone() const { return new WiredSpec(*this); }
+
+    void hashMembers(size_t &seed) const
+    {
+        boost::hash_combine(seed, m_desc);
+        for(size_t i = 0; i < m_children.size(); ++i)
+            boost::hash_combine(seed, *m_children[i]);
+    }
+
+    instrument_t m_instr;
+    std::string m_desc;
+    std::vector<ISignalSpecCPtr> m_children;
+};
+typedef boost::shared_ptr<WiredSpec> WiredSpecPtr;
+
+/// Roots on a few instruments, each over children of its own instrument that several roots
+/// share.  The same specs (by value) on every call.
+std::vector<ISignalSpecCPtr> makeWiredUniverse()
+{
+    std::vector<ISignalSpecCPtr> roots;
+    for(int k = 0; k < 6; ++k)
+    {
+        std::ostringstream name;
+        name << "SYN" << k;
+        const instrument_t instr = instrument_t::fromString(name.str());
+        std::vector<WiredSpecPtr> leaves;
+        for(int i = 0; i < 4; ++i)
+        {
+            std::ostringstream desc;
+            desc << name.str() << ".leaf" << i;
+            leaves.push_back(boost::make_shared<WiredSpec>(instr, desc.str()));
+        }
+        for(int i = 0; i < 5; ++i)
+        {
+            std::ostringstream desc;
+            desc << name.str() << ".root" << i;
+            WiredSpecPtr root = boost::make_shared<WiredSpec>(instr, desc.str());
+            root->m_children.push_back(leaves[i % leaves.size()]);
+            root->m_children.push_back(leaves[(i + 1) % leaves.size()]);
+            // rebuilt rather than shared, so the builder has to intern it by value
+            WiredSpecPtr copy(leaves[(i + 2) % leaves.size()]->clone());
+            root->m_children.push_back(copy);
+            roots.push_back(root);
+        }
+    }
+    return roots;
+}
+
+/// A builder on a fresh client context for every worker.
+boost::shared_ptr<SignalBuilder> syntheticBuilder(size_t)
+{
+    return makeSyntheticBuilder(makeSyntheticClientContext());
+}
+
+/// The graph of signals: each one's description, and its upstreams' descriptions and
+/// identities, numbered in order of first appearance, so two graphs compare equal when they
+/// are wired alike whatever their addresses.  Every upstream must be on its reader's context.
+std::vector<std::string> describeWiring(const std::vector<ISignalPtr> &signals)
+{
+    std::map<const ISignal*, size_t> idOf;
+    std::vector<std::string> lines;
+    for(size_t i = 0; i < signals.size(); ++i)
+    {
+        const WiredSignal *sig = dynamic_cast<const WiredSignal*>(signals[i].get());
+        BOOST_REQUIRE(sig);
+        std::ostringstream line;
+        line << sig->getDesc() << "#" << idOf.insert(std::make_pair(sig, idOf.size())).first->second << " <-";
+        for(size_t u = 0; u < sig->getUpstream().size(); ++u)
+        {
+            const WiredSignal *up = dynamic_cast<const WiredSignal*>(sig->getUpstream()[u].get());
+            BOOST_REQUIRE(up);
+            BOOST_CHECK(up->getContext() == sig->getContext());
+            line << " " << up->getDesc() << "#" << idOf.insert(std::make_pair(up, idOf.size())).first->second;
+        }
+        lines.push_back(line.str());
+    }
+    return lines;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(ParallelBuild)
+
+BOOST_AUTO_TEST_CASE(SharedSubSpecHashesMatchSerialValidation)
+{
+    const std::vector<TreeSpecPtr> serial = makeForest();
+    for(size_t i = 0; i < serial.size(); ++i)
+        serial[i]->checkValid();
+
+    for(size_t round = 0; round < 20; ++round)
+    {
+        // every thread validates every root, from a different starting point, so each shared
+        // sub-spec is cached by several threads at once
+        const size_t numThreads = 8;
+        const std::vector<TreeSpecPtr> parallel = makeForest();
+        boost::barrier start(numThreads);
+        boost::thread_group threads;
+        for(size_t t = 0; t < numThreads; ++t)
+            threads.create_thread(boost::bind(&validateAll, &start, &parallel, t * parallel.size() / numThreads));
+        threads.join_all();
+
+        for(size_t i = 0; i < serial.size(); ++i)
+        {
+            BOOST_REQUIRE(parallel[i]->isHashCached());
+            BOOST_CHECK_EQUAL(parallel[i]->specHash(), serial[i]->specHash());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CachedHashEqualsRecomputedHash)
+{
+    const std::vector<TreeSpecPtr> cached = makeForest(), fresh = makeForest();
+    for(size_t i = 0; i < cached.size(); ++i)
+        cached[i]->checkValid();
+    for(size_t i = 0; i < fresh.size(); ++i)
+    {
+        BOOST_REQUIRE(!fresh[i]->isHashCached());
+        BOOST_CHECK_EQUAL(cached[i]->specHash(), fresh[i]->specHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ParallelBuildWiresLikeSerialBuild)
+{
+    const size_t numWorkers = 4;
+    const std::vector<ISignalSpecCPtr> specs = makeWiredUniverse();
+
+    // the reference: one builder per worker, each building its specs in input order, in turn
+    const std::vector<size_t> workerOf = ShardedSignalEngine::assignShards(specs, numWorkers);
+    std::vector<ISignalPtr> serial(specs.size());
+    for(size_t w = 0; w < numWorkers; ++w)
+    {
+        boost::shared_ptr<SignalBuilder> builder = syntheticBuilder(w);
+        for(size_t i = 0; i < specs.size(); ++i)
+            if(workerOf[i] == w)
+                serial[i] = builder->buildSignal(specs[i]);
+    }
+    const std::vector<std::string> expected = describeWiring(serial);
+
+    for(size_t round = 0; round < 5; ++round)
+    {
+        const std::vector<ISignalSpecCPtr> fresh = makeWiredUniverse();
+        ParallelSignalBuild pb(numWorkers);
+        const std::vector<ISignalPtr> parallel = pb.build(&syntheticBuilder, fresh);
+        BOOST_REQUIRE_EQUAL(parallel.size(), fresh.size());
+        for(size_t i = 0; i < parallel.size(); ++i)
+        {
+            BOOST_REQUIRE(parallel[i]);
+            BOOST_CHECK_EQUAL(parallel[i]->getDesc(), fresh[i]->getDescription());
+            BOOST_CHECK_EQUAL(pb.getWorkerOf(i), workerOf[i]);
+            BOOST_CHECK(dynamic_cast<const WiredSignal&>(*parallel[i]).getContext()
+                == pb.getBuilder(workerOf[i])->getClientContext().get());
+        }
+        BOOST_CHECK(describeWiring(parallel) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BuildersSharingAContextAreRefused)
+{
+    const ClientContextPtr cc = makeSyntheticClientContext();
+    const std::vector<ISignalSpecCPtr> specs = makeWiredUniverse();
+    ParallelSignalBuild pb(2);
+    BOOST_CHECK_THROW(pb.build(boost::bind(&makeSyntheticBuilder, cc), specs), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
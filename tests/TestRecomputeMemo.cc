@@ -0,0 +1,119 @@
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include <longbeach/signals/RecomputeMemo.h>
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+timeval_t tvAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+RecomputeMemo::Key keyOf(uint64_t version, int64_t us)
+{
+    RecomputeMemo::Key key;
+    key.add(version).add(tvAt(us));
+    return key;
+}
+
+/// A five level book around mid, a cent apart, one lot more on each level down.
+void setBook(SyntheticBook &book, double mid, const timeval_t &tv)
+{
+    std::vector<double> bidPx, bidSz, askPx, askSz;
+    for(size_t l = 0; l < 5; ++l)
+    {
+        bidPx.push_back(mid - 0.005 - 0.01 * l);
+        askPx.push_back(mid + 0.005 + 0.01 * l);
+        bidSz.push_back(100.0 * (l + 1));
+        askSz.push_back(100.0 * (l + 2));
+    }
+    book.set(bidPx, bidSz, askPx, askSz, true, tv, 0, 0);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(RecomputeMemoTests)
+
+BOOST_AUTO_TEST_CASE(CheckCommitInvalidate)
+{
+    RecomputeMemo memo;
+    BOOST_CHECK_EQUAL(memo.getHitRate(), 0.0);
+
+    // nothing committed yet
+    BOOST_CHECK(!memo.check(keyOf(1, 10)));
+    memo.commit(keyOf(1, 10));
+    BOOST_CHECK(memo.check(keyOf(1, 10)));
+    BOOST_CHECK(memo.check(keyOf(1, 10)));
+
+    // any part of the key moving is a miss, and so is a key of another shape
+    BOOST_CHECK(!memo.check(keyOf(2, 10)));
+    BOOST_CHECK(!memo.check(keyOf(1, 11)));
+    RecomputeMemo::Key shorter;
+    shorter.add(uint64_t(1));
+    BOOST_CHECK(!memo.check(shorter));
+
+    // a miss does not replace the committed key; only commit does
+    BOOST_CHECK(memo.check(keyOf(1, 10)));
+    memo.invalidate();
+    BOOST_CHECK(!memo.check(keyOf(1, 10)));
+    memo.commit(keyOf(1, 10));
+    BOOST_CHECK(memo.check(keyOf(1, 10)));
+
+    BOOST_CHECK_EQUAL(memo.getNumHits(), 4u);
+    BOOST_CHECK_EQUAL(memo.getNumMisses(), 5u);
+    BOOST_CHECK_CLOSE(memo.getHitRate(), 4.0 / 9.0, 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyKeysAreEqual)
+{
+    RecomputeMemo memo;
+    memo.commit(RecomputeMemo::Key());
+    BOOST_CHECK(memo.check(RecomputeMemo::Key()));
+}
+
+BOOST_AUTO_TEST_CASE(SigBookSkipsRepeatedReads)
+{
+    const ClientContextPtr cc = makeSyntheticClientContext();
+    const instrument_t instr = instrument_t::fromString("SYN0");
+    const SyntheticBookPtr book(new SyntheticBook(instr));
+    const SyntheticPriceProviderPtr ref(new SyntheticPriceProvider(instr));
+    const SigBookPtr sig(new SigBook(instr, "sigbook", cc->getClockMonitor(), ref, book, 5, 9, 0, ARITH));
+    // the same signal read only once per change, for what recomputing gives
+    const SigBookPtr twin(new SigBook(instr, "twin", cc->getClockMonitor(), ref, book, 5, 9, 0, ARITH));
+    const RecomputeMemo &memo = sig->getRecomputeMemo();
+
+    ref->set(100.0, true, tvAt(1000));
+    setBook(*book, 100.0, tvAt(1000));
+    const std::vector<double> first = sig->getSignalState();
+    BOOST_REQUIRE(sig->isOK());
+    const uint64_t hits = memo.getNumHits(), misses = memo.getNumMisses();
+
+    // nothing moved: the second read is a hit and gives the same state
+    BOOST_CHECK(sig->getSignalState() == first);
+    BOOST_CHECK_EQUAL(memo.getNumHits(), hits + 1);
+    BOOST_CHECK_EQUAL(memo.getNumMisses(), misses);
+
+    // the book moves: recomputed
+    setBook(*book, 100.02, tvAt(2000));
+    const std::vector<double> second = sig->getSignalState();
+    BOOST_CHECK_EQUAL(memo.getNumMisses(), misses + 1);
+    BOOST_CHECK(second != first);
+    BOOST_CHECK(second == twin->getSignalState());
+
+    // and so does the reference price alone
+    ref->set(100.01, true, tvAt(3000));
+    const std::vector<double> third = sig->getSignalState();
+    BOOST_CHECK_EQUAL(memo.getNumMisses(), misses + 2);
+    BOOST_CHECK(third != second);
+    BOOST_CHECK(third == twin->getSignalState());
+    BOOST_CHECK_EQUAL(memo.getNumHits(), hits + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
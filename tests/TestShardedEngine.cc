@@ -0,0 +1,273 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/signals/ShardedSignalEngine.h>
+#include <longbeach/signals/SigMACD.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+// run() never builds, so no shard needs a builder
+boost::shared_ptr<SignalBuilder> noBuilder(size_t)
+{
+    return boost::shared_ptr<SignalBuilder>();
+}
+
+/// A feed per shard: each step posts the shard's next sequence number to every other shard;
+/// some of what a shard receives it echoes to shard 0, whose feed is the shortest, so work
+/// keeps arriving there after it is done.
+struct Feeds
+{
+    typedef std::pair<size_t, uint64_t> received_t; // (from shard, seq)
+
+    Feeds(ShardedSignalEngine *e, const std::vector<uint64_t> &lengths)
+        : engine(e), length(lengths), seq(lengths.size(), 0)
+        , received(lengths.size()), numEchoes(0), numMisplaced(0) {}
+
+    bool step(size_t shard)
+    {
+        const uint64_t n = seq[shard]++;
+        for(size_t to = 0; to < length.size(); ++to)
+            if(to != shard)
+                engine->post(shard, to, boost::bind(&Feeds::receive, this, to, shard, n));
+        return seq[shard] < length[shard];
+    }
+
+    void receive(size_t shard, size_t from, uint64_t n)
+    {
+        if(engine->getCurrentShard() != shard)
+            ++numMisplaced;     // checked once run() is over; Boost.Test is not thread-safe
+        received[shard].push_back(received_t(from, n));
+        if(shard != 0 && n % 7 == 0)
+            engine->post(shard, 0, boost::bind(&Feeds::echo, this));
+    }
+
+    void echo()     // only on shard 0
+    {
+        if(engine->getCurrentShard() != 0)
+            ++numMisplaced;
+        ++numEchoes;
+    }
+
+    /// What shard got from one producer, in arrival order.
+    std::vector<uint64_t> receivedFrom(size_t shard, size_t from) const
+    {
+        std::vector<uint64_t> out;
+        for(size_t i = 0; i < received[shard].size(); ++i)
+            if(received[shard][i].first == from)
+                out.push_back(received[shard][i].second);
+        return out;
+    }
+
+    ShardedSignalEngine *engine;
+    std::vector<uint64_t> length, seq;
+    std::vector<std::vector<received_t> > received;
+    uint64_t numEchoes;
+    std::atomic<uint64_t> numMisplaced;
+};
+
+std::vector<uint64_t> feedLengths()
+{
+    std::vector<uint64_t> lengths;
+    lengths.push_back(1);
+    lengths.push_back(3000);
+    lengths.push_back(1500);
+    lengths.push_back(2500);
+    return lengths;
+}
+
+timeval_t timeAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/// The states a signal went through, one entry per notification.
+class StateTrace : public IEvalNotificationObserver
+{
+public:
+    virtual void onSignalNotified(const ISignal *sig, const timeval_t &tv)
+    {
+        states.push_back(sig->getSignalState());
+    }
+
+    std::vector<std::vector<double> > states;
+};
+
+/// The prices shard s feeds, the same in every run: a random walk from its own seed.
+double priceAt(size_t shard, uint64_t n)
+{
+    uint64_t x = (shard + 1) * 0x9e3779b97f4a7c15ULL;
+    double px = 100.0 + shard;
+    for(uint64_t i = 0; i <= n; ++i)
+    {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        px += (int64_t(x >> 61) - 3) * 0.01;
+    }
+    return px;
+}
+
+/// On every shard, a SigMACD on the shard's own price, and one on the price of the shard
+/// before it, relayed across.  Everything a shard's signals see arrives on its own thread, and
+/// both signals only read a single input, so their notifications must follow a single-threaded
+/// run of the same prices exactly.
+struct MacdUniverse
+{
+    MacdUniverse(ShardedSignalEngine *e, const std::vector<uint64_t> &lengths)
+        : engine(e), length(lengths), seq(lengths.size(), 0), traces(2 * lengths.size())
+    {
+        const size_t n = lengths.size();
+        for(size_t s = 0; s < n; ++s)
+        {
+            std::ostringstream name;
+            name << "SYN" << s;
+            contexts.push_back(makeSyntheticClientContext());
+            prices.push_back(boost::make_shared<SyntheticPriceProvider>(instrument_t::fromString(name.str())));
+        }
+        for(size_t s = 0; s < n; ++s)
+        {
+            const size_t from = (s + n - 1) % n;
+            addSignal(s, prices[s], "local");
+            addSignal(s, engine ? engine->relayPrice(from, prices[from], s) : IPriceProviderPtr(prices[from]), "relayed");
+        }
+    }
+
+    void addSignal(size_t shard, const IPriceProviderPtr &pxp, const std::string &what)
+    {
+        std::ostringstream desc;
+        desc << "macd." << what << shard;
+        boost::shared_ptr<SigMACD> sig(new SigMACD(contexts[shard], pxp, 5, 13, 4, desc.str(), false));
+        sig->addNotificationObserver(&traces[signals.size()]);
+        signals.push_back(sig);
+    }
+
+    bool step(size_t shard)
+    {
+        const uint64_t n = seq[shard]++;
+        prices[shard]->set(priceAt(shard, n), n % 11 != 5, timeAt(int64_t(n) * 1000));
+        return seq[shard] < length[shard];
+    }
+
+    ~MacdUniverse()
+    {
+        for(size_t i = 0; i < signals.size(); ++i)
+            signals[i]->removeNotificationObserver(&traces[i]);
+    }
+
+    ShardedSignalEngine *engine;    // NULL: one thread, relayed signals read the source directly
+    std::vector<uint64_t> length, seq;
+    std::vector<ClientContextPtr> contexts;
+    std::vector<SyntheticPriceProviderPtr> prices;
+    std::vector<boost::shared_ptr<SigMACD> > signals;
+    std::vector<StateTrace> traces;
+};
+
+/// Posts work to its own shard from within a step, and checks it only runs after the step.
+struct SelfPoster
+{
+    SelfPoster(ShardedSignalEngine *e, size_t numShards)
+        : engine(e), inStep(numShards, false), numSteps(numShards, 0), numRun(numShards, 0), numInline(0), numMisplaced(0) {}
+
+    bool step(size_t shard)
+    {
+        inStep[shard] = true;
+        engine->post(shard, shard, boost::bind(&SelfPoster::run, this, shard));
+        inStep[shard] = false;
+        return ++numSteps[shard] < 1000;
+    }
+
+    void run(size_t shard)
+    {
+        if(inStep[shard])
+            ++numInline;
+        if(engine->getCurrentShard() != shard)
+            ++numMisplaced;
+        ++numRun[shard];
+    }
+
+    ShardedSignalEngine *engine;
+    std::vector<char> inStep;       // not vector<bool>: each shard writes its own entry
+    std::vector<uint64_t> numSteps, numRun;
+    std::atomic<uint64_t> numInline, numMisplaced;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(ShardedEngine)
+
+BOOST_AUTO_TEST_CASE(PostedWorkArrivesInOrderAndNoneIsLost)
+{
+    const std::vector<uint64_t> lengths = feedLengths();
+    // tiny queues, so most posts go through the backlog
+    ShardedSignalEngine engine(lengths.size(), &noBuilder, 2);
+    Feeds feeds(&engine, lengths);
+    engine.run(boost::bind(&Feeds::step, &feeds, _1));
+    BOOST_CHECK_EQUAL(feeds.numMisplaced.load(), 0u);
+
+    uint64_t expectedEchoes = 0;
+    for(size_t shard = 0; shard < lengths.size(); ++shard)
+    {
+        for(size_t from = 0; from < lengths.size(); ++from)
+        {
+            if(from == shard)
+                continue;
+            const std::vector<uint64_t> got = feeds.receivedFrom(shard, from);
+            BOOST_REQUIRE_EQUAL(got.size(), lengths[from]);
+            for(uint64_t n = 0; n < got.size(); ++n)
+                BOOST_REQUIRE_EQUAL(got[n], n);
+            if(shard != 0)
+                expectedEchoes += (lengths[from] + 6) / 7;
+        }
+    }
+    // shard 0 finished its feed after one step, yet took every echo
+    BOOST_CHECK_EQUAL(feeds.numEchoes, expectedEchoes);
+}
+
+BOOST_AUTO_TEST_CASE(RunsAreReproducible)
+{
+    const std::vector<uint64_t> lengths = feedLengths();
+    MacdUniverse serial(NULL, lengths);
+    for(size_t s = 0; s < lengths.size(); ++s)
+        while(serial.step(s)) {}
+
+    for(size_t run = 0; run < 5; ++run)
+    {
+        ShardedSignalEngine engine(lengths.size(), &noBuilder, 16);
+        MacdUniverse sharded(&engine, lengths);
+        engine.run(boost::bind(&MacdUniverse::step, &sharded, _1));
+
+        // every signal, its own price's and the relayed ones alike, went through the states
+        // the single-threaded run did, whatever the interleaving
+        for(size_t i = 0; i < serial.traces.size(); ++i)
+        {
+            BOOST_REQUIRE(!serial.traces[i].states.empty());
+            BOOST_CHECK_MESSAGE(sharded.traces[i].states == serial.traces[i].states,
+                sharded.signals[i]->getDesc() << " differs from the single-threaded run");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(WorkPostedToOwnShardRunsAfterTheStep)
+{
+    const size_t numShards = 3;
+    ShardedSignalEngine engine(numShards, &noBuilder, 4);
+    SelfPoster poster(&engine, numShards);
+    engine.run(boost::bind(&SelfPoster::step, &poster, _1));
+    BOOST_CHECK_EQUAL(poster.numInline.load(), 0u);
+    BOOST_CHECK_EQUAL(poster.numMisplaced.load(), 0u);
+    for(size_t s = 0; s < numShards; ++s)
+        BOOST_CHECK_EQUAL(poster.numRun[s], poster.numSteps[s]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,184 @@
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBatchEngine.h>
+#include <longbeach/signals/SignalsPriority.h>
+#include <longbeach/signals/SyntheticInputs.h>
+#include <longbeach/signals/SyntheticMarket.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const size_t NumLevels = 5;
+const size_t NumVars = 9;
+const char *const Instruments[] = { "SYN0", "SYN1", "SYN2" };
+
+timeval_t tvAt(int64_t us)
+{
+    return timeval_t() + boost::posix_time::microseconds(us);
+}
+
+/// The states a signal went through, one entry per notification; throws from the first
+/// notification after throwOnNext is set.
+class StateTrace : public IEvalNotificationObserver
+{
+public:
+    StateTrace() : throwOnNext(false) {}
+
+    virtual void onSignalNotified(const ISignal *sig, const timeval_t &tv)
+    {
+        states.push_back(sig->getSignalState());
+        if(throwOnNext)
+        {
+            throwOnNext = false;
+            throw std::runtime_error("listener failed");
+        }
+    }
+
+    bool throwOnNext;
+    std::vector<std::vector<double> > states;
+};
+
+/// Instruments each with a synthetic market, a book and a reference price, and on them a
+/// SigBook in the engine next to one without.
+struct Universe
+{
+    Universe(size_t numInstruments, ReturnMode mode)
+        : cc(makeSyntheticClientContext())
+        , engine(cc->getEventDistributor(), PRIORITY_SIGNALS_Signal)
+        , traces(numInstruments)
+    {
+        for(size_t i = 0; i < numInstruments; ++i)
+        {
+            SyntheticMarketConfig config;
+            config.depth = NumLevels;
+            config.tradeFraction = 0.0;
+            config.seed = 11 + i;
+            markets.push_back(boost::shared_ptr<SyntheticMarket>(new SyntheticMarket(config)));
+            const instrument_t instr = instrument_t::fromString(Instruments[i]);
+            books.push_back(SyntheticBookPtr(new SyntheticBook(instr)));
+            refs.push_back(SyntheticPriceProviderPtr(new SyntheticPriceProvider(instr)));
+            batched.push_back(SigBookPtr(new SigBook(instr, "batched", cc->getClockMonitor(), refs[i], books[i],
+                NumLevels, NumVars, 0, mode)));
+            plain.push_back(SigBookPtr(new SigBook(instr, "plain", cc->getClockMonitor(), refs[i], books[i],
+                NumLevels, NumVars, 0, mode)));
+            batched[i]->attachBatchEngine(&engine);
+            batched[i]->addNotificationObserver(&traces[i]);
+        }
+    }
+
+    ~Universe()
+    {
+        for(size_t i = 0; i < batched.size(); ++i)
+            batched[i]->removeNotificationObserver(&traces[i]);
+    }
+
+    /// Row r of instrument i: the reference price, which notifies at once, then the book.  Every
+    /// 53rd row the price is not ok, every 97th the book.
+    void feed(size_t i, size_t r)
+    {
+        SyntheticMarket &m = *markets[i];
+        while(m.next() != SyntheticMarket::BOOK_UPDATE)
+            ;
+        const timeval_t tv = tvAt(m.getTimeUs());
+        refs[i]->set(m.getMid(), (r + i) % 53 != 0, tv);
+        books[i]->set(m.getPrices(0), m.getSizes(0), m.getPrices(1), m.getSizes(1), (r + i) % 97 != 0, tv, 0, 0);
+    }
+
+    /// Whether the batched signal on instrument i reads as the plain one, to the bit.
+    bool same(size_t i) const
+    {
+        const std::vector<double> &b = batched[i]->getSignalState(), &p = plain[i]->getSignalState();
+        return batched[i]->isOK() == plain[i]->isOK() && b == p;
+    }
+
+    ClientContextPtr cc;
+    SigBookBatchEngine engine;
+    std::vector<boost::shared_ptr<SyntheticMarket> > markets;
+    std::vector<SyntheticBookPtr> books;
+    std::vector<SyntheticPriceProviderPtr> refs;
+    std::vector<SigBookPtr> batched, plain;
+    std::vector<StateTrace> traces;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(SigBookBatch)
+
+BOOST_AUTO_TEST_CASE(BatchedMatchesUnbatched)
+{
+    const ReturnMode modes[] = { DIFF, ARITH, LOG };
+    for(size_t m = 0; m < 3; ++m)
+    {
+        Universe u(3, modes[m]);
+        BOOST_CHECK_EQUAL(u.engine.getNumGroups(), 1u);
+        size_t numDiffs = 0;
+        for(size_t r = 0; r < 2000; ++r)
+        {
+            // not every instrument on every event, so the lanes vary from flush to flush
+            for(size_t i = 0; i < 3; ++i)
+                if(i == 0 || (r + i) % 3 != 0)
+                    u.feed(i, r);
+            u.engine.flush();
+            for(size_t i = 0; i < 3; ++i)
+                if(!u.same(i) && numDiffs++ == 0)
+                    BOOST_ERROR("mode " << m << ": instrument " << i << " differs first at row " << r);
+        }
+        BOOST_CHECK_EQUAL(numDiffs, 0u);
+        BOOST_CHECK_GT(u.engine.getNumEvaluated(), 2000u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ThrowingListenerLeavesTheRestDirty)
+{
+    Universe u(3, ARITH);
+    for(size_t i = 0; i < 3; ++i)
+        u.feed(i, 1);
+    u.engine.flush();
+
+    // lanes go in the order the books changed, so the first one's listener cuts off the rest
+    std::vector<size_t> numBefore;
+    for(size_t i = 0; i < 3; ++i)
+    {
+        u.feed(i, 2);
+        numBefore.push_back(u.traces[i].states.size());
+    }
+    u.traces[0].throwOnNext = true;
+    BOOST_CHECK_THROW(u.engine.flush(), std::runtime_error);
+    BOOST_CHECK_EQUAL(u.traces[0].states.size(), numBefore[0] + 1);
+    BOOST_CHECK_EQUAL(u.traces[1].states.size(), numBefore[1]);
+    BOOST_CHECK_EQUAL(u.traces[2].states.size(), numBefore[2]);
+
+    // the next flush notifies the others, and only them
+    u.engine.flush();
+    for(size_t i = 0; i < 3; ++i)
+    {
+        BOOST_CHECK_EQUAL(u.traces[i].states.size(), numBefore[i] + 1);
+        BOOST_CHECK(u.same(i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DetachNotifiesThePendingChange)
+{
+    Universe u(1, LOG);
+    u.feed(0, 1);
+    u.engine.flush();
+
+    u.feed(0, 2);
+    const size_t numBefore = u.traces[0].states.size();
+    u.batched[0]->attachBatchEngine(NULL);
+    BOOST_REQUIRE_EQUAL(u.traces[0].states.size(), numBefore + 1);
+    BOOST_CHECK(u.traces[0].states.back() == u.plain[0]->getSignalState());
+    BOOST_CHECK(u.same(0));
+
+    // the engine no longer has it
+    u.engine.flush();
+    BOOST_CHECK_EQUAL(u.traces[0].states.size(), numBefore + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,196 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/signals/SigKalmanFilter.h>
+#include <longbeach/signals/SignalGroup.h>
+#include <longbeach/signals/SignalsPriority.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+timeval_t tvOf(uint64_t n)
+{
+    return timeval_t() + boost::posix_time::milliseconds(long(n));
+}
+
+/// Event n: the price every member reads, which is bad now and then.
+double pxOf(uint64_t n)
+{
+    return 100.0 + 0.01 * double((n * 13) % 29);
+}
+
+bool okOf(uint64_t n)
+{
+    return n % 41 != 0;
+}
+
+/// Three Kalman filters of different gains on one price, so that every event moves all of
+/// them, and the group over them.
+struct Members
+{
+    Members() : cc(makeSyntheticClientContext()), price(new SyntheticPriceProvider(instrument_t::fromString("SYN0")))
+    {
+        const double R[] = { 1e-4, 1e-3, 1e-2 };
+        const char *descs[] = { "kalman.a", "kalman.b", "kalman.c" };
+        for(size_t i = 0; i < 3; ++i)
+        {
+            SigKalmanFilterSpec spec;
+            spec.R = R[i];
+            spec.Q = 1e-6;
+            spec.step = 1;
+            signals.push_back(ISignalPtr(new SigKalmanFilter(cc, descs[i], spec, price, 0)));
+        }
+        group.reset(new SignalGroup(cc->getEventDistributor(), PRIORITY_SIGNALS_Signal, signals));
+    }
+
+    /// Event n, then the publish its scheduled work would run.
+    void event(uint64_t n, bool publish = true)
+    {
+        price->set(pxOf(n), okOf(n), tvOf(n));
+        if(publish)
+            group->publish();
+    }
+
+    /// The members' states and isOK now, laid out as a frame.
+    void expect(SignalGroupFrame &frame) const
+    {
+        frame.matrix.clear();
+        frame.ok.clear();
+        for(size_t i = 0; i < signals.size(); ++i)
+        {
+            const std::vector<double> &state = signals[i]->getSignalState();
+            frame.matrix.insert(frame.matrix.end(), state.begin(), state.end());
+            frame.ok.push_back(signals[i]->isOK());
+        }
+    }
+
+    ClientContextPtr cc;
+    SyntheticPriceProviderPtr price;
+    std::vector<ISignalPtr> signals;
+    boost::scoped_ptr<SignalGroup> group;
+};
+
+bool sameStates(const SignalGroupFrame &a, const SignalGroupFrame &b)
+{
+    return a.matrix == b.matrix && a.ok == b.ok;
+}
+
+/// A writer running events through a group while readers check every frame they take
+/// against what a single-threaded run of the same events published under that epoch.
+struct Stress
+{
+    Stress(size_t numReaders, uint64_t numEvents)
+        : start(numReaders + 1), numEvents(numEvents), expected(size_t(numEvents))
+        , bDone(false), numReads(0), numBusy(0), numWrong(0), numBackwards(0)
+    {
+        Members reference;
+        for(uint64_t n = 1; n <= numEvents; ++n)
+        {
+            reference.event(n);
+            reference.expect(expected[n - 1]);
+        }
+    }
+
+    void write()
+    {
+        start.wait();
+        for(uint64_t n = 1; n <= numEvents; ++n)
+            live.event(n);
+        bDone.store(true);
+    }
+
+    /// Every other reader gives up after two torn copies rather than retrying.
+    void read(size_t reader)
+    {
+        SignalGroupFrame frame;
+        uint64_t last = 0;
+        start.wait();
+        while(!bDone.load())
+        {
+            const bool got = reader % 2 ? live.group->tryRead(frame, 2) : live.group->read(frame);
+            if(!got)
+            {
+                if(live.group->getEpoch() != 0)
+                    ++numBusy;
+                continue;
+            }
+            ++numReads;
+            // checked once the threads are joined; Boost.Test is not thread-safe
+            if(frame.epoch == 0 || frame.epoch > numEvents || !sameStates(frame, expected[frame.epoch - 1]))
+                ++numWrong;
+            if(frame.epoch < last)
+                ++numBackwards;
+            last = frame.epoch;
+        }
+    }
+
+    Members live;
+    boost::barrier start;
+    const uint64_t numEvents;
+    std::vector<SignalGroupFrame> expected;
+    std::atomic<bool> bDone;
+    std::atomic<uint64_t> numReads, numBusy, numWrong, numBackwards;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(SignalGroupFrames)
+
+BOOST_AUTO_TEST_CASE(FrameHoldsOneEventUnderOneEpoch)
+{
+    Members m;
+    SignalGroupFrame frame, expected;
+    BOOST_CHECK(!m.group->read(frame));
+    BOOST_CHECK_EQUAL(m.group->getEpoch(), 0u);
+
+    for(uint64_t n = 1; n <= 100; ++n)
+    {
+        m.event(n);
+        m.expect(expected);
+        BOOST_REQUIRE(m.group->read(frame));
+        BOOST_CHECK_EQUAL(frame.epoch, n);
+        BOOST_CHECK(sameStates(frame, expected));
+    }
+
+    // the members move on, but until the publish the frame is still the last event's
+    m.event(101, false);
+    BOOST_REQUIRE(m.group->read(frame));
+    BOOST_CHECK_EQUAL(frame.epoch, 100u);
+    BOOST_CHECK(sameStates(frame, expected));
+
+    m.group->publish();
+    m.expect(expected);
+    BOOST_REQUIRE(m.group->tryRead(frame, 1));
+    BOOST_CHECK_EQUAL(frame.epoch, 101u);
+    BOOST_CHECK(sameStates(frame, expected));
+    BOOST_CHECK_EQUAL(frame.rowSize(0), m.signals[0]->getStateSize());
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentReadersSeeWholeFrames)
+{
+    const size_t numReaders = 4;
+    Stress stress(numReaders, 20000);
+    boost::thread_group threads;
+    for(size_t r = 0; r < numReaders; ++r)
+        threads.create_thread(boost::bind(&Stress::read, &stress, r));
+    threads.create_thread(boost::bind(&Stress::write, &stress));
+    threads.join_all();
+
+    BOOST_CHECK_GT(stress.numReads.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.numWrong.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.numBackwards.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.live.group->getEpoch(), 20000u);
+    BOOST_TEST_MESSAGE("reads: " << stress.numReads.load() << ", given up: " << stress.numBusy.load());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
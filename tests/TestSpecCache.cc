@@ -0,0 +1,202 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <longbeach/signals/AsyncSignal.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigMACD.h>
+#include <longbeach/signals/SpecCache.h>
+#include <longbeach/signals/SyntheticInputs.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const uint64_t ConfigKey = 0x5eed5eed5eedULL;
+
+/// A cache file and a Lua state to load it with, both cleaned up afterwards.  The specs have
+/// native fields only, so loading never evaluates anything in the state.
+struct CacheFixture
+{
+    CacheFixture()
+        : path("TestSpecCache.bin"), pState(luaL_newstate())
+    {
+        for(int32_t i = 0; i < 3; ++i)
+        {
+            boost::shared_ptr<SigMACDSpec> spec(new SigMACDSpec());
+            spec->m_description = "macd" + std::string(1, char('a' + i));
+            spec->short_window = 5 + i;
+            spec->long_window = 20 + i;
+            spec->mid_window = 9 + i;
+            specs.push_back(spec);
+        }
+        SpecCache::save(path, ConfigKey, specs);
+        contents = readFile();
+    }
+
+    ~CacheFixture()
+    {
+        std::remove(path.c_str());
+        lua_close(pState);
+    }
+
+    std::string readFile() const
+    {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string &data) const
+    {
+        std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+    }
+
+    bool load(std::vector<ISignalSpecPtr> &loaded, uint64_t key = ConfigKey)
+    {
+        return SpecCache::load(path, key, *pState, loaded);
+    }
+
+    std::string path;
+    lua_State *pState;
+    std::vector<ISignalSpecCPtr> specs;
+    std::string contents;
+};
+
+/// Runs a config snippet ending in a return of a spec.
+ISignalSpecPtr evalSpec(lua_State &L, const std::string &script)
+{
+    if(luaL_dostring(&L, script.c_str()) != 0)
+    {
+        const std::string err = lua_tostring(&L, -1);
+        lua_pop(&L, 1);
+        BOOST_FAIL("config snippet failed: " << err);
+    }
+    const luabind::object obj(luabind::from_stack(&L, -1));
+    lua_pop(&L, 1);
+    return luabind::object_cast<ISignalSpecPtr>(obj);
+}
+
+size_t hashOf(const ISignalSpec &spec)
+{
+    size_t h = 0;
+    spec.hashCombine(h);
+    return h;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(SpecCacheSubSpecs)
+
+// the book is written as its Lua text and evaluated again at load; the SigBookBiasL2Spec under
+// the AsyncSignalSpec is written natively
+BOOST_AUTO_TEST_CASE(SpecsWithSubSpecsRoundTrip)
+{
+    const std::string path = "TestSpecCacheSubSpecs.bin";
+    lua_State *pConfig = makeSyntheticLuaState();
+    const std::string bias =
+        "local s = SigBookBiasL2Spec()\n"
+        "s.description = \"biasl2\"\n"
+        "s.book = " + syntheticBookSpecLua("SYN0", "SIM") + "\n"
+        "s.lambda = 0.5\n"
+        "s.max_levels = 10\n"
+        "s.min_level_weight = 0.01\n";
+    std::vector<ISignalSpecCPtr> specs;
+    specs.push_back(evalSpec(*pConfig, bias + "return s\n"));
+    specs.push_back(evalSpec(*pConfig, bias +
+        "local a = AsyncSignalSpec()\n"
+        "a.subSignal = s\n"
+        "a.pollPriority = 3\n"
+        "return a\n"));
+    lua_close(pConfig);
+
+    BOOST_REQUIRE(dynamic_cast<const SigBookBiasL2Spec&>(*specs[0]).m_book);
+    SpecCache::save(path, ConfigKey, specs);
+
+    // a fresh state, as a later run has: nothing of the config script is left in it
+    lua_State *pLoad = makeSyntheticLuaState();
+    std::vector<ISignalSpecPtr> loaded;
+    const bool ok = SpecCache::load(path, ConfigKey, *pLoad, loaded);
+    std::remove(path.c_str());
+    BOOST_REQUIRE(ok);
+    BOOST_REQUIRE_EQUAL(loaded.size(), specs.size());
+    for(size_t i = 0; i < specs.size(); ++i)
+    {
+        BOOST_CHECK(loaded[i]->compare(specs[i].get()));
+        BOOST_CHECK(specs[i]->compare(loaded[i].get()));
+        BOOST_CHECK_EQUAL(hashOf(*loaded[i]), hashOf(*specs[i]));
+        BOOST_CHECK_EQUAL(loaded[i]->getDescription(), specs[i]->getDescription());
+    }
+    const SigBookBiasL2Spec &book = dynamic_cast<const SigBookBiasL2Spec&>(*loaded[0]);
+    BOOST_REQUIRE(book.m_book);
+    BOOST_CHECK(*book.m_book == *dynamic_cast<const SigBookBiasL2Spec&>(*specs[0]).m_book);
+    BOOST_CHECK_EQUAL(book.getInstrument(), specs[0]->getInstrument());
+    lua_close(pLoad);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_FIXTURE_TEST_SUITE(SpecCacheFile, CacheFixture)
+
+BOOST_AUTO_TEST_CASE(RoundTripGivesEqualSpecs)
+{
+    std::vector<ISignalSpecPtr> loaded;
+    BOOST_REQUIRE(load(loaded));
+    BOOST_REQUIRE_EQUAL(loaded.size(), specs.size());
+    for(size_t i = 0; i < specs.size(); ++i)
+    {
+        BOOST_CHECK(loaded[i]->compare(specs[i].get()));
+        BOOST_CHECK_EQUAL(loaded[i]->getDescription(), specs[i]->getDescription());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(OtherConfigKeyIsRefused)
+{
+    std::vector<ISignalSpecPtr> loaded;
+    BOOST_CHECK(!load(loaded, ConfigKey + 1));
+    BOOST_CHECK(loaded.empty());
+}
+
+BOOST_AUTO_TEST_CASE(TruncatedFileIsRefusedWithoutThrowing)
+{
+    for(size_t size = 0; size < contents.size(); ++size)
+    {
+        writeFile(contents.substr(0, size));
+        std::vector<ISignalSpecPtr> loaded;
+        bool ok = true;
+        BOOST_REQUIRE_NO_THROW(ok = load(loaded));
+        BOOST_CHECK_MESSAGE(!ok && loaded.empty(), "loaded a cache cut to " << size << " bytes");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TrailingDataIsRefused)
+{
+    writeFile(contents + '\0');
+    std::vector<ISignalSpecPtr> loaded;
+    bool ok = true;
+    BOOST_REQUIRE_NO_THROW(ok = load(loaded));
+    BOOST_CHECK(!ok);
+    BOOST_CHECK(loaded.empty());
+}
+
+BOOST_AUTO_TEST_CASE(CorruptBytesAreRefusedWithoutThrowing)
+{
+    // every byte after the magic in turn; any change either fails to decode or to hash back
+    for(size_t i = 8; i < contents.size(); ++i)
+    {
+        std::string corrupt(contents);
+        corrupt[i] = char(~corrupt[i]);
+        writeFile(corrupt);
+        std::vector<ISignalSpecPtr> loaded;
+        bool ok = true;
+        BOOST_REQUIRE_NO_THROW(ok = load(loaded));
+        BOOST_CHECK_MESSAGE(!ok && loaded.empty(), "loaded a cache with byte " << i << " flipped");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <longbeach/core/LuabindScripting.h>
+
+#include <longbeach/signals/SpecHashCache.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+/// The smallest spec with a memoized hash: one revision number, settable from Lua.
+class KeySpec
+    : public ISignalSpec
+    , public SpecHashCache<KeySpec>
+{
+public:
+    explicit KeySpec(int revision = 0) : m_revision(revision) {}
+
+    virtual instrument_t getInstrument() const { return instrument_t::fromString("SYN0"); }
+    virtual std::string getDescription() const { return "key"; }
+    virtual ISignalPtr build(SignalBuilder *builder) const { return ISignalPtr(); }
+    virtual void checkValid() const { cacheHash(); }
+    virtual void hashCombine(size_t &result) const { boost::hash_combine(result, specHash()); }
+    virtual bool compare(const ISignalSpec *other) const
+    {
+        if(fastReject(other)) return false;
+        const KeySpec *b = dynamic_cast<const KeySpec*>(other);
+        return b && m_revision == b->m_revision;
+    }
+    virtual void print(std::ostream &o, const LuaPrintSettings &ps) const { o << "KeySpec(" << m_revision << ")"; }
+    virtual void getDataRequirements(IDataRequirements *rqs) const {}
+    virtual KeySpec *clone() const { return new KeySpec(*this); }
+
+    void hashMembers(size_t &seed) const { boost::hash_combine(seed, m_revision); }
+
+    // to get at the protected assignment
+    KeySpec &operator=(const KeySpec &e) { SpecHashCache<KeySpec>::operator=(e); m_revision = e.m_revision; return *this; }
+
+    int m_revision;
+};
+
+/// A KeySpec of a subclass; it compares as the KeySpec it is.
+class TaggedKeySpec : public KeySpec
+{
+public:
+    explicit TaggedKeySpec(int revision) : KeySpec(revision) {}
+    virtual TaggedKeySpec *clone() const { return new TaggedKeySpec(*this); }
+};
+
+size_t hashOfRevision(int revision)
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, revision);
+    return seed;
+}
+
+/// A Lua state with KeySpec bound, as a config script would edit it.
+struct LuaFixture
+{
+    LuaFixture() : L(luaL_newstate())
+    {
+        luabind::open(L);
+        luabind::module(L)
+        [
+            luabind::class_<KeySpec, boost::shared_ptr<KeySpec> >("KeySpec")
+                .def_readwrite("revision", &KeySpec::m_revision)
+        ];
+    }
+    ~LuaFixture() { lua_close(L); }
+
+    void run(const std::string &script)
+    {
+        if(luaL_dostring(L, script.c_str()) != 0)
+        {
+            const std::string err = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            BOOST_FAIL("script failed: " << err);
+        }
+    }
+
+    lua_State *L;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(SpecHashCacheTests)
+
+BOOST_AUTO_TEST_CASE(CheckValidCachesTheHash)
+{
+    KeySpec a(3);
+    BOOST_CHECK(!a.isHashCached());
+    BOOST_CHECK_EQUAL(a.specHash(), hashOfRevision(3));
+    a.checkValid();
+    BOOST_CHECK(a.isHashCached());
+    BOOST_CHECK_EQUAL(a.specHash(), hashOfRevision(3));
+
+    // copies, clones and assignments start uncached, with the same hash
+    const KeySpec copy(a);
+    BOOST_CHECK(!copy.isHashCached());
+    BOOST_CHECK_EQUAL(copy.specHash(), a.specHash());
+    const boost::scoped_ptr<KeySpec> clone(a.clone());
+    BOOST_CHECK(!clone->isHashCached());
+    KeySpec assigned(5);
+    assigned.checkValid();
+    assigned = a;
+    BOOST_CHECK(!assigned.isHashCached());
+    BOOST_CHECK_EQUAL(assigned.specHash(), hashOfRevision(3));
+}
+
+BOOST_AUTO_TEST_CASE(CompareWithAndWithoutCachedHashes)
+{
+    KeySpec a(1), same(1), other(2);
+    BOOST_CHECK(a.compare(&same));
+    BOOST_CHECK(!a.compare(&other));
+    BOOST_CHECK(!a.compare(NULL));
+
+    // one side cached: the full compare decides
+    a.checkValid();
+    BOOST_CHECK(a.compare(&same));
+    BOOST_CHECK(!a.compare(&other));
+    // both cached
+    same.checkValid();
+    other.checkValid();
+    BOOST_CHECK(a.compare(&same));
+    BOOST_CHECK(!a.compare(&other));
+}
+
+BOOST_AUTO_TEST_CASE(SubclassSpecsStillCompareEqual)
+{
+    KeySpec a(1);
+    TaggedKeySpec tagged(1), taggedOther(2);
+    a.checkValid();
+    tagged.checkValid();
+    taggedOther.checkValid();
+    // another class is never rejected on the hash alone; compare's dynamic_cast takes it
+    BOOST_CHECK(a.compare(&tagged));
+    BOOST_CHECK(!a.compare(&taggedOther));
+}
+
+BOOST_AUTO_TEST_CASE(LuaEditAfterCheckValidLeavesTheHashStale)
+{
+    LuaFixture lua;
+    const boost::shared_ptr<KeySpec> spec(new KeySpec(1));
+    spec->checkValid();
+    luabind::globals(lua.L)["k"] = spec;
+    lua.run("k.revision = 7");
+    BOOST_REQUIRE_EQUAL(spec->m_revision, 7);
+
+    // nothing saw the edit: the hash is still that of revision 1
+    BOOST_CHECK(spec->isHashCached());
+    BOOST_CHECK_EQUAL(spec->specHash(), hashOfRevision(1));
+    BOOST_CHECK(spec->specHash() != hashOfRevision(7));
+
+    // so a validated spec the edit made equal is rejected on the stale hash
+    KeySpec seven(7);
+    seven.checkValid();
+    BOOST_CHECK(!spec->compare(&seven));
+    // while one not validated yet still gets the full compare
+    const KeySpec unchecked(7);
+    BOOST_CHECK(spec->compare(&unchecked));
+
+    // validating again brings the hash up to date
+    spec->checkValid();
+    BOOST_CHECK_EQUAL(spec->specHash(), hashOfRevision(7));
+    BOOST_CHECK(spec->compare(&seven));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
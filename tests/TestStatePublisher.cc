@@ -0,0 +1,123 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <longbeach/signals/SignalStatePublisher.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const size_t StateSize = 37;    // enough words that a copy spans several cache lines
+
+/// Publish n carries n in every element, isOK = n is odd and a change time of n seconds, so
+/// any mix of two publishes in one snapshot shows.
+timeval_t tvOf(uint64_t n)
+{
+    return timeval_t() + boost::posix_time::seconds(long(n));
+}
+
+struct Stress
+{
+    Stress(size_t numReaders, uint64_t numPublishes)
+        : publisher(StateSize), start(numReaders + 1), numPublishes(numPublishes)
+        , bDone(false), numReads(0), numTorn(0), numBackwards(0) {}
+
+    void write()
+    {
+        std::vector<double> state(StateSize);
+        start.wait();
+        for(uint64_t n = 1; n <= numPublishes; ++n)
+        {
+            std::fill(state.begin(), state.end(), double(n));
+            publisher.publish(state, n & 1, tvOf(n));
+        }
+        bDone.store(true);
+    }
+
+    void read()
+    {
+        SignalStateSnapshot snap;
+        uint64_t last = 0;
+        start.wait();
+        while(!bDone.load())
+        {
+            if(!publisher.read(snap))
+                continue;
+            ++numReads;
+            const uint64_t n = snap.version;
+            bool torn = snap.isOK != bool(n & 1) || snap.lastChangeTv != tvOf(n);
+            for(size_t i = 0; i < snap.state.size(); ++i)
+                torn = torn || snap.state[i] != double(n);
+            if(torn)
+                ++numTorn;      // checked once the threads are joined; Boost.Test is not thread-safe
+            if(n < last)
+                ++numBackwards;
+            last = n;
+        }
+    }
+
+    SignalStatePublisher publisher;
+    boost::barrier start;
+    const uint64_t numPublishes;
+    std::atomic<bool> bDone;
+    std::atomic<uint64_t> numReads, numTorn, numBackwards;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(StatePublisher)
+
+BOOST_AUTO_TEST_CASE(NothingPublishedReadsFalse)
+{
+    SignalStatePublisher publisher(StateSize);
+    SignalStateSnapshot snap;
+    BOOST_CHECK(!publisher.read(snap));
+    BOOST_CHECK_EQUAL(publisher.getVersion(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ShortStateIsPaddedAndLongStateTruncated)
+{
+    SignalStatePublisher publisher(3);
+    SignalStateSnapshot snap;
+    publisher.publish(std::vector<double>(1, 5.0), true, tvOf(7));
+    BOOST_REQUIRE(publisher.read(snap));
+    BOOST_CHECK_EQUAL(snap.version, 1u);
+    BOOST_CHECK(snap.isOK);
+    BOOST_CHECK(snap.lastChangeTv == tvOf(7));
+    BOOST_REQUIRE_EQUAL(snap.state.size(), 3u);
+    BOOST_CHECK_EQUAL(snap.state[0], 5.0);
+    BOOST_CHECK_EQUAL(snap.state[2], 0.0);
+
+    publisher.publish(std::vector<double>(5, 2.0), false, tvOf(8));
+    BOOST_REQUIRE(publisher.read(snap));
+    BOOST_CHECK_EQUAL(snap.version, 2u);
+    BOOST_CHECK(!snap.isOK);
+    BOOST_CHECK_EQUAL(snap.state.size(), 3u);
+    BOOST_CHECK_EQUAL(snap.state[2], 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentReadersNeverSeeATornOrOlderState)
+{
+    const size_t numReaders = 4;
+    Stress stress(numReaders, 500000);
+    boost::thread_group threads;
+    for(size_t r = 0; r < numReaders; ++r)
+        threads.create_thread(boost::bind(&Stress::read, &stress));
+    threads.create_thread(boost::bind(&Stress::write, &stress));
+    threads.join_all();
+
+    BOOST_CHECK_GT(stress.numReads.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.numTorn.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.numBackwards.load(), 0u);
+    BOOST_CHECK_EQUAL(stress.publisher.getVersion(), 500000u);
+    BOOST_TEST_MESSAGE("reads: " << stress.numReads.load() << ", retries: " << stress.publisher.getNumRetries());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,185 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math.h>
+#include <vector>
+
+#include <longbeach/signals/SigBook.h>
+#include <longbeach/signals/SigBookBiasL2.h>
+#include <longbeach/signals/SigBookSizeBias.h>
+#include <longbeach/signals/SyntheticMarket.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const double TickSize = 0.01;
+
+/// A synthetic market whose levels sit on the tick grid.
+SyntheticMarketConfig gridMarket(size_t depth, uint64_t seed)
+{
+    SyntheticMarketConfig config;
+    config.depth = depth;
+    config.tickSize = TickSize;
+    config.initialMid = 100.005;    // levels at mid -/+ half a tick
+    config.topOfBookFraction = 0.5;
+    config.midMoveFraction = 0.05;
+    config.seed = seed;
+    return config;
+}
+
+void checkClose(double tick, double dbl, double relTol, const char *what, size_t event)
+{
+    BOOST_CHECK_MESSAGE(fabs(tick - dbl) <= relTol * std::max(1.0, fabs(dbl)),
+        what << " at event " << event << ": tick mode " << tick << ", double mode " << dbl);
+}
+
+/// Prices and sizes a little off the grid, as a feed's doubles may be.
+std::vector<double> jitter(const std::vector<double> &v, double scale, size_t seed)
+{
+    std::vector<double> out(v);
+    for(size_t i = 0; i < out.size(); ++i)
+        out[i] += ((seed + i) % 3 == 0 ? 1 : -1) * scale * ((seed * 7 + i) % 5);
+    return out;
+}
+
+/// SigBook's vars with the online kernels, in tick mode if tickSize > 0; false if not ok.
+bool sigBookVars(size_t numLevels, double tickSize, double refpx,
+                 const std::vector<double> &bpx, const std::vector<double> &bsz,
+                 const std::vector<double> &apx, const std::vector<double> &asz, std::vector<double> &vars)
+{
+    std::vector<double> bavg(numLevels), aavg(numLevels);
+    size_t failed;
+    if(SigBook::cumulativePrices(&bpx[0], &bsz[0], numLevels, tickSize, 1.0, &bavg[0], failed) != SigBook::CUMULATIVE_OK
+        || SigBook::cumulativePrices(&apx[0], &asz[0], numLevels, tickSize, 1.0, &aavg[0], failed) != SigBook::CUMULATIVE_OK)
+        return false;
+    vars.assign(2 * numLevels - 1, 0.0);
+    SigBook::varsFromPrices(&bavg[0], &aavg[0], numLevels, refpx, &vars[0]);
+    return true;
+}
+
+SigBookBiasL2Spec biasL2Spec(double tickSize, uint32_t maxLevels, double maxRelDistance)
+{
+    SigBookBiasL2Spec spec;
+    spec.m_lambda = 0.5;
+    spec.m_tickSize = tickSize;
+    spec.m_sizeUnit = 1.0;
+    spec.m_maxLevels = maxLevels;
+    spec.m_maxRelDistance = maxRelDistance;
+    return spec;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(TickMode)
+
+BOOST_AUTO_TEST_CASE(SigBookTickModeMatchesDoubleMode)
+{
+    const size_t numLevels = 5;
+    SyntheticMarket m(gridMarket(numLevels, 11));
+    std::vector<double> tickVars, dblVars;
+    for(size_t e = 0; e < 20000; ++e)
+    {
+        m.next();
+        const double refpx = m.getMid();
+        const bool tickOK = sigBookVars(numLevels, TickSize, refpx,
+            m.getPrices(0), m.getSizes(0), m.getPrices(1), m.getSizes(1), tickVars);
+        const bool dblOK = sigBookVars(numLevels, 0.0, refpx,
+            m.getPrices(0), m.getSizes(0), m.getPrices(1), m.getSizes(1), dblVars);
+        BOOST_REQUIRE(tickOK && dblOK);
+        for(size_t i = 0; i < dblVars.size(); ++i)
+            checkClose(tickVars[i], dblVars[i], 1e-12, "SigBook var", e);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SigBookTickModeIgnoresJitter)
+{
+    const size_t numLevels = 5;
+    SyntheticMarket m(gridMarket(numLevels, 12));
+    std::vector<double> exact, jittered;
+    for(size_t e = 0; e < 5000; ++e)
+    {
+        m.next();
+        const double refpx = m.getMid();
+        BOOST_REQUIRE(sigBookVars(numLevels, TickSize, refpx,
+            m.getPrices(0), m.getSizes(0), m.getPrices(1), m.getSizes(1), exact));
+        BOOST_REQUIRE(sigBookVars(numLevels, TickSize, refpx,
+            jitter(m.getPrices(0), 1e-9, e), jitter(m.getSizes(0), 1e-7, e),
+            jitter(m.getPrices(1), 1e-9, e + 1), jitter(m.getSizes(1), 1e-7, e + 1), jittered));
+        // the point of the tick mode: the same book to the tick gives the same bits
+        for(size_t i = 0; i < exact.size(); ++i)
+            BOOST_CHECK_EQUAL(exact[i], jittered[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SigBookTickModeFailsOnOverflowAndEmptyLevels)
+{
+    const double px[] = { 1e6, 1e6 - 1e-8 };
+    const double sz[] = { 1e9, 1e9 };
+    double avg[2];
+    size_t failed = 99;
+    // 1e14 ticks times 1e17 lots does not fit in 63 bits
+    BOOST_CHECK_EQUAL(SigBook::cumulativePrices(px, sz, 2, 1e-8, 1e-8, avg, failed), SigBook::CUMULATIVE_OVERFLOW);
+    BOOST_CHECK_EQUAL(failed, 0u);
+
+    const double huge[] = { 1e30, 1e30 };
+    BOOST_CHECK_EQUAL(SigBook::cumulativePrices(huge, sz, 2, 0.01, 1.0, avg, failed), SigBook::CUMULATIVE_OVERFLOW);
+
+    const double small[] = { 0.4, 0.3 };
+    BOOST_CHECK_EQUAL(SigBook::cumulativePrices(px, small, 2, 0.01, 1.0, avg, failed), SigBook::CUMULATIVE_NO_SIZE);
+    BOOST_CHECK_EQUAL(failed, 0u);
+
+    int64_t pxsz = 0, ttl = 0;
+    BOOST_CHECK(SigBook::accumulateLevelTicks(pxsz, ttl, 1000000, 1000));
+    BOOST_CHECK(!SigBook::accumulateLevelTicks(pxsz, ttl, int64_t(1) << 40, int64_t(1) << 40));
+}
+
+BOOST_AUTO_TEST_CASE(BiasL2TickModeMatchesDoubleMode)
+{
+    const size_t depth = 40;
+    const uint32_t maxLevels[] = { 0, 10 };
+    const double maxRelDistance[] = { 0.0, 0.001 };
+    for(size_t c = 0; c < 2; ++c)
+    {
+        const SigBookBiasL2::Params tick(biasL2Spec(TickSize, maxLevels[c], maxRelDistance[c]));
+        const SigBookBiasL2::Params dbl(biasL2Spec(0.0, maxLevels[c], maxRelDistance[c]));
+        SyntheticMarket m(gridMarket(depth, 21 + c));
+        for(size_t e = 0; e < 10000; ++e)
+        {
+            m.next();
+            const std::vector<double> &bpx = m.getPrices(0), &bsz = m.getSizes(0);
+            const std::vector<double> &apx = m.getPrices(1), &asz = m.getSizes(1);
+            const double midpx = (bpx[0] + apx[0]) / 2;
+            const double t = SigBookBiasL2::evalLevels(tick, midpx, tick.lambda,
+                &bpx[0], &bsz[0], depth, &apx[0], &asz[0], depth);
+            const double d = SigBookBiasL2::evalLevels(dbl, midpx, dbl.lambda,
+                &bpx[0], &bsz[0], depth, &apx[0], &asz[0], depth);
+            checkClose(t, d, 1e-9, "SigBookBiasL2 bias", e);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SizeBiasTickModeMatchesDoubleMode)
+{
+    const size_t depth = 5;
+    SyntheticMarket m(gridMarket(depth, 31));
+    for(size_t e = 0; e < 10000; ++e)
+    {
+        m.next();
+        const std::vector<double> &bsz = m.getSizes(0), &asz = m.getSizes(1);
+        const std::vector<double> bj = jitter(bsz, 1e-7, e), aj = jitter(asz, 1e-7, e + 1);
+        for(size_t l = 0; l < depth; ++l)
+        {
+            const double power[] = { 0.0, 0.5 };
+            for(size_t p = 0; p < 2; ++p)
+            {
+                // whole lots: the snap changes nothing
+                const double d = SigBookSizeBias::levelImbalance(bsz[l], asz[l], power[p], 0.0);
+                BOOST_CHECK_EQUAL(SigBookSizeBias::levelImbalance(bsz[l], asz[l], power[p], 1.0), d);
+                BOOST_CHECK_EQUAL(SigBookSizeBias::levelImbalance(bj[l], aj[l], power[p], 1.0), d);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,147 @@
+#include <boost/test/unit_test.hpp>
+
+#include <math.h>
+#include <vector>
+
+#include <longbeach/signals/SyntheticInputs.h>
+#include <longbeach/signals/VolatilityProvider.h>
+
+using namespace longbeach;
+using namespace longbeach::signals;
+
+namespace {
+
+const double Tolerance = 1e-10;     // percent, for BOOST_CHECK_CLOSE
+
+/// A clock and a book to build providers on; the tests feed changes through update.
+struct VolFixture
+{
+    VolFixture()
+        : cc(makeSyntheticClientContext())
+        , book(new SyntheticBook(instrument_t::fromString("SYN0")))
+    {
+    }
+
+    VolatilityProviderPtr make(VolatilityProvider::Mode mode, int windowSecs) const
+    {
+        return VolatilityProviderPtr(new VolatilityProvider(cc->getClockMonitor(), book, mode,
+            boost::posix_time::seconds(windowSecs), boost::posix_time::seconds(1)));
+    }
+
+    ClientContextPtr cc;
+    SyntheticBookPtr book;
+};
+
+/// A change per sample that is not periodic in any small window.
+double changeAt(size_t n)
+{
+    return 0.01 * double(int((n * 37) % 11) - 5);
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(Volatility)
+
+BOOST_AUTO_TEST_CASE(EwmaSeedsOnTheFirstChangeThenDecays)
+{
+    VolFixture f;
+    const VolatilityProviderPtr vol = f.make(VolatilityProvider::EWMA, 10);
+    BOOST_CHECK(!vol->isReady());
+    BOOST_CHECK_EQUAL(vol->getVolatility(), 0.0);
+
+    // the first change is the average, not alpha times it
+    vol->update(2.0);
+    BOOST_CHECK(vol->isReady());
+    BOOST_CHECK_EQUAL(vol->getVolatility(), 2.0);
+
+    // with no further moves the variance decays by exp(-period / window) a sample
+    vol->update(0.0);
+    BOOST_CHECK_CLOSE(vol->getVolatility(), 2.0 * exp(-0.05), Tolerance);
+
+    const double alpha = 1.0 - exp(-0.1);
+    double var = 4.0 * exp(-0.1);
+    for(size_t n = 0; n < 100; ++n)
+    {
+        const double c = changeAt(n);
+        vol->update(c);
+        var += alpha * (c * c - var);
+    }
+    BOOST_CHECK_CLOSE(vol->getVolatility(), sqrt(var), Tolerance);
+    BOOST_CHECK_EQUAL(vol->getNumChanges(), 102u);
+}
+
+BOOST_AUTO_TEST_CASE(WindowAveragesTheLastChangesAcrossLaps)
+{
+    VolFixture f;
+    const size_t window = 4;
+    const VolatilityProviderPtr vol = f.make(VolatilityProvider::WINDOW, int(window));
+
+    // before the ring fills, over the changes seen so far
+    vol->update(1.0);
+    vol->update(2.0);
+    vol->update(3.0);
+    BOOST_CHECK_CLOSE(vol->getVolatility(), sqrt(14.0 / 3), Tolerance);
+    // filling it wraps and re-sums
+    vol->update(4.0);
+    BOOST_CHECK_CLOSE(vol->getVolatility(), sqrt(30.0 / 4), Tolerance);
+    // then the oldest drops out
+    vol->update(5.0);
+    BOOST_CHECK_CLOSE(vol->getVolatility(), sqrt(54.0 / 4), Tolerance);
+
+    // many laps on, still the plain mean over the last four
+    std::vector<double> changes;
+    changes.push_back(2.0);
+    changes.push_back(3.0);
+    changes.push_back(4.0);
+    changes.push_back(5.0);
+    size_t numDiffs = 0;
+    for(size_t n = 0; n < 1001; ++n)
+    {
+        changes.push_back(changeAt(n));
+        vol->update(changes.back());
+        double sum = 0.0;
+        for(size_t k = changes.size() - window; k < changes.size(); ++k)
+            sum += changes[k] * changes[k];
+        const double expected = sqrt(sum / window);
+        if(fabs(vol->getVolatility() - expected) > 1e-12 * (1.0 + expected) && numDiffs++ == 0)
+            BOOST_ERROR("change " << n << ": " << vol->getVolatility() << ", expected " << expected);
+    }
+    BOOST_CHECK_EQUAL(numDiffs, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(WindowShorterThanThePeriodIsRefused)
+{
+    VolFixture f;
+    BOOST_CHECK_THROW(VolatilityProvider(f.cc->getClockMonitor(), f.book, VolatilityProvider::WINDOW,
+        boost::posix_time::milliseconds(500), boost::posix_time::seconds(1)), std::exception);
+}
+
+BOOST_AUTO_TEST_CASE(GetSharedHandsOutOneProviderPerBook)
+{
+    VolFixture f;
+    const ClockMonitorPtr cm = f.cc->getClockMonitor();
+    const ptime_duration_t window = boost::posix_time::seconds(30), period = boost::posix_time::seconds(1);
+
+    VolatilityProviderPtr a = VolatilityProvider::getShared(cm, f.book, VolatilityProvider::EWMA, window, period);
+    VolatilityProviderPtr b = VolatilityProvider::getShared(cm, f.book, VolatilityProvider::EWMA, window, period);
+    BOOST_CHECK(a == b);
+    a->update(1.0);
+    BOOST_CHECK_EQUAL(b->getNumChanges(), 1u);
+
+    // any parameter apart gives a provider of its own
+    BOOST_CHECK(a != VolatilityProvider::getShared(cm, f.book, VolatilityProvider::WINDOW, window, period));
+    BOOST_CHECK(a != VolatilityProvider::getShared(cm, f.book, VolatilityProvider::EWMA,
+        boost::posix_time::seconds(60), period));
+    // and so does another book on the same instrument and source
+    const SyntheticBookPtr other(new SyntheticBook(f.book->getInstrument(), f.book->getSource()));
+    BOOST_CHECK(a != VolatilityProvider::getShared(cm, other, VolatilityProvider::EWMA, window, period));
+
+    // once nobody holds it, the next caller starts afresh
+    a.reset();
+    BOOST_CHECK_EQUAL(b->getNumChanges(), 1u);
+    b.reset();
+    const VolatilityProviderPtr c = VolatilityProvider::getShared(cm, f.book, VolatilityProvider::EWMA, window, period);
+    BOOST_CHECK_EQUAL(c->getNumChanges(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()